@@ -0,0 +1,72 @@
+/**
+ * @file   Arena.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the arena allocator of the verilog IR.
+ */
+
+#include "llvm/Support/CommandLine.h"
+
+#include "Arena.h"
+
+
+namespace verilog
+{
+
+static llvm::cl::opt<bool> UseArena("verilog-arena",
+		llvm::cl::desc("Allocate verilog IR objects in a per-module arena"),
+		llvm::cl::init(true));
+
+
+Arena::Arena() : bump_allocation(UseArena)
+{
+}
+
+void *Arena::allocate(size_t size, size_t alignment)
+{
+	statistics.num_bytes += size;
+
+	// One heap allocation per object
+	if (!bump_allocation || size > chunk_size / 4)
+	{
+		char *memory = static_cast<char *>(::operator new(size));
+		chunks.push_back(memory);
+		statistics.num_heap_allocations++;
+		return memory;
+	}
+
+	// Align the current position
+	size_t padding = (alignment - reinterpret_cast<size_t>(current) %
+			alignment) % alignment;
+	if (!current || padding + size > remaining)
+	{
+		current = static_cast<char *>(::operator new(chunk_size));
+		remaining = chunk_size;
+		padding = 0;
+		chunks.push_back(current);
+		statistics.num_heap_allocations++;
+	}
+
+	// Bump
+	char *memory = current + padding;
+	current += padding + size;
+	remaining -= padding + size;
+	return memory;
+}
+
+void Arena::release()
+{
+	// Destroy objects in reverse order of creation
+	for (auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+		it->function(it->object);
+	destructors.clear();
+
+	// Free memory
+	for (char *chunk : chunks)
+		::operator delete(chunk);
+	chunks.clear();
+	current = nullptr;
+	remaining = 0;
+}
+
+}
@@ -0,0 +1,116 @@
+/**
+ * @file   Arena.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  Arena class contains a bump allocator owning the verilog IR objects
+ *         of a module, which are all released together.
+ */
+
+#ifndef VERILOG_ARENA_H
+#define VERILOG_ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace verilog
+{
+
+// Allocation counters of one or more arenas
+struct ArenaStatistics
+{
+	// Number of objects created
+	size_t num_objects = 0;
+
+	// Number of bytes requested for objects
+	size_t num_bytes = 0;
+
+	// Number of calls to the heap allocator
+	size_t num_heap_allocations = 0;
+
+	// Add the counters of another arena
+	void add(const ArenaStatistics &other)
+	{
+		num_objects += other.num_objects;
+		num_bytes += other.num_bytes;
+		num_heap_allocations += other.num_heap_allocations;
+	}
+};
+
+
+class Arena
+{
+	// Destructor of an object created in the arena
+	struct Destructor
+	{
+		void (*function)(void *object);
+		void *object;
+	};
+
+	// Size of the memory chunks taken from the heap
+	static const size_t chunk_size = 64 * 1024;
+
+	// Memory chunks, including objects bigger than a chunk
+	std::vector<char *> chunks;
+
+	// Free space in the current chunk
+	char *current = nullptr;
+	size_t remaining = 0;
+
+	// If false, every object gets its own heap allocation, as done before
+	// arenas were introduced. Used to compare both allocation schemes.
+	bool bump_allocation;
+
+	// Objects to destroy when the arena is released, in creation order
+	std::vector<Destructor> destructors;
+
+	// Allocation counters
+	ArenaStatistics statistics;
+
+	// Call the destructor of an object of type T
+	template<typename T> static void destroy(void *object)
+	{
+		static_cast<T *>(object)->~T();
+	}
+
+	// Return uninitialized memory for an object
+	void *allocate(size_t size, size_t alignment);
+
+public:
+
+	// Constructor. Bump allocation is enabled unless the command line
+	// option '-verilog-arena=false' is given.
+	Arena();
+
+	// Destructor, releasing all objects
+	~Arena() { release(); }
+
+	// Arenas own their objects and cannot be copied
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+
+	// Create an object in the arena. It is destroyed when the arena is
+	// released, and must not be deleted by the caller.
+	template<typename T, typename... Args> T *create(Args &&... args)
+	{
+		void *memory = allocate(sizeof(T), alignof(T));
+		T *object = new (memory) T(std::forward<Args>(args)...);
+		if (!std::is_trivially_destructible<T>::value)
+			destructors.push_back({ &destroy<T>, object });
+		statistics.num_objects++;
+		return object;
+	}
+
+	// Destroy all objects and return the memory to the heap
+	void release();
+
+	// Return the allocation counters
+	const ArenaStatistics &getStatistics() { return statistics; }
+};
+
+}
+
+#endif
@@ -0,0 +1,52 @@
+/**
+ * @file   Bits.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  Bit counting and extension helpers shared by the netlist passes.
+ */
+
+#ifndef VERILOG_BITS_H
+#define VERILOG_BITS_H
+
+
+namespace verilog
+{
+
+// Return the number of bits of an unsigned value, at least 1
+inline int getNumBits(unsigned long long value)
+{
+	int num_bits = 1;
+	while (value >>= 1)
+		num_bits++;
+	return num_bits;
+}
+
+
+// Return the base 2 logarithm of a power of two, or -1 for other values
+inline int getLog2(unsigned long long value)
+{
+	if (!value || (value & (value - 1)))
+		return -1;
+	return getNumBits(value) - 1;
+}
+
+
+// Return the low 'width' bits of a value
+inline unsigned long long truncate(unsigned long long value, int width)
+{
+	return width < 64 ? value & ((1ULL << width) - 1) : value;
+}
+
+
+// Return the low 'width' bits of a value, sign-extended
+inline long long signExtend(unsigned long long value, int width)
+{
+	value = truncate(value, width);
+	if (width < 64 && (value >> (width - 1)) & 1)
+		value |= ~0ULL << width;
+	return value;
+}
+
+}
+
+#endif
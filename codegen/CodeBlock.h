@@ -9,24 +9,24 @@
 #ifndef VERILOG_BASIC_BLOCK_H
 #define VERILOG_BASIC_BLOCK_H
 
+#include <algorithm>
 #include <iostream>
 #include <list>
+#include <utility>
+#include <vector>
 #include <cassert>
 
 
 namespace verilog
 {
 
-// Forward declarations
-class DataFlow;
-
 class CodeBlock
 {
 	// Label name
 	std::string name;
 
-	// List of dataFlows
-	std::list<DataFlow *> dataflows;
+	// Dataflows, as IDs in the netlist of the module
+	std::vector<int> dataflows;
 
         // List of successors and predecessors
         std::list<CodeBlock *> succ;
@@ -40,11 +40,28 @@ public:
 	}
 
 	// Add dataFlow to code block
-	void addDataFlow(DataFlow *dataflow)
+	void addDataFlow(int dataflow)
 	{
 		dataflows.push_back(dataflow);
 	}
 
+	// Return the dataflows of the code block
+	const std::vector<int> &getDataFlows() { return dataflows; }
+
+	// Replace the list of dataflows
+	void setDataFlows(std::vector<int> &&list)
+	{
+		dataflows = std::move(list);
+	}
+
+	// Remove the dataflows for which the predicate returns true,
+	// keeping the order of the others
+	template<typename Predicate> void removeDataFlows(Predicate predicate)
+	{
+		dataflows.erase(std::remove_if(dataflows.begin(),
+				dataflows.end(), predicate), dataflows.end());
+	}
+
 
         // Add a code block B2 to the list of successors of the current code
         // block B1. Also, add B1 to the list of predecessors of B2.
@@ -58,13 +75,9 @@ public:
 
 	// Return label name
 	const std::string &getName() { return name; }
-
-	// Print code block
-	void dump();
 };
 
 
 }
 
 #endif
-
@@ -9,15 +9,25 @@
 #ifndef VERILOG_INSTRUCTION_H
 #define VERILOG_INSTRUCTION_H
 
-#include <iostream>
-#include <list>
-
-#include "Argument.h"
-
 
 namespace verilog
 {
 
+// Dataflows are stored in the netlist of the module, which holds their
+// opcode, destination net, and operand nets. This class describes the
+// opcodes. Operands of OpcodeConcat are listed from the most significant
+// one, and are constants or slices of nets, so that their width is known.
+// Operands of OpcodeRegister are the value stored on every rising edge of
+// the clock, the clock, and the synchronous reset. Operands of OpcodeMux
+// are the 1-bit select, the value selected if it is 1, and the value
+// selected if it is 0. OpcodeMaj computes the bitwise majority of its
+// three operands, the carry of a full adder. OpcodeRam is a port of a
+// block RAM: its operands are the memory, the clock, the address, the
+// write enable and the word written on the rising edge of the clock, and
+// its destination is the register loaded with the word read at the same
+// address, before the write. OpcodeRom reads a memory holding constant
+// words, its first operand, at the address given by its second one, with
+// no clock: it is a lookup table built from logic.
 class DataFlow
 {
 public:
@@ -27,21 +37,25 @@ public:
 	{
 		OpcodeInvalid = 0,
 		
-		OpcodePortListStart,
-		OpcodeInputPortDefine,
-		OpcodeOutputPortDefine,
-		OpcodePortListEnd,
-		OpcodeSignalDefine,
 		OpcodeAssign,
 		OpcodeAdd,
 		OpcodeSub,
+		OpcodeMul,
 		OpcodeLshr,
+		OpcodeShl,
 		OpcodeXor,
 		OpcodeAnd,
 		OpcodeOr,
 		OpcodeEq,
-		OpcodeSgt,
-		OpcodeEndModule,
+		OpcodeUgt,
+		OpcodeSext,
+		OpcodeNot,
+		OpcodeMux,
+		OpcodeMaj,
+		OpcodeConcat,
+		OpcodeRegister,
+		OpcodeRam,
+		OpcodeRom,
 
 		OpcodeMax
 	};
@@ -49,34 +63,15 @@ public:
 private:
 	
 	// Instruction names
-	static std::string names[OpcodeMax];
-
-	// Opcode
-	Opcode opcode;
+	static const char *names[OpcodeMax];
 
-	// List of arguments
-	std::list<Argument *> arguments;
-	
 public:
 
-	// Constructor
-	DataFlow(Opcode opcode) : opcode(opcode)
-	{
-	}
-
-	// Add an argument
-	void addArgument(Argument *argument)
-	{
-		arguments.push_back(argument);
-	}
-
-
-	// Print dataflow
-	void dump();
+	// Return the verilog operator or keyword of an opcode
+	static const char *getName(Opcode opcode) { return names[opcode]; }
 };
 
 
 }
 
 #endif
-
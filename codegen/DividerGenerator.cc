@@ -0,0 +1,460 @@
+/**
+ * @file   DividerGenerator.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the generation of dividers.
+ */
+
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+#include "Bits.h"
+#include "CodeBlock.h"
+#include "DividerGenerator.h"
+#include "Error.h"
+#include "Module.h"
+#include "Netlist.h"
+
+
+namespace verilog
+{
+
+static llvm::cl::list<std::string> Dividers("verilog-divider",
+		llvm::cl::desc("Build the division named <name>, or the divisions of "
+				"the function named <name>, or all other divisions, with "
+				"architecture <arch>: 'radix2' or 'radix4' arrays, or "
+				"an 'iterative' divider"),
+		llvm::cl::value_desc("[name:]arch"),
+		llvm::cl::CommaSeparated);
+
+
+// Architecture names, by architecture
+static const char *architecture_names[] = {
+	"radix2",
+	"radix4",
+	"iterative"
+};
+
+
+DividerGenerator::DividerGenerator(Module &module) :
+		module(module),
+		netlist(module.getNetlist())
+{
+}
+
+
+DividerGenerator::Architecture DividerGenerator::getArchitecture(
+		const std::string &function_name, const std::string &name)
+{
+	// A division takes the architecture given for its name, else the one
+	// given for its function, else the default one
+	Architecture architectures[3] = { ArchitectureRadix2, ArchitectureRadix2,
+			ArchitectureRadix2 };
+	bool given[3] = { };
+	for (const std::string &option : Dividers)
+	{
+		size_t pos = option.rfind(':');
+		std::string target = pos == std::string::npos ? "" :
+				option.substr(0, pos);
+		std::string architecture_name = pos == std::string::npos ? option :
+				option.substr(pos + 1);
+		int architecture = 0;
+		while (architecture <= ArchitectureIterative &&
+				architecture_name != architecture_names[architecture])
+			architecture++;
+		if (pos == 0 || architecture > ArchitectureIterative)
+			fatal("Error: invalid divider '" + option +
+					"', expected [<name>:]radix2|radix4|iterative");
+		int level = target.empty() ? 2 : !name.empty() && target == name ?
+				0 : target == function_name ? 1 : -1;
+		if (level < 0)
+			continue;
+		architectures[level] = (Architecture) architecture;
+		given[level] = true;
+	}
+	for (int level = 0; level < 3; level++)
+		if (given[level])
+			return architectures[level];
+	return ArchitectureRadix2;
+}
+
+
+int DividerGenerator::addLogic(DataFlow::Opcode opcode, int width,
+		std::initializer_list<int> operands)
+{
+	int dest = netlist.addWire(width);
+	module.addDataFlow(code_block, opcode, dest, operands);
+	return dest;
+}
+
+
+int DividerGenerator::addSlice(int net, int low, int width)
+{
+	// Emit 'assign dest = net[low + width - 1:low];'
+	int dest = netlist.addWire(width);
+	int dataflow = module.addDataFlow(code_block, DataFlow::OpcodeAssign, dest,
+			{ net });
+	netlist.setOperandSlice(dataflow, 0, low, width);
+	return dest;
+}
+
+
+int DividerGenerator::addConcat(const std::vector<int> &nets)
+{
+	// Emit 'assign dest = {net1, net2, ...};', with every net given as a
+	// slice of its full width
+	int width = 0;
+	for (int net : nets)
+		width += netlist.getNetWidth(net);
+	int dest = netlist.addWire(width);
+	int dataflow = netlist.addDataFlow(DataFlow::OpcodeConcat, dest, nets);
+	code_block->addDataFlow(dataflow);
+	for (int index = 0; index < (int) nets.size(); index++)
+		if (netlist.getNetKind(nets[index]) != Netlist::NetKindConstant)
+			netlist.setOperandSlice(dataflow, index, 0,
+					netlist.getNetWidth(nets[index]));
+	return dest;
+}
+
+
+void DividerGenerator::addRegister(int dest, int next)
+{
+	// Emit 'always @(posedge clk) dest <= rst ? 0 : next;'
+	module.addDataFlow(code_block, DataFlow::OpcodeRegister, dest,
+			{ next, module.getClockPort(), module.getResetPort() });
+}
+
+
+void DividerGenerator::addRow(int &shifted, int width,
+		const std::vector<int> &multiples, int divisor_width,
+		std::vector<int> &digits)
+{
+	// Every multiple gives the difference with the partial remainder, one
+	// bit wider for the borrow, and fits if there is no borrow. Multiples
+	// are increasing, so the last one that fits gives the new partial
+	// remainder, which is below the divisor.
+	int remainder_width = std::min(width, divisor_width);
+	int remainder = shifted;
+	std::vector<int> fits;
+	for (int multiple : multiples)
+	{
+		// Emit 'assign difference = shifted - multiple[width - 1:0];'
+		int multiple_width = netlist.getNetWidth(multiple);
+		int difference = netlist.addWire(width + 1);
+		int dataflow = module.addDataFlow(code_block, DataFlow::OpcodeSub,
+				difference, { shifted, multiple });
+		netlist.setOperandSlice(dataflow, 1, 0,
+				std::min(width, multiple_width));
+
+		// Bits of the multiple above the partial remainder must be zero
+		int fit = addLogic(DataFlow::OpcodeNot, 1,
+				{ addSlice(difference, width, 1) });
+		if (multiple_width > width)
+			fit = addLogic(DataFlow::OpcodeAnd, 1, { fit,
+					addLogic(DataFlow::OpcodeEq, 1, { addSlice(multiple, width,
+					multiple_width - width), module.getConstant(0,
+					multiple_width - width) }) });
+		fits.push_back(fit);
+
+		// Emit 'assign next = fit ? difference : remainder;'
+		int next = netlist.addWire(remainder_width);
+		dataflow = module.addDataFlow(code_block, DataFlow::OpcodeMux, next,
+				{ fit, difference, remainder });
+		netlist.setOperandSlice(dataflow, 1, 0, remainder_width);
+		netlist.setOperandSlice(dataflow, 2, 0, remainder_width);
+		remainder = next;
+	}
+	shifted = remainder;
+
+	// The digit is the number of multiples that fit
+	if (fits.size() == 1)
+	{
+		digits.push_back(fits[0]);
+		return;
+	}
+	digits.push_back(fits[1]);
+	digits.push_back(addLogic(DataFlow::OpcodeXor, 1,
+			{ fits[0], fits[1], fits[2] }));
+}
+
+
+void DividerGenerator::addArray(int dividend, int divisor, int digit_bits,
+		int &quotient, int &remainder)
+{
+	// Multiples of the divisor compared in every row
+	int width = netlist.getNetWidth(dividend);
+	std::vector<int> multiples = { divisor };
+	if (digit_bits == 2)
+	{
+		int twice = addConcat({ divisor, module.getConstant(0, 1) });
+		multiples.push_back(twice);
+		multiples.push_back(addLogic(DataFlow::OpcodeAdd, width + 2,
+				{ twice, divisor }));
+	}
+
+	// Rows, from the most significant bits of the dividend. The first
+	// row takes the bits left over by the others.
+	std::vector<int> digits;
+	int shifted = -1;
+	int shifted_width = 0;
+	for (int position = width; position > 0; )
+	{
+		int bits = position % digit_bits ? position % digit_bits : digit_bits;
+		position -= bits;
+		int next_bits = addSlice(dividend, position, bits);
+		shifted = shifted < 0 ? next_bits : addConcat({ shifted, next_bits });
+		shifted_width += bits;
+		addRow(shifted, shifted_width, bits == 2 ? multiples :
+				std::vector<int>{ divisor }, width, digits);
+		shifted_width = std::min(shifted_width, width);
+	}
+	quotient = addConcat(digits);
+	remainder = shifted;
+}
+
+
+void DividerGenerator::translateDivide(CodeBlock *code_block, int dest,
+		int dividend, int divisor, bool is_signed, bool remainder,
+		Architecture architecture)
+{
+	// Absolute values of signed operands
+	this->code_block = code_block;
+	int width = netlist.getNetWidth(dest);
+	int zero = module.getConstant(0, width);
+	int dividend_sign = -1;
+	int divisor_sign = -1;
+	if (is_signed)
+	{
+		dividend_sign = addSlice(dividend, width - 1, 1);
+		divisor_sign = addSlice(divisor, width - 1, 1);
+		dividend = addLogic(DataFlow::OpcodeMux, width, { dividend_sign,
+				addLogic(DataFlow::OpcodeSub, width, { zero, dividend }),
+				dividend });
+		divisor = addLogic(DataFlow::OpcodeMux, width, { divisor_sign,
+				addLogic(DataFlow::OpcodeSub, width, { zero, divisor }),
+				divisor });
+	}
+
+	// Unsigned divider
+	int quotient_net;
+	int remainder_net;
+	if (architecture == ArchitectureIterative)
+	{
+		IterativeDivider divider;
+		divider.dividend = dividend;
+		divider.divisor = divisor;
+		divider.quotient = netlist.addRegister(width);
+		divider.remainder = netlist.addRegister(width);
+		dividers.push_back(divider);
+		quotient_net = divider.quotient;
+		remainder_net = divider.remainder;
+	}
+	else
+	{
+		addArray(dividend, divisor, architecture == ArchitectureRadix4 ? 2 : 1,
+				quotient_net, remainder_net);
+	}
+
+	// Sign of the result
+	int result = remainder ? remainder_net : quotient_net;
+	if (is_signed)
+	{
+		int negate = remainder ? dividend_sign : addLogic(DataFlow::OpcodeXor,
+				1, { dividend_sign, divisor_sign });
+		result = addLogic(DataFlow::OpcodeMux, width, { negate,
+				addLogic(DataFlow::OpcodeSub, width, { zero, result }), result });
+	}
+
+	// Emit 'assign dest = result;'
+	module.addDataFlow(code_block, DataFlow::OpcodeAssign, dest, { result });
+}
+
+
+void DividerGenerator::getDependencies(int net, std::vector<bool> &visited,
+		std::vector<bool> &dependencies)
+{
+	if (visited[net])
+		return;
+	visited[net] = true;
+	for (int index = 0; index < (int) dividers.size(); index++)
+	{
+		if (net == dividers[index].quotient || net == dividers[index].remainder)
+		{
+			dependencies[index] = true;
+			return;
+		}
+	}
+	int definition = netlist.getNetDefinition(net);
+	if (netlist.getNetKind(net) == Netlist::NetKindRegister || definition < 0)
+		return;
+	for (int index = 0; index < netlist.getNumOperands(definition); index++)
+		getDependencies(netlist.getOperand(definition, index), visited,
+				dependencies);
+}
+
+
+void DividerGenerator::run()
+{
+	if (dividers.empty())
+		return;
+
+	// Arguments are read from the registers latching them
+	std::map<int, int> latches;
+	auto getLatch = [&](int net)
+	{
+		if (netlist.getNetKind(net) != Netlist::NetKindInput)
+			return net;
+		auto it = latches.find(net);
+		if (it == latches.end())
+			it = latches.emplace(net, netlist.addRegister(
+					netlist.getNetWidth(net))).first;
+		return it->second;
+	};
+	std::vector<CodeBlock *> code_blocks = module.getCodeBlocks();
+	for (CodeBlock *code_block : code_blocks)
+		for (int dataflow : code_block->getDataFlows())
+			for (int index = 0; index < netlist.getNumOperands(dataflow);
+					index++)
+				netlist.setOperand(dataflow, index, getLatch(
+						netlist.getOperand(dataflow, index)));
+	for (IterativeDivider &divider : dividers)
+	{
+		divider.dividend = getLatch(divider.dividend);
+		divider.divisor = getLatch(divider.divisor);
+	}
+
+	// The value of the output port is computed into a wire, loaded into
+	// the result register once all dividers have finished
+	int output_port = module.getOutputPort();
+	int output_definition = netlist.getNetDefinition(output_port);
+	int value = netlist.addWire(netlist.getNetWidth(output_port));
+	std::vector<int> operand_list;
+	for (int index = 0; index < netlist.getNumOperands(output_definition);
+			index++)
+		operand_list.push_back(netlist.getOperand(output_definition, index));
+	int copy = netlist.addDataFlow(netlist.getOpcode(output_definition),
+			value, operand_list);
+	for (int index = 0; index < netlist.getNumOperands(output_definition);
+			index++)
+		netlist.setOperandSlice(copy, index,
+				netlist.getOperandLow(output_definition, index),
+				netlist.getOperandWidth(output_definition, index));
+	netlist.removeDataFlow(output_definition);
+	for (CodeBlock *code_block : code_blocks)
+	{
+		std::vector<int> list = code_block->getDataFlows();
+		std::replace(list.begin(), list.end(), output_definition, copy);
+		code_block->setDataFlows(std::move(list));
+	}
+
+	// Ports, and the code block of the control logic
+	module.addClockPorts();
+	module.addHandshakePorts();
+	code_block = module.create<CodeBlock>("control");
+	module.addCodeBlock(code_block);
+	int one = module.getConstant(1, 1);
+	int zero = module.getConstant(0, 1);
+
+	// 'start' is accepted while not busy, latching the arguments
+	int busy = netlist.addRegister(1);
+	int accept = addLogic(DataFlow::OpcodeAnd, 1, { module.getStartPort(),
+			addLogic(DataFlow::OpcodeNot, 1, { busy }) });
+	for (auto &latch : latches)
+		addRegister(latch.second, addLogic(DataFlow::OpcodeMux,
+				netlist.getNetWidth(latch.second),
+				{ accept, latch.first, latch.second }));
+
+	// Dividers and their finish times, in cycles after the arguments are
+	// latched
+	std::vector<int> finished;
+	std::vector<int> finish_times;
+	int latency = 0;
+	for (int index = 0; index < (int) dividers.size(); index++)
+	{
+		IterativeDivider &divider = dividers[index];
+		int width = netlist.getNetWidth(divider.quotient);
+		int count_width = getNumBits(width);
+
+		// The divider starts once the dividers computing its operands
+		// have finished
+		std::vector<bool> visited(netlist.getNumNets());
+		std::vector<bool> dependencies(dividers.size());
+		getDependencies(divider.dividend, visited, dependencies);
+		getDependencies(divider.divisor, visited, dependencies);
+		int ready = busy;
+		int start_time = 0;
+		for (int other = 0; other < index; other++)
+		{
+			if (!dependencies[other])
+				continue;
+			ready = addLogic(DataFlow::OpcodeAnd, 1, { ready, finished[other] });
+			start_time = std::max(start_time, finish_times[other]);
+		}
+		finish_times.push_back(start_time + width + 1);
+		latency = std::max(latency, finish_times.back());
+
+		// Emit 'assign go = ready & ~started;', and count the cycles left
+		int started = netlist.addRegister(1);
+		int count = netlist.addRegister(count_width);
+		int go = addLogic(DataFlow::OpcodeAnd, 1, { ready,
+				addLogic(DataFlow::OpcodeNot, 1, { started }) });
+		int idle = addLogic(DataFlow::OpcodeEq, 1, { count,
+				module.getConstant(0, count_width) });
+		int running = addLogic(DataFlow::OpcodeNot, 1, { idle });
+		finished.push_back(addLogic(DataFlow::OpcodeAnd, 1, { started, idle }));
+		addRegister(started, addLogic(DataFlow::OpcodeMux, 1, { accept, zero,
+				addLogic(DataFlow::OpcodeOr, 1, { started, go }) }));
+		addRegister(count, addLogic(DataFlow::OpcodeMux, count_width, { go,
+				module.getConstant(width, count_width),
+				addLogic(DataFlow::OpcodeMux, count_width, { running,
+				addLogic(DataFlow::OpcodeSub, count_width, { count,
+				module.getConstant(1, count_width) }), count }) }));
+
+		// One radix-2 row, shifting the next bit of the dividend out of
+		// the quotient register into the partial remainder
+		std::vector<int> digits;
+		int shifted = addConcat({ divider.remainder,
+				addSlice(divider.quotient, width - 1, 1) });
+		addRow(shifted, width + 1, { divider.divisor }, width, digits);
+		int quotient = width > 1 ? addConcat({ addSlice(divider.quotient, 0,
+				width - 1), digits[0] }) : digits[0];
+		addRegister(divider.remainder, addLogic(DataFlow::OpcodeMux, width,
+				{ go, module.getConstant(0, width),
+				addLogic(DataFlow::OpcodeMux, width, { running, shifted,
+				divider.remainder }) }));
+		addRegister(divider.quotient, addLogic(DataFlow::OpcodeMux, width,
+				{ go, divider.dividend, addLogic(DataFlow::OpcodeMux, width,
+				{ running, quotient, divider.quotient }) }));
+	}
+
+	// The result is loaded once all dividers have finished, 'done' is set
+	// in the next cycle, and 'start' is accepted again
+	int last = busy;
+	for (int net : finished)
+		last = addLogic(DataFlow::OpcodeAnd, 1, { last, net });
+	int result = netlist.addRegister(netlist.getNetWidth(output_port));
+	int done = netlist.addRegister(1);
+	addRegister(busy, addLogic(DataFlow::OpcodeMux, 1, { accept, one,
+			addLogic(DataFlow::OpcodeMux, 1, { last, zero, busy }) }));
+	addRegister(result, addLogic(DataFlow::OpcodeMux,
+			netlist.getNetWidth(result), { last, value, result }));
+	addRegister(done, last);
+	module.addDataFlow(code_block, DataFlow::OpcodeAssign, output_port,
+			{ result });
+	module.addDataFlow(code_block, DataFlow::OpcodeAssign,
+			module.getDonePort(), { done });
+
+	// Cycles from 'start' to 'done': the arguments are latched, the
+	// dividers take a cycle to start and one per quotient bit, and the
+	// result is loaded
+	std::ostringstream os;
+	os << "iterative dividers " << dividers.size()
+			<< (dividers.size() == 1 ? " unit" : " units")
+			<< ", latency " << latency + 2 << " cycles";
+	module.addComment(os.str());
+}
+
+}
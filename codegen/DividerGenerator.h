@@ -0,0 +1,144 @@
+/**
+ * @file   DividerGenerator.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  DividerGenerator class builds the dividers of divisions and
+ *         remainders by a variable.
+ */
+
+#ifndef VERILOG_DIVIDER_GENERATOR_H
+#define VERILOG_DIVIDER_GENERATOR_H
+
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "DataFlow.h"
+
+
+namespace verilog
+{
+
+// Forward declarations
+class CodeBlock;
+class Module;
+class Netlist;
+
+
+// Dividers divide unsigned operands by restoring division, one quotient
+// digit at a time from the most significant one: the next bits of the
+// dividend are shifted into the partial remainder, which is compared with
+// the multiples of the divisor, and the largest multiple not above it is
+// subtracted. Every division uses one of three architectures:
+//
+// - A radix-2 array has one row per quotient bit, each with a subtracter.
+//   The partial remainder of row 'i' has at most 'i + 1' bits, so its
+//   subtracter only spans as many bits, and the high bits of the divisor
+//   are tested for zero instead. The array is combinational, and can be
+//   cut into stages by the pipeliner, accepting a division every cycle
+//   with a latency of about its width.
+//
+// - A radix-4 array has one row per pair of quotient bits, comparing the
+//   partial remainder with one, two and three times the divisor in
+//   parallel. It has half the rows and three times the subtracters.
+//
+// - An iterative divider is a single radix-2 row with registers holding
+//   the partial remainder and the quotient, taking one cycle per quotient
+//   bit. Its module becomes sequential, with 'start' and 'done' ports:
+//   the arguments are latched on 'start', every divider starts once the
+//   dividers computing its operands have finished, and the result is
+//   loaded once all of them have finished.
+//
+// Signed divisions divide the absolute values of their operands, and
+// negate the quotient if their signs differ, and the remainder if the
+// dividend is negative.
+class DividerGenerator
+{
+public:
+
+	// Architectures of a divider
+	enum Architecture
+	{
+		ArchitectureRadix2,
+		ArchitectureRadix4,
+		ArchitectureIterative
+	};
+
+private:
+
+	// Operands and registers of an iterative divider
+	struct IterativeDivider
+	{
+		int dividend;
+		int divisor;
+		int quotient;
+		int remainder;
+	};
+
+	// Module being translated
+	Module &module;
+	Netlist &netlist;
+
+	// Code block the dataflows are added to
+	CodeBlock *code_block = nullptr;
+
+	// Iterative dividers, in translation order
+	std::vector<IterativeDivider> dividers;
+
+	// Add a dataflow computing a new wire of the given width, and return
+	// the wire
+	int addLogic(DataFlow::Opcode opcode, int width,
+			std::initializer_list<int> operands);
+
+	// Return a new wire holding 'width' bits of a net from bit 'low'
+	int addSlice(int net, int low, int width);
+
+	// Return a new wire concatenating the given nets, from the most
+	// significant one
+	int addConcat(const std::vector<int> &nets);
+
+	// Add a register loaded with 'next' on every clock edge
+	void addRegister(int dest, int next);
+
+	// Add a row comparing 'shifted', a partial remainder of 'width' bits
+	// and the next bits of the dividend, with the multiples of a divisor
+	// of 'divisor_width' bits. Replace 'shifted' with the new partial
+	// remainder, and add the quotient digit to 'digits', as one net per
+	// bit.
+	void addRow(int &shifted, int width, const std::vector<int> &multiples,
+			int divisor_width, std::vector<int> &digits);
+
+	// Add an array dividing two unsigned nets of the same width, with
+	// rows of 'digit_bits' quotient bits, and return the quotient and the
+	// remainder
+	void addArray(int dividend, int divisor, int digit_bits, int &quotient,
+			int &remainder);
+
+	// Return the iterative dividers computing the nets a net depends on
+	void getDependencies(int net, std::vector<bool> &visited,
+			std::vector<bool> &dependencies);
+
+public:
+
+	// Constructor
+	DividerGenerator(Module &module);
+
+	// Return the architecture of the division named 'name' in a function,
+	// given by option '-verilog-divider'
+	static Architecture getArchitecture(const std::string &function_name,
+			const std::string &name);
+
+	// Emit 'assign dest = dividend / divisor;', or the remainder if
+	// 'remainder' is true, with signed or unsigned operands
+	void translateDivide(CodeBlock *code_block, int dest, int dividend,
+			int divisor, bool is_signed, bool remainder,
+			Architecture architecture);
+
+	// Once all blocks are translated, add the ports and the control logic
+	// of the iterative dividers, if any, and report their latency
+	void run();
+};
+
+}
+
+#endif
@@ -0,0 +1,602 @@
+/**
+ * @file   Emitter.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the printing of verilog modules.
+ */
+
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+#include "CodeBlock.h"
+#include "Emitter.h"
+#include "Error.h"
+#include "Module.h"
+#include "Netlist.h"
+
+
+namespace verilog
+{
+
+static llvm::cl::opt<std::string> RomDirectory("verilog-rom-directory",
+		llvm::cl::desc("Write the initial words of block RAMs and ROMs to "
+				"hex files in <dir>, read by '$readmemh' (default: the "
+				"directory of the verilog file)"),
+		llvm::cl::value_desc("dir"));
+
+
+const Emitter::EmitFunction Emitter::emit_functions[DataFlow::OpcodeMax] = {
+	&Emitter::emitInvalid,		// OpcodeInvalid
+	&Emitter::emitOperator,		// OpcodeAssign
+	&Emitter::emitOperator,		// OpcodeAdd
+	&Emitter::emitOperator,		// OpcodeSub
+	&Emitter::emitOperator,		// OpcodeMul
+	&Emitter::emitOperator,		// OpcodeLshr
+	&Emitter::emitOperator,		// OpcodeShl
+	&Emitter::emitOperator,		// OpcodeXor
+	&Emitter::emitOperator,		// OpcodeAnd
+	&Emitter::emitOperator,		// OpcodeOr
+	&Emitter::emitOperator,		// OpcodeEq
+	&Emitter::emitOperator,		// OpcodeUgt
+	&Emitter::emitSignExtend,	// OpcodeSext
+	&Emitter::emitNot,		// OpcodeNot
+	&Emitter::emitMux,		// OpcodeMux
+	&Emitter::emitMajority,	// OpcodeMaj
+	&Emitter::emitConcat,		// OpcodeConcat
+	&Emitter::emitRegister,	// OpcodeRegister
+	&Emitter::emitRam,		// OpcodeRam
+	&Emitter::emitRom		// OpcodeRom
+};
+
+
+void Emitter::appendUnsigned(unsigned long long value, int digits)
+{
+	char text[24];
+	char *end = text + sizeof text;
+	char *p = end;
+	do
+	{
+		*--p = '0' + value % 10;
+		value /= 10;
+		digits--;
+	} while (value || digits > 0);
+	buffer.append(p, end - p);
+}
+
+
+void Emitter::appendNumber(long long value, int digits)
+{
+	if (value < 0)
+	{
+		append('-');
+		appendUnsigned(-(unsigned long long) value, digits);
+	}
+	else
+	{
+		appendUnsigned(value, digits);
+	}
+}
+
+
+void Emitter::appendWidth(int width)
+{
+	if (width < 1)
+		fatal("Unsupported signal width " + std::to_string(width));
+	if (width > 1)
+	{
+		append('[');
+		appendNumber(width - 1);
+		append(":0] ");
+	}
+}
+
+
+void Emitter::appendNet(int net, bool sized)
+{
+	if (netlist->getNetKind(net) == Netlist::NetKindConstant && sized)
+	{
+		appendLiteral(netlist->getNetValue(net), netlist->getNetWidth(net));
+	}
+	else if (netlist->getNetKind(net) == Netlist::NetKindConstant)
+	{
+		appendNumber(netlist->getNetValue(net));
+	}
+	else if (netlist->getNetNumber(net) < 0)
+	{
+		append(netlist->getNetName(net));
+	}
+	else
+	{
+		Netlist::NetKind kind = netlist->getNetKind(net);
+		append(kind == Netlist::NetKindRegister ? "reg" :
+				kind == Netlist::NetKindMemory ? "mem" : "wire");
+		appendNumber(netlist->getNetNumber(net), 3);
+	}
+}
+
+
+void Emitter::appendLiteral(unsigned long long value, int width)
+{
+	// Unsigned value of the low bits
+	if (width < 64)
+		value &= (1ULL << width) - 1;
+	appendNumber(width);
+	append("'d");
+	appendUnsigned(value);
+}
+
+
+void Emitter::appendOperand(int dataflow, int index, bool sized,
+		int truncated)
+{
+	int net = netlist->getOperand(dataflow, index);
+	int low = netlist->getOperandLow(dataflow, index);
+	int width = netlist->getOperandWidth(dataflow, index);
+	int net_width = netlist->getNetWidth(net);
+	if (width)
+		width -= truncated;
+
+	// Whole net
+	if (!width || (!low && width == net_width))
+	{
+		appendNet(net, sized);
+		return;
+	}
+
+	// Bits of a constant
+	if (netlist->getNetKind(net) == Netlist::NetKindConstant)
+	{
+		appendLiteral(low < 64 ? netlist->getNetValue(net) >> low :
+				netlist->getNetValue(net) >> 63, width);
+		return;
+	}
+
+	// Bits above a narrowed wire are zero. Its width is never smaller
+	// than the slice if its value is sign-extended.
+	if (low >= net_width)
+	{
+		appendLiteral(0, width);
+		return;
+	}
+	int high = low + width - 1;
+	bool padded = high >= net_width;
+	if (padded)
+	{
+		append('{');
+		appendLiteral(0, high - net_width + 1);
+		append(", ");
+		high = net_width - 1;
+	}
+
+	// 'net[high:low]', 'net[low]', or 'net' if it has 1 bit
+	appendNet(net);
+	if (net_width > 1)
+	{
+		append('[');
+		appendNumber(high);
+		if (high != low)
+		{
+			append(':');
+			appendNumber(low);
+		}
+		append(']');
+	}
+	if (padded)
+		append('}');
+}
+
+
+void Emitter::appendDeclaration(int net)
+{
+	Netlist::NetKind kind = netlist->getNetKind(net);
+	if (kind != Netlist::NetKindWire)
+		declared_registers[net] = true;
+	append(kind == Netlist::NetKindWire ? "\twire " : "\treg ");
+	appendWidth(netlist->getNetWidth(net));
+	appendNet(net);
+
+	// 'reg [31:0] mem000 [0:depth - 1];'
+	if (kind == Netlist::NetKindMemory)
+	{
+		append(" [0:");
+		appendNumber(netlist->getMemoryDepth(net) - 1);
+		append(']');
+	}
+	append(";\n");
+
+	// Initial words loaded from a hex file named after the module and the
+	// memory, read from the path it is written to
+	const std::vector<long long> *words = kind == Netlist::NetKindMemory ?
+			netlist->getMemoryContents(net) : nullptr;
+	if (!words)
+		return;
+	if (hex_prefix.empty())
+		fatal("Error: memory '" + netlist->getPrintedName(net) +
+				"' of module '" + module_name + "' needs a hex file, but the "
+				"verilog code is not written to a file: use "
+				"-verilog-rom-directory <dir>");
+	std::string path = hex_prefix + module_name + '_' +
+			netlist->getPrintedName(net) + ".hex";
+	writeHexFile(path, *words, netlist->getNetWidth(net));
+	append("\tinitial $readmemh(\"");
+	append(path);
+	append("\", ");
+	appendNet(net);
+	append(");\n");
+}
+
+
+void Emitter::writeHexFile(const std::string &path,
+		const std::vector<long long> &words, int width)
+{
+	// One word per line, with as many hex digits as the width needs
+	static const char digits[] = "0123456789abcdef";
+	hex_files.push_back(path);
+	std::ofstream file(path.c_str());
+	if (!file)
+		fatal("Cannot open hex file: " + path);
+	int num_digits = (width + 3) / 4;
+	std::string line(num_digits, '0');
+	for (long long word : words)
+	{
+		unsigned long long bits = word;
+		for (int digit = num_digits - 1; digit >= 0; digit--, bits >>= 4)
+			line[digit] = digits[bits & 15];
+		file << line << '\n';
+	}
+	if (!file)
+		fatal("Error writing hex file: " + path);
+}
+
+
+void Emitter::appendRegisterDeclarations(int dataflow)
+{
+	// Tables read by lookups are printed as case statements, and never
+	// declared
+	int num_operands = netlist->getNumOperands(dataflow);
+	int first = netlist->getOpcode(dataflow) == DataFlow::OpcodeRom ? 1 : 0;
+	for (int index = first; index < num_operands; index++)
+	{
+		int net = netlist->getOperand(dataflow, index);
+		Netlist::NetKind kind = netlist->getNetKind(net);
+		if ((kind == Netlist::NetKindRegister ||
+				kind == Netlist::NetKindMemory) && !declared_registers[net])
+			appendDeclaration(net);
+	}
+}
+
+
+void Emitter::appendAssign(int dest)
+{
+	// Internal wires are declared where they are assigned
+	if (netlist->getNetKind(dest) == Netlist::NetKindWire)
+		appendDeclaration(dest);
+	append("\tassign ");
+	appendNet(dest);
+	append(" = ");
+}
+
+
+void Emitter::emitInvalid(int dataflow)
+{
+	fatal("Invalid dataflow " + std::to_string(dataflow));
+}
+
+
+void Emitter::emitOperator(int dataflow)
+{
+	// 'assign dest = src1 op src2 ...;'. Constants are written as
+	// sized literals inside expressions, and as plain numbers when
+	// assigned to a net.
+	DataFlow::Opcode opcode = netlist->getOpcode(dataflow);
+	const char *name = DataFlow::getName(opcode);
+	appendAssign(netlist->getDest(dataflow));
+	int num_operands = netlist->getNumOperands(dataflow);
+	for (int index = 0; index < num_operands; index++)
+	{
+		if (index)
+		{
+			append(' ');
+			append(name);
+			append(' ');
+		}
+		appendOperand(dataflow, index, opcode != DataFlow::OpcodeAssign);
+	}
+	append("; \n");
+}
+
+
+void Emitter::emitSignExtend(int dataflow)
+{
+	// 'assign dest = {{n{src[msb]}}, src};', or '{n{src}}' for 1-bit
+	// sources, which cannot be indexed. Destinations narrowed to the
+	// width of the source or less only keep its low bits.
+	int dest = netlist->getDest(dataflow);
+	int src = netlist->getOperand(dataflow, 0);
+	int width = netlist->getNetWidth(src);
+	appendAssign(dest);
+	if (netlist->getNetWidth(dest) <= width)
+	{
+		appendNet(src);
+		append("; \n");
+		return;
+	}
+	append('{');
+	if (width == 1)
+	{
+		appendNumber(netlist->getNetWidth(dest));
+		append('{');
+		appendNet(src);
+		append('}');
+	}
+	else
+	{
+		append('{');
+		appendNumber(netlist->getNetWidth(dest) - width);
+		append('{');
+		appendNet(src);
+		append('[');
+		appendNumber(width - 1);
+		append("]}}, ");
+		appendNet(src);
+	}
+	append("}; \n");
+}
+
+
+void Emitter::emitNot(int dataflow)
+{
+	// 'assign dest = ~src;'
+	appendAssign(netlist->getDest(dataflow));
+	append('~');
+	appendOperand(dataflow, 0, true);
+	append("; \n");
+}
+
+
+void Emitter::emitMux(int dataflow)
+{
+	// 'assign dest = sel ? src1 : src2;'
+	appendAssign(netlist->getDest(dataflow));
+	appendOperand(dataflow, 0, true);
+	append(" ? ");
+	appendOperand(dataflow, 1, true);
+	append(" : ");
+	appendOperand(dataflow, 2, true);
+	append("; \n");
+}
+
+
+void Emitter::emitMajority(int dataflow)
+{
+	// 'assign dest = src1 & src2 | src1 & src3 | src2 & src3;'
+	appendAssign(netlist->getDest(dataflow));
+	for (int pair = 0; pair < 3; pair++)
+	{
+		if (pair)
+			append(" | ");
+		appendOperand(dataflow, pair == 2 ? 1 : 0, true);
+		append(" & ");
+		appendOperand(dataflow, pair == 0 ? 1 : 2, true);
+	}
+	append("; \n");
+}
+
+
+void Emitter::emitConcat(int dataflow)
+{
+	// 'assign dest = {src1, src2, ...};'. Leading bits truncated by a
+	// narrowed destination are left out, as are the braces if a single
+	// operand remains.
+	int dest = netlist->getDest(dataflow);
+	int num_operands = netlist->getNumOperands(dataflow);
+	int first = 0;
+	int offset = 0;
+	for (int index = num_operands - 1; index >= 0; index--)
+	{
+		if (offset >= netlist->getNetWidth(dest))
+			break;
+		int width = netlist->getOperandWidth(dataflow, index);
+		offset += width ? width : netlist->getNetWidth(
+				netlist->getOperand(dataflow, index));
+		first = index;
+	}
+
+	// High bits of the first slice above the destination
+	int truncated = std::max(0, offset - netlist->getNetWidth(dest));
+	if (!netlist->getOperandWidth(dataflow, first))
+		truncated = 0;
+
+	appendAssign(dest);
+	if (num_operands - first > 1)
+		append('{');
+	for (int index = first; index < num_operands; index++)
+	{
+		if (index > first)
+			append(", ");
+		appendOperand(dataflow, index, true, index == first ? truncated : 0);
+	}
+	if (num_operands - first > 1)
+		append('}');
+	append("; \n");
+}
+
+
+void Emitter::emitRegister(int dataflow)
+{
+	// 'always @(posedge clk) dest <= rst ? 0 : src;'
+	int dest = netlist->getDest(dataflow);
+	if (!declared_registers[dest])
+		appendDeclaration(dest);
+	append("\talways @(posedge ");
+	appendOperand(dataflow, 1, false);
+	append(")\n\t\t");
+	appendNet(dest);
+	append(" <= ");
+	appendOperand(dataflow, 2, false);
+	append(" ? 0 : ");
+	appendOperand(dataflow, 0, true);
+	append(";\n");
+}
+
+
+void Emitter::emitRam(int dataflow)
+{
+	// 'always @(posedge clk) begin if (we) mem[addr] <= data;
+	// dest <= mem[addr]; end', the template inferred as a block RAM
+	// port. The write is left out of read-only ports.
+	int dest = netlist->getDest(dataflow);
+	if (!declared_registers[dest])
+		appendDeclaration(dest);
+	long long value;
+	bool read_only = netlist->getConstant(netlist->getOperand(dataflow, 3),
+			value) && !value;
+	append("\talways @(posedge ");
+	appendOperand(dataflow, 1, false);
+	append(")\n\tbegin\n");
+	if (!read_only)
+	{
+		append("\t\tif (");
+		appendOperand(dataflow, 3, false);
+		append(")\n\t\t\t");
+		appendOperand(dataflow, 0, false);
+		append('[');
+		appendOperand(dataflow, 2, false);
+		append("] <= ");
+		appendOperand(dataflow, 4, true);
+		append(";\n");
+	}
+	append("\t\t");
+	appendNet(dest);
+	append(" <= ");
+	appendOperand(dataflow, 0, false);
+	append('[');
+	appendOperand(dataflow, 2, false);
+	append("];\n\tend\n");
+}
+
+
+void Emitter::emitRom(int dataflow)
+{
+	// 'always @(*) case (addr) 0: dest = word0; ... default: dest = 0;
+	// endcase', the template inferred as a ROM in LUTs. The destination
+	// is assigned in a procedural block, so it is declared as 'reg'. Zero
+	// words are left to the default.
+	int dest = netlist->getDest(dataflow);
+	int width = netlist->getNetWidth(dest);
+	const std::vector<long long> &words = *netlist->getMemoryContents(
+			netlist->getOperand(dataflow, 0));
+	append("\treg ");
+	appendWidth(width);
+	appendNet(dest);
+	append(";\n\talways @(*)\n\t\tcase (");
+	appendOperand(dataflow, 1, false);
+	append(")\n");
+	for (int address = 0; address < (int) words.size(); address++)
+	{
+		unsigned long long word = words[address];
+		if (width < 64)
+			word &= (1ULL << width) - 1;
+		if (!word)
+			continue;
+		append("\t\t");
+		appendNumber(address);
+		append(": ");
+		appendNet(dest);
+		append(" = ");
+		appendLiteral(word, width);
+		append(";\n");
+	}
+	append("\t\tdefault: ");
+	appendNet(dest);
+	append(" = ");
+	appendLiteral(0, width);
+	append(";\n\t\tendcase\n");
+}
+
+
+void Emitter::emit(Module &module)
+{
+	auto start = std::chrono::steady_clock::now();
+	netlist = &module.getNetlist();
+	module_name = module.getName();
+
+	// Hex files are named after the verilog file without its extension,
+	// so that modules of the same name in different files do not share
+	// them, and written next to it, or to '-verilog-rom-directory'. The
+	// standard output and memory need the directory.
+	std::string file_name = sink->getFileName();
+	size_t slash = file_name.find_last_of('/');
+	size_t dot = file_name.find_last_of('.');
+	if (dot != std::string::npos && (slash == std::string::npos ||
+			dot > slash))
+		file_name.erase(dot);
+	if (!RomDirectory.empty())
+		file_name = RomDirectory + '/' + (slash == std::string::npos ?
+				file_name : file_name.substr(slash + 1));
+	hex_prefix = file_name.empty() || file_name.back() == '/' ?
+			file_name : file_name + '_';
+	buffer.clear();
+	declared_registers.assign(netlist->getNumNets(), false);
+
+	for (CodeBlock *code_block : module.getCodeBlocks())
+	{
+		append("//");
+		append(code_block->getName());
+		append(":\n");
+
+		// Port list
+		if (code_block == module.getEntryCodeBlock())
+		{
+			append("\tmodule ");
+			append(module.getName());
+			append(" (\n");
+			for (int net : module.getInputPorts())
+			{
+				append("\tinput wire ");
+				appendWidth(netlist->getNetWidth(net));
+				appendNet(net);
+				append(", \n");
+			}
+			if (module.getDonePort() >= 0)
+			{
+				append("\toutput wire ");
+				appendNet(module.getDonePort());
+				append(", \n");
+			}
+			append("\toutput wire ");
+			appendWidth(netlist->getNetWidth(module.getOutputPort()));
+			appendNet(module.getOutputPort());
+			append("\n\t);\n");
+			for (const std::string &comment : module.getComments())
+			{
+				append("\t// ");
+				append(comment);
+				append('\n');
+			}
+		}
+
+		// Dataflows
+		for (int dataflow : code_block->getDataFlows())
+		{
+			appendRegisterDeclarations(dataflow);
+			(this->*emit_functions[netlist->getOpcode(dataflow)])(dataflow);
+		}
+
+		if (code_block == module.getExitCodeBlock())
+			append("\tendmodule\n");
+	}
+
+	// One write per module
+	sink->write(buffer.data(), buffer.size());
+	num_bytes += buffer.size();
+	netlist = nullptr;
+	std::chrono::duration<double> elapsed =
+			std::chrono::steady_clock::now() - start;
+	seconds += elapsed.count();
+}
+
+}
@@ -0,0 +1,140 @@
+/**
+ * @file   Emitter.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  Emitter class prints verilog modules into a buffer, which is
+ *         written to a sink with one call per module.
+ */
+
+#ifndef VERILOG_EMITTER_H
+#define VERILOG_EMITTER_H
+
+#include <string>
+#include <vector>
+
+#include "DataFlow.h"
+#include "Sink.h"
+
+
+namespace verilog
+{
+
+// Forward declarations
+class Module;
+class Netlist;
+
+
+class Emitter
+{
+	// Printing function of a dataflow
+	typedef void (Emitter::*EmitFunction)(int dataflow);
+
+	// Printing function of each opcode
+	static const EmitFunction emit_functions[DataFlow::OpcodeMax];
+
+	// Destination of the verilog code
+	Sink *sink;
+
+	// Text of the module being printed. The buffer is reused for all
+	// modules, so it only grows to the size of the largest one.
+	std::string buffer;
+
+	// Netlist and name of the module being printed
+	const Netlist *netlist = nullptr;
+	std::string module_name;
+
+	// Path and beginning of the name of the hex files of the module
+	std::string hex_prefix;
+
+	// Hex files written for all modules
+	std::vector<std::string> hex_files;
+
+	// Registers and memories of the module declared so far. State
+	// machines read registers before assigning them, so they are
+	// declared where they are first used.
+	std::vector<bool> declared_registers;
+
+	// Number of characters written, and time spent in seconds
+	size_t num_bytes = 0;
+	double seconds = 0;
+
+	// Append text to the buffer
+	void append(const char *text) { buffer.append(text); }
+	void append(const std::string &text) { buffer.append(text); }
+	void append(char c) { buffer.push_back(c); }
+
+	// Append a decimal number, padded with zeros to 'digits' digits
+	void appendUnsigned(unsigned long long value, int digits = 1);
+	void appendNumber(long long value, int digits = 1);
+
+	// Append the range of a signal of the given width, followed by a
+	// space. Nothing is appended for 1-bit signals.
+	void appendWidth(int width);
+
+	// Append the name of a net, or the value of a constant net. If
+	// 'sized' is true, constants are written as sized literals, such as
+	// 32'd2.
+	void appendNet(int net, bool sized = false);
+
+	// Append a sized literal with the given low bits of a value
+	void appendLiteral(unsigned long long value, int width);
+
+	// Append an operand of a dataflow, which is a net or a slice of it,
+	// such as x[31:8]. The given number of high bits of a slice are
+	// left out.
+	void appendOperand(int dataflow, int index, bool sized,
+			int truncated = 0);
+
+	// Append the declaration of an internal wire, register or memory.
+	// Memories with initial words load them from a hex file, written next
+	// to the verilog file, or in the directory given by option
+	// '-verilog-rom-directory', which is required when the verilog code
+	// is not written to a file.
+	void appendDeclaration(int net);
+
+	// Write the given words of a memory to a hex file, one per line
+	void writeHexFile(const std::string &path,
+			const std::vector<long long> &words, int width);
+
+	// Declare the registers and memories read by a dataflow that are not
+	// declared yet
+	void appendRegisterDeclarations(int dataflow);
+
+	// Append the beginning of 'assign dest = ', declaring the
+	// destination first if it is an internal wire
+	void appendAssign(int dest);
+
+	// Printing functions of dataflows
+	void emitInvalid(int dataflow);
+	void emitOperator(int dataflow);
+	void emitSignExtend(int dataflow);
+	void emitNot(int dataflow);
+	void emitMux(int dataflow);
+	void emitMajority(int dataflow);
+	void emitConcat(int dataflow);
+	void emitRegister(int dataflow);
+	void emitRam(int dataflow);
+	void emitRom(int dataflow);
+
+public:
+
+	// Constructor
+	Emitter(Sink &sink) : sink(&sink) { }
+
+	// Print a module and write it to the sink
+	void emit(Module &module);
+
+	// Return the number of characters written to the sink
+	size_t getNumBytes() const { return num_bytes; }
+
+	// Return the time spent printing and writing modules, in seconds
+	double getSeconds() const { return seconds; }
+
+	// Return the hex files written, so that they can be removed if the
+	// compilation fails
+	const std::vector<std::string> &getHexFiles() const { return hex_files; }
+};
+
+}
+
+#endif
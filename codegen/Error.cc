@@ -0,0 +1,48 @@
+/**
+ * @file   Error.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the error reporting of the code generator.
+ */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "Error.h"
+
+
+namespace verilog
+{
+
+// Whether errors throw in the current thread
+static thread_local bool trapped = false;
+
+
+void fatal(const std::string &message)
+{
+	if (trapped)
+		throw Error(message);
+	std::cerr << message << '\n';
+	exit(1);
+}
+
+
+void warning(const std::string &message)
+{
+	// One write, so that warnings of several threads are not mixed
+	std::cerr << message + '\n';
+}
+
+
+ErrorTrap::ErrorTrap() : previous(trapped)
+{
+	trapped = true;
+}
+
+
+ErrorTrap::~ErrorTrap()
+{
+	trapped = previous;
+}
+
+}
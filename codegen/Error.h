@@ -0,0 +1,65 @@
+/**
+ * @file   Error.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  Errors of the code generator, which terminate the program or
+ *         only fail the file being compiled, and warnings.
+ */
+
+#ifndef VERILOG_ERROR_H
+#define VERILOG_ERROR_H
+
+#include <stdexcept>
+#include <string>
+
+
+namespace verilog
+{
+
+// Error of the code generator, thrown inside an ErrorTrap
+class Error : public std::runtime_error
+{
+public:
+
+	// Constructor
+	explicit Error(const std::string &message) : std::runtime_error(message) { }
+};
+
+
+// Report an error of the code generator. The message is printed on the
+// standard error output and the program exits, as expected from an 'opt'
+// pass, unless an ErrorTrap exists in the current thread, in which case
+// an Error is thrown instead.
+[[noreturn]] void fatal(const std::string &message);
+
+
+// Report a problem of the code generator that does not stop it, such as
+// an option that cannot be honored. The message is printed on the
+// standard error output.
+void warning(const std::string &message);
+
+
+// While an object of this class exists, errors of the code generator in
+// the current thread throw an Error. The compile driver uses it to fail
+// one file of a batch without stopping the others.
+class ErrorTrap
+{
+	// Whether errors were already trapped
+	bool previous;
+
+public:
+
+	// Constructor
+	ErrorTrap();
+
+	// Destructor
+	~ErrorTrap();
+
+	// Traps are scoped and cannot be copied
+	ErrorTrap(const ErrorTrap &) = delete;
+	ErrorTrap &operator=(const ErrorTrap &) = delete;
+};
+
+}
+
+#endif
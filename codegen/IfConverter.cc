@@ -0,0 +1,338 @@
+/**
+ * @file   IfConverter.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the if-conversion of LLVM functions.
+ */
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <set>
+
+#include "CodeBlock.h"
+#include "Error.h"
+#include "IfConverter.h"
+#include "Module.h"
+#include "Netlist.h"
+
+
+namespace verilog
+{
+
+// Return the number of gates needed to compute a predicate net
+static int getCost(int base, int cond, bool negated)
+{
+	if (cond < 0)
+		return 0;
+	return (base >= 0) + negated;
+}
+
+
+IfConverter::IfConverter(Module &module) :
+		module(module),
+		netlist(module.getNetlist())
+{
+}
+
+
+llvm::BranchInst *IfConverter::getBranch(llvm::BasicBlock *block)
+{
+	for (llvm::BasicBlock::iterator it = block->begin(), e = block->end();
+			it != e; ++it)
+	{
+		if (!it->isTerminator())
+			continue;
+		if (llvm::isa<llvm::ReturnInst>(it))
+			return nullptr;
+		if (llvm::isa<llvm::BranchInst>(it))
+			return llvm::cast<llvm::BranchInst>(it);
+
+		std::string text;
+		llvm::raw_string_ostream stream(text);
+		it->print(stream);
+		fatal("Unsupported LLVM terminator: " + stream.str());
+	}
+
+	fatal("Basic block without terminator in function '" +
+			block->getParent()->getName().str() + "'");
+}
+
+
+bool IfConverter::analyze(llvm::Function &function)
+{
+	// Depth-first search from the entry block. Blocks on the stack are
+	// being visited, so reaching one of them again closes a loop.
+	enum State { StateUnvisited = 0, StateVisiting, StateVisited };
+	llvm::DenseMap<llvm::BasicBlock *, State> states;
+	std::vector<std::pair<llvm::BasicBlock *, unsigned>> stack;
+	llvm::BasicBlock *entry = &function.getEntryBlock();
+	states[entry] = StateVisiting;
+	stack.push_back(std::make_pair(entry, 0u));
+	while (!stack.empty())
+	{
+		llvm::BasicBlock *block = stack.back().first;
+		unsigned index = stack.back().second;
+		llvm::BranchInst *branch = getBranch(block);
+		if (branch && index < branch->getNumSuccessors())
+		{
+			llvm::BasicBlock *successor = branch->getSuccessor(index);
+			stack.back().second++;
+			predecessors[successor].push_back(block);
+			if (states[successor] == StateVisiting)
+				return false;
+			if (states[successor] == StateUnvisited)
+			{
+				states[successor] = StateVisiting;
+				stack.push_back(std::make_pair(successor, 0u));
+			}
+			continue;
+		}
+
+		// All successors visited
+		states[block] = StateVisited;
+		if (!branch)
+			num_returns++;
+		stack.pop_back();
+	}
+
+	// Order reachable blocks as in the function, as long as every block
+	// follows its predecessors.
+	llvm::DenseMap<llvm::BasicBlock *, int> num_pending;
+	std::vector<llvm::BasicBlock *> order;
+	for (llvm::Function::iterator it = function.begin(), e = function.end();
+			it != e; ++it)
+	{
+		if (!states[&*it])
+			continue;
+		num_pending[&*it] = predecessors[&*it].size();
+		order.push_back(&*it);
+	}
+	std::set<int> ready;
+	ready.insert(0);
+	while (!ready.empty())
+	{
+		llvm::BasicBlock *block = order[*ready.begin()];
+		ready.erase(ready.begin());
+		blocks.push_back(block);
+		llvm::BranchInst *branch = getBranch(block);
+		for (unsigned index = 0; branch && index < branch->getNumSuccessors();
+				index++)
+		{
+			llvm::BasicBlock *successor = branch->getSuccessor(index);
+			if (!--num_pending[successor])
+				ready.insert(std::find(order.begin(), order.end(), successor) -
+						order.begin());
+		}
+	}
+	return true;
+}
+
+
+int IfConverter::getNegation(int net, CodeBlock *code_block)
+{
+	auto it = negations.find(net);
+	if (it != negations.end())
+		return it->second;
+
+	// Emit 'assign dest = ~net;'
+	int dest = netlist.addWire(1);
+	module.addDataFlow(code_block, DataFlow::OpcodeNot, dest, { net });
+	negations[net] = dest;
+	return dest;
+}
+
+
+int IfConverter::getPredicateNet(const Predicate &predicate,
+		CodeBlock *code_block)
+{
+	if (predicate.cond < 0)
+		return predicate.base;
+	int literal = predicate.negated ? getNegation(predicate.cond, code_block) :
+			predicate.cond;
+	if (predicate.base < 0)
+		return literal;
+
+	// Emit 'assign dest = base & literal;'
+	auto key = std::make_pair(predicate.base, literal);
+	auto it = conjunctions.find(key);
+	if (it != conjunctions.end())
+		return it->second;
+	int dest = netlist.addWire(1);
+	module.addDataFlow(code_block, DataFlow::OpcodeAnd, dest,
+			{ predicate.base, literal });
+	conjunctions[key] = dest;
+	return dest;
+}
+
+
+IfConverter::Predicate IfConverter::getEdgePredicate(llvm::BasicBlock *block,
+		llvm::BasicBlock *successor, CodeBlock *code_block)
+{
+	// Unconditional edges are taken with their block
+	Predicate predicate = block_predicates[block];
+	llvm::BranchInst *branch = getBranch(block);
+	if (!branch->isConditional() ||
+			branch->getSuccessor(0) == branch->getSuccessor(1))
+		return predicate;
+
+	Predicate edge;
+	edge.base = getPredicateNet(predicate, code_block);
+	edge.cond = module.translateLLVMValue(code_block, branch->getCondition());
+	edge.negated = branch->getSuccessor(1) == successor;
+	return edge;
+}
+
+
+void IfConverter::addMultiplexer(std::vector<Case> &cases, int dest,
+		CodeBlock *code_block)
+{
+	// Cheapest predicates are tested first, and the most expensive one
+	// is never computed.
+	std::stable_sort(cases.begin(), cases.end(),
+			[](const Case &first, const Case &second)
+	{
+		return getCost(first.predicate.base, first.predicate.cond,
+				first.predicate.negated) <
+				getCost(second.predicate.base, second.predicate.cond,
+				second.predicate.negated);
+	});
+
+	// A single case, one that always holds, or the same value in all
+	// cases is a copy.
+	bool same = true;
+	for (const Case &c : cases)
+		same = same && c.value == cases[0].value;
+	if (same || (cases[0].predicate.base < 0 && cases[0].predicate.cond < 0))
+	{
+		module.addDataFlow(code_block, DataFlow::OpcodeAssign, dest,
+				{ cases[0].value });
+		return;
+	}
+
+	// Emit 'assign dest = pred1 ? value1 : pred2 ? value2 : ... : valueN;'
+	// as a chain of 2-input multiplexers, from the last one.
+	int num_cases = cases.size();
+	int value = cases.back().value;
+	for (int index = num_cases - 2; index >= 0; index--)
+	{
+		// Two cases differing only by their branch condition are
+		// selected by the condition alone.
+		const Predicate &predicate = cases[index].predicate;
+		const Predicate &last = cases[index + 1].predicate;
+		int select;
+		int first = cases[index].value;
+		int second = value;
+		if (index == num_cases - 2 && predicate.cond >= 0 &&
+				predicate.base == last.base && predicate.cond == last.cond &&
+				predicate.negated != last.negated)
+		{
+			select = predicate.cond;
+			if (predicate.negated)
+				std::swap(first, second);
+		}
+		else
+		{
+			select = getPredicateNet(predicate, code_block);
+		}
+
+		int mux = index ? netlist.addWire(netlist.getNetWidth(dest)) : dest;
+		module.addDataFlow(code_block, DataFlow::OpcodeMux, mux,
+				{ select, first, second });
+		value = mux;
+	}
+}
+
+
+void IfConverter::translateBlock(llvm::BasicBlock *block, CodeBlock *code_block)
+{
+	// The entry block always runs
+	Predicate predicate;
+	std::vector<llvm::BasicBlock *> &list = predecessors[block];
+	std::vector<Predicate> edges;
+	for (unsigned index = 0; index < list.size(); index++)
+		if (std::find(list.begin(), list.begin() + index, list[index]) ==
+				list.begin() + index)
+			edges.push_back(getEdgePredicate(list[index], block, code_block));
+
+	if (edges.size() == 1)
+	{
+		predicate = edges[0];
+	}
+	else if (edges.size() == 2 && edges[0].cond >= 0 &&
+			edges[0].base == edges[1].base &&
+			edges[0].cond == edges[1].cond &&
+			edges[0].negated != edges[1].negated)
+	{
+		// Both edges of a branch, as after an 'if' and 'else'
+		predicate.base = edges[0].base;
+	}
+	else if (edges.size() > 1)
+	{
+		// Emit 'assign dest = pred1 | pred2 | ...;', unless an edge is
+		// always taken
+		bool always = false;
+		for (const Predicate &edge : edges)
+			always = always || (edge.base < 0 && edge.cond < 0);
+		int net = -1;
+		for (const Predicate &edge : edges)
+		{
+			if (always)
+				break;
+			int edge_net = getPredicateNet(edge, code_block);
+			if (net < 0)
+			{
+				net = edge_net;
+				continue;
+			}
+			int dest = netlist.addWire(1);
+			module.addDataFlow(code_block, DataFlow::OpcodeOr, dest,
+					{ net, edge_net });
+			net = dest;
+		}
+		predicate.base = net;
+	}
+	block_predicates[block] = predicate;
+}
+
+
+int IfConverter::translatePHI(llvm::PHINode *phi, CodeBlock *code_block)
+{
+	int width = Module::translateLLVMType(phi->getType(), "phi nodes");
+	int dest = netlist.addWire(width);
+	module.addSymbol(phi, dest);
+
+	// One case per predecessor. Incoming blocks that cannot branch here,
+	// such as blocks ending with a return, are ignored.
+	llvm::BasicBlock *block = phi->getParent();
+	std::vector<llvm::BasicBlock *> &list = predecessors[block];
+	std::vector<Case> cases;
+	for (unsigned index = 0; index < list.size(); index++)
+	{
+		llvm::BasicBlock *predecessor = list[index];
+		if (std::find(list.begin(), list.begin() + index, predecessor) !=
+				list.begin() + index)
+			continue;
+		Case c;
+		c.predicate = getEdgePredicate(predecessor, block, code_block);
+		c.value = module.translateLLVMValue(code_block,
+				phi->getIncomingValueForBlock(predecessor));
+		cases.push_back(c);
+	}
+	addMultiplexer(cases, dest, code_block);
+	return dest;
+}
+
+
+void IfConverter::translateReturn(llvm::BasicBlock *block, int value,
+		CodeBlock *code_block)
+{
+	Case c;
+	c.predicate = block_predicates[block];
+	c.value = value;
+	returns.push_back(c);
+	if ((int) returns.size() == num_returns)
+		addMultiplexer(returns, module.getOutputPort(), code_block);
+}
+
+}
@@ -0,0 +1,129 @@
+/**
+ * @file   IfConverter.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  IfConverter class turns the acyclic control flow of an LLVM
+ *         function into predicates and multiplexers of a verilog module.
+ */
+
+#ifndef VERILOG_IF_CONVERTER_H
+#define VERILOG_IF_CONVERTER_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+
+#include <map>
+#include <utility>
+#include <vector>
+
+
+namespace verilog
+{
+
+// Forward declarations
+class CodeBlock;
+class Module;
+class Netlist;
+
+
+// All basic blocks of the function are translated into one datapath.
+// Every block gets a predicate, the condition under which it runs, built
+// from the branch conditions on the paths reaching it. Phi nodes become
+// multiplexers selecting the value of the edge taken, and the output port
+// is selected among the values of all return instructions.
+//
+// Only the first terminator of a block is considered, since the parser
+// may add a branch after a return.
+class IfConverter
+{
+	// Condition under which a block or an edge of the control flow
+	// graph is taken. It is the predicate net 'base', or true if -1,
+	// and'ed with the branch condition net 'cond' if not -1, negated if
+	// 'negated' is set.
+	struct Predicate
+	{
+		int base = -1;
+		int cond = -1;
+		bool negated = false;
+	};
+
+	// Value selected by a multiplexer if its predicate holds
+	struct Case
+	{
+		Predicate predicate;
+		int value;
+	};
+
+	// Module being translated
+	Module &module;
+	Netlist &netlist;
+
+	// Reachable basic blocks, in function order unless a block precedes
+	// one of its predecessors
+	std::vector<llvm::BasicBlock *> blocks;
+
+	// Predecessors of every reachable block, once per edge
+	llvm::DenseMap<llvm::BasicBlock *, std::vector<llvm::BasicBlock *>>
+			predecessors;
+
+	// Predicates of the blocks translated so far
+	llvm::DenseMap<llvm::BasicBlock *, Predicate> block_predicates;
+
+	// Negations and conjunctions already created, indexed by operands
+	std::map<int, int> negations;
+	std::map<std::pair<int, int>, int> conjunctions;
+
+	// Return values found so far, and number of return instructions
+	std::vector<Case> returns;
+	int num_returns = 0;
+
+	// Return a net holding the predicate, or -1 if it is true
+	int getPredicateNet(const Predicate &predicate, CodeBlock *code_block);
+
+	// Return a net holding the negation of a net
+	int getNegation(int net, CodeBlock *code_block);
+
+	// Return the predicate of the edge from a block to its successor
+	Predicate getEdgePredicate(llvm::BasicBlock *block,
+			llvm::BasicBlock *successor, CodeBlock *code_block);
+
+	// Assign 'dest' the value of the case whose predicate holds. One of
+	// them must hold, and the last one is selected without testing it.
+	void addMultiplexer(std::vector<Case> &cases, int dest,
+			CodeBlock *code_block);
+
+public:
+
+	// Constructor
+	IfConverter(Module &module);
+
+	// Return the branch of a block, or nullptr if it ends with a return.
+	// Other terminators produce an error.
+	static llvm::BranchInst *getBranch(llvm::BasicBlock *block);
+
+	// Find the reachable blocks of a function, and order them so that
+	// every block follows its predecessors. Return false if the function
+	// contains a loop, in which case it cannot be if-converted.
+	bool analyze(llvm::Function &function);
+
+	// Return the reachable blocks, in translation order
+	const std::vector<llvm::BasicBlock *> &getBlocks() { return blocks; }
+
+	// Compute the predicate of a block, once its predecessors have been
+	// translated. Its logic is added to the block's code block.
+	void translateBlock(llvm::BasicBlock *block, CodeBlock *code_block);
+
+	// Translate a phi node into a multiplexer and return its net
+	int translatePHI(llvm::PHINode *phi, CodeBlock *code_block);
+
+	// Record the value returned by a block. Once all return values are
+	// known, the output port is assigned the one of the block taken.
+	void translateReturn(llvm::BasicBlock *block, int value,
+			CodeBlock *code_block);
+};
+
+}
+
+#endif
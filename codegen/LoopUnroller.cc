@@ -0,0 +1,551 @@
+/**
+ * @file   LoopUnroller.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the unrolling of loops with a constant trip
+ *         count.
+ */
+
+#include "llvm/IR/Constants.h"
+#include "llvm/Support/CFG.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+
+#include "Error.h"
+#include "IfConverter.h"
+#include "LoopUnroller.h"
+#include "MemoryMapper.h"
+#include "Module.h"
+
+
+namespace verilog
+{
+
+static llvm::cl::opt<unsigned> UnrollThreshold("verilog-unroll-threshold",
+		llvm::cl::desc("Fully unroll the loops with a constant trip count of "
+				"at most <n>"),
+		llvm::cl::value_desc("n"),
+		llvm::cl::init(16));
+
+static llvm::cl::list<std::string> UnrollFactors("verilog-unroll-factor",
+		llvm::cl::desc("Unroll the loop whose header has label <label> <n> "
+				"times, fully if <n> is at least its trip count, and not "
+				"at all if <n> is 1"),
+		llvm::cl::value_desc("label:n"),
+		llvm::cl::CommaSeparated);
+
+
+// Return the unroll factors of option '-verilog-unroll-factor', by label
+static std::map<std::string, int> getUnrollFactors()
+{
+	std::map<std::string, int> factors;
+	for (const std::string &option : UnrollFactors)
+	{
+		size_t pos = option.rfind(':');
+		char *end = nullptr;
+		long factor = pos == std::string::npos ? 0 :
+				strtol(option.c_str() + pos + 1, &end, 10);
+		if (pos == std::string::npos || pos == 0 || !end || *end ||
+				factor < 1)
+			fatal("Error: invalid unroll factor '" + option +
+					"', expected <label>:<n>");
+		factors[option.substr(0, pos)] = factor;
+	}
+	return factors;
+}
+
+
+LoopUnroller::LoopUnroller(Module &module) :
+		module(module)
+{
+}
+
+
+bool LoopUnroller::findLoop(llvm::Function &function, Loop &loop)
+{
+	// Depth-first search from the entry block. An edge reaching a block
+	// on the stack closes a loop.
+	enum State { StateUnvisited = 0, StateVisiting, StateVisited };
+	llvm::DenseMap<llvm::BasicBlock *, State> states;
+	llvm::DenseMap<llvm::BasicBlock *, std::vector<llvm::BasicBlock *>> latches;
+	std::vector<llvm::BasicBlock *> headers;
+	std::vector<std::pair<llvm::BasicBlock *, unsigned>> stack;
+	llvm::BasicBlock *entry = &function.getEntryBlock();
+	states[entry] = StateVisiting;
+	stack.push_back(std::make_pair(entry, 0u));
+	while (!stack.empty())
+	{
+		llvm::BasicBlock *block = stack.back().first;
+		unsigned index = stack.back().second;
+		llvm::BranchInst *branch = IfConverter::getBranch(block);
+		if (branch && index < branch->getNumSuccessors())
+		{
+			llvm::BasicBlock *successor = branch->getSuccessor(index);
+			stack.back().second++;
+			if (states[successor] == StateVisiting)
+			{
+				if (latches[successor].empty())
+					headers.push_back(successor);
+				latches[successor].push_back(block);
+			}
+			else if (states[successor] == StateUnvisited)
+			{
+				states[successor] = StateVisiting;
+				stack.push_back(std::make_pair(successor, 0u));
+			}
+			continue;
+		}
+		states[block] = StateVisited;
+		stack.pop_back();
+	}
+
+	for (llvm::BasicBlock *header : headers)
+	{
+		if (visited_headers.count(header) || latches[header].size() != 1)
+			continue;
+
+		// Blocks reaching the latch without going through the header
+		std::set<llvm::BasicBlock *> members = { header };
+		std::vector<llvm::BasicBlock *> worklist = { latches[header][0] };
+		while (!worklist.empty())
+		{
+			llvm::BasicBlock *block = worklist.back();
+			worklist.pop_back();
+			if (!states[block] || !members.insert(block).second)
+				continue;
+			for (llvm::pred_iterator it = llvm::pred_begin(block),
+					e = llvm::pred_end(block); it != e; ++it)
+				worklist.push_back(*it);
+		}
+
+		// Outer loops wait until their inner loops are unrolled
+		bool innermost = true;
+		for (llvm::BasicBlock *other : headers)
+			innermost = innermost && (other == header || !members.count(other));
+		if (!innermost)
+			continue;
+
+		loop = Loop();
+		loop.header = header;
+		loop.latch = latches[header][0];
+		loop.last_latch = loop.latch;
+		for (llvm::Function::iterator it = function.begin(),
+				e = function.end(); it != e; ++it)
+			if (&*it != header && members.count(&*it))
+				loop.blocks.push_back(&*it);
+		loop.blocks.insert(loop.blocks.begin(), header);
+		visited_headers.insert(header);
+		if (analyzeLoop(loop))
+			return true;
+	}
+	return false;
+}
+
+
+bool LoopUnroller::analyzeLoop(Loop &loop)
+{
+	// The header tests the exit, and other blocks stay in the loop
+	auto inLoop = [&loop](llvm::BasicBlock *block)
+	{
+		return std::find(loop.blocks.begin(), loop.blocks.end(), block) !=
+				loop.blocks.end();
+	};
+	llvm::BranchInst *branch = IfConverter::getBranch(loop.header);
+	if (!branch || !branch->isConditional())
+		return false;
+	int index = inLoop(branch->getSuccessor(0)) ? 0 : 1;
+	loop.body = branch->getSuccessor(index);
+	loop.exit = branch->getSuccessor(1 - index);
+	if (!inLoop(loop.body) || inLoop(loop.exit) || loop.body == loop.header)
+		return false;
+	for (llvm::BasicBlock *block : loop.blocks)
+	{
+		llvm::BranchInst *block_branch = IfConverter::getBranch(block);
+		if (!block_branch)
+			return false;
+		for (unsigned succ = 0; block != loop.header &&
+				succ < block_branch->getNumSuccessors(); succ++)
+			if (!inLoop(block_branch->getSuccessor(succ)))
+				return false;
+	}
+	if (IfConverter::getBranch(loop.latch)->isConditional())
+		return false;
+
+	// A single block enters the loop
+	for (llvm::pred_iterator it = llvm::pred_begin(loop.header),
+			e = llvm::pred_end(loop.header); it != e; ++it)
+	{
+		if (*it == loop.latch)
+			continue;
+		if (loop.preheader && loop.preheader != *it)
+			return false;
+		loop.preheader = *it;
+	}
+	return loop.preheader && IfConverter::getBranch(loop.preheader);
+}
+
+
+bool LoopUnroller::evaluate(const Loop &loop, llvm::Value *value,
+		llvm::DenseMap<llvm::Value *, llvm::APInt> &values)
+{
+	auto it = values.find(value);
+	if (it != values.end())
+		return true;
+	if (llvm::ConstantInt *constant = llvm::dyn_cast<llvm::ConstantInt>(value))
+	{
+		values[value] = constant->getValue();
+		return true;
+	}
+
+	// Only binary operators and comparisons of the loop, other than phi
+	// nodes, are computed
+	llvm::Instruction *instruction = llvm::dyn_cast<llvm::Instruction>(value);
+	if (!instruction || llvm::isa<llvm::PHINode>(instruction) ||
+			std::find(loop.blocks.begin(), loop.blocks.end(),
+			instruction->getParent()) == loop.blocks.end() ||
+			instruction->getNumOperands() != 2 ||
+			!evaluate(loop, instruction->getOperand(0), values) ||
+			!evaluate(loop, instruction->getOperand(1), values))
+		return false;
+	const llvm::APInt &a = values.find(instruction->getOperand(0))->second;
+	const llvm::APInt &b = values.find(instruction->getOperand(1))->second;
+	llvm::APInt result;
+	if (llvm::ICmpInst *icmp = llvm::dyn_cast<llvm::ICmpInst>(instruction))
+	{
+		bool taken;
+		switch (icmp->getPredicate())
+		{
+		case llvm::CmpInst::ICMP_EQ: taken = a.eq(b); break;
+		case llvm::CmpInst::ICMP_NE: taken = a.ne(b); break;
+		case llvm::CmpInst::ICMP_SGT: taken = a.sgt(b); break;
+		case llvm::CmpInst::ICMP_SGE: taken = a.sge(b); break;
+		case llvm::CmpInst::ICMP_SLT: taken = a.slt(b); break;
+		case llvm::CmpInst::ICMP_SLE: taken = a.sle(b); break;
+		case llvm::CmpInst::ICMP_UGT: taken = a.ugt(b); break;
+		case llvm::CmpInst::ICMP_UGE: taken = a.uge(b); break;
+		case llvm::CmpInst::ICMP_ULT: taken = a.ult(b); break;
+		case llvm::CmpInst::ICMP_ULE: taken = a.ule(b); break;
+		default: return false;
+		}
+		result = llvm::APInt(1, taken);
+	}
+	else
+	{
+		switch (instruction->getOpcode())
+		{
+		case llvm::Instruction::Add: result = a + b; break;
+		case llvm::Instruction::Sub: result = a - b; break;
+		case llvm::Instruction::Mul: result = a * b; break;
+		case llvm::Instruction::Xor: result = a ^ b; break;
+		case llvm::Instruction::And: result = a & b; break;
+		case llvm::Instruction::Or: result = a | b; break;
+		case llvm::Instruction::Shl:
+		case llvm::Instruction::LShr:
+
+			// Shifts by the width or more are undefined
+			if (b.uge(a.getBitWidth()))
+				return false;
+			result = instruction->getOpcode() == llvm::Instruction::Shl ?
+					a.shl(b.getZExtValue()) : a.lshr(b.getZExtValue());
+			break;
+		default:
+			return false;
+		}
+	}
+	values[value] = result;
+	return true;
+}
+
+
+int LoopUnroller::getTripCount(const Loop &loop)
+{
+	// Phi nodes with a constant initial value
+	llvm::DenseMap<llvm::Value *, llvm::APInt> phi_values;
+	for (llvm::BasicBlock::iterator it = loop.header->begin();
+			llvm::isa<llvm::PHINode>(it); ++it)
+	{
+		llvm::PHINode *phi = llvm::cast<llvm::PHINode>(it);
+		if (llvm::ConstantInt *constant = llvm::dyn_cast<llvm::ConstantInt>(
+				phi->getIncomingValueForBlock(loop.preheader)))
+			phi_values[phi] = constant->getValue();
+	}
+
+	// Run the iterations until the exit test holds. Phi nodes whose next
+	// value is not a constant are forgotten.
+	llvm::BranchInst *branch = IfConverter::getBranch(loop.header);
+	bool exit_value = branch->getSuccessor(0) == loop.exit;
+	for (int trip_count = 0; trip_count <= max_trip_count; trip_count++)
+	{
+		llvm::DenseMap<llvm::Value *, llvm::APInt> values = phi_values;
+		if (!evaluate(loop, branch->getCondition(), values))
+			return -1;
+		if (values.find(branch->getCondition())->second.getBoolValue() ==
+				exit_value)
+			return trip_count;
+		llvm::DenseMap<llvm::Value *, llvm::APInt> next_values;
+		for (auto &phi_value : phi_values)
+		{
+			llvm::Value *next = llvm::cast<llvm::PHINode>(phi_value.first)->
+					getIncomingValueForBlock(loop.latch);
+			if (evaluate(loop, next, values))
+				next_values[phi_value.first] = values.find(next)->second;
+		}
+		phi_values = next_values;
+	}
+	return -1;
+}
+
+
+llvm::BasicBlock *LoopUnroller::cloneIteration(Loop &loop,
+		llvm::DenseMap<llvm::Value *, llvm::Value *> &value_map,
+		bool peeled)
+{
+	// Copy the instructions up to the terminator of every block, except
+	// for the phi nodes of the header, already in the map. Peeled copies
+	// go before the header, others at the end of the function.
+	llvm::Function *function = loop.header->getParent();
+	std::vector<std::pair<llvm::Instruction *, llvm::Instruction *>> clones;
+	for (llvm::BasicBlock *block : loop.blocks)
+	{
+		llvm::BasicBlock *copy = llvm::BasicBlock::Create(
+				function->getContext(), block->getName(), function,
+				peeled ? loop.header : nullptr);
+		value_map[block] = copy;
+		changed_blocks.push_back(copy);
+		for (llvm::BasicBlock::iterator it = block->begin(), e = block->end();
+				it != e; ++it)
+		{
+			if (block == loop.header && llvm::isa<llvm::PHINode>(it))
+				continue;
+			llvm::Instruction *clone = it->clone();
+			clone->setName(it->getName());
+			copy->getInstList().push_back(clone);
+			value_map[&*it] = clone;
+			clones.push_back(std::make_pair(&*it, clone));
+			if (it->isTerminator())
+				break;
+		}
+	}
+
+	// Read the copied values
+	for (auto &pair : clones)
+	{
+		llvm::Instruction *clone = pair.second;
+		for (unsigned index = 0; index < clone->getNumOperands(); index++)
+		{
+			auto it = value_map.find(clone->getOperand(index));
+			if (it != value_map.end())
+				clone->setOperand(index, it->second);
+		}
+		if (llvm::PHINode *phi = llvm::dyn_cast<llvm::PHINode>(clone))
+			for (unsigned index = 0; index < phi->getNumIncomingValues();
+					index++)
+			{
+				auto it = value_map.find(phi->getIncomingBlock(index));
+				if (it != value_map.end())
+					phi->setIncomingBlock(index,
+							llvm::cast<llvm::BasicBlock>(it->second));
+			}
+	}
+
+	// Fold the copies with constant operands, such as counters of peeled
+	// iterations
+	for (auto &pair : clones)
+	{
+		llvm::Instruction *clone = pair.second;
+		if (clone->getNumOperands() != 2 ||
+				!llvm::isa<llvm::Constant>(clone->getOperand(0)) ||
+				!llvm::isa<llvm::Constant>(clone->getOperand(1)))
+			continue;
+		llvm::Constant *a = llvm::cast<llvm::Constant>(clone->getOperand(0));
+		llvm::Constant *b = llvm::cast<llvm::Constant>(clone->getOperand(1));
+		llvm::Constant *folded = nullptr;
+		if (llvm::ICmpInst *icmp = llvm::dyn_cast<llvm::ICmpInst>(clone))
+			folded = llvm::ConstantExpr::getICmp(icmp->getPredicate(), a, b);
+		else if (llvm::isa<llvm::BinaryOperator>(clone))
+			folded = llvm::ConstantExpr::get(clone->getOpcode(), a, b);
+		if (!folded || !llvm::isa<llvm::ConstantInt>(folded))
+			continue;
+		clone->replaceAllUsesWith(folded);
+		clone->eraseFromParent();
+		value_map[pair.first] = folded;
+	}
+
+	// The copy of the header always enters the body, and the copy of the
+	// latch branches to the header
+	llvm::BasicBlock *header_copy = llvm::cast<llvm::BasicBlock>(
+			value_map[loop.header]);
+	llvm::BranchInst *branch = IfConverter::getBranch(header_copy);
+	llvm::Value *condition = branch->getCondition();
+	branch->eraseFromParent();
+	llvm::BranchInst::Create(llvm::cast<llvm::BasicBlock>(
+			value_map[loop.body]), header_copy);
+	llvm::RecursivelyDeleteTriviallyDeadInstructions(condition);
+	llvm::BasicBlock *latch_copy = llvm::cast<llvm::BasicBlock>(
+			value_map[loop.latch]);
+	IfConverter::getBranch(latch_copy)->setSuccessor(0, loop.header);
+	return latch_copy;
+}
+
+
+void LoopUnroller::peelIteration(Loop &loop)
+{
+	// The copy reads the initial values of the phi nodes, and the header
+	// reads the values of the copy
+	llvm::DenseMap<llvm::Value *, llvm::Value *> value_map;
+	for (auto &recurrence : loop.recurrences)
+		value_map[recurrence.first] = recurrence.first->
+				getIncomingValueForBlock(loop.preheader);
+	llvm::BasicBlock *latch_copy = cloneIteration(loop, value_map, true);
+	loop.preheader->getTerminator()->replaceUsesOfWith(loop.header,
+			value_map[loop.header]);
+	for (auto &recurrence : loop.recurrences)
+	{
+		llvm::PHINode *phi = recurrence.first;
+		int index = phi->getBasicBlockIndex(loop.preheader);
+		auto it = value_map.find(recurrence.second);
+		phi->setIncomingBlock(index, latch_copy);
+		phi->setIncomingValue(index, it == value_map.end() ?
+				recurrence.second : it->second);
+	}
+	loop.preheader = latch_copy;
+}
+
+
+void LoopUnroller::appendIteration(Loop &loop)
+{
+	// The copy reads the values carried by the last latch, and replaces
+	// it
+	llvm::DenseMap<llvm::Value *, llvm::Value *> value_map;
+	for (auto &recurrence : loop.recurrences)
+		value_map[recurrence.first] = recurrence.first->
+				getIncomingValueForBlock(loop.last_latch);
+	llvm::BasicBlock *latch_copy = cloneIteration(loop, value_map, false);
+	IfConverter::getBranch(loop.last_latch)->setSuccessor(0,
+			llvm::cast<llvm::BasicBlock>(value_map[loop.header]));
+	for (auto &recurrence : loop.recurrences)
+	{
+		llvm::PHINode *phi = recurrence.first;
+		int index = phi->getBasicBlockIndex(loop.last_latch);
+		auto it = value_map.find(recurrence.second);
+		phi->setIncomingBlock(index, latch_copy);
+		phi->setIncomingValue(index, it == value_map.end() ?
+				recurrence.second : it->second);
+	}
+	loop.last_latch = latch_copy;
+}
+
+
+void LoopUnroller::removeLoop(Loop &loop)
+{
+	// The header branches to the exit, and its phi nodes take their
+	// initial value
+	llvm::BranchInst *branch = IfConverter::getBranch(loop.header);
+	llvm::Value *condition = branch->getCondition();
+	branch->eraseFromParent();
+	llvm::BranchInst::Create(loop.exit, loop.header);
+	llvm::RecursivelyDeleteTriviallyDeadInstructions(condition);
+	for (auto &recurrence : loop.recurrences)
+	{
+		llvm::PHINode *phi = recurrence.first;
+		phi->replaceAllUsesWith(phi->getIncomingValueForBlock(
+				loop.preheader));
+		phi->eraseFromParent();
+	}
+	loop.recurrences.clear();
+
+	// The body is not reached anymore
+	for (llvm::BasicBlock *block : loop.blocks)
+		if (block != loop.header)
+			block->dropAllReferences();
+	for (llvm::BasicBlock *block : loop.blocks)
+		if (block != loop.header)
+			block->eraseFromParent();
+	changed_blocks.push_back(loop.header);
+}
+
+
+void LoopUnroller::mergeBlocks()
+{
+	for (llvm::BasicBlock *block : changed_blocks)
+	{
+		llvm::BasicBlock *predecessor = block->getSinglePredecessor();
+		llvm::BranchInst *branch = predecessor && predecessor != block ?
+				IfConverter::getBranch(predecessor) : nullptr;
+		if (branch && !branch->isConditional())
+			llvm::MergeBlockIntoPredecessor(block);
+	}
+	changed_blocks.clear();
+}
+
+
+bool LoopUnroller::run(llvm::Function &function)
+{
+	std::map<std::string, int> factors = getUnrollFactors();
+	bool changed = false;
+	Loop loop;
+	while (findLoop(function, loop))
+	{
+		// Loops with a small trip count are fully unrolled by default, and
+		// so are the shifts of sliding windows, mapped to shift registers
+		std::string name = loop.header->getName().str();
+		auto it = factors.find(name);
+		int trip_count = getTripCount(loop);
+		int factor = it != factors.end() ? it->second :
+				trip_count >= 0 && (trip_count <= (int) UnrollThreshold ||
+				MemoryMapper::isShift(loop.blocks)) ? trip_count : 1;
+		std::ostringstream os;
+		os << "loop " << name << ": ";
+		if (trip_count < 0)
+		{
+			if (it != factors.end())
+				module.addComment(os.str() +
+						"trip count unknown, not unrolled");
+			continue;
+		}
+		if (factor < trip_count && factor <= 1)
+			continue;
+
+		// Phi nodes of the header and the values carried by the latch
+		for (llvm::BasicBlock::iterator it = loop.header->begin();
+				llvm::isa<llvm::PHINode>(it); ++it)
+		{
+			llvm::PHINode *phi = llvm::cast<llvm::PHINode>(it);
+			loop.recurrences.push_back(std::make_pair(phi,
+					phi->getIncomingValueForBlock(loop.latch)));
+		}
+
+		// Peel all iterations, or those that are not a multiple of the
+		// factor
+		os << trip_count << (trip_count == 1 ? " iteration" : " iterations");
+		if (factor >= trip_count)
+		{
+			for (int iteration = 0; iteration < trip_count; iteration++)
+				peelIteration(loop);
+			removeLoop(loop);
+			visited_headers.erase(loop.header);
+			os << ", fully unrolled";
+		}
+		else
+		{
+			for (int iteration = 0; iteration < trip_count % factor;
+					iteration++)
+				peelIteration(loop);
+			for (int copy = 1; copy < factor; copy++)
+				appendIteration(loop);
+			os << ", unrolled " << factor << " times";
+		}
+		module.addComment(os.str());
+		mergeBlocks();
+		changed = true;
+	}
+	return changed;
+}
+
+}
@@ -0,0 +1,129 @@
+/**
+ * @file   LoopUnroller.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  LoopUnroller class unrolls the loops of an LLVM function whose
+ *         trip count is known at compile time.
+ */
+
+#ifndef VERILOG_LOOP_UNROLLER_H
+#define VERILOG_LOOP_UNROLLER_H
+
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace verilog
+{
+
+// Forward declarations
+class Module;
+
+
+// Innermost loops with the shape of a 'while' are unrolled before
+// translation: a header holding the phi nodes and the only exit test, and
+// a body reached from it, branching back to it from a single latch. The
+// trip count is found by running the loop on constants, as long as the
+// exit test only depends on phi nodes with constant initial values.
+//
+// Loops with a trip count up to '-verilog-unroll-threshold' are fully
+// unrolled, leaving a datapath without loops, as well as loops shifting
+// the elements of an array, which become shift registers once unrolled.
+// '-verilog-unroll-factor' gives the factor of a loop, named by the label
+// of its header.
+// Iterations are peeled off in front of the loop, each copy branching to
+// the next one, and a loop unrolled by a factor 'n' runs 'n' copies of its
+// body per exit test once the remaining iterations are a multiple of 'n'.
+// Straight-line copies are then merged into single blocks.
+class LoopUnroller
+{
+	// A loop, with the block entering it and the block it exits to
+	struct Loop
+	{
+		llvm::BasicBlock *header = nullptr;
+		llvm::BasicBlock *latch = nullptr;
+		llvm::BasicBlock *preheader = nullptr;
+		llvm::BasicBlock *exit = nullptr;
+
+		// Block branching back to the header, the latch or its last copy
+		llvm::BasicBlock *last_latch = nullptr;
+
+		// Successor of the header in the loop
+		llvm::BasicBlock *body = nullptr;
+
+		// Blocks of the loop, header first, in function order
+		std::vector<llvm::BasicBlock *> blocks;
+
+		// Phi nodes of the header and the values carried by the latch
+		std::vector<std::pair<llvm::PHINode *, llvm::Value *>> recurrences;
+	};
+
+	// Module being translated, where unrolled loops are reported
+	Module &module;
+
+	// Headers of the loops already considered
+	std::set<llvm::BasicBlock *> visited_headers;
+
+	// Blocks created or changed by unrolling, merged in the end
+	std::vector<llvm::BasicBlock *> changed_blocks;
+
+	// Find an innermost loop not visited yet. Return false if none is
+	// left.
+	bool findLoop(llvm::Function &function, Loop &loop);
+
+	// Return whether a loop has the shape of a 'while', and complete its
+	// description
+	bool analyzeLoop(Loop &loop);
+
+	// Compute the value of an LLVM value in an iteration, given the
+	// values of the phi nodes of the header. Return false if it is not a
+	// constant.
+	bool evaluate(const Loop &loop, llvm::Value *value,
+			llvm::DenseMap<llvm::Value *, llvm::APInt> &values);
+
+	// Return the trip count of a loop, or -1 if it is not a constant
+	// no larger than 'max_trip_count'
+	int getTripCount(const Loop &loop);
+
+	// Copy the blocks of one iteration, reading the given values of the
+	// phi nodes, and branching from the copy of the latch to the header.
+	// Return the copy of the latch.
+	llvm::BasicBlock *cloneIteration(Loop &loop,
+			llvm::DenseMap<llvm::Value *, llvm::Value *> &value_map,
+			bool peeled);
+
+	// Run the first iteration before the loop
+	void peelIteration(Loop &loop);
+
+	// Run one more iteration after the latch, without exit test
+	void appendIteration(Loop &loop);
+
+	// Remove a loop whose exit test fails on entry
+	void removeLoop(Loop &loop);
+
+	// Merge the changed blocks into their predecessors
+	void mergeBlocks();
+
+public:
+
+	// Largest trip count found by running a loop
+	static const int max_trip_count = 1 << 16;
+
+	// Constructor
+	LoopUnroller(Module &module);
+
+	// Unroll the loops of a function. Return whether it was changed.
+	bool run(llvm::Function &function);
+};
+
+}
+
+#endif
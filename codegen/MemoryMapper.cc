@@ -0,0 +1,1460 @@
+/**
+ * @file   MemoryMapper.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the mapping of arrays to block RAMs and
+ *         registers.
+ */
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/Support/CFG.h"
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "Bits.h"
+#include "CodeBlock.h"
+#include "Error.h"
+#include "MemoryMapper.h"
+#include "Module.h"
+#include "Netlist.h"
+#include "StateMachine.h"
+#include "StrengthReducer.h"
+
+
+namespace verilog
+{
+
+static llvm::cl::list<std::string> Partitions("verilog-partition",
+		llvm::cl::desc("Partition the array named <name>, or the arrays of "
+				"the function named <name>, or all other arrays: 'none' "
+				"for one block RAM, 'cyclic:<n>' or 'block:<n>' for <n> "
+				"block RAMs, or 'complete' for registers"),
+		llvm::cl::value_desc("[name:]kind[:n]"),
+		llvm::cl::CommaSeparated);
+
+static llvm::cl::opt<bool> ShiftRegisters("verilog-shift-registers",
+		llvm::cl::desc("Map the global arrays shifted by one element per "
+				"call to shift registers and line buffers"),
+		llvm::cl::init(true));
+
+static llvm::cl::opt<unsigned> LineBufferThreshold(
+		"verilog-line-buffer-threshold",
+		llvm::cl::desc("Map the runs of at least <n> elements of a shift "
+				"register only read by the shift to block RAMs"),
+		llvm::cl::value_desc("n"),
+		llvm::cl::init(16));
+
+static llvm::cl::opt<unsigned> RomLutThreshold("verilog-rom-lut-threshold",
+		llvm::cl::desc("Map the constant arrays of up to <n> words to lookup "
+				"tables in logic, and larger ones to block ROMs"),
+		llvm::cl::value_desc("n"),
+		llvm::cl::init(64));
+
+
+// Partition names, by partition
+static const char *partition_names[] = {
+	"none",
+	"cyclic",
+	"block",
+	"complete"
+};
+
+
+// Width of element numbers, the width of the indices of the parser
+static const int element_width = 32;
+
+
+// Return the type stored by an alloca or a global variable, or nullptr
+// for other values
+static llvm::Type *getStoredType(llvm::Value *base)
+{
+	if (llvm::AllocaInst *alloca = llvm::dyn_cast<llvm::AllocaInst>(base))
+		return alloca->getAllocatedType();
+	if (llvm::GlobalVariable *global = llvm::dyn_cast<llvm::GlobalVariable>(
+			base))
+		return llvm::cast<llvm::PointerType>(global->getType())->
+				getElementType();
+	return nullptr;
+}
+
+
+// Return the alloca or global variable addressed by a pointer
+static llvm::Value *getBase(llvm::Value *pointer)
+{
+	llvm::GEPOperator *gep = llvm::dyn_cast<llvm::GEPOperator>(pointer);
+	return gep ? gep->getPointerOperand() : pointer;
+}
+
+
+// Return the pointer of a load or a store, or nullptr for other
+// instructions
+static llvm::Value *getPointer(llvm::Instruction *instruction)
+{
+	if (llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(instruction))
+		return load->getPointerOperand();
+	if (llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(instruction))
+		return store->getPointerOperand();
+	return nullptr;
+}
+
+
+// Return the number of scalar elements of a type
+static int getNumElements(llvm::Type *type)
+{
+	int num_elements = 1;
+	while (type->isArrayTy())
+	{
+		num_elements *= type->getArrayNumElements();
+		type = type->getArrayElementType();
+	}
+	return num_elements;
+}
+
+
+// Append the scalar words of a constant to 'words', in memory order.
+// Undefined words are zero.
+static void getWords(llvm::Constant *constant, std::vector<long long> &words)
+{
+	llvm::Type *type = constant->getType();
+	if (type->isArrayTy())
+	{
+		for (unsigned index = 0; index < type->getArrayNumElements(); index++)
+			getWords(constant->getAggregateElement(index), words);
+		return;
+	}
+	llvm::ConstantInt *value = llvm::dyn_cast<llvm::ConstantInt>(constant);
+	words.push_back(value ? value->getSExtValue() : 0);
+}
+
+
+// Return whether a function stores to an alloca or global variable
+static bool isWritten(llvm::Function &function, llvm::Value *base)
+{
+	for (llvm::BasicBlock &block : function)
+		for (llvm::Instruction &instruction : block)
+			if (llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(
+					&instruction))
+				if (getBase(store->getPointerOperand()) == base)
+					return true;
+	return false;
+}
+
+
+// Add the indices of a pointer to an element to 'indices', with the
+// number of elements they step over. Return false if the pointer does
+// not address a scalar element of an array.
+static bool getIndices(llvm::Value *pointer,
+		std::vector<std::pair<llvm::Value *, int>> &indices)
+{
+	llvm::GEPOperator *gep = llvm::dyn_cast<llvm::GEPOperator>(pointer);
+	if (!gep)
+		return true;
+	llvm::Type *type = getStoredType(gep->getPointerOperand());
+	llvm::ConstantInt *first = gep->getNumOperands() > 1 ?
+			llvm::dyn_cast<llvm::ConstantInt>(gep->getOperand(1)) : nullptr;
+	if (!type || !first || !first->isZero())
+		return false;
+	for (unsigned index = 2; index < gep->getNumOperands(); index++)
+	{
+		if (!type->isArrayTy())
+			return false;
+		type = type->getArrayElementType();
+		indices.push_back(std::make_pair(gep->getOperand(index),
+				getNumElements(type)));
+	}
+	return !type->isArrayTy();
+}
+
+
+// Split a value into a base value and a constant offset added to it. The
+// base is nullptr for constants.
+static void getOffset(llvm::Value *value, llvm::Value *&base,
+		long long &offset)
+{
+	offset = 0;
+	while (llvm::BinaryOperator *op = llvm::dyn_cast<llvm::BinaryOperator>(
+			value))
+	{
+		llvm::ConstantInt *constant = llvm::dyn_cast<llvm::ConstantInt>(
+				op->getOperand(1));
+		if (op->getOpcode() == llvm::Instruction::Add && !constant)
+		{
+			constant = llvm::dyn_cast<llvm::ConstantInt>(op->getOperand(0));
+			if (!constant)
+				break;
+			offset += constant->getSExtValue();
+			value = op->getOperand(1);
+		}
+		else if (op->getOpcode() == llvm::Instruction::Add && constant)
+		{
+			offset += constant->getSExtValue();
+			value = op->getOperand(0);
+		}
+		else if (op->getOpcode() == llvm::Instruction::Sub && constant)
+		{
+			offset -= constant->getSExtValue();
+			value = op->getOperand(0);
+		}
+		else
+		{
+			break;
+		}
+	}
+	base = value;
+	if (llvm::ConstantInt *constant = llvm::dyn_cast<llvm::ConstantInt>(value))
+	{
+		offset += constant->getSExtValue();
+		base = nullptr;
+	}
+}
+
+
+// Compute the residue of a value modulo a constant, if it is known at
+// compile time. Phi nodes being analyzed are assumed to have the residue
+// of their constant incoming values, and every other incoming value must
+// agree.
+static bool getResidue(llvm::Value *value, long long modulus,
+		long long &residue, llvm::DenseMap<llvm::Value *, long long> &assumed,
+		int depth = 0)
+{
+	if (llvm::ConstantInt *constant = llvm::dyn_cast<llvm::ConstantInt>(value))
+	{
+		residue = (constant->getSExtValue() % modulus + modulus) % modulus;
+		return true;
+	}
+	auto it = assumed.find(value);
+	if (it != assumed.end())
+	{
+		residue = it->second;
+		return true;
+	}
+	if (depth > 8)
+		return false;
+
+	// Sums, differences and products of known residues
+	if (llvm::BinaryOperator *op = llvm::dyn_cast<llvm::BinaryOperator>(value))
+	{
+		long long first, second;
+		if (!getResidue(op->getOperand(0), modulus, first, assumed, depth + 1))
+			return false;
+		llvm::ConstantInt *amount = llvm::dyn_cast<llvm::ConstantInt>(
+				op->getOperand(1));
+		switch (op->getOpcode())
+		{
+		case llvm::Instruction::Shl:
+			if (!amount || amount->getZExtValue() > 62)
+				return false;
+			second = (1LL << amount->getZExtValue()) % modulus;
+			residue = first * second % modulus;
+			return true;
+
+		case llvm::Instruction::Add:
+		case llvm::Instruction::Sub:
+		case llvm::Instruction::Mul:
+			if (!getResidue(op->getOperand(1), modulus, second, assumed,
+					depth + 1))
+				return false;
+			residue = op->getOpcode() == llvm::Instruction::Add ?
+					first + second : op->getOpcode() ==
+					llvm::Instruction::Sub ? first - second + modulus :
+					first * second;
+			residue %= modulus;
+			return true;
+
+		default:
+			return false;
+		}
+	}
+
+	// Phi nodes with a constant incoming value
+	llvm::PHINode *phi = llvm::dyn_cast<llvm::PHINode>(value);
+	if (!phi)
+		return false;
+	llvm::ConstantInt *initial = nullptr;
+	for (unsigned index = 0; index < phi->getNumIncomingValues() && !initial;
+			index++)
+		initial = llvm::dyn_cast<llvm::ConstantInt>(
+				phi->getIncomingValue(index));
+	if (!initial)
+		return false;
+	residue = (initial->getSExtValue() % modulus + modulus) % modulus;
+	assumed[phi] = residue;
+	for (unsigned index = 0; index < phi->getNumIncomingValues(); index++)
+	{
+		long long other;
+		if (!getResidue(phi->getIncomingValue(index), modulus, other, assumed,
+				depth + 1) || other != residue)
+		{
+			assumed.erase(phi);
+			return false;
+		}
+	}
+	return true;
+}
+
+
+MemoryMapper::MemoryMapper(Module &module) :
+		module(module),
+		netlist(module.getNetlist())
+{
+}
+
+
+MemoryMapper::Partition MemoryMapper::getPartition(
+		const std::string &function_name, const std::string &name, int &factor)
+{
+	// An array takes the partition given for its name, else the one
+	// given for its function, else the default one
+	Partition partitions[3] = { PartitionNone, PartitionNone, PartitionNone };
+	int factors[3] = { 1, 1, 1 };
+	bool given[3] = { };
+	for (const std::string &option : Partitions)
+	{
+		// Fields separated by colons
+		std::vector<std::string> fields;
+		std::istringstream is(option);
+		std::string field;
+		while (std::getline(is, field, ':'))
+			fields.push_back(field);
+
+		// Target, partition, and factor of cyclic and block partitions
+		int partition = PartitionComplete + 1;
+		int first = 0;
+		for (int kind = 0; kind <= PartitionComplete && !fields.empty();
+				kind++)
+			if (fields[0] == partition_names[kind])
+				partition = kind;
+		if (partition > PartitionComplete && fields.size() > 1)
+		{
+			first = 1;
+			for (int kind = 0; kind <= PartitionComplete; kind++)
+				if (fields[1] == partition_names[kind])
+					partition = kind;
+		}
+		bool has_factor = partition == PartitionCyclic ||
+				partition == PartitionBlock;
+		int num_fields = first + (has_factor ? 2 : 1);
+		int value = has_factor && (int) fields.size() == num_fields ?
+				atoi(fields[first + 1].c_str()) : 1;
+		if (partition > PartitionComplete || (first && fields[0].empty()) ||
+				(int) fields.size() != num_fields || value < 1)
+			fatal("Error: invalid partition '" + option +
+					"', expected [<name>:]none|cyclic:<n>|block:<n>|"
+					"complete");
+
+		std::string target = first ? fields[0] : "";
+		int level = target.empty() ? 2 : target == name ? 0 :
+				target == function_name ? 1 : -1;
+		if (level < 0)
+			continue;
+		partitions[level] = (Partition) partition;
+		factors[level] = value;
+		given[level] = true;
+	}
+	for (int level = 0; level < 3; level++)
+	{
+		if (given[level])
+		{
+			factor = factors[level];
+			return partitions[level];
+		}
+	}
+	factor = 1;
+	return PartitionNone;
+}
+
+
+bool MemoryMapper::isShift(const std::vector<llvm::BasicBlock *> &blocks)
+{
+	// Every store writes a word loaded from the same global array
+	bool has_stores = false;
+	for (llvm::BasicBlock *block : blocks)
+	{
+		for (llvm::Instruction &instruction : *block)
+		{
+			llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(
+					&instruction);
+			if (!store)
+				continue;
+			llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(
+					store->getValueOperand());
+			llvm::Value *base = getBase(store->getPointerOperand());
+			if (!ShiftRegisters || !load ||
+					!llvm::isa<llvm::GlobalVariable>(base) ||
+					getBase(load->getPointerOperand()) != base ||
+					std::find(blocks.begin(), blocks.end(), load->getParent()) ==
+					blocks.end())
+				return false;
+			has_stores = true;
+		}
+	}
+	return has_stores;
+}
+
+
+int MemoryMapper::getArray(llvm::Function &function, llvm::Value *pointer)
+{
+	llvm::Value *base = getBase(pointer);
+	auto it = array_indices.find(base);
+	if (it != array_indices.end())
+		return it->second;
+
+	// Only elements of allocas and global variables are accessed
+	std::vector<std::pair<llvm::Value *, int>> indices;
+	llvm::Type *type = getStoredType(base);
+	if (!type || !getIndices(pointer, indices))
+		fatal("Unsupported pointer in load or store");
+
+	// Flattened array. Scalars are registers.
+	Array array;
+	array.name = base->getName().str();
+	array.num_elements = getNumElements(type);
+	while (type->isArrayTy())
+		type = type->getArrayElementType();
+	array.width = Module::translateLLVMType(type, "arrays");
+	array.partition = getStoredType(base)->isArrayTy() ?
+			getPartition(function.getName().str(), array.name, array.factor) :
+			PartitionComplete;
+	array.factor = std::min(array.factor, array.num_elements);
+	switch (array.partition)
+	{
+	case PartitionNone:
+		array.depth = array.num_elements;
+		break;
+
+	case PartitionCyclic:
+		array.num_banks = array.factor;
+		array.depth = (array.num_elements + array.factor - 1) / array.factor;
+		break;
+
+	case PartitionBlock:
+		array.depth = (array.num_elements + array.factor - 1) / array.factor;
+		array.num_banks = (array.num_elements + array.depth - 1) / array.depth;
+		break;
+
+	case PartitionComplete:
+		array.num_banks = 0;
+		break;
+	}
+
+	// Global arrays with an initializer start with its words. Those never
+	// written are ROMs, and small ones are lookup tables.
+	llvm::GlobalVariable *global = llvm::dyn_cast<llvm::GlobalVariable>(base);
+	if (global && global->hasInitializer())
+	{
+		getWords(global->getInitializer(), array.contents);
+		array.read_only = !isWritten(function, base);
+		if (!array.read_only && global->isConstant())
+			fatal("Store to constant array '" + array.name + "'");
+	}
+	if (array.read_only && array.partition != PartitionComplete &&
+			array.num_elements <= (int) RomLutThreshold)
+	{
+		array.num_banks = 0;
+		array.depth = array.num_elements;
+		array.lut = netlist.addMemory(array.width, array.num_elements);
+		netlist.setMemoryContents(array.lut, array.contents);
+	}
+	array.banks.resize(array.num_banks);
+
+	int index = arrays.size();
+	arrays.push_back(std::move(array));
+	array_indices[base] = index;
+	return index;
+}
+
+
+bool MemoryMapper::getConstantElement(llvm::Value *pointer, long long &element)
+{
+	std::vector<std::pair<llvm::Value *, int>> indices;
+	getIndices(pointer, indices);
+	element = 0;
+	for (auto &index : indices)
+	{
+		llvm::ConstantInt *constant = llvm::dyn_cast<llvm::ConstantInt>(
+				index.first);
+		if (!constant)
+			return false;
+		element += constant->getSExtValue() * index.second;
+	}
+	return true;
+}
+
+
+int MemoryMapper::getBank(const Array &array, llvm::Value *pointer)
+{
+	if (array.num_banks == 1)
+		return 0;
+
+	// Elements of block partitions are only known if constant
+	long long element;
+	if (getConstantElement(pointer, element))
+		return array.partition == PartitionCyclic ?
+				element % array.num_banks : element / array.depth;
+	if (array.partition != PartitionCyclic)
+		return -1;
+
+	// Residue of the element number by the number of banks, such as the
+	// counter of a loop unrolled by as many iterations plus a constant
+	std::vector<std::pair<llvm::Value *, int>> indices;
+	getIndices(pointer, indices);
+	llvm::DenseMap<llvm::Value *, long long> assumed;
+	long long bank = 0;
+	for (auto &index : indices)
+	{
+		long long residue;
+		if (!getResidue(index.first, array.num_banks, residue, assumed))
+			return -1;
+		bank = (bank + residue * index.second) % array.num_banks;
+	}
+	return bank;
+}
+
+
+void MemoryMapper::findShifts(llvm::Function &function)
+{
+	if (!ShiftRegisters)
+		return;
+
+	// Loads and stores of global arrays, by array, and the position of
+	// every instruction in its block
+	std::vector<llvm::Value *> bases;
+	std::map<llvm::Value *, std::vector<llvm::Instruction *>> base_accesses;
+	llvm::DenseMap<llvm::Instruction *, int> positions;
+	for (llvm::BasicBlock &block : function)
+	{
+		int position = 0;
+		for (llvm::Instruction &instruction : block)
+		{
+			positions[&instruction] = position++;
+			llvm::Value *pointer = getPointer(&instruction);
+			llvm::Value *base = pointer ? getBase(pointer) : nullptr;
+			llvm::Type *type = base ? getStoredType(base) : nullptr;
+			if (!base || !llvm::isa<llvm::GlobalVariable>(base) || !type ||
+					!type->isArrayTy())
+				continue;
+			if (base_accesses[base].empty())
+				bases.push_back(base);
+			base_accesses[base].push_back(&instruction);
+		}
+	}
+
+	for (llvm::Value *base : bases)
+	{
+		std::vector<llvm::Instruction *> &instructions = base_accesses[base];
+		Array &array = arrays[getArray(function, getPointer(instructions[0]))];
+		int num_elements = array.num_elements;
+		if (num_elements < 2)
+			continue;
+
+		// Store of every element, and the load of its block whose word it
+		// stores, if any, with the number of loads of every element
+		bool valid = true;
+		llvm::BasicBlock *shift_block = nullptr;
+		std::vector<llvm::StoreInst *> stores(num_elements, nullptr);
+		std::vector<llvm::LoadInst *> sources(num_elements, nullptr);
+		std::vector<int> num_loads(num_elements, 0);
+		llvm::DenseMap<llvm::Instruction *, long long> elements;
+		for (llvm::Instruction *instruction : instructions)
+		{
+			long long element;
+			valid = valid && getConstantElement(getPointer(instruction),
+					element) && element >= 0 && element < num_elements;
+			if (!valid)
+				break;
+			elements[instruction] = element;
+			llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(
+					instruction);
+			if (!store)
+			{
+				num_loads[element]++;
+				continue;
+			}
+			valid = !stores[element];
+			stores[element] = store;
+			llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(
+					store->getValueOperand());
+			if (!load || !elements.count(load) ||
+					load->getParent() != store->getParent())
+				continue;
+			valid = valid && (!shift_block ||
+					store->getParent() == shift_block);
+			shift_block = store->getParent();
+			sources[element] = load;
+		}
+
+		// Every element but the one entering the array takes the old value
+		// of its neighbour, all in the same direction and in the same block.
+		// The element entering the array may be stored in another block.
+		int step = 0;
+		int input = -1;
+		for (int element = 0; valid && element < num_elements; element++)
+		{
+			valid = stores[element] != nullptr;
+			if (!valid || !sources[element])
+			{
+				valid = valid && input < 0;
+				input = element;
+				continue;
+			}
+			int source = elements[sources[element]];
+			step = step ? step : element - source;
+			llvm::StoreInst *source_store = source >= 0 &&
+					source < num_elements ? stores[source] : nullptr;
+			valid = (step == 1 || step == -1) && element - source == step &&
+					source_store && (source_store->getParent() != shift_block ||
+					positions[sources[element]] < positions[source_store]);
+		}
+		if (!valid || !shift_block || input != (step > 0 ? 0 :
+				num_elements - 1))
+			continue;
+		array.partition = PartitionComplete;
+		array.num_banks = 0;
+		array.depth = 0;
+		array.banks.clear();
+		array.shift_block = shift_block;
+		array.element_lines.assign(num_elements, -1);
+
+		// Elements only loaded to be moved to their neighbour are kept in
+		// line buffers
+		std::vector<bool> moved(num_elements, false);
+		for (int element = 0; element < num_elements; element++)
+		{
+			int next = element + step;
+			moved[element] = element != input && next >= 0 &&
+					next < num_elements && num_loads[element] == 1 &&
+					sources[next] && sources[next]->hasOneUse();
+		}
+		for (int element = 0; element < num_elements; )
+		{
+			int end = element;
+			while (end < num_elements && moved[end])
+				end++;
+			if (end - element >= (int) LineBufferThreshold && end > element)
+			{
+				DelayLine line;
+				line.first = element;
+				line.length = end - element;
+				line.entering = step > 0 ? element : end - 1;
+				line.leaving = step > 0 ? end - 1 : element;
+				line.moves.push_back(sources[line.leaving + step]);
+				for (int other = element; other < end; other++)
+				{
+					line.moves.push_back(stores[other]);
+					array.element_lines[other] = array.delay_lines.size();
+				}
+				array.delay_lines.push_back(line);
+			}
+			element = std::max(end, element + 1);
+		}
+	}
+}
+
+
+void MemoryMapper::addRegisters()
+{
+	for (Array &array : arrays)
+	{
+		if (array.partition != PartitionComplete || array.read_only)
+			continue;
+
+		// Registers are reset to zero, and cannot start with other words
+		for (long long word : array.contents)
+		{
+			if (word)
+				fatal("Unsupported initial values of array '" +
+						array.name + "' mapped to registers");
+		}
+
+		// Line buffers are shifted by a single state, never running twice
+		// in a row, so that the word read at the pointer is up to date. Blocks
+		// split by the memory ports may have moved their accesses to
+		// different states, which keep registers.
+		std::vector<DelayLine> delay_lines;
+		for (DelayLine &line : array.delay_lines)
+		{
+			llvm::BasicBlock *block = line.moves[0]->getParent();
+			bool kept = true;
+			for (llvm::Instruction *move : line.moves)
+				kept = kept && move->getParent() == block;
+			for (llvm::succ_iterator it = llvm::succ_begin(block),
+					e = llvm::succ_end(block); it != e; ++it)
+				kept = kept && *it != block;
+			for (int element = line.first; element < line.first + line.length;
+					element++)
+				array.element_lines[element] = kept ? delay_lines.size() : -1;
+			if (kept)
+				delay_lines.push_back(line);
+		}
+		array.delay_lines.swap(delay_lines);
+		if (!array.delay_lines.empty())
+			array.shift_block = array.delay_lines[0].moves[0]->getParent();
+
+		array.registers.assign(array.num_elements, -1);
+		for (int element = 0; element < array.num_elements; element++)
+			if (array.element_lines.empty() || array.element_lines[element] < 0)
+				array.registers[element] = netlist.addRegister(array.width);
+		array.values.assign(array.num_elements, -1);
+		array.writes.resize(array.num_elements);
+	}
+}
+
+
+int MemoryMapper::getDelayLine(const Array &array, llvm::Value *pointer,
+		long long &element)
+{
+	if (array.delay_lines.empty() || !getConstantElement(pointer, element))
+		return -1;
+	return array.element_lines[element];
+}
+
+
+bool MemoryMapper::isDistinct(llvm::Value *first, llvm::Value *second)
+{
+	long long first_element, second_element;
+	if (getConstantElement(first, first_element) &&
+			getConstantElement(second, second_element))
+		return first_element != second_element;
+
+	// Indices differing by a constant in a single dimension
+	llvm::GEPOperator *first_gep = llvm::dyn_cast<llvm::GEPOperator>(first);
+	llvm::GEPOperator *second_gep = llvm::dyn_cast<llvm::GEPOperator>(second);
+	if (!first_gep || !second_gep ||
+			first_gep->getNumOperands() != second_gep->getNumOperands())
+		return false;
+	int differing = -1;
+	for (unsigned index = 0; index < first_gep->getNumOperands(); index++)
+	{
+		if (first_gep->getOperand(index) == second_gep->getOperand(index))
+			continue;
+		if (differing >= 0)
+			return false;
+		differing = index;
+	}
+	if (differing < 0)
+		return false;
+	llvm::Value *first_base, *second_base;
+	long long first_offset, second_offset;
+	getOffset(first_gep->getOperand(differing), first_base, first_offset);
+	getOffset(second_gep->getOperand(differing), second_base, second_offset);
+	return first_base == second_base && first_offset != second_offset;
+}
+
+
+bool MemoryMapper::scheduleBlock(llvm::BasicBlock *block)
+{
+	// Ports used in the current state by bank, with the pointers stored
+	// to, and the loads whose word is read in the next state
+	std::map<std::pair<int, int>, int> used;
+	std::map<std::pair<int, int>, std::vector<llvm::Value *>> stored;
+	std::vector<llvm::Instruction *> pending;
+
+	// Return whether an access fits in the ports left in the current
+	// state, with its port and the banks it uses
+	auto fits = [&](llvm::Value *pointer, AccessInfo &info, int &first_bank,
+			int &last_bank)
+	{
+		// A port of every bank accessed. Words stored in the state may
+		// not be loaded, and no two stores may write the same word.
+		info.array = getArray(*block->getParent(), pointer);
+		Array &array = arrays[info.array];
+		first_bank = 0;
+		last_bank = -1;
+		if (array.partition != PartitionComplete && array.lut < 0)
+		{
+			info.bank = getBank(array, pointer);
+			first_bank = info.bank < 0 ? 0 : info.bank;
+			last_bank = info.bank < 0 ? array.num_banks - 1 : info.bank;
+		}
+		bool distinct = true;
+		for (int bank = first_bank; bank <= last_bank; bank++)
+		{
+			auto key = std::make_pair(info.array, bank);
+			info.port = std::max(info.port, used[key]);
+			for (llvm::Value *other : stored[key])
+				distinct = distinct && isDistinct(other, pointer);
+		}
+		return distinct && info.port < num_ports;
+	};
+
+	// Add an access to the current state
+	auto addAccess = [&](llvm::Instruction *instruction, llvm::Value *pointer,
+			const AccessInfo &info, int first_bank, int last_bank)
+	{
+		accesses[instruction] = info;
+		for (int bank = first_bank; bank <= last_bank; bank++)
+		{
+			auto key = std::make_pair(info.array, bank);
+			used[key] = info.port + 1;
+			if (llvm::isa<llvm::StoreInst>(instruction))
+				stored[key].push_back(pointer);
+		}
+		if (llvm::isa<llvm::LoadInst>(instruction) && last_bank >= 0)
+			pending.push_back(instruction);
+	};
+
+	for (llvm::BasicBlock::iterator it(block->getFirstNonPHI()),
+			e = block->end(); it != e; ++it)
+	{
+		llvm::Instruction *instruction = &*it;
+		llvm::Value *pointer = nullptr;
+		if (llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(instruction))
+			pointer = load->getPointerOperand();
+		else if (llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(
+				instruction))
+			pointer = store->getPointerOperand();
+
+		// Words loaded are only read in the next state
+		bool waits = false;
+		for (unsigned index = 0; index < instruction->getNumOperands(); index++)
+			waits = waits || std::find(pending.begin(), pending.end(),
+					instruction->getOperand(index)) != pending.end();
+
+		AccessInfo info;
+		int first_bank, last_bank = -1;
+		bool split = waits || (pointer && !fits(pointer, info, first_bank,
+				last_bank));
+
+		// Later loads not depending on the words being loaded are moved to
+		// the current state while its ports last, with their addresses, so
+		// that a chain of loads and uses takes one state per word and not
+		// two. Loads are not moved above calls, or stores that may write
+		// their word.
+		if (waits)
+		{
+			// Instructions left in place, and the instructions free of side
+			// effects that may be moved with the addresses depending on them
+			std::set<llvm::Value *> blocked(pending.begin(), pending.end());
+			std::vector<llvm::Instruction *> movable;
+			std::vector<llvm::StoreInst *> stores;
+			for (llvm::BasicBlock::iterator later = it;
+					!later->isTerminator(); )
+			{
+				llvm::Instruction *candidate = &*later++;
+				bool ready = true;
+				for (unsigned index = 0; index < candidate->getNumOperands();
+						index++)
+					ready = ready && !blocked.count(candidate->getOperand(index));
+				llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(
+						candidate);
+				if (!load)
+				{
+					if (ready && !candidate->mayHaveSideEffects() &&
+							!candidate->mayReadFromMemory())
+					{
+						movable.push_back(candidate);
+						continue;
+					}
+					if (llvm::isa<llvm::CallInst>(candidate))
+						break;
+					if (llvm::StoreInst *store =
+							llvm::dyn_cast<llvm::StoreInst>(candidate))
+						stores.push_back(store);
+					blocked.insert(candidate);
+					continue;
+				}
+
+				llvm::Value *load_pointer = load->getPointerOperand();
+				for (llvm::StoreInst *store : stores)
+					ready = ready && (getArray(*block->getParent(),
+							store->getPointerOperand()) != getArray(
+							*block->getParent(), load_pointer) ||
+							isDistinct(store->getPointerOperand(), load_pointer));
+				AccessInfo load_info;
+				int load_first, load_last;
+				if (!ready || !fits(load_pointer, load_info, load_first,
+						load_last))
+				{
+					blocked.insert(load);
+					continue;
+				}
+
+				// The instructions computing the address are moved first
+				std::set<llvm::Value *> cone = { load_pointer };
+				for (auto move = movable.rbegin(); move != movable.rend();
+						++move)
+					if (cone.count(*move))
+						for (unsigned index = 0;
+								index < (*move)->getNumOperands(); index++)
+							cone.insert((*move)->getOperand(index));
+				std::vector<llvm::Instruction *> kept;
+				for (llvm::Instruction *move : movable)
+				{
+					if (cone.count(move))
+						move->moveBefore(instruction);
+					else
+						kept.push_back(move);
+				}
+				movable.swap(kept);
+				load->moveBefore(instruction);
+				addAccess(load, load_pointer, load_info, load_first,
+						load_last);
+			}
+		}
+
+		// Words loaded by the last state of a block are read in the
+		// block it branches to, if it is only entered from there, or in
+		// a state of their own
+		if (instruction->isTerminator() && !pending.empty() && !split)
+		{
+			llvm::BranchInst *branch = llvm::dyn_cast<llvm::BranchInst>(
+					instruction);
+			llvm::BasicBlock *successor = branch &&
+					branch->isUnconditional() ? branch->getSuccessor(0) :
+					nullptr;
+			if (successor && successor != block &&
+					successor->getSinglePredecessor() == block &&
+					!llvm::isa<llvm::PHINode>(successor->begin()))
+			{
+				for (llvm::Instruction *load : pending)
+					accesses[load].data_block = successor;
+				pending.clear();
+			}
+			else
+			{
+				split = true;
+			}
+		}
+
+		// The rest of the block is a new state
+		if (split)
+		{
+			llvm::BasicBlock *tail = block->splitBasicBlock(it,
+					block->getName() + ".mem");
+			for (llvm::Instruction *load : pending)
+				accesses[load].data_block = tail;
+			num_splits++;
+			return true;
+		}
+
+		if (pointer)
+			addAccess(instruction, pointer, info, first_bank, last_bank);
+		if (instruction->isTerminator())
+			break;
+	}
+	return false;
+}
+
+
+bool MemoryMapper::schedule(llvm::Function &function)
+{
+	// Blocks split are scheduled next
+	findShifts(function);
+	bool changed = false;
+	for (llvm::Function::iterator it = function.begin(), e = function.end();
+			it != e; ++it)
+		changed = scheduleBlock(&*it) || changed;
+	addRegisters();
+
+	// Report the arrays
+	for (Array &array : arrays)
+	{
+		std::ostringstream os;
+		os << "array " << array.name << ": " << array.num_elements
+				<< (array.num_elements == 1 ? " word" : " words") << " of "
+				<< array.width << (array.width == 1 ? " bit, " : " bits, ");
+		int num_registers = 0;
+		for (int reg : array.registers)
+			num_registers += reg >= 0;
+		const char *memory = array.read_only ? "block ROM" : "block RAM";
+		if (array.shift_block)
+			os << "shift register of " << num_registers << " registers";
+		else if (array.partition == PartitionComplete && array.read_only)
+			os << array.num_elements << (array.num_elements == 1 ?
+					" constant" : " constants");
+		else if (array.partition == PartitionComplete)
+			os << array.num_elements << (array.num_elements == 1 ?
+					" register" : " registers");
+		else if (array.lut >= 0)
+			os << "lookup table";
+		else if (array.partition == PartitionNone)
+			os << "1 " << memory;
+		else
+			os << partition_names[array.partition] << " partition, "
+					<< array.num_banks << ' ' << memory
+					<< (array.num_banks == 1 ? " of " : "s of ") << array.depth
+					<< (array.depth == 1 ? " word" : " words");
+		if (!array.delay_lines.empty())
+		{
+			int length = 0;
+			for (DelayLine &line : array.delay_lines)
+				length += line.length;
+			os << " and " << array.delay_lines.size()
+					<< (array.delay_lines.size() == 1 ? " line buffer" :
+					" line buffers") << " of " << length << " words";
+		}
+		module.addComment(os.str());
+	}
+	if (num_splits)
+	{
+		std::ostringstream os;
+		os << "  memory ports: " << num_splits
+				<< (num_splits == 1 ? " state" : " states") << " added";
+		module.addComment(os.str());
+	}
+	return changed;
+}
+
+
+bool MemoryMapper::hasArrays()
+{
+	for (Array &array : arrays)
+		if (!array.read_only || (array.lut < 0 &&
+				array.partition != PartitionComplete))
+			return true;
+	return false;
+}
+
+
+void MemoryMapper::setBlock(llvm::BasicBlock *block, CodeBlock *code_block)
+{
+	this->code_block = code_block;
+	if (block == this->block)
+		return;
+
+	// Values stored in registers by the previous block
+	for (Array &array : arrays)
+	{
+		for (int element = 0; element < (int) array.values.size(); element++)
+		{
+			if (array.values[element] < 0)
+				continue;
+			array.writes[element].push_back(std::make_pair(this->block,
+					array.values[element]));
+			array.values[element] = -1;
+		}
+	}
+	this->block = block;
+}
+
+
+int MemoryMapper::addLogic(DataFlow::Opcode opcode, int width,
+		std::initializer_list<int> operands)
+{
+	int dest = netlist.addWire(width);
+	module.addDataFlow(code_block, opcode, dest, operands);
+	return dest;
+}
+
+
+int MemoryMapper::addSlice(int net, int low, int width)
+{
+	// Emit 'assign dest = net[low + width - 1:low];'
+	int dest = netlist.addWire(width);
+	int dataflow = module.addDataFlow(code_block, DataFlow::OpcodeAssign, dest,
+			{ net });
+	netlist.setOperandSlice(dataflow, 0, low, width);
+	return dest;
+}
+
+
+int MemoryMapper::divide(int net, int divisor, bool remainder)
+{
+	long long value;
+	if (netlist.getConstant(net, value))
+		return module.getConstant(remainder ? value % divisor :
+				value / divisor, element_width);
+
+	// Powers of two are wiring
+	int log2 = getLog2(divisor);
+	if (log2 == 0)
+		return remainder ? module.getConstant(0, element_width) : net;
+	if (log2 > 0 && remainder)
+		return addSlice(net, 0, log2);
+	if (log2 > 0)
+		return addLogic(DataFlow::OpcodeLshr, element_width, { net,
+				module.getConstant(log2, element_width) });
+
+	int dest = netlist.addWire(element_width);
+	StrengthReducer strength_reducer(module);
+	strength_reducer.translateDivide(code_block, dest, net, divisor, false,
+			remainder);
+	return dest;
+}
+
+
+int MemoryMapper::addSelect(int index, const std::vector<int> &nets)
+{
+	// Pairs of nets are selected by one bit of the index, from the
+	// lowest one. Indices never exceed the number of nets.
+	std::vector<int> level = nets;
+	int width = netlist.getNetWidth(nets[0]);
+	for (int bit = 0; level.size() > 1; bit++)
+	{
+		int select = addSlice(index, bit, 1);
+		std::vector<int> next;
+		for (int position = 0; position < (int) level.size(); position += 2)
+			next.push_back(position + 1 < (int) level.size() ?
+					addLogic(DataFlow::OpcodeMux, width, { select,
+					level[position + 1], level[position] }) : level[position]);
+		level.swap(next);
+	}
+	return level[0];
+}
+
+
+int MemoryMapper::addCompare(int index, int value, int num_values)
+{
+	if (num_values == 1)
+		return module.getConstant(1, 1);
+	int width = getNumBits(num_values - 1);
+	return addLogic(DataFlow::OpcodeEq, 1, { addSlice(index, 0, width),
+			module.getConstant(value, width) });
+}
+
+
+int MemoryMapper::translateElement(llvm::Value *pointer)
+{
+	// Sum of the indices times the number of elements they step over
+	std::vector<std::pair<llvm::Value *, int>> indices;
+	getIndices(pointer, indices);
+	long long constant = 0;
+	int net = -1;
+	for (auto &index : indices)
+	{
+		if (llvm::ConstantInt *value = llvm::dyn_cast<llvm::ConstantInt>(
+				index.first))
+		{
+			constant += value->getSExtValue() * index.second;
+			continue;
+		}
+		int term = module.translateLLVMValue(code_block, index.first);
+		if (index.second != 1)
+		{
+			int product = netlist.addWire(element_width);
+			StrengthReducer strength_reducer(module);
+			strength_reducer.translateMultiply(code_block, product, term,
+					index.second);
+			term = product;
+		}
+		net = net < 0 ? term : addLogic(DataFlow::OpcodeAdd, element_width,
+				{ net, term });
+	}
+	if (net < 0)
+		return module.getConstant(constant, element_width);
+	if (constant)
+		net = addLogic(DataFlow::OpcodeAdd, element_width,
+				{ net, module.getConstant(constant, element_width) });
+
+	// Copied in the state of the access, so that values computed in
+	// other states are read from the registers holding them
+	return addLogic(DataFlow::OpcodeAssign, element_width, { net });
+}
+
+
+void MemoryMapper::translateAddress(const Array &array, int element,
+		int known_bank, int &bank, int &address)
+{
+	// Cyclic partitions interleave the banks, and block partitions
+	// concatenate them
+	bank = -1;
+	address = element;
+	if (array.num_banks > 1)
+	{
+		bool cyclic = array.partition == PartitionCyclic;
+		int divisor = cyclic ? array.num_banks : array.depth;
+		address = divide(element, divisor, !cyclic);
+		if (known_bank < 0)
+			bank = divide(element, divisor, cyclic);
+	}
+
+	int address_width = getNumBits(array.depth - 1);
+	long long value;
+	address = netlist.getConstant(address, value) ?
+			module.getConstant(value, address_width) :
+			addSlice(address, 0, address_width);
+}
+
+
+int MemoryMapper::getReadData(Array &array, int bank, int port)
+{
+	int &read_data = array.banks[bank].ports[port].read_data;
+	if (read_data < 0)
+		read_data = netlist.addRegister(array.width);
+	return read_data;
+}
+
+
+int MemoryMapper::getValue(Array &array, int element)
+{
+	if (array.read_only)
+		return module.getConstant(array.contents[element], array.width);
+	return array.values[element] < 0 ? array.registers[element] :
+			array.values[element];
+}
+
+
+void MemoryMapper::translateLoad(llvm::LoadInst *load, CodeBlock *code_block)
+{
+	setBlock(load->getParent(), code_block);
+	AccessInfo &info = accesses[load];
+	Array &array = arrays[info.array];
+
+	// Elements inside line buffers are only moved by the shift, and the
+	// one leaving it is the word read at the pointer
+	long long line_element;
+	int line_index = getDelayLine(array, load->getPointerOperand(),
+			line_element);
+	if (line_index >= 0 &&
+			line_element != array.delay_lines[line_index].leaving)
+		return;
+	int dest = netlist.addWire(array.width);
+	module.addSymbol(load, dest);
+	if (line_index >= 0)
+	{
+		int &read_data = array.delay_lines[line_index].read_data;
+		if (read_data < 0)
+			read_data = netlist.addRegister(array.width);
+		module.addDataFlow(code_block, DataFlow::OpcodeAssign, dest,
+				{ read_data });
+		return;
+	}
+
+	// Elements of completely partitioned arrays are read directly, or
+	// selected by the element number
+	int element = translateElement(load->getPointerOperand());
+	long long value;
+	bool constant = netlist.getConstant(element, value);
+	if (constant && (value < 0 || value >= array.num_elements))
+		fatal("Index " + std::to_string(value) +
+				" out of bounds of array '" + array.name + "'");
+	if (array.partition == PartitionComplete)
+	{
+		int result;
+		if (constant)
+		{
+			result = getValue(array, value);
+		}
+		else
+		{
+			std::vector<int> values;
+			for (int other = 0; other < array.num_elements; other++)
+				values.push_back(getValue(array, other));
+			result = addSelect(element, values);
+		}
+		module.addDataFlow(code_block, DataFlow::OpcodeAssign, dest, { result });
+		return;
+	}
+
+	// Words of lookup tables are read in the same state
+	int bank, address;
+	if (array.lut >= 0)
+	{
+		if (constant)
+		{
+			module.addDataFlow(code_block, DataFlow::OpcodeAssign, dest,
+					{ getValue(array, value) });
+			return;
+		}
+		translateAddress(array, element, -1, bank, address);
+		module.addDataFlow(code_block, DataFlow::OpcodeRom, dest,
+				{ array.lut, address });
+		return;
+	}
+
+	// Address given in this state, on the port of the bank or of every
+	// bank
+	translateAddress(array, element, info.bank, bank, address);
+	Access access = { load->getParent(), address, -1, -1 };
+	int first_bank = info.bank < 0 ? 0 : info.bank;
+	int last_bank = info.bank < 0 ? array.num_banks - 1 : info.bank;
+	std::vector<int> words;
+	for (int other = first_bank; other <= last_bank; other++)
+	{
+		array.banks[other].ports[info.port].accesses.push_back(access);
+		words.push_back(getReadData(array, other, info.port));
+	}
+
+	// Word read in the next state, selected by the bank
+	this->code_block = module.getCodeBlock(info.data_block);
+	int word = words.size() == 1 ? words[0] : addSelect(bank, words);
+	module.addDataFlow(this->code_block, DataFlow::OpcodeAssign, dest, { word });
+	this->code_block = code_block;
+}
+
+
+void MemoryMapper::translateStore(llvm::StoreInst *store,
+		CodeBlock *code_block)
+{
+	setBlock(store->getParent(), code_block);
+	AccessInfo &info = accesses[store];
+	Array &array = arrays[info.array];
+
+	// Only the element entering a line buffer is written to it
+	long long line_element;
+	int line_index = getDelayLine(array, store->getPointerOperand(),
+			line_element);
+	if (line_index >= 0 &&
+			line_element != array.delay_lines[line_index].entering)
+		return;
+	int value = module.translateLLVMValue(code_block,
+			store->getValueOperand());
+	value = addLogic(DataFlow::OpcodeAssign, array.width, { value });
+	if (line_index >= 0)
+	{
+		array.delay_lines[line_index].write_data = value;
+		return;
+	}
+	int element = translateElement(store->getPointerOperand());
+	long long constant;
+	bool is_constant = netlist.getConstant(element, constant);
+	if (is_constant && (constant < 0 || constant >= array.num_elements))
+		fatal("Index " + std::to_string(constant) +
+				" out of bounds of array '" + array.name + "'");
+
+	// Registers take the value stored last in the state
+	if (array.partition == PartitionComplete)
+	{
+		if (is_constant)
+		{
+			array.values[constant] = value;
+			return;
+		}
+		for (int other = 0; other < array.num_elements; other++)
+			array.values[other] = addLogic(DataFlow::OpcodeMux, array.width,
+					{ addCompare(element, other, array.num_elements), value,
+					getValue(array, other) });
+		return;
+	}
+
+	// Word written at the end of this state, in the bank selected
+	int bank, address;
+	translateAddress(array, element, info.bank, bank, address);
+	int first_bank = info.bank < 0 ? 0 : info.bank;
+	int last_bank = info.bank < 0 ? array.num_banks - 1 : info.bank;
+	for (int other = first_bank; other <= last_bank; other++)
+	{
+		Access access = { store->getParent(), address, info.bank < 0 ?
+				addCompare(bank, other, array.num_banks) : -1, value };
+		array.banks[other].ports[info.port].accesses.push_back(access);
+	}
+}
+
+
+int MemoryMapper::addBankMemory(const Array &array, int bank)
+{
+	// Words of the initializer in the bank, following the addresses
+	// computed by translateAddress()
+	int memory = netlist.addMemory(array.width, array.depth);
+	if (array.contents.empty())
+		return memory;
+	std::vector<long long> words(array.depth);
+	for (int address = 0; address < array.depth; address++)
+	{
+		int element = array.partition == PartitionCyclic ?
+				address * array.num_banks + bank :
+				bank * array.depth + address;
+		if (element < array.num_elements)
+			words[address] = array.contents[element];
+	}
+	netlist.setMemoryContents(memory, words);
+	return memory;
+}
+
+
+void MemoryMapper::run(StateMachine *state_machine)
+{
+	setBlock(nullptr, nullptr);
+	if (arrays.empty())
+		return;
+	code_block = module.create<CodeBlock>("memories");
+	module.addCodeBlock(code_block);
+
+	for (Array &array : arrays)
+	{
+		// Registers are loaded in the states storing them, and hold
+		// their value otherwise
+		for (int element = 0; element < (int) array.registers.size();
+				element++)
+		{
+			int reg = array.registers[element];
+			if (reg < 0)
+				continue;
+			int next = reg;
+			for (auto &write : array.writes[element])
+				next = addLogic(DataFlow::OpcodeMux, array.width,
+						{ state_machine->getBlockNet(write.first),
+						write.second, next });
+			module.addDataFlow(code_block, DataFlow::OpcodeRegister, reg,
+					{ next, module.getClockPort(), module.getResetPort() });
+		}
+
+		// The shift writes every line buffer at its pointer, and moves the
+		// pointer to the next word
+		for (DelayLine &line : array.delay_lines)
+		{
+			int state = state_machine->getBlockNet(array.shift_block);
+			int width = getNumBits(line.length - 1);
+			if (line.read_data < 0)
+				line.read_data = netlist.addRegister(array.width);
+			int pointer = netlist.addRegister(width);
+			int next = addLogic(DataFlow::OpcodeAdd, width,
+					{ pointer, module.getConstant(1, width) });
+			if (getLog2(line.length) < 0)
+				next = addLogic(DataFlow::OpcodeMux, width, { addLogic(
+						DataFlow::OpcodeEq, 1, { pointer,
+						module.getConstant(line.length - 1, width) }),
+						module.getConstant(0, width), next });
+			next = addLogic(DataFlow::OpcodeMux, width, { state, next,
+					pointer });
+			module.addDataFlow(code_block, DataFlow::OpcodeRegister, pointer,
+					{ next, module.getClockPort(), module.getResetPort() });
+			module.addDataFlow(code_block, DataFlow::OpcodeRam, line.read_data,
+					{ netlist.addMemory(array.width, line.length),
+					module.getClockPort(), pointer, state, line.write_data });
+		}
+
+		// Every port of a block RAM takes the address, enable and word
+		// of the access of the current state
+		for (int bank = 0; bank < array.num_banks; bank++)
+		{
+			int memory = -1;
+			for (Port &port : array.banks[bank].ports)
+			{
+				if (port.accesses.empty())
+					continue;
+				if (memory < 0)
+					memory = addBankMemory(array, bank);
+				int address = port.accesses.back().address;
+				int enable = -1;
+				int data = -1;
+				for (auto it = port.accesses.rbegin();
+						it != port.accesses.rend(); ++it)
+				{
+					int state = state_machine->getBlockNet(it->block);
+					if (it != port.accesses.rbegin())
+						address = addLogic(DataFlow::OpcodeMux,
+								netlist.getNetWidth(address),
+								{ state, it->address, address });
+					if (it->data < 0)
+						continue;
+					data = data < 0 ? it->data : addLogic(DataFlow::OpcodeMux,
+							array.width, { state, it->data, data });
+					if (it->enable >= 0)
+						state = addLogic(DataFlow::OpcodeAnd, 1,
+								{ state, it->enable });
+					enable = enable < 0 ? state : addLogic(DataFlow::OpcodeOr,
+							1, { state, enable });
+				}
+				if (data < 0)
+				{
+					data = module.getConstant(0, array.width);
+					enable = module.getConstant(0, 1);
+				}
+				if (port.read_data < 0)
+					port.read_data = netlist.addRegister(array.width);
+				module.addDataFlow(code_block, DataFlow::OpcodeRam,
+						port.read_data, { memory, module.getClockPort(),
+						address, enable, data });
+			}
+		}
+	}
+}
+
+}
@@ -0,0 +1,320 @@
+/**
+ * @file   MemoryMapper.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  MemoryMapper class maps the arrays of a function to block RAMs
+ *         or registers, and schedules their accesses on the memory ports.
+ */
+
+#ifndef VERILOG_MEMORY_MAPPER_H
+#define VERILOG_MEMORY_MAPPER_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Operator.h"
+
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "DataFlow.h"
+
+
+namespace verilog
+{
+
+// Forward declarations
+class CodeBlock;
+class Module;
+class Netlist;
+class StateMachine;
+
+
+// Local and global arrays, and global scalars, are read and written by
+// loads and stores, whose address is given by a 'getelementptr' on the
+// array. Every array is flattened, and partitioned into banks by option
+// '-verilog-partition':
+//
+// - Without partitioning, an array is one dual-port block RAM.
+// - A 'cyclic' partition by 'n' puts element 'i' in bank 'i % n', at
+//   address 'i / n', and a 'block' partition by 'n' splits the array into
+//   'n' banks of consecutive elements. Every bank is a dual-port block
+//   RAM, so that 'n' banks give '2 * n' accesses per cycle.
+// - A 'complete' partition makes every element a register, read and
+//   written any number of times per cycle. Global scalars are always
+//   completely partitioned.
+//
+// Block RAMs have synchronous reads: a load gives its address in one
+// cycle, and its word is read in the next one. Functions accessing arrays
+// become state machines, where every block is a state taking one cycle,
+// so blocks are split before translation wherever a state would exceed
+// the two ports of a bank, read a word loaded in the same cycle, or load
+// a word that may be stored in the same cycle, after moving up the later
+// loads not depending on the words being loaded. A load whose bank is not
+// known at compile time uses a port of every bank of its array, and its
+// word is selected by the bank number.
+//
+// Global arrays shifted by one element per call, such as the taps of a
+// filter or the window of a stencil, are recognized once their shift loop
+// is unrolled: every element but one is stored in a single block with the
+// old value of its neighbour, and the last one with a new value. They
+// become shift registers, whose elements are read at constant indices
+// without multiplexers. Runs of elements only read by the shift, such as
+// the rows between the taps of a stencil, become line buffers: a block RAM
+// used as a circular buffer, written with the element entering the run at
+// a pointer advanced by every shift, and whose word read at the pointer is
+// the element leaving it.
+//
+// Global arrays with an initializer that the function never writes, such
+// as coefficient tables, S-boxes and CRC tables, are ROMs. Arrays of up to
+// '-verilog-rom-lut-threshold' words are lookup tables in logic, read with
+// no clock and no port limit, and larger ones are block ROMs, ports of
+// block RAMs loaded with the words of the initializer and never written.
+// Completely partitioned ROMs are constants. Block RAMs of arrays written
+// by the function also start with the words of their initializer.
+class MemoryMapper
+{
+public:
+
+	// Partitions of an array
+	enum Partition
+	{
+		PartitionNone,
+		PartitionCyclic,
+		PartitionBlock,
+		PartitionComplete
+	};
+
+private:
+
+	// Number of ports of every block RAM
+	static const int num_ports = 2;
+
+	// An access to a memory port, in the state of a block, with the
+	// given address. Stores also have a 1-bit net enabling them in
+	// their state, or -1 if they are not conditional, and the word
+	// written, or -1 for loads.
+	struct Access
+	{
+		llvm::BasicBlock *block;
+		int address;
+		int enable;
+		int data;
+	};
+
+	// Port of a block RAM, with the register loaded with the word read,
+	// or -1 if no word is read, and its accesses in translation order
+	struct Port
+	{
+		int read_data = -1;
+		std::vector<Access> accesses;
+	};
+
+	// A bank of an array, mapped to a block RAM
+	struct Bank
+	{
+		Port ports[num_ports];
+	};
+
+	// A line buffer holding 'length' elements of a shifted array from
+	// 'first', with the elements entering and leaving it, and the stores
+	// and the load moving its elements. The block shifting the array
+	// writes the element entering it at the pointer, and the word read at
+	// the pointer is the element leaving it while the pointer does not
+	// move.
+	struct DelayLine
+	{
+		int first;
+		int length;
+		int entering;
+		int leaving;
+		std::vector<llvm::Instruction *> moves;
+		int read_data = -1;
+		int write_data = -1;
+	};
+
+	// An array. Elements are numbered in memory order.
+	struct Array
+	{
+		std::string name;
+		int width = 0;
+		int num_elements = 0;
+		Partition partition = PartitionNone;
+		int factor = 1;
+
+		// Number of banks and words per bank of partitioned arrays,
+		// and their block RAMs
+		int num_banks = 1;
+		int depth = 0;
+		std::vector<Bank> banks;
+
+		// Registers of completely partitioned arrays, the nets holding
+		// the values stored in the block being translated, or -1, and the
+		// values of every element at the end of the blocks storing them
+		std::vector<int> registers;
+		std::vector<int> values;
+		std::vector<std::vector<std::pair<llvm::BasicBlock *, int>>> writes;
+
+		// Block shifting a shifted array, or nullptr, its line buffers, and
+		// the line buffer of every element, or -1 for registers
+		llvm::BasicBlock *shift_block = nullptr;
+		std::vector<DelayLine> delay_lines;
+		std::vector<int> element_lines;
+
+		// Words of the initializer of global arrays, or empty, whether the
+		// function never writes the array, and the memory read by the
+		// lookup table of small ROMs, or -1
+		std::vector<long long> contents;
+		bool read_only = false;
+		int lut = -1;
+	};
+
+	// Access of a load or a store, with its array, the bank it accesses,
+	// or -1 if it is only known at run time, its port, and the block
+	// reading the word loaded
+	struct AccessInfo
+	{
+		int array = -1;
+		int bank = -1;
+		int port = 0;
+		llvm::BasicBlock *data_block = nullptr;
+	};
+
+	// Module being translated
+	Module &module;
+	Netlist &netlist;
+
+	// Arrays, in the order of their first access, and their index by
+	// alloca or global variable
+	std::vector<Array> arrays;
+	llvm::DenseMap<llvm::Value *, int> array_indices;
+
+	// Accesses of loads and stores
+	llvm::DenseMap<llvm::Instruction *, AccessInfo> accesses;
+
+	// Number of blocks split by the port limits
+	int num_splits = 0;
+
+	// Block being translated, and code block the dataflows are added to
+	CodeBlock *code_block = nullptr;
+	llvm::BasicBlock *block = nullptr;
+
+	// Return the partition of the array named 'name' in a function, and
+	// its factor, given by option '-verilog-partition'
+	static Partition getPartition(const std::string &function_name,
+			const std::string &name, int &factor);
+
+	// Return the index of the array accessed by a load or store pointer,
+	// creating it on its first access
+	int getArray(llvm::Function &function, llvm::Value *pointer);
+
+	// Return the element accessed by a pointer in 'element', if it is a
+	// constant
+	bool getConstantElement(llvm::Value *pointer, long long &element);
+
+	// Find the global arrays shifted by one element per call, and make
+	// them shift registers with line buffers
+	void findShifts(llvm::Function &function);
+
+	// Keep the line buffers whose accesses are still in a single state
+	// once the blocks are split, and add the registers of completely
+	// partitioned arrays
+	void addRegisters();
+
+	// Return the line buffer holding the element accessed by a pointer,
+	// or -1, and the element in 'element'
+	int getDelayLine(const Array &array, llvm::Value *pointer,
+			long long &element);
+
+	// Return the bank accessed by a pointer if it is known at compile
+	// time, or -1
+	int getBank(const Array &array, llvm::Value *pointer);
+
+	// Return whether two pointers to the same array never address the
+	// same element at the same time
+	bool isDistinct(llvm::Value *first, llvm::Value *second);
+
+	// Schedule the accesses of a block on the memory ports, from its
+	// first non-phi instruction. Split it where the accesses of a state
+	// end, and return whether it was split.
+	bool scheduleBlock(llvm::BasicBlock *block);
+
+	// Start translating the instructions of a block into a code block.
+	// Values stored by the previous block are recorded.
+	void setBlock(llvm::BasicBlock *block, CodeBlock *code_block);
+
+	// Add a dataflow computing a new wire of the given width, and return
+	// the wire
+	int addLogic(DataFlow::Opcode opcode, int width,
+			std::initializer_list<int> operands);
+
+	// Return a new wire holding 'width' bits of a net from bit 'low'
+	int addSlice(int net, int low, int width);
+
+	// Return a net holding the quotient or the remainder of an element
+	// number by a constant
+	int divide(int net, int divisor, bool remainder);
+
+	// Return a net selecting one of the given nets by the low bits of an
+	// index, with a tree of multiplexers
+	int addSelect(int index, const std::vector<int> &nets);
+
+	// Return a 1-bit net set if the low bits of an index are 'value'
+	int addCompare(int index, int value, int num_values);
+
+	// Return a net holding the element number of a pointer
+	int translateElement(llvm::Value *pointer);
+
+	// Compute the bank and address of an element, with the bank known at
+	// compile time, if it is not -1
+	void translateAddress(const Array &array, int element, int known_bank,
+			int &bank, int &address);
+
+	// Add the block RAM of a bank of an array, starting with the words of
+	// its initializer, if any
+	int addBankMemory(const Array &array, int bank);
+
+	// Return the register loaded with the word read by a port
+	int getReadData(Array &array, int bank, int port);
+
+	// Return the current value of an element of a completely
+	// partitioned array
+	int getValue(Array &array, int element);
+
+public:
+
+	// Constructor
+	MemoryMapper(Module &module);
+
+	// Return whether the stores of the given blocks only move elements of
+	// global arrays, as the shift of a sliding window does
+	static bool isShift(const std::vector<llvm::BasicBlock *> &blocks);
+
+	// Find the arrays accessed by a function and map them, and split its
+	// blocks where the accesses of a state exceed the memory ports.
+	// Return whether the function was changed.
+	bool schedule(llvm::Function &function);
+
+	// Return whether the function accesses arrays held in registers or
+	// block RAMs, which need a state machine. Constants and lookup tables
+	// are read without a clock.
+	bool hasArrays();
+
+	// Emit 'assign dest = array[element];' for a load
+	void translateLoad(llvm::LoadInst *load, CodeBlock *code_block);
+
+	// Emit 'array[element] = value;' for a store
+	void translateStore(llvm::StoreInst *store, CodeBlock *code_block);
+
+	// Once all blocks are translated into the states of a state machine,
+	// add the registers and the memory ports, driven by the accesses of
+	// every state
+	void run(StateMachine *state_machine);
+};
+
+}
+
+#endif
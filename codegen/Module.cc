@@ -6,7 +6,12 @@
  * @brief  This file defines the operations on verilog modules.
  */
 
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+
 #include "CodeBlock.h"
+#include "Error.h"
 #include "Module.h"
 #include "DataFlow.h"
 
@@ -14,149 +19,176 @@
 namespace verilog
 {
 
+static llvm::cl::opt<bool> InlineConstants("verilog-inline-constants",
+		llvm::cl::desc("Write constant operands as sized literals, such as "
+				"32'd2, instead of assigning them to wires"));
+
+
+
+Module::Module(const std::string &name) : name(name)
+{
+	entry_code_block = create<CodeBlock>("entry");
+	exit_code_block = create<CodeBlock>("exit");
+}
+
+
+ModuleStatistics Module::getStatistics()
+{
+	// Code blocks are allocated in the arena, and their lists of
+	// dataflows on the heap
+	ModuleStatistics statistics;
+	statistics.num_code_blocks = code_blocks.size();
+	statistics.num_nets = netlist.getNumNets();
+	statistics.num_dataflows = netlist.getNumDataFlows();
+	statistics.num_bytes = arena.getStatistics().num_bytes;
+	statistics.num_heap_blocks = arena.getStatistics().num_heap_allocations;
+	for (CodeBlock *code_block : code_blocks)
+	{
+		size_t capacity = code_block->getDataFlows().capacity();
+		statistics.num_bytes += capacity * sizeof(int);
+		if (capacity)
+			statistics.num_heap_blocks++;
+	}
+	netlist.getMemoryUsage(statistics.num_bytes, statistics.num_heap_blocks);
+	return statistics;
+}
+
+
+int Module::translateLLVMType(llvm::Type *type, const char *what)
+{
+	if (type->isIntegerTy(32))
+		return 32;
+	else if (type->isIntegerTy(16))
+		return 16;
+	else if (type->isIntegerTy(8))
+		return 8;
+	else if (type->isIntegerTy(1))
+		return 1;
+
+	fatal("Unsupported type in " + std::string(what));
+}
+
+
+int Module::addInputPort(const std::string &name, int width)
+{
+	int net = netlist.addNamedNet(Netlist::NetKindInput, width, name);
+	input_ports.push_back(net);
+	return net;
+}
+
+
+void Module::addClockPorts()
+{
+	clock_port = netlist.addNamedNet(Netlist::NetKindInput, 1, "clk");
+	reset_port = netlist.addNamedNet(Netlist::NetKindInput, 1, "rst");
+	input_ports.insert(input_ports.begin(), { clock_port, reset_port });
+}
+
+
+void Module::addHandshakePorts()
+{
+	start_port = netlist.addNamedNet(Netlist::NetKindInput, 1, "start");
+	done_port = netlist.addNamedNet(Netlist::NetKindOutput, 1, "done");
+	input_ports.insert(input_ports.begin() + (clock_port >= 0 ? 2 : 0),
+			start_port);
+}
+
 
-Module::Module()
+int Module::setOutputPort(const std::string &name, int width)
 {
-	entry_code_block = new CodeBlock("entry");
-//	for(auto& functionArgs : 
-	exit_code_block = new CodeBlock("exit");
+	output_port = netlist.addNamedNet(Netlist::NetKindOutput, width, name);
+	return output_port;
 }
 
-void Module::addCodeBlock(CodeBlock *code_block)
+
+void Module::addCodeBlock(CodeBlock *code_block,
+		const llvm::BasicBlock *llvm_basic_block)
 {
-	code_block_table[code_block->getName()] = code_block;
+	if (llvm_basic_block)
+		code_block_table[llvm_basic_block] = code_block;
 	code_blocks.push_back(code_block);
 }
+
+
+void Module::insertCodeBlock(CodeBlock *code_block)
+{
+	auto it = std::find(code_blocks.begin(), code_blocks.end(),
+			exit_code_block);
+	code_blocks.insert(it, code_block);
+}
 	
 
-CodeBlock *Module::getCodeBlock(const std::string &name)
+CodeBlock *Module::getCodeBlock(const llvm::BasicBlock *llvm_basic_block)
 {
-	auto it = code_block_table.find(name);
+	auto it = code_block_table.find(llvm_basic_block);
 	return it == code_block_table.end() ? nullptr : it->second;
 }
 
 
-Wire *Module::wirelookupSymbol(const std::string &name)
+int Module::addDataFlow(CodeBlock *code_block, DataFlow::Opcode opcode,
+		int dest, std::initializer_list<int> operands)
 {
-	auto it = wire_symbol_table.find(name);
-	if (it == wire_symbol_table.end())
-	{
-		std::cerr << "Error: symbol '" << name << "' not found\n";
-		exit(1);
-	}
-	return it->second;
+	int dataflow = netlist.addDataFlow(opcode, dest, operands);
+	code_block->addDataFlow(dataflow);
+	return dataflow;
 }
 
-Register *Module::registerlookupSymbol(const std::string &name)
+
+int Module::lookupSymbol(const llvm::Value *llvm_value)
 {
-	auto it = register_symbol_table.find(name);
-	if (it == register_symbol_table.end())
-	{
-		std::cerr << "Error: symbol '" << name << "' not found\n";
-		exit(1);
-	}
+	auto it = symbol_table.find(llvm_value);
+	if (it == symbol_table.end())
+		fatal("Error: symbol '" + llvm_value->getName().str() +
+				"' not found");
 	return it->second;
 }
 
-Wire *Module::translateLLVMValueWire(CodeBlock *code_block,
-		llvm::Value *llvm_value,
-		Wire::Direction direction)
-{
-	if (llvm_value->getValueID() == llvm::Value::ConstantIntVal)
-	{
-
-                // Emit 'assign dest = constant;'
-                DataFlow *dataflow = new DataFlow(
-                DataFlow::OpcodeAssign);
-                                                               
-		// First Argument
-		Wire *dest = Wire::newWire(Wire::DirectionOutput);
 
-		// Second argument
-		llvm::ConstantInt *llvm_constant = llvm::cast<llvm::ConstantInt>
-				(llvm_value);
-		Constant *constant = new Constant(llvm_constant->getSExtValue());
-		verilog::DataFlow *verilog_signaldef = new verilog::DataFlow(verilog::DataFlow::OpcodeSignalDefine);
-
-			llvm::Type *type = llvm_constant->getType();	
-			if (type->isIntegerTy(32))
-			{
-				dest->setWidth(32);	
-			}
-			else if (type->isIntegerTy(16))
-			{
-				dest->setWidth(16);	
-			}
-			else if (type->isIntegerTy(8))
-			{
-				dest->setWidth(8);	
-			}
-			else if (type->isIntegerTy(1))
-			{
-				dest->setWidth(1);	
-			}
-			else
-			{
-				std::cerr << "Unsupported type in temporay registers\n";
-				exit(1);
-			}
-                code_block->addDataFlow(verilog_signaldef);
-                verilog_signaldef->addArgument(dest);
-
-                code_block->addDataFlow(dataflow);
-		dataflow->addArgument(dest);
-		dataflow->addArgument(constant);
-
-
-		// Return copy of created register
-		return new Wire(dest->getName(), direction);
-	}
-	else
-	{
-		Wire *wire = wirelookupSymbol(llvm_value->getName());
-		return new Wire(wire->getName(), direction);
-	}
+int Module::getConstant(long long value, int width)
+{
+	auto key = std::make_pair(value, width);
+	auto it = constant_net_table.find(key);
+	if (it != constant_net_table.end())
+		return it->second;
+	int net = netlist.addConstant(value, width);
+	constant_net_table[key] = net;
+	return net;
 }
 
-Register *Module::translateLLVMValueRegister(CodeBlock *code_block,
-		llvm::Value *llvm_value,
-		Register::Direction direction,
-		bool seqReg)
+
+int Module::translateLLVMValue(CodeBlock *code_block, llvm::Value *llvm_value)
 {
 	if (llvm_value->getValueID() == llvm::Value::ConstantIntVal)
 	{
-                // Emit 'assign dest = constant;'
-                DataFlow *dataflow = new DataFlow(
-                DataFlow::OpcodeAssign);
-                code_block->addDataFlow(dataflow);
-
-		// First Argument
-		Register *dest = Register::newRegister(Register::DirectionOutput);
-		dataflow->addArgument(dest);
-
-		// Second argument
 		llvm::ConstantInt *llvm_constant = llvm::cast<llvm::ConstantInt>
 				(llvm_value);
-		Constant *constant = new Constant(llvm_constant->getSExtValue());
-		dataflow->addArgument(constant);
-
-		// Return copy of created register
-		return new Register(dest->getName(), direction, seqReg);
+		int width = translateLLVMType(llvm_constant->getType(),
+				"temporay registers");
+		long long value = llvm_constant->getSExtValue();
+
+		// Constants are pooled, one net per value and width
+		auto key = std::make_pair(value, width);
+		auto it = constant_table.find(key);
+		if (it != constant_table.end())
+			return it->second;
+
+		// With inline constants, the constant net is used directly as
+		// an operand. Otherwise, emit 'assign dest = constant;' and
+		// return the created wire.
+		int net = getConstant(value, width);
+		if (!InlineConstants)
+		{
+			int dest = netlist.addWire(width);
+			addDataFlow(code_block, DataFlow::OpcodeAssign, dest, { net });
+			net = dest;
+		}
+		constant_table[key] = net;
+		return net;
 	}
 	else
 	{
-		Register *reg = registerlookupSymbol(llvm_value->getName());
-		return new Register(reg->getName(), direction, seqReg);
+		return lookupSymbol(llvm_value);
 	}
 }
-	
 
-void Module::dump()
-{
-	// Print all basic blocks
-	for (CodeBlock *code_block : code_blocks)
-		code_block->dump();
 }
-
-}
-
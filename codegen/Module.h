@@ -10,11 +10,13 @@
 #define VERILOG_FUNCTION_H
 
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Constants.h"
-#include "Argument.h"
+#include "Arena.h"
+#include "Netlist.h"
 
-#include <unordered_map>
+#include <vector>
 
 
 namespace verilog
@@ -22,38 +24,158 @@ namespace verilog
 
 // Forward declarations
 class CodeBlock;
-class Wire;
-class Register;
+
+
+// Size of the verilog IR of one or more modules, measured once they are
+// optimized
+struct ModuleStatistics
+{
+	// Number of code blocks, nets and dataflows
+	size_t num_code_blocks = 0;
+	size_t num_nets = 0;
+	size_t num_dataflows = 0;
+
+	// Number of bytes taken by the code blocks and by the arrays of the
+	// netlist and the code blocks, including their unused capacity
+	size_t num_bytes = 0;
+
+	// Number of heap blocks holding them, either arena chunks or arrays
+	size_t num_heap_blocks = 0;
+
+	// Add the counters of another module
+	void add(const ModuleStatistics &other)
+	{
+		num_code_blocks += other.num_code_blocks;
+		num_nets += other.num_nets;
+		num_dataflows += other.num_dataflows;
+		num_bytes += other.num_bytes;
+		num_heap_blocks += other.num_heap_blocks;
+	}
+};
 
 
 class Module
 {
-	// Table of code blocks, indexed by name
-	std::unordered_map<std::string, CodeBlock *> code_block_table;
+	// Arena owning all code blocks of the module. They are released
+	// together with the module.
+	Arena arena;
+
+	// Module name
+	std::string name;
+
+	// Nets and dataflows
+	Netlist netlist;
+
+	// Input port nets, in order, and output port net
+	std::vector<int> input_ports;
+	int output_port = -1;
+
+	// Clock and reset input ports of clocked modules, or -1
+	int clock_port = -1;
+	int reset_port = -1;
+
+	// Handshake ports of state machines, or -1
+	int start_port = -1;
+	int done_port = -1;
+
+	// Comment lines printed after the port list
+	std::vector<std::string> comments;
+
+	// Table of code blocks, indexed by LLVM basic block
+	llvm::DenseMap<const llvm::BasicBlock *, CodeBlock *> code_block_table;
 
 	// List of code blocks, preseving the LLVM order
-	std::list<CodeBlock *> code_blocks;
+	std::vector<CodeBlock *> code_blocks;
 
 	// Entry and exit code blocks
 	CodeBlock *entry_code_block;
 	CodeBlock *exit_code_block;
 
-	// Symbol table, associating LLVM variable names to VERILOG wires
-	std::unordered_map<std::string, Wire *> wire_symbol_table;
-	// Symbol table, associating LLVM variable names to VERILOG registers
-	std::unordered_map<std::string, Register *> register_symbol_table;
+	// Symbol table, associating LLVM values to nets
+	llvm::DenseMap<const llvm::Value *, int> symbol_table;
+
+	// Constant pool, associating a value and a width to the net holding
+	// the constant
+	llvm::DenseMap<std::pair<long long, int>, int> constant_table;
+
+	// Constant nets, indexed by value and width
+	llvm::DenseMap<std::pair<long long, int>, int> constant_net_table;
 
 public:
 
 	// Constructor. It creates an entry and exit code blocks for the
 	// function.
-	Module();
+	Module(const std::string &name);
+
+	// Create an IR object owned by the module, such as a code block.
+	// It must not be deleted by the caller.
+	template<typename T, typename... Args> T *create(Args &&... args)
+	{
+		return arena.create<T>(std::forward<Args>(args)...);
+	}
 
-	// Add a code block
-	void addCodeBlock(CodeBlock *code_block);
+	// Return the size of the module
+	ModuleStatistics getStatistics();
 
-	// Get code block given its label, or nullptr if it doesn't exist.
-	CodeBlock *getCodeBlock(const std::string &name);
+	// Return the module name
+	const std::string &getName() { return name; }
+
+	// Return the netlist
+	Netlist &getNetlist() { return netlist; }
+
+	// Return the width of an LLVM integer type, or produce an error
+	// mentioning the given kind of value if the type is not supported.
+	static int translateLLVMType(llvm::Type *type, const char *what);
+
+	// Add an input port and return its net
+	int addInputPort(const std::string &name, int width);
+
+	// Set the output port and return its net
+	int setOutputPort(const std::string &name, int width);
+
+	// Add the clock and reset input ports, 'clk' and 'rst', before the
+	// other input ports. They are used by the registers of the module.
+	void addClockPorts();
+
+	// Return the clock and reset ports, or -1 if the module is not
+	// clocked
+	int getClockPort() { return clock_port; }
+	int getResetPort() { return reset_port; }
+
+	// Add the 'start' input port, after the clock and reset ports, and
+	// the 'done' output port, printed before the result
+	void addHandshakePorts();
+
+	// Return the handshake ports, or -1 if the module has none
+	int getStartPort() { return start_port; }
+	int getDonePort() { return done_port; }
+
+	// Add a comment line, printed after the port list
+	void addComment(const std::string &comment) { comments.push_back(comment); }
+
+	// Return the comment lines
+	const std::vector<std::string> &getComments() { return comments; }
+
+	// Return the input port nets
+	const std::vector<int> &getInputPorts() { return input_ports; }
+
+	// Return the output port net
+	int getOutputPort() { return output_port; }
+
+	// Add a code block, translated from the given LLVM basic block
+	void addCodeBlock(CodeBlock *code_block,
+			const llvm::BasicBlock *llvm_basic_block = nullptr);
+
+	// Add a code block before the exit code block, once the code blocks
+	// of the function were added
+	void insertCodeBlock(CodeBlock *code_block);
+
+	// Get the code block translated from an LLVM basic block, or nullptr
+	// if it doesn't exist.
+	CodeBlock *getCodeBlock(const llvm::BasicBlock *llvm_basic_block);
+
+	// Return the list of code blocks
+	const std::vector<CodeBlock *> &getCodeBlocks() { return code_blocks; }
 
 	// Return entry code block
 	CodeBlock *getEntryCodeBlock() { return entry_code_block; }
@@ -61,48 +183,34 @@ public:
 	// Return exit code block
 	CodeBlock *getExitCodeBlock() { return exit_code_block; }
 
-	// Add symbol to symbol table
-	void WireAddSymbol(const std::string &name, Wire *wire)
-	{
-		wire_symbol_table[name] = wire;
-	}
+	// Add a dataflow to the netlist and append it to a code block.
+	// Return its ID.
+	int addDataFlow(CodeBlock *code_block, DataFlow::Opcode opcode,
+			int dest, std::initializer_list<int> operands);
 
 	// Add symbol to symbol table
-	void RegisterAddSymbol(const std::string &name, Register *reg)
+	void addSymbol(const llvm::Value *llvm_value, int net)
 	{
-		register_symbol_table[name] = reg;
+		symbol_table[llvm_value] = net;
 	}
 
 	// Lookup symbol table, and produce error if symbol not found.
-	Wire *wirelookupSymbol(const std::string &name);
-	
-	// Lookup symbol table, and produce error if symbol not found.
-	Register *registerlookupSymbol(const std::string &name);
-
-	// If the given value is an LLVM variable, return a new wire
-	// associated with the symbol as read from the symbol table. If the
-	// value is an LLVM constant, emit an 'li' instruction in the given
-	// code block, and return the wire that was assigned the constant.
-	Wire *translateLLVMValueWire(CodeBlock *code_block,
-			llvm::Value *llvm_value,
-			Wire::Direction direction
-			);
-
-	// If the given value is an LLVM variable, return a new register
-	// associated with the symbol as read from the symbol table. If the
-	// value is an LLVM constant, emit an 'li' instruction in the given
-	// code block, and return the register that was assigned the constant.
-	Register *translateLLVMValueRegister(CodeBlock *code_block,
-			llvm::Value *llvm_value,
-			Register::Direction direction,
-			bool seqReg = false);
-
-	// Print it
-	void dump();
+	int lookupSymbol(const llvm::Value *llvm_value);
+
+	// Return the constant net with the given value and width, creating
+	// it the first time. Values are stored sign-extended.
+	int getConstant(long long value, int width);
+
+	// If the given value is an LLVM variable, return the net associated
+	// with it in the symbol table. If the value is an LLVM constant,
+	// return its net in the constant pool. The first use of a constant
+	// emits an 'assign' in the given code block, and the wire assigned
+	// the constant is shared by later uses, unless constants are
+	// written inline.
+	int translateLLVMValue(CodeBlock *code_block, llvm::Value *llvm_value);
 };
 
 }
 
 
 #endif
-
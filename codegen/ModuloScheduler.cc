@@ -0,0 +1,640 @@
+/**
+ * @file   ModuloScheduler.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the pipelining of loops by modulo scheduling.
+ */
+
+#include <algorithm>
+#include <set>
+
+#include "Bits.h"
+#include "CodeBlock.h"
+#include "Module.h"
+#include "ModuloScheduler.h"
+#include "Netlist.h"
+#include "Pipeliner.h"
+
+
+namespace verilog
+{
+
+ModuloScheduler::ModuloScheduler(Module &module, CodeBlock *header_code_block,
+		CodeBlock *code_block, double clock_period) :
+		module(module),
+		netlist(module.getNetlist()),
+		header_code_block(header_code_block),
+		code_block(code_block),
+		clock_period(clock_period)
+{
+	for (int resource = 0; resource < ResourceScheduler::ResourceMax;
+			resource++)
+	{
+		limits[resource] = 0;
+		shared[resource] = false;
+	}
+}
+
+
+void ModuloScheduler::addCodeBlock(CodeBlock *code_block)
+{
+	code_blocks.push_back(code_block);
+	for (int dataflow : code_block->getDataFlows())
+	{
+		dataflows.push_back(dataflow);
+		if (code_block == header_code_block)
+			header_nets.push_back(netlist.getDest(dataflow));
+	}
+}
+
+
+void ModuloScheduler::addRecurrence(int phi, int next)
+{
+	recurrences.push_back(std::make_pair(phi, next));
+}
+
+
+void ModuloScheduler::setExitCondition(int condition, bool value)
+{
+	exit_condition = condition;
+	exit_value = value;
+}
+
+
+int ModuloScheduler::getCycle(int net)
+{
+	auto it = net_cycles.find(net);
+	return it == net_cycles.end() ? -1 : it->second;
+}
+
+
+ResourceScheduler::Resource ModuloScheduler::getSharedResource(int dataflow)
+{
+	ResourceScheduler::Resource resource = ResourceScheduler::getResource(
+			netlist.getOpcode(dataflow));
+	return resource != ResourceScheduler::ResourceNone && shared[resource] ?
+			resource : ResourceScheduler::ResourceNone;
+}
+
+
+void ModuloScheduler::scheduleIteration(int ii, bool share,
+		const std::vector<int> &phi_cycles, std::map<int, int> &cycles)
+{
+	// Time every net is ready in its cycle, and whether it depends on the
+	// output of a shared unit in its cycle. Phi nodes and values of
+	// earlier cycles come from registers, ready at time 0.
+	std::map<int, double> arrival;
+	std::set<int> after_unit;
+	cycles.clear();
+	for (unsigned index = 0; index < recurrences.size(); index++)
+		cycles[recurrences[index].first] = phi_cycles[index];
+
+	// Units of every kind running in every cycle modulo II
+	std::map<std::pair<int, int>, int> used;
+	double mux_delay = Pipeliner::getDelay(DataFlow::OpcodeMux, 1, 1);
+	for (int dataflow : dataflows)
+	{
+		int cycle = 0;
+		double start = 0;
+		bool chained = false;
+		int num_operands = netlist.getNumOperands(dataflow);
+		for (int index = 0; index < num_operands; index++)
+		{
+			auto it = cycles.find(netlist.getOperand(dataflow, index));
+			if (it != cycles.end())
+				cycle = std::max(cycle, it->second);
+		}
+		for (int index = 0; index < num_operands; index++)
+		{
+			int src = netlist.getOperand(dataflow, index);
+			auto it = cycles.find(src);
+			if (it != cycles.end() && it->second == cycle)
+			{
+				start = std::max(start, arrival[src]);
+				chained = chained || after_unit.count(src);
+			}
+		}
+
+		// Move to the next cycle if the period is exceeded, as in the
+		// pipeliner. Shared operators also cross the multiplexers of
+		// their operands.
+		ResourceScheduler::Resource resource = share ?
+				getSharedResource(dataflow) : ResourceScheduler::ResourceNone;
+		double delay = clock_period > 0 ?
+				Pipeliner::getDelay(netlist, dataflow) +
+				(resource != ResourceScheduler::ResourceNone ? mux_delay : 0) :
+				0;
+		if ((delay > 0 && start > 0 && start + delay > clock_period) ||
+				(resource != ResourceScheduler::ResourceNone && chained))
+		{
+			cycle++;
+			start = 0;
+			chained = false;
+		}
+
+		// Shared dataflows wait for a unit free in their cycle modulo II
+		if (resource != ResourceScheduler::ResourceNone)
+		{
+			while (used[std::make_pair(resource, cycle % ii)] ==
+					limits[resource])
+			{
+				cycle++;
+				start = 0;
+			}
+			used[std::make_pair(resource, cycle % ii)]++;
+		}
+		int dest = netlist.getDest(dataflow);
+		cycles[dest] = cycle;
+		arrival[dest] = start + delay;
+		if (resource != ResourceScheduler::ResourceNone || chained)
+			after_unit.insert(dest);
+	}
+}
+
+
+bool ModuloScheduler::schedule(int ii, bool share)
+{
+	// Read the phi nodes in cycle 0, and later as long as the value
+	// carried by the previous iteration is not ready one cycle before.
+	// The latest cycles needed never exceed the number of dataflows, each
+	// waiting at most II cycles for a unit, unless a recurrence is longer
+	// than II.
+	std::vector<int> phi_cycles(recurrences.size());
+	std::map<int, int> cycles;
+	int max_cycle = dataflows.size() * (share ? ii + 1 : 1);
+	bool changed = true;
+	while (changed)
+	{
+		scheduleIteration(ii, share, phi_cycles, cycles);
+		changed = false;
+		for (unsigned index = 0; index < recurrences.size(); index++)
+		{
+			auto it = cycles.find(recurrences[index].second);
+			if (it == cycles.end() || it->second + 1 - ii <= phi_cycles[index])
+				continue;
+			phi_cycles[index] = it->second + 1 - ii;
+			if (phi_cycles[index] > max_cycle)
+				return false;
+			changed = true;
+		}
+	}
+
+	// The loop exits once the exit test, the values of the header and
+	// the phi nodes of the iteration are known
+	net_cycles = std::move(cycles);
+	this->ii = ii;
+	length = 1;
+	exit_cycle = std::max(getCycle(exit_condition), 0);
+	for (auto &net_cycle : net_cycles)
+		length = std::max(length, net_cycle.second + 1);
+	for (int net : header_nets)
+		exit_cycle = std::max(exit_cycle, getCycle(net));
+	for (int cycle : phi_cycles)
+		exit_cycle = std::max(exit_cycle, cycle);
+	return true;
+}
+
+
+void ModuloScheduler::schedule()
+{
+	// Operators of a kind are shared if there are more than allowed.
+	// Every unit runs one operation per cycle modulo II, so II is at
+	// least the number of operations per unit.
+	int num_operators[ResourceScheduler::ResourceMax] = { };
+	for (int dataflow : dataflows)
+	{
+		ResourceScheduler::Resource resource = ResourceScheduler::getResource(
+				netlist.getOpcode(dataflow));
+		if (resource != ResourceScheduler::ResourceNone)
+			num_operators[resource]++;
+	}
+	bool share = false;
+	resource_mii = 1;
+	for (int resource = 0; resource < ResourceScheduler::ResourceMax;
+			resource++)
+	{
+		shared[resource] = limits[resource] > 0 &&
+				num_operators[resource] > limits[resource];
+		if (shared[resource])
+			resource_mii = std::max(resource_mii, (num_operators[resource] +
+					limits[resource] - 1) / limits[resource]);
+		share = share || shared[resource];
+	}
+
+	// Smallest II of the recurrences, with an operator per operation,
+	// and smallest II meeting both bounds with the operators shared
+	int candidate = 1;
+	while (!schedule(candidate, false))
+		candidate++;
+	recurrence_mii = candidate;
+	if (!share)
+		return;
+	candidate = std::max(candidate, resource_mii);
+	while (!schedule(candidate, true))
+		candidate++;
+}
+
+
+void ModuloScheduler::bind()
+{
+	// Dataflows go to units not used in their cycle modulo II yet,
+	// preferring the unit reading the most of their operands already,
+	// which saves multiplexer inputs. A new unit is only added when all
+	// others are used.
+	for (int resource = 0; resource < ResourceScheduler::ResourceMax;
+			resource++)
+	{
+		if (!shared[resource])
+			continue;
+		std::vector<std::vector<int>> &list = units[resource];
+		std::vector<std::set<int>> phases;
+		for (int dataflow : dataflows)
+		{
+			if (getSharedResource(dataflow) != resource)
+				continue;
+			int phase = getCycle(netlist.getDest(dataflow)) % ii;
+			int best = -1;
+			int best_matches = -1;
+			for (unsigned unit = 0; unit < list.size(); unit++)
+			{
+				if (phases[unit].count(phase))
+					continue;
+				int matches = 0;
+				for (int other : list[unit])
+					for (int index = 0; index < 2; index++)
+						if (netlist.getOperand(other, index) ==
+								netlist.getOperand(dataflow, index))
+							matches++;
+				if (matches > best_matches)
+				{
+					best = unit;
+					best_matches = matches;
+				}
+			}
+			if (best < 0)
+			{
+				best = list.size();
+				list.emplace_back();
+				phases.emplace_back();
+			}
+			list[best].push_back(dataflow);
+			phases[best].insert(phase);
+		}
+	}
+}
+
+
+bool ModuloScheduler::getUnits(ResourceScheduler::Resource resource,
+		int &num_operations, int &num_units)
+{
+	num_operations = 0;
+	for (auto &unit : units[resource])
+		num_operations += unit.size();
+	num_units = units[resource].size();
+	return shared[resource];
+}
+
+
+int ModuloScheduler::addLogic(DataFlow::Opcode opcode, int width,
+		std::initializer_list<int> operands, bool header)
+{
+	int dest = netlist.addWire(width);
+	if (header)
+		header_logic.push_back(netlist.addDataFlow(opcode, dest, operands));
+	else
+		module.addDataFlow(code_block, opcode, dest, operands);
+	return dest;
+}
+
+
+void ModuloScheduler::addRegister(int dest, int next)
+{
+	// Emit 'always @(posedge clk) dest <= rst ? 0 : next;'
+	module.addDataFlow(code_block, DataFlow::OpcodeRegister, dest,
+			{ next, module.getClockPort(), module.getResetPort() });
+}
+
+
+int ModuloScheduler::getDelayedNet(int net, int num_cycles)
+{
+	std::vector<int> &chain = delays[net];
+	while ((int) chain.size() < num_cycles)
+	{
+		int reg = netlist.addRegister(netlist.getNetWidth(net));
+		addRegister(reg, chain.empty() ? net : chain.back());
+		chain.push_back(reg);
+	}
+	return num_cycles ? chain[num_cycles - 1] : net;
+}
+
+
+int ModuloScheduler::getNetInCycle(int net, int cycle)
+{
+	// Values computed before the loop hold in all cycles. Constants are
+	// read directly, wherever they are assigned.
+	int net_cycle = getCycle(net);
+	long long value;
+	if (net_cycle < 0)
+		return netlist.getConstant(net, value) ?
+				module.getConstant(value, netlist.getNetWidth(net)) : net;
+	auto it = phi_nets.find(net);
+	return getDelayedNet(it == phi_nets.end() ? net : it->second,
+			cycle - net_cycle);
+}
+
+
+int ModuloScheduler::getPhaseNet(int cycle)
+{
+	// Emit 'assign dest = phase == c;'
+	int phase = cycle % ii;
+	auto it = phase_nets.find(phase);
+	if (it != phase_nets.end())
+		return it->second;
+	int width = netlist.getNetWidth(phase_register);
+	int net = addLogic(DataFlow::OpcodeEq, 1, { phase_register,
+			module.getConstant(phase, width) }, true);
+	phase_nets[phase] = net;
+	return net;
+}
+
+
+int ModuloScheduler::addUnitLogic(DataFlow::Opcode opcode, int width,
+		std::initializer_list<int> operands)
+{
+	int dest = netlist.addWire(width);
+	unit_logic.push_back(netlist.addDataFlow(opcode, dest, operands));
+	return dest;
+}
+
+
+void ModuloScheduler::addUnit(ResourceScheduler::Resource resource,
+		const std::vector<int> &list)
+{
+	// Width of the operands, and of the result of additions and
+	// multiplications
+	bool is_comparator = resource == ResourceScheduler::ResourceComparator;
+	int width = 1;
+	for (int dataflow : list)
+	{
+		for (int index = 0; index < 2; index++)
+		{
+			int slice_width = netlist.getOperandWidth(dataflow, index);
+			width = std::max(width, slice_width ? slice_width :
+					netlist.getNetWidth(netlist.getOperand(dataflow, index)));
+		}
+		if (!is_comparator)
+			width = std::max(width, netlist.getNetWidth(
+					netlist.getDest(dataflow)));
+	}
+
+	// Every operand selects the one of the dataflow of the current phase,
+	// and defaults to the one of the last dataflow. Dataflows reading the
+	// same operand as the last one need no multiplexer input.
+	int operands[2];
+	for (int index = 0; index < 2; index++)
+	{
+		int last = list.back();
+		int src = netlist.getOperand(last, index);
+		int low = netlist.getOperandLow(last, index);
+		int slice_width = netlist.getOperandWidth(last, index);
+		int net = src;
+		if (slice_width)
+		{
+			net = netlist.addWire(slice_width);
+			int assign = netlist.addDataFlow(DataFlow::OpcodeAssign, net,
+					{ src });
+			netlist.setOperandSlice(assign, 0, low, slice_width);
+			unit_logic.push_back(assign);
+		}
+		for (int position = list.size() - 2; position >= 0; position--)
+		{
+			int dataflow = list[position];
+			if (netlist.getOperand(dataflow, index) == src &&
+					netlist.getOperandLow(dataflow, index) == low &&
+					netlist.getOperandWidth(dataflow, index) == slice_width)
+				continue;
+
+			// Emit 'assign mux = phase == c ? src : mux;'
+			int mux = netlist.addWire(width);
+			int select = netlist.addDataFlow(DataFlow::OpcodeMux, mux,
+					{ getPhaseNet(getCycle(netlist.getDest(dataflow))),
+					netlist.getOperand(dataflow, index), net });
+			netlist.setOperandSlice(select, 1,
+					netlist.getOperandLow(dataflow, index),
+					netlist.getOperandWidth(dataflow, index));
+			unit_logic.push_back(select);
+			net = mux;
+		}
+		operands[index] = net;
+	}
+
+	// Outputs of the unit, by opcode
+	std::map<DataFlow::Opcode, int> outputs;
+	for (int dataflow : list)
+		outputs[netlist.getOpcode(dataflow)] = -1;
+	if (resource == ResourceScheduler::ResourceAdder && outputs.size() > 1)
+	{
+		// Additions and subtractions share one adder, which adds the
+		// complement of the second operand plus one in the phases of the
+		// subtractions: 'assign sum = a + (b ^ {n{sub}}) + sub;'
+		int sub = -1;
+		for (int dataflow : list)
+		{
+			if (netlist.getOpcode(dataflow) != DataFlow::OpcodeSub)
+				continue;
+			int phase = getPhaseNet(getCycle(netlist.getDest(dataflow)));
+			sub = sub < 0 ? phase : addUnitLogic(DataFlow::OpcodeOr, 1,
+					{ sub, phase });
+		}
+		int mask = width > 1 ? addUnitLogic(DataFlow::OpcodeSext, width,
+				{ sub }) : sub;
+		int sum = addUnitLogic(DataFlow::OpcodeAdd, width, { operands[0],
+				addUnitLogic(DataFlow::OpcodeXor, width, { operands[1], mask }),
+				sub });
+		outputs[DataFlow::OpcodeAdd] = sum;
+		outputs[DataFlow::OpcodeSub] = sum;
+	}
+	else
+	{
+		for (auto &output : outputs)
+			output.second = addUnitLogic(output.first,
+					is_comparator ? 1 : width, { operands[0], operands[1] });
+	}
+
+	// Dataflows read the output of the unit, truncated to their width
+	for (int dataflow : list)
+	{
+		int dest = netlist.getDest(dataflow);
+		int output = outputs[netlist.getOpcode(dataflow)];
+		netlist.removeDataFlow(dataflow);
+		int assign = netlist.addDataFlow(DataFlow::OpcodeAssign, dest,
+				{ output });
+		if (netlist.getNetWidth(dest) < netlist.getNetWidth(output))
+			netlist.setOperandSlice(assign, 0, 0, netlist.getNetWidth(dest));
+		replacements[dataflow] = assign;
+	}
+}
+
+
+void ModuloScheduler::addSorted(int dataflow, const std::vector<bool> &sortable,
+		std::vector<bool> &visited, std::vector<int> &list)
+{
+	if (visited[dataflow])
+		return;
+	visited[dataflow] = true;
+	for (int index = 0; index < netlist.getNumOperands(dataflow); index++)
+	{
+		int definition = netlist.getNetDefinition(
+				netlist.getOperand(dataflow, index));
+		if (definition >= 0 && sortable[definition])
+			addSorted(definition, sortable, visited, list);
+	}
+	list.push_back(dataflow);
+}
+
+
+void ModuloScheduler::sortDataFlows()
+{
+	// Only the dataflows of the loop and of the units move. Registers are
+	// never among them, so they do not order dataflows.
+	std::vector<bool> sortable(netlist.getNumDataFlows());
+	std::vector<bool> visited(netlist.getNumDataFlows());
+	for (int &dataflow : dataflows)
+	{
+		auto it = replacements.find(dataflow);
+		if (it != replacements.end())
+			dataflow = it->second;
+		sortable[dataflow] = true;
+	}
+	for (int dataflow : unit_logic)
+		sortable[dataflow] = true;
+	for (CodeBlock *loop_code_block : code_blocks)
+	{
+		std::vector<int> list;
+		for (int dataflow : loop_code_block->getDataFlows())
+		{
+			auto it = replacements.find(dataflow);
+			addSorted(it == replacements.end() ? dataflow : it->second,
+					sortable, visited, list);
+		}
+		loop_code_block->setDataFlows(std::move(list));
+	}
+}
+
+
+void ModuloScheduler::run(int state_register, int state)
+{
+	// Emit 'assign issue = state == loop;' for II 1. Otherwise, a phase
+	// counter wrapping around every II cycles starts the iterations when
+	// it is 0, and restarts when the loop is entered.
+	state_net = addLogic(DataFlow::OpcodeEq, 1, { state_register, state }, true);
+	issue_net = state_net;
+	if (ii > 1)
+	{
+		int width = getNumBits(ii - 1);
+		phase_register = netlist.addRegister(width);
+		int zero = module.getConstant(0, width);
+		issue_net = addLogic(DataFlow::OpcodeAnd, 1,
+				{ state_net, getPhaseNet(0) }, true);
+		int last = addLogic(DataFlow::OpcodeEq, 1,
+				{ phase_register, module.getConstant(ii - 1, width) });
+		int increment = addLogic(DataFlow::OpcodeAdd, width,
+				{ phase_register, module.getConstant(1, width) });
+		int next = addLogic(DataFlow::OpcodeMux, width,
+				{ last, zero, increment });
+		addRegister(phase_register, addLogic(DataFlow::OpcodeMux, width,
+				{ state_net, next, zero }));
+	}
+
+	// The first iteration starts in the first cycle of the loop state,
+	// before 'started' is set
+	int started = netlist.addRegister(1);
+	int first = addLogic(DataFlow::OpcodeAnd, 1, { issue_net,
+			addLogic(DataFlow::OpcodeNot, 1, { started }, true) }, true);
+	addRegister(started, addLogic(DataFlow::OpcodeAnd, 1, { state_net,
+			addLogic(DataFlow::OpcodeOr, 1, { started, issue_net }) }));
+
+	// Valid and first iteration bits move one cycle further on every
+	// clock edge, and are cleared out of the loop state
+	int last_phi_cycle = 0;
+	for (auto &recurrence : recurrences)
+		last_phi_cycle = std::max(last_phi_cycle, getCycle(recurrence.first));
+	valid_nets.push_back(issue_net);
+	first_nets.push_back(first);
+	for (int cycle = 1; cycle <= std::max(exit_cycle, last_phi_cycle); cycle++)
+	{
+		std::vector<int> *chains[] = { &valid_nets, &first_nets };
+		for (std::vector<int> *chain : chains)
+		{
+			int reg = netlist.addRegister(1);
+			addRegister(reg, addLogic(DataFlow::OpcodeAnd, 1,
+					{ chain->back(), state_net }));
+			chain->push_back(reg);
+		}
+	}
+
+	// Phi nodes read their register in the first iteration, and the value
+	// carried by the previous iteration, started II cycles earlier,
+	// otherwise. All nets are created before the multiplexers, since
+	// phi nodes may carry each other.
+	for (auto &recurrence : recurrences)
+		phi_nets[recurrence.first] = netlist.addWire(
+				netlist.getNetWidth(recurrence.first));
+	for (auto &recurrence : recurrences)
+	{
+		int phi = recurrence.first;
+		int cycle = getCycle(phi);
+		header_logic.push_back(netlist.addDataFlow(DataFlow::OpcodeMux,
+				phi_nets[phi], { first_nets[cycle], phi,
+				getNetInCycle(recurrence.second, cycle + ii) }));
+	}
+
+	// Every dataflow reads the values of its iteration
+	for (int dataflow : dataflows)
+	{
+		int cycle = getCycle(netlist.getDest(dataflow));
+		for (int index = 0; index < netlist.getNumOperands(dataflow); index++)
+			netlist.setOperand(dataflow, index, getNetInCycle(
+					netlist.getOperand(dataflow, index), cycle));
+	}
+
+	// Shared units
+	bind();
+	for (int resource = 0; resource < ResourceScheduler::ResourceMax;
+			resource++)
+		for (auto &unit : units[resource])
+			addUnit((ResourceScheduler::Resource) resource, unit);
+	sortDataFlows();
+
+	// The logic read by the loop goes before the header
+	std::vector<int> list = header_logic;
+	const std::vector<int> &header_dataflows = header_code_block->getDataFlows();
+	list.insert(list.end(), header_dataflows.begin(), header_dataflows.end());
+	header_code_block->setDataFlows(std::move(list));
+
+	// Emit 'assign exit = valid & cond;', or '~cond' if the loop exits
+	// when the condition is false
+	int condition = getNetInCycle(exit_condition, exit_cycle);
+	if (!exit_value)
+		condition = addLogic(DataFlow::OpcodeNot, 1, { condition });
+	exit_net = addLogic(DataFlow::OpcodeAnd, 1,
+			{ valid_nets[exit_cycle], condition });
+}
+
+
+bool ModuloScheduler::isHeaderNet(int net)
+{
+	for (auto &recurrence : recurrences)
+		if (recurrence.first == net)
+			return true;
+	return std::find(header_nets.begin(), header_nets.end(), net) !=
+			header_nets.end();
+}
+
+
+int ModuloScheduler::getExitValue(int net)
+{
+	return getNetInCycle(net, exit_cycle);
+}
+
+}
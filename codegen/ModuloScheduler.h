@@ -0,0 +1,250 @@
+/**
+ * @file   ModuloScheduler.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  ModuloScheduler class pipelines the innermost loops of a state
+ *         machine, starting a new iteration every II cycles.
+ */
+
+#ifndef VERILOG_MODULO_SCHEDULER_H
+#define VERILOG_MODULO_SCHEDULER_H
+
+#include <initializer_list>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "DataFlow.h"
+#include "ResourceScheduler.h"
+
+
+namespace verilog
+{
+
+// Forward declarations
+class CodeBlock;
+class Module;
+class Netlist;
+
+
+// A loop made of a header, which holds its phi nodes and the exit test,
+// and at most one body block, runs in a single state of the state
+// machine. Every dataflow of an iteration is given a cycle, counted from
+// the start of the iteration, chaining dataflows in a cycle as long as
+// the clock period allows. Iterations start every II cycles, the
+// initiation interval, so several of them are in flight at once.
+//
+// The smallest II is bounded by the recurrences: the value carried to a
+// phi node must be ready one cycle before the next iteration reads it.
+// Phi nodes may be read later than the start of an iteration to meet
+// this bound. Operators of a kind whose number exceeds the limit given
+// for the kind are shared, which bounds II by the number of operations
+// per unit. Every unit runs at most one operation per cycle modulo II,
+// taking its operands from multiplexers controlled by the phase of the
+// iteration, and a shared dataflow never reads the output of a unit in
+// its cycle, as in the resource scheduler.
+//
+// Values used in later cycles of their iteration are delayed by chains
+// of registers shifting every cycle, shared by all users of a value, so
+// that every iteration in flight has its own copy: these are the rotating
+// registers of the loop. A chain of valid bits tracks the cycle of every
+// iteration in flight, filling the pipeline in the prologue, and a chain
+// of bits marks the first iteration, which reads the phi nodes from
+// their registers loaded before the loop. Iterations are speculative: the
+// loop exits in the cycle where the exit test of a valid iteration is
+// known, discarding the later iterations, so there is no epilogue.
+class ModuloScheduler
+{
+	// Module being translated
+	Module &module;
+	Netlist &netlist;
+
+	// Code blocks of the header, where the logic read by the loop is
+	// added first, and of the rest of the pipeline logic
+	CodeBlock *header_code_block;
+	CodeBlock *code_block;
+
+	// Logic added before the dataflows of the header
+	std::vector<int> header_logic;
+
+	// Clock period in ns, or 0 to chain all dataflows of an iteration
+	double clock_period;
+
+	// Largest number of units of every kind, or 0 for no limit, and
+	// whether operators of every kind are shared
+	int limits[ResourceScheduler::ResourceMax];
+	bool shared[ResourceScheduler::ResourceMax];
+
+	// Code blocks of the loop, and dataflows of an iteration, in order
+	std::vector<CodeBlock *> code_blocks;
+	std::vector<int> dataflows;
+
+	// Nets computed by the header, whose value is available on exit
+	std::vector<int> header_nets;
+
+	// Phi registers and the nets carried to them by an iteration
+	std::vector<std::pair<int, int>> recurrences;
+
+	// Exit test, taken if 'exit_condition' equals 'exit_value'
+	int exit_condition = -1;
+	bool exit_value = false;
+
+	// Schedule. The cycle of every net of the loop is indexed by net,
+	// and -1 for values computed before the loop.
+	std::map<int, int> net_cycles;
+	int ii = 1;
+	int recurrence_mii = 1;
+	int resource_mii = 1;
+	int length = 1;
+	int exit_cycle = 0;
+
+	// Net set in the cycles of the loop state, and net set in the cycles
+	// where an iteration starts
+	int state_net = -1;
+	int issue_net = -1;
+
+	// Register counting the cycles of the iteration started last modulo
+	// II, if II is not 1, and nets set in each of its values
+	int phase_register = -1;
+	std::map<int, int> phase_nets;
+
+	// Dataflows bound to every unit, by kind, the logic of the units, and
+	// the dataflows replaced by the ones reading the units
+	std::vector<std::vector<int>> units[ResourceScheduler::ResourceMax];
+	std::vector<int> unit_logic;
+	std::map<int, int> replacements;
+
+	// Valid and first iteration bits, by cycle of the iteration
+	std::vector<int> valid_nets;
+	std::vector<int> first_nets;
+
+	// Value of every phi node in the cycle it is read
+	std::map<int, int> phi_nets;
+
+	// Registers delaying every net, by one cycle more at each entry
+	std::map<int, std::vector<int>> delays;
+
+	// Net set when the loop exits
+	int exit_net = -1;
+
+	// Return the cycle of a net, or -1 if computed before the loop
+	int getCycle(int net);
+
+	// Return the kind of a dataflow if its operator is shared, or
+	// ResourceNone
+	ResourceScheduler::Resource getSharedResource(int dataflow);
+
+	// Compute the cycles of the dataflows for an initiation interval,
+	// reading the phi nodes in the given cycles, and sharing operators if
+	// 'share' is true. Return the cycles in 'cycles'.
+	void scheduleIteration(int ii, bool share,
+			const std::vector<int> &phi_cycles, std::map<int, int> &cycles);
+
+	// Try to schedule the loop with an initiation interval. Return false
+	// if a recurrence does not fit in it.
+	bool schedule(int ii, bool share);
+
+	// Bind the dataflows of shared kinds to units
+	void bind();
+
+	// Add a dataflow computing a new wire of the given width to the
+	// pipeline code block, or before the header if 'header' is true, and
+	// return the wire
+	int addLogic(DataFlow::Opcode opcode, int width,
+			std::initializer_list<int> operands, bool header = false);
+
+	// Add a register loaded with 'next' on every clock edge
+	void addRegister(int dest, int next);
+
+	// Return a net holding the value of a net of the loop a number of
+	// cycles after the one computing it
+	int getDelayedNet(int net, int num_cycles);
+
+	// Return a net holding the value of a net of the loop in the given
+	// cycle of the iteration
+	int getNetInCycle(int net, int cycle);
+
+	// Return a net set in the cycles running the given cycle of the
+	// iterations modulo II
+	int getPhaseNet(int cycle);
+
+	// Add a dataflow computing a new wire of the given width to the logic
+	// of the units, and return the wire
+	int addUnitLogic(DataFlow::Opcode opcode, int width,
+			std::initializer_list<int> operands);
+
+	// Add the logic of a unit, and make its dataflows read its outputs
+	void addUnit(ResourceScheduler::Resource resource,
+			const std::vector<int> &list);
+
+	// Add a dataflow of the loop or of a unit to 'list' after the ones it
+	// reads, unless it was added already
+	void addSorted(int dataflow, const std::vector<bool> &sortable,
+			std::vector<bool> &visited, std::vector<int> &list);
+
+	// Order the dataflows of the code blocks of the loop so that nets are
+	// assigned before they are read, placing the logic of the units
+	// before their first user
+	void sortDataFlows();
+
+public:
+
+	// Constructor. The pipeline logic is added to 'code_block', except
+	// for the logic read by the loop, added to the code block of the
+	// header.
+	ModuloScheduler(Module &module, CodeBlock *header_code_block,
+			CodeBlock *code_block, double clock_period);
+
+	// Set the largest number of units of a kind, or 0 for no limit
+	void setLimit(ResourceScheduler::Resource resource, int limit)
+	{
+		limits[resource] = limit;
+	}
+
+	// Add the dataflows of the header or of the body, in order
+	void addCodeBlock(CodeBlock *code_block);
+
+	// Add a phi node of the header and the value carried to it
+	void addRecurrence(int phi, int next);
+
+	// Set the exit test of the header
+	void setExitCondition(int condition, bool value);
+
+	// Find the smallest initiation interval and the cycles of the
+	// dataflows
+	void schedule();
+
+	// Add the pipeline logic, given the state register and the constant
+	// net holding the loop state, and make the dataflows of the loop read
+	// the values of their iteration
+	void run(int state_register, int state);
+
+	// Return whether a net is a phi node or a value of the header
+	bool isHeaderNet(int net);
+
+	// Return a net holding the value of a net of the header, or of a phi
+	// node, in the iteration that exits
+	int getExitValue(int net);
+
+	// Return the net set in the cycle the loop exits
+	int getExitNet() { return exit_net; }
+
+	// Return the number of operations and of units of a kind, if they
+	// are shared
+	bool getUnits(ResourceScheduler::Resource resource, int &num_operations,
+			int &num_units);
+
+	// Return the schedule
+	int getII() { return ii; }
+	int getRecurrenceMII() { return recurrence_mii; }
+	int getResourceMII() { return resource_mii; }
+	int getNumStages() { return (length + ii - 1) / ii; }
+
+	// Return the number of cycles in the loop state when the first
+	// iteration exits
+	int getExitLatency() { return exit_cycle + 1; }
+};
+
+}
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * @file   Netlist.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the operations on the netlist of a verilog module.
+ */
+
+#include <cstdio>
+
+#include "Netlist.h"
+
+
+namespace verilog
+{
+
+thread_local int Netlist::next_number = 0;
+
+
+// Add the bytes and the heap block of an array to the counters
+template<typename T> static void addArrayUsage(const std::vector<T> &array,
+		size_t &num_bytes, size_t &num_heap_blocks)
+{
+	num_bytes += array.capacity() * sizeof(T);
+	if (array.capacity())
+		num_heap_blocks++;
+}
+
+
+int Netlist::addNet(NetKind kind, int width, int number, int name)
+{
+	net_kind.push_back(kind);
+	net_width.push_back(width);
+	net_number.push_back(number);
+	net_name.push_back(name);
+	net_value.push_back(0);
+	net_definition.push_back(-1);
+	net_contents.push_back(-1);
+	return net_kind.size() - 1;
+}
+
+
+int Netlist::addNamedNet(NetKind kind, int width, const std::string &name)
+{
+	names.push_back(name);
+	return addNet(kind, width, -1, names.size() - 1);
+}
+
+
+int Netlist::addConstant(long long value, int width)
+{
+	int net = addNet(NetKindConstant, width, -1, -1);
+	net_value[net] = value;
+	return net;
+}
+
+
+int Netlist::addDataFlow(DataFlow::Opcode opcode, int dest,
+		const int *operand_begin, int num_operands)
+{
+	int dataflow = dataflow_opcode.size();
+	dataflow_opcode.push_back(opcode);
+	dataflow_dest.push_back(dest);
+	dataflow_operand_begin.push_back(operands.size());
+	dataflow_num_operands.push_back(num_operands);
+	operands.insert(operands.end(), operand_begin,
+			operand_begin + num_operands);
+
+	// Whole nets
+	operand_low.resize(operands.size());
+	operand_width.resize(operands.size());
+
+	// Record definition
+	if (dest >= 0)
+		net_definition[dest] = dataflow;
+	return dataflow;
+}
+
+
+void Netlist::removeDataFlow(int dataflow)
+{
+	int dest = dataflow_dest[dataflow];
+	if (dest >= 0 && net_definition[dest] == dataflow)
+		net_definition[dest] = -1;
+	dataflow_opcode[dataflow] = DataFlow::OpcodeInvalid;
+	dataflow_num_operands[dataflow] = 0;
+}
+
+
+const std::string &Netlist::getNetName(int net) const
+{
+	static const std::string empty;
+	return net_name[net] < 0 ? empty : names[net_name[net]];
+}
+
+
+
+std::string Netlist::getPrintedName(int net) const
+{
+	if (net_number[net] < 0)
+		return getNetName(net);
+	char text[24];
+	snprintf(text, sizeof text, "%s%03d", net_kind[net] == NetKindRegister ?
+			"reg" : net_kind[net] == NetKindMemory ? "mem" : "wire",
+			net_number[net]);
+	return text;
+}
+
+
+bool Netlist::getConstant(int net, long long &value) const
+{
+	if (net_kind[net] == NetKindConstant)
+	{
+		value = net_value[net];
+		return true;
+	}
+
+	// Whole constant net assigned to a wire
+	int definition = net_definition[net];
+	if (definition < 0 || dataflow_opcode[definition] != DataFlow::OpcodeAssign ||
+			getOperandWidth(definition, 0))
+		return false;
+	int src = getOperand(definition, 0);
+	if (net_kind[src] != NetKindConstant)
+		return false;
+	value = net_value[src];
+	return true;
+}
+
+
+void Netlist::getMemoryUsage(size_t &num_bytes, size_t &num_heap_blocks) const
+{
+	addArrayUsage(net_kind, num_bytes, num_heap_blocks);
+	addArrayUsage(net_width, num_bytes, num_heap_blocks);
+	addArrayUsage(net_number, num_bytes, num_heap_blocks);
+	addArrayUsage(net_name, num_bytes, num_heap_blocks);
+	addArrayUsage(net_value, num_bytes, num_heap_blocks);
+	addArrayUsage(net_definition, num_bytes, num_heap_blocks);
+	addArrayUsage(net_contents, num_bytes, num_heap_blocks);
+	addArrayUsage(contents, num_bytes, num_heap_blocks);
+	for (const std::vector<long long> &words : contents)
+		addArrayUsage(words, num_bytes, num_heap_blocks);
+	addArrayUsage(names, num_bytes, num_heap_blocks);
+	addArrayUsage(dataflow_opcode, num_bytes, num_heap_blocks);
+	addArrayUsage(dataflow_dest, num_bytes, num_heap_blocks);
+	addArrayUsage(dataflow_operand_begin, num_bytes, num_heap_blocks);
+	addArrayUsage(dataflow_num_operands, num_bytes, num_heap_blocks);
+	addArrayUsage(operands, num_bytes, num_heap_blocks);
+	addArrayUsage(operand_low, num_bytes, num_heap_blocks);
+	addArrayUsage(operand_width, num_bytes, num_heap_blocks);
+}
+
+}
@@ -0,0 +1,237 @@
+/**
+ * @file   Netlist.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  Netlist class contains the nets and dataflows of a verilog module,
+ *         stored in parallel arrays and referred to by integer IDs.
+ */
+
+#ifndef VERILOG_NETLIST_H
+#define VERILOG_NETLIST_H
+
+#include <cassert>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "DataFlow.h"
+
+
+namespace verilog
+{
+
+class Netlist
+{
+public:
+
+	// Net kinds
+	enum NetKind
+	{
+		NetKindInvalid = 0,
+
+		NetKindWire,
+		NetKindInput,
+		NetKindOutput,
+		NetKindConstant,
+		NetKindRegister,
+		NetKindMemory
+	};
+
+private:
+
+	// Nets. Net 'i' is described by entry 'i' of every array.
+	std::vector<NetKind> net_kind;
+	std::vector<int> net_width;
+
+	// Number of automatically named nets, printed as 'wireNNN' or
+	// 'regNNN', or -1
+	std::vector<int> net_number;
+
+	// Index in 'names' of explicitly named nets, such as ports, or -1
+	std::vector<int> net_name;
+
+	// Value of constant nets, or number of words of memories
+	std::vector<long long> net_value;
+
+	// Dataflow defining each net, or -1 for ports and constants
+	std::vector<int> net_definition;
+
+	// Index in 'contents' of the initial words of memories, or -1 for
+	// memories starting undefined and other nets
+	std::vector<int> net_contents;
+
+	// Initial words of memories, such as the tables of ROMs
+	std::vector<std::vector<long long>> contents;
+
+	// Names of explicitly named nets
+	std::vector<std::string> names;
+
+	// Dataflows. Dataflow 'i' is described by entry 'i' of every array.
+	// Its operands are entries 'dataflow_operand_begin[i]' and on of
+	// 'operands'.
+	std::vector<DataFlow::Opcode> dataflow_opcode;
+	std::vector<int> dataflow_dest;
+	std::vector<int> dataflow_operand_begin;
+	std::vector<int> dataflow_num_operands;
+
+	// Operand nets of all dataflows. An operand can be a slice of its
+	// net, given by its lowest bit and its width, or the whole net if
+	// the width is 0.
+	std::vector<int> operands;
+	std::vector<int> operand_low;
+	std::vector<int> operand_width;
+
+	// Net number counter. It is kept per thread, so that modules
+	// translated in parallel are numbered exactly as in a serial run.
+	static thread_local int next_number;
+
+	// Add a net and return its ID
+	int addNet(NetKind kind, int width, int number, int name);
+
+	// Add a dataflow given the range of its operands
+	int addDataFlow(DataFlow::Opcode opcode, int dest,
+			const int *operand_begin, int num_operands);
+
+public:
+
+	// Restart net numbering from zero. This is done for every LLVM
+	// module, so the names only depend on the translated file.
+	static void resetNumbering() { next_number = 0; }
+
+	// Add an automatically named internal wire and return its ID
+	int addWire(int width)
+	{
+		return addNet(NetKindWire, width, next_number++, -1);
+	}
+
+	// Add an automatically named register and return its ID
+	int addRegister(int width)
+	{
+		return addNet(NetKindRegister, width, next_number++, -1);
+	}
+
+	// Add an automatically named memory of 'depth' words of the given
+	// width, and return its ID. Memories are only read and written by
+	// OpcodeRam dataflows, and read by OpcodeRom dataflows.
+	int addMemory(int width, int depth)
+	{
+		int net = addNet(NetKindMemory, width, next_number++, -1);
+		net_value[net] = depth;
+		return net;
+	}
+
+	// Add a named net, such as a module port, and return its ID
+	int addNamedNet(NetKind kind, int width, const std::string &name);
+
+	// Add a constant net and return its ID
+	int addConstant(long long value, int width);
+
+	// Add a dataflow assigning net 'dest' from the given operands, and
+	// return its ID. Argument 'dest' is -1 for dataflows not driving
+	// any net.
+	int addDataFlow(DataFlow::Opcode opcode, int dest,
+			std::initializer_list<int> operand_list)
+	{
+		return addDataFlow(opcode, dest, operand_list.begin(),
+				operand_list.size());
+	}
+	int addDataFlow(DataFlow::Opcode opcode, int dest,
+			const std::vector<int> &operand_list)
+	{
+		return addDataFlow(opcode, dest, operand_list.data(),
+				operand_list.size());
+	}
+
+	// Remove a dataflow, whose opcode becomes OpcodeInvalid. Its ID
+	// must also be removed from its code block.
+	void removeDataFlow(int dataflow);
+
+	// Number of nets and dataflows
+	int getNumNets() const { return net_kind.size(); }
+	int getNumDataFlows() const { return dataflow_opcode.size(); }
+
+	// Add the bytes taken by the arrays of the netlist, including their
+	// unused capacity, to 'num_bytes', and the heap blocks holding them
+	// to 'num_heap_blocks'
+	void getMemoryUsage(size_t &num_bytes, size_t &num_heap_blocks) const;
+
+	// Net properties
+	NetKind getNetKind(int net) const { return net_kind[net]; }
+	int getNetWidth(int net) const { return net_width[net]; }
+	void setNetWidth(int net, int width) { net_width[net] = width; }
+	int getNetNumber(int net) const { return net_number[net]; }
+	long long getNetValue(int net) const { return net_value[net]; }
+	int getNetDefinition(int net) const { return net_definition[net]; }
+	int getMemoryDepth(int net) const { return net_value[net]; }
+
+	// Set the initial words of a memory, as many as its depth
+	void setMemoryContents(int net, const std::vector<long long> &words)
+	{
+		assert(net_kind[net] == NetKindMemory &&
+				(int) words.size() == net_value[net]);
+		net_contents[net] = contents.size();
+		contents.push_back(words);
+	}
+
+	// Return the initial words of a memory, or nullptr if it starts
+	// undefined
+	const std::vector<long long> *getMemoryContents(int net) const
+	{
+		return net_contents[net] < 0 ? nullptr :
+				&contents[net_contents[net]];
+	}
+
+	// Return the name of a net given explicitly, or an empty string
+	// for automatically numbered nets.
+	const std::string &getNetName(int net) const;
+
+	// Return the name of a net as printed, such as 'wire012' or 'mem003'
+	std::string getPrintedName(int net) const;
+
+	// If the net holds a constant, either as a constant net or as a wire
+	// assigned a constant, return true and its value in 'value'.
+	bool getConstant(int net, long long &value) const;
+
+	// Dataflow properties
+	DataFlow::Opcode getOpcode(int dataflow) const
+	{
+		return dataflow_opcode[dataflow];
+	}
+	int getDest(int dataflow) const { return dataflow_dest[dataflow]; }
+	int getNumOperands(int dataflow) const
+	{
+		return dataflow_num_operands[dataflow];
+	}
+	int getOperand(int dataflow, int index) const
+	{
+		assert(index < dataflow_num_operands[dataflow]);
+		return operands[dataflow_operand_begin[dataflow] + index];
+	}
+	void setOperand(int dataflow, int index, int net)
+	{
+		assert(index < dataflow_num_operands[dataflow]);
+		operands[dataflow_operand_begin[dataflow] + index] = net;
+	}
+
+	// Slice of an operand. The width is 0 if the whole net is used.
+	int getOperandLow(int dataflow, int index) const
+	{
+		assert(index < dataflow_num_operands[dataflow]);
+		return operand_low[dataflow_operand_begin[dataflow] + index];
+	}
+	int getOperandWidth(int dataflow, int index) const
+	{
+		assert(index < dataflow_num_operands[dataflow]);
+		return operand_width[dataflow_operand_begin[dataflow] + index];
+	}
+	void setOperandSlice(int dataflow, int index, int low, int width)
+	{
+		assert(index < dataflow_num_operands[dataflow]);
+		operand_low[dataflow_operand_begin[dataflow] + index] = low;
+		operand_width[dataflow_operand_begin[dataflow] + index] = width;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,591 @@
+/**
+ * @file   Optimizer.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the netlist optimizations of verilog modules.
+ */
+
+#include "llvm/Support/CommandLine.h"
+
+#include <initializer_list>
+#include <iomanip>
+#include <unordered_set>
+#include <utility>
+
+#include "CodeBlock.h"
+#include "Error.h"
+#include "Module.h"
+#include "Netlist.h"
+#include "Optimizer.h"
+#include "Pipeliner.h"
+#include "Reassociator.h"
+#include "ResourceScheduler.h"
+#include "TableGenerator.h"
+#include "WidthInference.h"
+
+
+namespace verilog
+{
+
+static llvm::cl::opt<bool> Optimize("verilog-opt",
+		llvm::cl::desc("Optimize the verilog netlist (copy forwarding, "
+				"common subexpressions, dead nets)"),
+		llvm::cl::init(true));
+
+static llvm::cl::opt<bool> LowerBitOperations("verilog-lower-bits",
+		llvm::cl::desc("Write shifts and masks by constants as slices and "
+				"concatenations"),
+		llvm::cl::init(true));
+
+static llvm::cl::opt<bool> NarrowWidths("verilog-narrow",
+		llvm::cl::desc("Give internal wires their minimal width"),
+		llvm::cl::init(true));
+
+static llvm::cl::opt<bool> Reassociate("verilog-reassociate",
+		llvm::cl::desc("Rebalance chains of additions and bitwise operators "
+				"into trees of minimal delay"),
+		llvm::cl::init(true));
+
+static llvm::cl::opt<bool> CarrySave("verilog-carry-save",
+		llvm::cl::desc("Reduce additions of three or more operands with "
+				"carry-save adders where they are faster"),
+		llvm::cl::init(true));
+
+static llvm::cl::opt<unsigned> TableInputs("verilog-table-inputs",
+		llvm::cl::desc("Replace combinational modules reading at most <n> "
+				"input bits, up to 16, with a truth table evaluated at "
+				"compile time, where its area and delay are smaller"),
+		llvm::cl::value_desc("n"),
+		llvm::cl::init(12));
+
+static llvm::cl::opt<bool> TableForce("verilog-table-force",
+		llvm::cl::desc("Use the truth table of modules reading at most "
+				"'-verilog-table-inputs' input bits, whatever its area and "
+				"delay"));
+
+static llvm::cl::opt<unsigned> PipelineStages("verilog-pipeline-stages",
+		llvm::cl::desc("Emit clocked modules with <n> register stages, "
+				"accepting new inputs every cycle"),
+		llvm::cl::value_desc("n"),
+		llvm::cl::init(0));
+
+static llvm::cl::opt<double> ClockPeriod("verilog-clock-ns",
+		llvm::cl::desc("Emit clocked modules with the fewest register stages "
+				"meeting a clock period of <ns> nanoseconds, and report "
+				"their critical path"),
+		llvm::cl::value_desc("ns"),
+		llvm::cl::init(0));
+
+static llvm::cl::opt<unsigned> MaxAdders("verilog-max-adders",
+		llvm::cl::desc("Share at most <n> adders and subtracters between "
+				"the additions of a module, over several cycles"),
+		llvm::cl::value_desc("n"),
+		llvm::cl::init(0));
+
+static llvm::cl::opt<unsigned> MaxComparators("verilog-max-comparators",
+		llvm::cl::desc("Share at most <n> comparators between the "
+				"comparisons of a module, over several cycles"),
+		llvm::cl::value_desc("n"),
+		llvm::cl::init(0));
+
+static llvm::cl::opt<unsigned> MaxMultipliers("verilog-max-multipliers",
+		llvm::cl::desc("Share at most <n> multipliers between the "
+				"multiplications of a module, over several cycles"),
+		llvm::cl::value_desc("n"),
+		llvm::cl::init(0));
+
+
+// Return whether the operands of an opcode can be swapped
+static bool isCommutative(DataFlow::Opcode opcode)
+{
+	switch (opcode)
+	{
+	case DataFlow::OpcodeAdd:
+	case DataFlow::OpcodeMul:
+	case DataFlow::OpcodeXor:
+	case DataFlow::OpcodeAnd:
+	case DataFlow::OpcodeOr:
+	case DataFlow::OpcodeEq:
+		return true;
+	default:
+		return false;
+	}
+}
+
+
+// Return whether two operands use the same bits of the same net
+static bool isSameOperand(const Netlist *netlist, int first, int first_index,
+		int second, int second_index)
+{
+	return netlist->getOperand(first, first_index) ==
+			netlist->getOperand(second, second_index) &&
+			netlist->getOperandLow(first, first_index) ==
+			netlist->getOperandLow(second, second_index) &&
+			netlist->getOperandWidth(first, first_index) ==
+			netlist->getOperandWidth(second, second_index);
+}
+
+
+// Hash and equality of the values computed by two dataflows, given by
+// their opcode, width, and operands. Operands of commutative opcodes
+// are compared in any order.
+struct ExpressionHash
+{
+	const Netlist *netlist;
+
+	size_t operator()(int dataflow) const
+	{
+		DataFlow::Opcode opcode = netlist->getOpcode(dataflow);
+		size_t hash = opcode * 31 + netlist->getNetWidth(
+				netlist->getDest(dataflow));
+		int num_operands = netlist->getNumOperands(dataflow);
+		for (int index = 0; index < num_operands; index++)
+		{
+			size_t operand = netlist->getOperand(dataflow, index);
+			operand = (operand * 31 + netlist->getOperandLow(dataflow,
+					index)) * 31 + netlist->getOperandWidth(dataflow, index);
+			hash = isCommutative(opcode) ? hash + operand * 0x9e3779b9 :
+					hash * 31 + operand;
+		}
+		return hash;
+	}
+};
+
+struct ExpressionEqual
+{
+	const Netlist *netlist;
+
+	bool operator()(int first, int second) const
+	{
+		DataFlow::Opcode opcode = netlist->getOpcode(first);
+		int num_operands = netlist->getNumOperands(first);
+		if (opcode != netlist->getOpcode(second) ||
+				num_operands != netlist->getNumOperands(second) ||
+				netlist->getNetWidth(netlist->getDest(first)) !=
+				netlist->getNetWidth(netlist->getDest(second)))
+			return false;
+
+		// Same operands in the same order
+		bool equal = true;
+		for (int index = 0; index < num_operands && equal; index++)
+			equal = isSameOperand(netlist, first, index, second, index);
+		if (equal || !isCommutative(opcode) || num_operands != 2)
+			return equal;
+
+		// Swapped operands
+		return isSameOperand(netlist, first, 0, second, 1) &&
+				isSameOperand(netlist, first, 1, second, 0);
+	}
+};
+
+
+void OptimizerStatistics::dump(std::ostream &os) const
+{
+	os << "===-- verilog netlist optimizations --===\n";
+	os << "  bit operations lowered         " << num_bit_operations_lowered << '\n';
+	os << "  copies forwarded               " << num_copies_forwarded << '\n';
+	os << "  subexpressions merged          " << num_subexpressions_merged << '\n';
+	os << "  dead dataflows removed         " << num_dead_dataflows << '\n';
+	os << "  wire bits saved                " << num_wire_bits_saved
+			<< " of " << num_wire_bits << '\n';
+	os << "  wire bits saved per module     " << std::fixed
+			<< std::setprecision(1) << (num_modules ?
+			(double) num_wire_bits_saved / num_modules : 0.0) << '\n';
+	os << "  sign extensions added          " << num_sign_extensions << '\n';
+	os << "  chains rebalanced              " << num_chains_rebalanced
+			<< " (" << num_carry_save_trees << " carry-save)\n";
+	os << "  operators shared               " << num_operators_shared << '\n';
+	os << "  truth tables                   " << num_tables << '\n';
+	os << "  pipeline registers added       " << num_registers
+			<< " (" << num_register_bits << " bits)\n";
+}
+
+
+Optimizer::Optimizer(Module &module) :
+		module(module),
+		netlist(module.getNetlist())
+{
+	replacement.resize(netlist.getNumNets());
+	for (int net = 0; net < netlist.getNumNets(); net++)
+		replacement[net] = net;
+}
+
+
+int Optimizer::getReplacement(int net)
+{
+	while (replacement[net] != net)
+	{
+		// Shorten the chain on the way
+		replacement[net] = replacement[replacement[net]];
+		net = replacement[net];
+	}
+	return net;
+}
+
+
+void Optimizer::replaceOperands(int dataflow)
+{
+	int num_operands = netlist.getNumOperands(dataflow);
+	for (int index = 0; index < num_operands; index++)
+		netlist.setOperand(dataflow, index, getReplacement(
+				netlist.getOperand(dataflow, index)));
+}
+
+
+void Optimizer::updateDataFlows()
+{
+	for (CodeBlock *code_block : module.getCodeBlocks())
+	{
+		code_block->removeDataFlows([this](int dataflow)
+		{
+			return netlist.getOpcode(dataflow) ==
+					DataFlow::OpcodeInvalid;
+		});
+		for (int dataflow : code_block->getDataFlows())
+			replaceOperands(dataflow);
+	}
+}
+
+
+int Optimizer::lowerBitOperation(int dataflow)
+{
+	DataFlow::Opcode opcode = netlist.getOpcode(dataflow);
+	if (opcode != DataFlow::OpcodeLshr && opcode != DataFlow::OpcodeShl &&
+			opcode != DataFlow::OpcodeAnd && opcode != DataFlow::OpcodeOr)
+		return -1;
+
+	// Operand and constant. Masks can be either operand.
+	int dest = netlist.getDest(dataflow);
+	int width = netlist.getNetWidth(dest);
+	int src = netlist.getOperand(dataflow, 0);
+	int other = netlist.getOperand(dataflow, 1);
+	long long value;
+	if (netlist.getOperandWidth(dataflow, 0) ||
+			netlist.getOperandWidth(dataflow, 1))
+		return -1;
+	if ((opcode == DataFlow::OpcodeAnd || opcode == DataFlow::OpcodeOr) &&
+			netlist.getConstant(src, value))
+		std::swap(src, other);
+	if (netlist.getConstant(src, value) || !netlist.getConstant(other, value))
+		return -1;
+	unsigned long long all = width < 64 ? (1ULL << width) - 1 : ~0ULL;
+	unsigned long long bits = value & all;
+
+	// Operands of the concatenation, from the most significant one
+	std::vector<int> operands;
+	std::vector<std::pair<int, int>> slices;
+	int zero = module.getConstant(0, width);
+	int copy = -1;
+	switch (opcode)
+	{
+	case DataFlow::OpcodeLshr:
+	case DataFlow::OpcodeShl:
+	{
+		// '{n'd0, src[msb:n]}' or '{src[msb-n:0], n'd0}'
+		if (value < 0 || value >= width)
+		{
+			copy = zero;
+			break;
+		}
+		if (!value)
+		{
+			copy = src;
+			break;
+		}
+		int amount = value;
+		if (opcode == DataFlow::OpcodeShl)
+		{
+			operands.push_back(src);
+			slices.emplace_back(0, width - amount);
+		}
+		operands.push_back(module.getConstant(0, amount));
+		slices.emplace_back(0, 0);
+		if (opcode == DataFlow::OpcodeLshr)
+		{
+			operands.push_back(src);
+			slices.emplace_back(amount, width - amount);
+		}
+		break;
+	}
+
+	case DataFlow::OpcodeAnd:
+	case DataFlow::OpcodeOr:
+	{
+		// Bits kept from the operand, and bits forced to the mask
+		bool is_and = opcode == DataFlow::OpcodeAnd;
+		if (bits == (is_and ? all : 0))
+		{
+			copy = src;
+			break;
+		}
+		if (bits == (is_and ? 0 : all))
+		{
+			copy = module.getConstant(is_and ? 0 : -1, width);
+			break;
+		}
+
+		// One operand per run of equal mask bits
+		for (int high = width - 1; high >= 0; )
+		{
+			bool set = (bits >> high) & 1;
+			int low = high;
+			while (low > 0 && ((bits >> (low - 1)) & 1) == set)
+				low--;
+			if (set == is_and)
+			{
+				operands.push_back(src);
+				slices.emplace_back(low, high - low + 1);
+			}
+			else
+			{
+				operands.push_back(module.getConstant(set ? -1 : 0,
+						high - low + 1));
+				slices.emplace_back(0, 0);
+			}
+			high = low - 1;
+		}
+		break;
+	}
+
+	default:
+		return -1;
+	}
+
+	// Replace the dataflow
+	netlist.removeDataFlow(dataflow);
+	statistics.num_bit_operations_lowered++;
+	if (copy >= 0)
+		return netlist.addDataFlow(DataFlow::OpcodeAssign, dest, { copy });
+	int concat = netlist.addDataFlow(DataFlow::OpcodeConcat, dest, operands);
+	for (int index = 0; index < (int) slices.size(); index++)
+		netlist.setOperandSlice(concat, index, slices[index].first,
+				slices[index].second);
+	return concat;
+}
+
+
+void Optimizer::lowerBitOperations()
+{
+	for (CodeBlock *code_block : module.getCodeBlocks())
+	{
+		std::vector<int> list;
+		for (int dataflow : code_block->getDataFlows())
+		{
+			int lowered = lowerBitOperation(dataflow);
+			list.push_back(lowered >= 0 ? lowered : dataflow);
+		}
+		code_block->setDataFlows(std::move(list));
+	}
+
+	// Constant nets created
+	for (int net = replacement.size(); net < netlist.getNumNets(); net++)
+		replacement.push_back(net);
+}
+
+
+void Optimizer::forwardCopies()
+{
+	for (CodeBlock *code_block : module.getCodeBlocks())
+	{
+		for (int dataflow : code_block->getDataFlows())
+		{
+			if (netlist.getOpcode(dataflow) == DataFlow::OpcodeInvalid)
+				continue;
+			replaceOperands(dataflow);
+
+			// Copy of a whole net into an internal wire of the same
+			// width. Constants are kept, since they are pooled already.
+			int dest = netlist.getDest(dataflow);
+			if (netlist.getOpcode(dataflow) != DataFlow::OpcodeAssign ||
+					netlist.getNetKind(dest) != Netlist::NetKindWire ||
+					netlist.getOperandWidth(dataflow, 0))
+				continue;
+			int src = netlist.getOperand(dataflow, 0);
+			if (netlist.getNetKind(src) == Netlist::NetKindConstant ||
+					netlist.getNetWidth(src) != netlist.getNetWidth(dest))
+				continue;
+
+			replacement[dest] = src;
+			netlist.removeDataFlow(dataflow);
+			statistics.num_copies_forwarded++;
+		}
+	}
+	updateDataFlows();
+}
+
+
+void Optimizer::eliminateCommonSubexpressions()
+{
+	std::unordered_set<int, ExpressionHash, ExpressionEqual> expressions(
+			netlist.getNumDataFlows(), ExpressionHash{ &netlist },
+			ExpressionEqual{ &netlist });
+	for (CodeBlock *code_block : module.getCodeBlocks())
+	{
+		for (int dataflow : code_block->getDataFlows())
+		{
+			DataFlow::Opcode opcode = netlist.getOpcode(dataflow);
+			if (opcode == DataFlow::OpcodeInvalid)
+				continue;
+			replaceOperands(dataflow);
+
+			// Only values held in internal wires can be merged
+			int dest = netlist.getDest(dataflow);
+			if (netlist.getNetKind(dest) != Netlist::NetKindWire)
+				continue;
+
+			// First occurrence
+			auto it = expressions.insert(dataflow);
+			if (it.second)
+				continue;
+
+			// Merge with the previous occurrence
+			replacement[dest] = netlist.getDest(*it.first);
+			netlist.removeDataFlow(dataflow);
+			statistics.num_subexpressions_merged++;
+		}
+	}
+	updateDataFlows();
+}
+
+
+void Optimizer::reassociate()
+{
+	Reassociator reassociator(module, statistics, CarrySave);
+	reassociator.run();
+
+	// Nets created
+	for (int net = replacement.size(); net < netlist.getNumNets(); net++)
+		replacement.push_back(net);
+}
+
+
+void Optimizer::removeDeadDataFlows()
+{
+	// Mark dataflows reaching the output ports, starting from the
+	// dataflows that drive them. Memory ports write their memory, so
+	// they are kept as well.
+	std::vector<bool> live(netlist.getNumDataFlows());
+	std::vector<int> work_list;
+	for (int port : { module.getOutputPort(), module.getDonePort() })
+	{
+		int definition = port < 0 ? -1 : netlist.getNetDefinition(port);
+		if (definition >= 0)
+		{
+			live[definition] = true;
+			work_list.push_back(definition);
+		}
+	}
+	for (int dataflow = 0; dataflow < netlist.getNumDataFlows(); dataflow++)
+	{
+		if (netlist.getOpcode(dataflow) == DataFlow::OpcodeRam &&
+				!live[dataflow])
+		{
+			live[dataflow] = true;
+			work_list.push_back(dataflow);
+		}
+	}
+	while (!work_list.empty())
+	{
+		int dataflow = work_list.back();
+		work_list.pop_back();
+		for (int index = 0; index < netlist.getNumOperands(dataflow); index++)
+		{
+			int definition = netlist.getNetDefinition(
+					netlist.getOperand(dataflow, index));
+			if (definition >= 0 && !live[definition])
+			{
+				live[definition] = true;
+				work_list.push_back(definition);
+			}
+		}
+	}
+
+	// Remove the others
+	for (int dataflow = 0; dataflow < netlist.getNumDataFlows(); dataflow++)
+	{
+		if (live[dataflow] || netlist.getOpcode(dataflow) ==
+				DataFlow::OpcodeInvalid)
+			continue;
+		netlist.removeDataFlow(dataflow);
+		statistics.num_dead_dataflows++;
+	}
+	updateDataFlows();
+}
+
+
+double Optimizer::getClockPeriod()
+{
+	return ClockPeriod;
+}
+
+
+int Optimizer::getResourceLimit(ResourceScheduler::Resource resource)
+{
+	switch (resource)
+	{
+	case ResourceScheduler::ResourceAdder:
+		return MaxAdders;
+
+	case ResourceScheduler::ResourceComparator:
+		return MaxComparators;
+
+	case ResourceScheduler::ResourceMultiplier:
+		return MaxMultipliers;
+
+	default:
+		return 0;
+	}
+}
+
+
+void Optimizer::run()
+{
+	if (Optimize)
+	{
+		if (LowerBitOperations)
+			lowerBitOperations();
+		forwardCopies();
+		eliminateCommonSubexpressions();
+		if (Reassociate)
+			reassociate();
+		removeDeadDataFlows();
+		if (NarrowWidths)
+		{
+			WidthInference width_inference(module, statistics);
+			width_inference.run();
+		}
+	}
+
+	// Combinational modules of few input bits are evaluated into a table
+	if (TableInputs > (unsigned) TableGenerator::max_inputs)
+		fatal("Error: invalid table inputs '" + std::to_string(TableInputs) +
+				"', expected at most " +
+				std::to_string(TableGenerator::max_inputs));
+	TableGenerator table_generator(module, statistics);
+	table_generator.run(TableInputs, TableForce);
+
+	// Operators of functions without loops are shared over several
+	// cycles if there are more than allowed. This gives a state machine,
+	// and a clock period bounds the logic chained in a cycle.
+	if ((MaxAdders || MaxComparators || MaxMultipliers) &&
+			module.getStartPort() < 0)
+	{
+		ResourceScheduler resource_scheduler(module, statistics, ClockPeriod);
+		for (int resource = 0; resource < ResourceScheduler::ResourceMax;
+				resource++)
+			resource_scheduler.setLimit((ResourceScheduler::Resource) resource,
+					getResourceLimit((ResourceScheduler::Resource) resource));
+		resource_scheduler.run();
+	}
+
+	// Registers are placed on the final netlist. A clock period
+	// overrides the number of stages. State machines are not pipelined.
+	if ((PipelineStages || ClockPeriod > 0) && module.getStartPort() < 0)
+	{
+		Pipeliner pipeliner(module, statistics, PipelineStages,
+				ClockPeriod);
+		pipeliner.run();
+	}
+}
+
+}
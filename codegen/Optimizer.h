@@ -0,0 +1,171 @@
+/**
+ * @file   Optimizer.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  Optimizer class runs the netlist optimizations of a verilog
+ *         module before it is printed.
+ */
+
+#ifndef VERILOG_OPTIMIZER_H
+#define VERILOG_OPTIMIZER_H
+
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#include "ResourceScheduler.h"
+
+
+namespace verilog
+{
+
+// Forward declarations
+class Module;
+class Netlist;
+
+
+// Counters of the netlist optimizations, added over one or more modules
+struct OptimizerStatistics
+{
+	// Shifts and masks by constants turned into slices and
+	// concatenations, or removed
+	size_t num_bit_operations_lowered = 0;
+
+	// Copy assignments whose destination was replaced by their source
+	size_t num_copies_forwarded = 0;
+
+	// Dataflows merged with an identical dataflow
+	size_t num_subexpressions_merged = 0;
+
+	// Dataflows removed because their net does not reach the output
+	size_t num_dead_dataflows = 0;
+
+	// Modules whose wires were narrowed
+	size_t num_modules = 0;
+
+	// Bits of internal wires before width inference, and bits saved by
+	// narrowing them, net of the sign extensions added
+	size_t num_wire_bits = 0;
+	long long num_wire_bits_saved = 0;
+
+	// Sign extensions added for narrowed wires
+	size_t num_sign_extensions = 0;
+
+	// Chains of associative operators rebuilt as trees, and those
+	// reduced by carry-save adders
+	size_t num_chains_rebalanced = 0;
+	size_t num_carry_save_trees = 0;
+
+	// Operators removed by sharing units between them
+	size_t num_operators_shared = 0;
+
+	// Modules replaced by a truth table
+	size_t num_tables = 0;
+
+	// Pipeline registers added, and their bits
+	size_t num_registers = 0;
+	size_t num_register_bits = 0;
+
+	// Add the counters of another module
+	void add(const OptimizerStatistics &other)
+	{
+		num_bit_operations_lowered += other.num_bit_operations_lowered;
+		num_copies_forwarded += other.num_copies_forwarded;
+		num_subexpressions_merged += other.num_subexpressions_merged;
+		num_dead_dataflows += other.num_dead_dataflows;
+		num_modules += other.num_modules;
+		num_wire_bits += other.num_wire_bits;
+		num_wire_bits_saved += other.num_wire_bits_saved;
+		num_sign_extensions += other.num_sign_extensions;
+		num_chains_rebalanced += other.num_chains_rebalanced;
+		num_carry_save_trees += other.num_carry_save_trees;
+		num_operators_shared += other.num_operators_shared;
+		num_tables += other.num_tables;
+		num_registers += other.num_registers;
+		num_register_bits += other.num_register_bits;
+	}
+
+	// Print a report
+	void dump(std::ostream &os) const;
+};
+
+
+class Optimizer
+{
+	// Module being optimized
+	Module &module;
+	Netlist &netlist;
+
+	// Counters
+	OptimizerStatistics statistics;
+
+	// Net replacing each net, built by the passes merging nets
+	std::vector<int> replacement;
+
+	// Return the net that replaces a net, following chains of
+	// replacements.
+	int getReplacement(int net);
+
+	// Replace the operands of a dataflow by their replacement nets
+	void replaceOperands(int dataflow);
+
+	// Remove dataflows with opcode OpcodeInvalid from all code blocks,
+	// and replace the operands of the others. Uses found before the
+	// replaced net in the code block order are updated here.
+	void updateDataFlows();
+
+	// Return a dataflow computing the same value as a shift by a
+	// constant amount, or an 'and' or 'or' with a constant mask, using
+	// only wiring. Return -1 if the dataflow is not one of them.
+	int lowerBitOperation(int dataflow);
+
+	// Replace shifts and masks by constants with slices and
+	// concatenations of their operand
+	void lowerBitOperations();
+
+	// Replace internal wires assigned another net by that net
+	void forwardCopies();
+
+	// Merge dataflows with the same opcode, width, and operands
+	void eliminateCommonSubexpressions();
+
+	// Rebuild chains of associative operators as trees of minimal delay
+	void reassociate();
+
+	// Remove dataflows whose destination does not reach the output ports
+	void removeDeadDataFlows();
+
+public:
+
+	// Constructor
+	Optimizer(Module &module);
+
+	// Run all optimizations enabled in the command line. They are all
+	// enabled unless option '-verilog-opt=false' is given. Width
+	// inference can be disabled alone with '-verilog-narrow=false', the
+	// lowering of constant shifts and masks with
+	// '-verilog-lower-bits=false', and the rebalancing of associative
+	// chains with '-verilog-reassociate=false'. Combinational modules
+	// reading at most '-verilog-table-inputs' input bits are then replaced
+	// by a truth table where it wins. Finally, operators are shared if
+	// option '-verilog-max-adders', '-verilog-max-comparators' or
+	// '-verilog-max-multipliers' is exceeded, and the module is pipelined
+	// otherwise if option '-verilog-pipeline-stages' or '-verilog-clock-ns'
+	// is given.
+	void run();
+
+	// Return the counters of the optimizations
+	const OptimizerStatistics &getStatistics() { return statistics; }
+
+	// Return the clock period given with option '-verilog-clock-ns', or 0
+	static double getClockPeriod();
+
+	// Return the largest number of units of a kind given with options
+	// '-verilog-max-adders', '-verilog-max-comparators' and
+	// '-verilog-max-multipliers', or 0 for no limit
+	static int getResourceLimit(ResourceScheduler::Resource resource);
+};
+
+}
+
+#endif
@@ -0,0 +1,433 @@
+/**
+ * @file   Pipeliner.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the pipelining of verilog modules.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <iomanip>
+#include <sstream>
+
+#include "CodeBlock.h"
+#include "Module.h"
+#include "Netlist.h"
+#include "Optimizer.h"
+#include "Pipeliner.h"
+
+
+namespace verilog
+{
+
+// Return whether an opcode only connects bits, with no logic delay
+static bool isWiring(DataFlow::Opcode opcode)
+{
+	switch (opcode)
+	{
+	case DataFlow::OpcodeAssign:
+	case DataFlow::OpcodeSext:
+	case DataFlow::OpcodeConcat:
+		return true;
+	default:
+		return false;
+	}
+}
+
+
+// Delay model, in ns. Logic of up to three operands and 2:1 multiplexers
+// take one LUT level, additions and comparisons a LUT level and a carry
+// chain, equality a tree of 6-input LUTs, shifts by a variable amount
+// a tree of 4:1 multiplexers, multiplications a cascade of DSP blocks, and
+// lookup tables a 6-input LUT followed by wide multiplexers.
+// Delays of the registers are not modelled.
+static const double lut_delay = 0.3;
+static const double carry_delay = 0.02;
+static const double dsp_delay = 1.5;
+
+
+Pipeliner::Pipeliner(Module &module, OptimizerStatistics &statistics,
+		int num_stages, double clock_period) :
+		module(module),
+		netlist(module.getNetlist()),
+		statistics(statistics),
+		num_stages(num_stages),
+		clock_period(clock_period)
+{
+}
+
+
+double Pipeliner::getDelay(const Netlist &netlist, int dataflow)
+{
+	// Width of the widest operand. Tables only count by their address.
+	int operand_width = 1;
+	for (int index = 0; index < netlist.getNumOperands(dataflow); index++)
+	{
+		if (netlist.getNetKind(netlist.getOperand(dataflow, index)) ==
+				Netlist::NetKindMemory)
+			continue;
+		int slice_width = netlist.getOperandWidth(dataflow, index);
+		operand_width = std::max(operand_width, slice_width ? slice_width :
+				netlist.getNetWidth(netlist.getOperand(dataflow, index)));
+	}
+	return getDelay(netlist.getOpcode(dataflow),
+			netlist.getNetWidth(netlist.getDest(dataflow)), operand_width);
+}
+
+
+double Pipeliner::getDelay(DataFlow::Opcode opcode, int width,
+		int operand_width)
+{
+	int levels = 1;
+	switch (opcode)
+	{
+	case DataFlow::OpcodeAdd:
+	case DataFlow::OpcodeSub:
+		return lut_delay + carry_delay * width;
+
+	case DataFlow::OpcodeUgt:
+		return lut_delay + carry_delay * operand_width;
+
+	case DataFlow::OpcodeMul:
+
+		// One DSP block per 18 bits of the operands
+		return dsp_delay * ((operand_width + 17) / 18);
+
+	case DataFlow::OpcodeEq:
+
+		// Three pairs of bits in the first level
+		for (int n = (operand_width + 2) / 3; n > 1; n = (n + 5) / 6)
+			levels++;
+		return lut_delay * levels;
+
+	case DataFlow::OpcodeLshr:
+	case DataFlow::OpcodeShl:
+		for (int n = 4; n < operand_width; n *= 4)
+			levels++;
+		return lut_delay * levels;
+
+	case DataFlow::OpcodeXor:
+	case DataFlow::OpcodeAnd:
+	case DataFlow::OpcodeOr:
+	case DataFlow::OpcodeNot:
+	case DataFlow::OpcodeMux:
+	case DataFlow::OpcodeMaj:
+		return lut_delay;
+
+	case DataFlow::OpcodeRom:
+
+		// A 6-input LUT per bit, and a level of wide multiplexers per two
+		// more bits of the address
+		for (int n = 6; n < operand_width; n += 2)
+			levels++;
+		return lut_delay * levels;
+
+	default:
+		return 0;
+	}
+}
+
+
+void Pipeliner::assignStages()
+{
+	// Number of operators on the longest path to every net
+	std::vector<int> depth(netlist.getNumNets());
+	int max_depth = 0;
+	for (int dataflow : dataflows)
+	{
+		int dest_depth = 0;
+		for (int index = 0; index < netlist.getNumOperands(dataflow); index++)
+			dest_depth = std::max(dest_depth,
+					depth[netlist.getOperand(dataflow, index)]);
+		if (!isWiring(netlist.getOpcode(dataflow)))
+			dest_depth++;
+		depth[netlist.getDest(dataflow)] = dest_depth;
+		max_depth = std::max(max_depth, dest_depth);
+	}
+
+	// Operator at depth 'd' goes to stage (d - 1) * (stages + 1) /
+	// max_depth, and wiring goes to the stage of its operands. The output
+	// port is assigned in the last stage.
+	for (int dataflow : dataflows)
+	{
+		int dest = netlist.getDest(dataflow);
+		int stage = 0;
+		for (int index = 0; index < netlist.getNumOperands(dataflow); index++)
+			stage = std::max(stage,
+					net_stage[netlist.getOperand(dataflow, index)]);
+		if (!isWiring(netlist.getOpcode(dataflow)))
+			stage = std::max(stage, (depth[dest] - 1) *
+					(num_stages + 1) / max_depth);
+		if (dest == module.getOutputPort())
+			stage = num_stages;
+		dataflow_stage[dataflow] = stage;
+		net_stage[dest] = stage;
+	}
+}
+
+
+int Pipeliner::scheduleEarly(std::vector<int> &stages)
+{
+	// Stage of every net, and time its value is ready in that stage
+	std::vector<int> stage_of(netlist.getNumNets());
+	std::vector<double> arrival(netlist.getNumNets());
+	int last_stage = 0;
+	for (int dataflow : dataflows)
+	{
+		// Earliest stage where all operands are available. Operands of
+		// earlier stages come from registers, ready at time 0.
+		int stage = 0;
+		double start = 0;
+		int num_operands = netlist.getNumOperands(dataflow);
+		for (int index = 0; index < num_operands; index++)
+			stage = std::max(stage, stage_of[netlist.getOperand(dataflow, index)]);
+		for (int index = 0; index < num_operands; index++)
+		{
+			int src = netlist.getOperand(dataflow, index);
+			if (stage_of[src] == stage)
+				start = std::max(start, arrival[src]);
+		}
+
+		// Move to the next stage if the period is exceeded. Dataflows
+		// longer than the period get a stage of their own.
+		double delay = getDelay(netlist, dataflow);
+		if (delay > 0 && start > 0 && start + delay > clock_period)
+		{
+			stage++;
+			start = 0;
+		}
+		int dest = netlist.getDest(dataflow);
+		stages[dataflow] = stage;
+		stage_of[dest] = stage;
+		arrival[dest] = start + delay;
+		last_stage = std::max(last_stage, stage);
+	}
+
+	// The output port is assigned in the last stage
+	int output_definition = netlist.getNetDefinition(module.getOutputPort());
+	if (output_definition >= 0)
+		stages[output_definition] = last_stage;
+	return last_stage;
+}
+
+
+bool Pipeliner::scheduleLate(std::vector<int> &stages)
+{
+	// Earliest stage using every net, and time from the net to the end
+	// of that stage
+	std::vector<int> stage_of(netlist.getNumNets(), INT_MAX);
+	std::vector<double> departure(netlist.getNumNets());
+	for (auto it = dataflows.rbegin(); it != dataflows.rend(); ++it)
+	{
+		// Latest stage before all users, as computed by them. Nets with
+		// no users are computed in the last stage.
+		int dataflow = *it;
+		int dest = netlist.getDest(dataflow);
+		int stage = stage_of[dest];
+		double end = departure[dest];
+		if (dest == module.getOutputPort() || stage == INT_MAX)
+		{
+			stage = num_stages;
+			end = 0;
+		}
+
+		// Move to the previous stage if the period is exceeded
+		double delay = getDelay(netlist, dataflow);
+		if (delay > 0 && end > 0 && end + delay > clock_period)
+		{
+			stage--;
+			end = 0;
+		}
+		if (stage < 0)
+			return false;
+		stages[dataflow] = stage;
+
+		for (int index = 0; index < netlist.getNumOperands(dataflow); index++)
+		{
+			int src = netlist.getOperand(dataflow, index);
+			if (stage < stage_of[src])
+			{
+				stage_of[src] = stage;
+				departure[src] = end + delay;
+			}
+			else if (stage == stage_of[src])
+			{
+				departure[src] = std::max(departure[src], end + delay);
+			}
+		}
+	}
+	return true;
+}
+
+
+long long Pipeliner::getRegisterBits(const std::vector<int> &stages)
+{
+	// Stage computing every net, and last stage using it
+	std::vector<int> first(netlist.getNumNets());
+	std::vector<int> last(netlist.getNumNets());
+	for (int dataflow : dataflows)
+	{
+		int dest = netlist.getDest(dataflow);
+		first[dest] = stages[dataflow];
+		last[dest] = std::max(last[dest], stages[dataflow]);
+		for (int index = 0; index < netlist.getNumOperands(dataflow); index++)
+		{
+			int src = netlist.getOperand(dataflow, index);
+			last[src] = std::max(last[src], stages[dataflow]);
+		}
+	}
+
+	// Constants and tables need no registers
+	long long num_bits = 0;
+	long long value;
+	for (int net = 0; net < netlist.getNumNets(); net++)
+		if (last[net] > first[net] && !netlist.getConstant(net, value) &&
+				netlist.getNetKind(net) != Netlist::NetKindMemory)
+			num_bits += (long long) netlist.getNetWidth(net) *
+					(last[net] - first[net]);
+	return num_bits;
+}
+
+
+void Pipeliner::assignStagesForPeriod()
+{
+	// Both schedules use the fewest stages meeting the period
+	std::vector<int> early(netlist.getNumDataFlows());
+	std::vector<int> late(netlist.getNumDataFlows());
+	num_stages = scheduleEarly(early);
+	std::vector<int> &stages = scheduleLate(late) &&
+			getRegisterBits(late) < getRegisterBits(early) ? late : early;
+	for (int dataflow : dataflows)
+	{
+		dataflow_stage[dataflow] = stages[dataflow];
+		net_stage[netlist.getDest(dataflow)] = stages[dataflow];
+	}
+}
+
+
+int Pipeliner::getDelayedNet(int net, int stage, std::vector<int> &list)
+{
+	// Emit 'always @(posedge clk) reg <= rst ? 0 : src;' for every stage
+	// not delayed yet
+	int delay = stage - net_stage[net];
+	std::vector<int> &chain = registers[net];
+	while ((int) chain.size() < delay)
+	{
+		int src = chain.empty() ? net : chain.back();
+		int width = netlist.getNetWidth(net);
+		int dest = netlist.addRegister(width);
+		list.push_back(netlist.addDataFlow(DataFlow::OpcodeRegister, dest,
+				{ src, module.getClockPort(), module.getResetPort() }));
+		chain.push_back(dest);
+		statistics.num_registers++;
+		statistics.num_register_bits += width;
+	}
+	return chain[delay - 1];
+}
+
+
+void Pipeliner::reportCriticalPath()
+{
+	// Time every net is ready, and operand it is computed from on the
+	// longest path. Registers start new paths.
+	std::vector<double> arrival(netlist.getNumNets());
+	std::vector<int> previous(netlist.getNumNets(), -1);
+	int last = -1;
+	for (CodeBlock *code_block : module.getCodeBlocks())
+	{
+		for (int dataflow : code_block->getDataFlows())
+		{
+			if (netlist.getOpcode(dataflow) == DataFlow::OpcodeRegister)
+				continue;
+			int dest = netlist.getDest(dataflow);
+			int from = -1;
+			for (int index = 0; index < netlist.getNumOperands(dataflow); index++)
+			{
+				int src = netlist.getOperand(dataflow, index);
+				if (netlist.getNetKind(src) != Netlist::NetKindConstant &&
+						netlist.getNetKind(src) != Netlist::NetKindMemory &&
+						(from < 0 || arrival[src] > arrival[from]))
+					from = src;
+			}
+			arrival[dest] = (from < 0 ? 0 : arrival[from]) +
+					getDelay(netlist, dataflow);
+			previous[dest] = from;
+			if (last < 0 || arrival[dest] > arrival[last])
+				last = dest;
+		}
+	}
+	if (last < 0)
+		return;
+
+	// Nets of the path, from its start
+	std::vector<int> path;
+	for (int net = last; net >= 0; net = previous[net])
+		path.push_back(net);
+	std::reverse(path.begin(), path.end());
+
+	std::ostringstream os;
+	os << std::fixed << std::setprecision(2);
+	os << "critical path " << arrival[last] << " ns, clock period "
+			<< clock_period << " ns" << (arrival[last] > clock_period ?
+			" (not met)" : "") << ", " << num_stages <<
+			(num_stages == 1 ? " stage" : " stages");
+	module.addComment(os.str());
+	for (int net : path)
+	{
+		int definition = netlist.getNetDefinition(net);
+		os.str("");
+		os << "  " << std::left << std::setw(12) << netlist.getPrintedName(net)
+				<< std::setw(8) << (definition < 0 ? "" :
+				DataFlow::getName(netlist.getOpcode(definition)))
+				<< std::right << std::setw(6) << arrival[net] << " ns";
+		module.addComment(os.str());
+	}
+}
+
+
+void Pipeliner::run()
+{
+	// Dataflows in code block order
+	for (CodeBlock *code_block : module.getCodeBlocks())
+		for (int dataflow : code_block->getDataFlows())
+			dataflows.push_back(dataflow);
+
+	dataflow_stage.resize(netlist.getNumDataFlows());
+	net_stage.resize(netlist.getNumNets());
+	registers.resize(netlist.getNumNets());
+	if (clock_period > 0)
+		assignStagesForPeriod();
+	else
+		assignStages();
+
+	// Delay operands computed in earlier stages. Constants, including
+	// wires assigned a constant, and the tables of lookups hold their
+	// value in all stages. The registers are added before the first
+	// dataflow using them.
+	if (num_stages > 0)
+		module.addClockPorts();
+	for (CodeBlock *code_block : module.getCodeBlocks())
+	{
+		std::vector<int> list;
+		for (int dataflow : code_block->getDataFlows())
+		{
+			int stage = dataflow_stage[dataflow];
+			for (int index = 0; index < netlist.getNumOperands(dataflow); index++)
+			{
+				int src = netlist.getOperand(dataflow, index);
+				long long value;
+				if (net_stage[src] < stage && !netlist.getConstant(src, value) &&
+						netlist.getNetKind(src) != Netlist::NetKindMemory)
+					netlist.setOperand(dataflow, index,
+							getDelayedNet(src, stage, list));
+			}
+			list.push_back(dataflow);
+		}
+		code_block->setDataFlows(std::move(list));
+	}
+
+	if (clock_period > 0)
+		reportCriticalPath();
+}
+
+}
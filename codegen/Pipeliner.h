@@ -0,0 +1,111 @@
+/**
+ * @file   Pipeliner.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  Pipeliner class turns the combinational netlist of a verilog
+ *         module into a clocked pipeline accepting new inputs every cycle.
+ */
+
+#ifndef VERILOG_PIPELINER_H
+#define VERILOG_PIPELINER_H
+
+#include <vector>
+
+#include "DataFlow.h"
+
+
+namespace verilog
+{
+
+// Forward declarations
+class Module;
+class Netlist;
+struct OptimizerStatistics;
+
+
+// Every dataflow is given a pipeline stage, from 0 to the number of
+// stages. Stage 0 reads the input ports, and the output port is assigned
+// in the last stage, so results appear as many cycles after their inputs
+// as there are stages. Where a dataflow uses a net computed in an earlier
+// stage, the net is delayed by a chain of registers, one per stage
+// crossed. Chains are shared by all users of a net.
+//
+// Stages are either given, in which case the longest chain of operators
+// is cut into parts of equal length, or derived from a clock period and
+// a delay model of the operators. In the latter case, dataflows are
+// scheduled as soon as possible and as late as possible, using the
+// fewest stages that meet the period, and the schedule needing fewer
+// register bits is kept.
+class Pipeliner
+{
+	// Module being pipelined
+	Module &module;
+	Netlist &netlist;
+
+	// Counters
+	OptimizerStatistics &statistics;
+
+	// Number of register stages, and clock period in ns, or 0 if the
+	// number of stages is given
+	int num_stages;
+	double clock_period;
+
+	// Stage of every dataflow, and stage where the value of every net is
+	// computed. Ports and constants are available in stage 0.
+	std::vector<int> dataflow_stage;
+	std::vector<int> net_stage;
+
+	// Registers delaying every net, by one stage more at each entry
+	std::vector<std::vector<int>> registers;
+
+	// Dataflows in code block order
+	std::vector<int> dataflows;
+
+	// Assign a stage to every dataflow, cutting the longest chain of
+	// operators into stages of equal length.
+	void assignStages();
+
+	// Schedule dataflows as soon as possible, or as late as possible
+	// within the given number of stages, so that no stage is longer than
+	// the clock period. Stages are returned per dataflow. The first one
+	// returns the number of stages used, and the second one returns
+	// false if the dataflows do not fit in 'num_stages' stages.
+	int scheduleEarly(std::vector<int> &stages);
+	bool scheduleLate(std::vector<int> &stages);
+
+	// Return the register bits needed by a schedule
+	long long getRegisterBits(const std::vector<int> &stages);
+
+	// Choose the stages meeting the clock period
+	void assignStagesForPeriod();
+
+	// Return a net holding the value of a net in the given stage,
+	// adding the registers that delay it to 'list' the first time.
+	int getDelayedNet(int net, int stage, std::vector<int> &list);
+
+	// Add the longest combinational path of the pipelined module to the
+	// comments of the module
+	void reportCriticalPath();
+
+public:
+
+	// Constructor. If 'clock_period' is not 0, the number of stages is
+	// derived from it.
+	Pipeliner(Module &module, OptimizerStatistics &statistics,
+			int num_stages, double clock_period = 0);
+
+	// Add the clock and reset ports and the pipeline registers
+	void run();
+
+	// Return the delay of a dataflow in ns
+	static double getDelay(const Netlist &netlist, int dataflow);
+
+	// Return the delay in ns of an operator, given the width of its
+	// result and of its widest operand
+	static double getDelay(DataFlow::Opcode opcode, int width,
+			int operand_width);
+};
+
+}
+
+#endif
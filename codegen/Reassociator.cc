@@ -0,0 +1,277 @@
+/**
+ * @file   Reassociator.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the rebalancing of associative chains.
+ */
+
+#include <algorithm>
+
+#include "CodeBlock.h"
+#include "Module.h"
+#include "Netlist.h"
+#include "Optimizer.h"
+#include "Pipeliner.h"
+#include "Reassociator.h"
+
+
+namespace verilog
+{
+
+// Return whether the operands of an opcode can be combined in any order
+static bool isAssociative(DataFlow::Opcode opcode)
+{
+	switch (opcode)
+	{
+	case DataFlow::OpcodeAdd:
+	case DataFlow::OpcodeAnd:
+	case DataFlow::OpcodeOr:
+	case DataFlow::OpcodeXor:
+		return true;
+	default:
+		return false;
+	}
+}
+
+
+Reassociator::Reassociator(Module &module, OptimizerStatistics &statistics,
+		bool carry_save) :
+		module(module),
+		netlist(module.getNetlist()),
+		statistics(statistics),
+		carry_save(carry_save)
+{
+}
+
+
+bool Reassociator::isInner(int dataflow)
+{
+	// A whole wire read once by a dataflow of the same chain, in the same
+	// code block. Dataflows of rebuilt chains are roots.
+	if (dataflow >= (int) code_blocks.size())
+		return false;
+	DataFlow::Opcode opcode = netlist.getOpcode(dataflow);
+	int dest = netlist.getDest(dataflow);
+	if (!isAssociative(opcode) ||
+			netlist.getNetKind(dest) != Netlist::NetKindWire ||
+			num_users[dest] != 1)
+		return false;
+	int other = user[dest];
+	if (netlist.getOpcode(other) != opcode ||
+			netlist.getNetWidth(netlist.getDest(other)) !=
+			netlist.getNetWidth(dest) ||
+			code_blocks[other] != code_blocks[dataflow])
+		return false;
+	for (int index = 0; index < netlist.getNumOperands(other); index++)
+		if (netlist.getOperand(other, index) == dest &&
+				netlist.getOperandWidth(other, index))
+			return false;
+	return true;
+}
+
+
+void Reassociator::collectLeaves(int dataflow, std::vector<Leaf> &leaves,
+		std::vector<int> &inner)
+{
+	for (int index = 0; index < netlist.getNumOperands(dataflow); index++)
+	{
+		int src = netlist.getOperand(dataflow, index);
+		int definition = netlist.getNetDefinition(src);
+		if (definition >= 0 && isInner(definition))
+		{
+			inner.push_back(definition);
+			collectLeaves(definition, leaves, inner);
+			continue;
+		}
+		leaves.push_back(Leaf{ src, netlist.getOperandLow(dataflow, index),
+				netlist.getOperandWidth(dataflow, index), arrival[src] });
+	}
+}
+
+
+Reassociator::Leaf Reassociator::addOperator(DataFlow::Opcode opcode,
+		int width, const std::vector<Leaf> &operands, std::vector<int> *list,
+		int dest)
+{
+	Leaf result{ dest, 0, 0, 0 };
+	for (const Leaf &operand : operands)
+		result.arrival = std::max(result.arrival, operand.arrival);
+	result.arrival += Pipeliner::getDelay(opcode, width, width);
+	if (!list)
+		return result;
+
+	// Emit 'assign dest = src1 op src2 ...;'
+	std::vector<int> nets;
+	for (const Leaf &operand : operands)
+		nets.push_back(operand.net);
+	if (result.net < 0)
+		result.net = netlist.addWire(width);
+	int dataflow = netlist.addDataFlow(opcode, result.net, nets);
+	for (int index = 0; index < (int) operands.size(); index++)
+		netlist.setOperandSlice(dataflow, index, operands[index].low,
+				operands[index].width);
+	list->push_back(dataflow);
+	arrival.resize(netlist.getNumNets());
+	arrival[result.net] = result.arrival;
+	return result;
+}
+
+
+Reassociator::Leaf Reassociator::buildTree(DataFlow::Opcode opcode,
+		int width, std::vector<Leaf> leaves, std::vector<int> *list, int dest)
+{
+	// Leaves ready at the same time keep the order of the chain
+	while (leaves.size() > 2)
+	{
+		std::stable_sort(leaves.begin(), leaves.end(),
+				[](const Leaf &first, const Leaf &second)
+				{
+					return first.arrival < second.arrival;
+				});
+		Leaf result = addOperator(opcode, width, { leaves[0], leaves[1] },
+				list);
+		leaves.erase(leaves.begin(), leaves.begin() + 2);
+		leaves.push_back(result);
+	}
+	return addOperator(opcode, width, leaves, list, dest);
+}
+
+
+Reassociator::Leaf Reassociator::buildCarrySaveTree(int width,
+		std::vector<Leaf> leaves, std::vector<int> *list, int dest)
+{
+	while (leaves.size() > 2)
+	{
+		std::stable_sort(leaves.begin(), leaves.end(),
+				[](const Leaf &first, const Leaf &second)
+				{
+					return first.arrival < second.arrival;
+				});
+		std::vector<Leaf> operands(leaves.begin(), leaves.begin() + 3);
+		leaves.erase(leaves.begin(), leaves.begin() + 3);
+
+		// Emit 'assign sum = x ^ y ^ z;' and the majority of the three
+		// operands, the carry, shifted by one bit. The carry out of the
+		// top bit is dropped, as in the adders.
+		leaves.push_back(addOperator(DataFlow::OpcodeXor, width, operands,
+				list));
+		if (width == 1)
+			continue;
+		Leaf carry = addOperator(DataFlow::OpcodeMaj, width, operands, list);
+		if (list)
+		{
+			int shifted = netlist.addWire(width);
+			int concat = netlist.addDataFlow(DataFlow::OpcodeConcat, shifted,
+					{ carry.net, module.getConstant(0, 1) });
+			netlist.setOperandSlice(concat, 0, 0, width - 1);
+			list->push_back(concat);
+			arrival.resize(netlist.getNumNets());
+			arrival[shifted] = carry.arrival;
+			carry.net = shifted;
+		}
+		leaves.push_back(carry);
+	}
+	return addOperator(DataFlow::OpcodeAdd, width, leaves, list, dest);
+}
+
+
+bool Reassociator::rebalance(int dataflow, std::vector<int> &list)
+{
+	// Chains of three leaves or more. Two leaves are a single operator.
+	DataFlow::Opcode opcode = netlist.getOpcode(dataflow);
+	if (!isAssociative(opcode) || isInner(dataflow))
+		return false;
+	std::vector<Leaf> leaves;
+	std::vector<int> inner;
+	collectLeaves(dataflow, leaves, inner);
+	if (leaves.size() < 3)
+		return false;
+
+	// Time the root is ready in each form
+	int dest = netlist.getDest(dataflow);
+	int width = netlist.getNetWidth(dest);
+	double tree = buildTree(opcode, width, leaves, nullptr).arrival;
+	double carry_save_tree = opcode == DataFlow::OpcodeAdd && carry_save ?
+			buildCarrySaveTree(width, leaves, nullptr).arrival : tree;
+	const double epsilon = 1e-9;
+	if (std::min(tree, carry_save_tree) >= arrival[dest] - epsilon)
+		return false;
+
+	// Replace the chain
+	for (int other : inner)
+		netlist.removeDataFlow(other);
+	netlist.removeDataFlow(dataflow);
+	if (carry_save_tree < tree - epsilon)
+	{
+		buildCarrySaveTree(width, leaves, &list, dest);
+		statistics.num_carry_save_trees++;
+	}
+	else
+	{
+		buildTree(opcode, width, leaves, &list, dest);
+	}
+	statistics.num_chains_rebalanced++;
+	return true;
+}
+
+
+void Reassociator::run()
+{
+	// Users of every net
+	num_users.assign(netlist.getNumNets(), 0);
+	user.assign(netlist.getNumNets(), -1);
+	code_blocks.assign(netlist.getNumDataFlows(), nullptr);
+	for (CodeBlock *code_block : module.getCodeBlocks())
+	{
+		for (int dataflow : code_block->getDataFlows())
+		{
+			code_blocks[dataflow] = code_block;
+			for (int index = 0; index < netlist.getNumOperands(dataflow);
+					index++)
+			{
+				int src = netlist.getOperand(dataflow, index);
+				num_users[src]++;
+				user[src] = dataflow;
+			}
+		}
+	}
+
+	// Chains are rebuilt in code block order, once the times of their
+	// leaves are known. Their dataflows are placed before the root, after
+	// all the leaves. Registers, including the words read from memories,
+	// are ready at the start of the cycle.
+	arrival.assign(netlist.getNumNets(), 0);
+	for (CodeBlock *code_block : module.getCodeBlocks())
+	{
+		std::vector<int> list;
+		for (int dataflow : code_block->getDataFlows())
+		{
+			DataFlow::Opcode opcode = netlist.getOpcode(dataflow);
+			if (opcode == DataFlow::OpcodeInvalid)
+				continue;
+			if (opcode != DataFlow::OpcodeRegister &&
+					opcode != DataFlow::OpcodeRam)
+			{
+				double start = 0;
+				for (int index = 0; index < netlist.getNumOperands(dataflow);
+						index++)
+					start = std::max(start,
+							arrival[netlist.getOperand(dataflow, index)]);
+				arrival[netlist.getDest(dataflow)] = start +
+						Pipeliner::getDelay(netlist, dataflow);
+			}
+			if (!rebalance(dataflow, list))
+				list.push_back(dataflow);
+		}
+		code_block->setDataFlows(std::move(list));
+	}
+
+	// Inner dataflows of the rebuilt chains were listed before their root
+	for (CodeBlock *code_block : module.getCodeBlocks())
+		code_block->removeDataFlows([this](int dataflow)
+		{
+			return netlist.getOpcode(dataflow) == DataFlow::OpcodeInvalid;
+		});
+}
+
+}
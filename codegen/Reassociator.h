@@ -0,0 +1,120 @@
+/**
+ * @file   Reassociator.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  Reassociator class rebalances chains of associative operators of
+ *         a verilog netlist into trees of minimal delay.
+ */
+
+#ifndef VERILOG_REASSOCIATOR_H
+#define VERILOG_REASSOCIATOR_H
+
+#include <vector>
+
+#include "DataFlow.h"
+
+
+namespace verilog
+{
+
+// Forward declarations
+class CodeBlock;
+class Module;
+class Netlist;
+struct OptimizerStatistics;
+
+
+// A chain is a tree of dataflows with the same associative and commutative
+// opcode (addition, 'and', 'or', 'xor') and the same width, where every
+// dataflow but the last one, the root, has a single user in the chain.
+// Its operands, the leaves, may be combined in any order. Translation
+// produces linear chains, such as '((a + b) + c) + d', whose depth grows
+// with the number of leaves.
+//
+// Leaves are combined again by pairs, the two that are ready first in
+// the delay model of the pipeliner, which gives a balanced tree when all
+// leaves are ready at the same time and leaves late operands close to
+// the root. Additions of three or more leaves may instead be reduced by
+// carry-save adders: each one turns three operands into a sum and a
+// carry, computed bit by bit in a single LUT level, until two operands
+// are left for one final carry-propagate adder. A chain is only rebuilt
+// if its root is ready earlier, and the carry-save tree is only chosen
+// if it beats the tree of adders.
+class Reassociator
+{
+	// An operand of a chain, which may be a slice of its net, and the
+	// time it is ready
+	struct Leaf
+	{
+		int net;
+		int low;
+		int width;
+		double arrival;
+	};
+
+	// Module being optimized
+	Module &module;
+	Netlist &netlist;
+
+	// Counters
+	OptimizerStatistics &statistics;
+
+	// Whether additions may be reduced by carry-save adders
+	bool carry_save;
+
+	// Number of dataflows reading every net, and the last one
+	std::vector<int> num_users;
+	std::vector<int> user;
+
+	// Code block of every dataflow
+	std::vector<CodeBlock *> code_blocks;
+
+	// Time every net is ready in ns, counted from the registers and
+	// input ports
+	std::vector<double> arrival;
+
+	// Return whether a dataflow is part of the chain of its user, without
+	// being its root
+	bool isInner(int dataflow);
+
+	// Add the leaves of the chain ending at a dataflow to 'leaves', and
+	// its dataflows other than the root to 'inner'
+	void collectLeaves(int dataflow, std::vector<Leaf> &leaves,
+			std::vector<int> &inner);
+
+	// Return an operator of a chain combining the given operands. The
+	// dataflow is added to 'list' with a new wire as its destination, or
+	// 'dest' if it is not -1. Without a list, only the time its result
+	// is ready is computed.
+	Leaf addOperator(DataFlow::Opcode opcode, int width,
+			const std::vector<Leaf> &operands, std::vector<int> *list,
+			int dest = -1);
+
+	// Combine the leaves of a chain into a tree of binary operators, two
+	// leaves that are ready first at a time, and return its root
+	Leaf buildTree(DataFlow::Opcode opcode, int width,
+			std::vector<Leaf> leaves, std::vector<int> *list, int dest = -1);
+
+	// Reduce the leaves of an addition by carry-save adders, and return
+	// the final adder
+	Leaf buildCarrySaveTree(int width, std::vector<Leaf> leaves,
+			std::vector<int> *list, int dest = -1);
+
+	// Rebuild the chain ending at a dataflow if its root is then ready
+	// earlier, adding the new dataflows to 'list'. Return whether it was
+	// rebuilt.
+	bool rebalance(int dataflow, std::vector<int> &list);
+
+public:
+
+	// Constructor. Carry-save adders are used if 'carry_save' is true.
+	Reassociator(Module &module, OptimizerStatistics &statistics,
+			bool carry_save);
+
+	// Rebalance all chains of the module
+	void run();
+};
+
+}
+
+#endif
@@ -0,0 +1,560 @@
+/**
+ * @file   ResourceScheduler.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the list scheduling and sharing of operators.
+ */
+
+#include <algorithm>
+#include <sstream>
+
+#include "Bits.h"
+#include "CodeBlock.h"
+#include "Module.h"
+#include "Netlist.h"
+#include "Optimizer.h"
+#include "Pipeliner.h"
+#include "ResourceScheduler.h"
+
+
+namespace verilog
+{
+
+// Names of the kinds of operators, in the plural
+static const char *resource_names[ResourceScheduler::ResourceMax] = {
+	"adders",
+	"comparators",
+	"multipliers"
+};
+
+
+ResourceScheduler::ResourceScheduler(Module &module,
+		OptimizerStatistics &statistics, double clock_period) :
+		module(module),
+		netlist(module.getNetlist()),
+		statistics(statistics),
+		clock_period(clock_period)
+{
+	for (int resource = 0; resource < ResourceMax; resource++)
+	{
+		limits[resource] = 0;
+		shared[resource] = false;
+	}
+}
+
+
+ResourceScheduler::Resource ResourceScheduler::getResource(
+		DataFlow::Opcode opcode)
+{
+	switch (opcode)
+	{
+	case DataFlow::OpcodeAdd:
+	case DataFlow::OpcodeSub:
+		return ResourceAdder;
+
+	case DataFlow::OpcodeEq:
+	case DataFlow::OpcodeUgt:
+		return ResourceComparator;
+
+	case DataFlow::OpcodeMul:
+		return ResourceMultiplier;
+
+	default:
+		return ResourceNone;
+	}
+}
+
+
+const char *ResourceScheduler::getResourceName(Resource resource)
+{
+	return resource_names[resource];
+}
+
+
+ResourceScheduler::Resource ResourceScheduler::getSharedResource(int dataflow)
+{
+	Resource resource = getResource(netlist.getOpcode(dataflow));
+	return resource != ResourceNone && shared[resource] ? resource :
+			ResourceNone;
+}
+
+
+void ResourceScheduler::schedule()
+{
+	// Delay of every dataflow. Shared operators also cross the
+	// multiplexers of their operands.
+	std::vector<double> delays(netlist.getNumDataFlows());
+	double mux_delay = Pipeliner::getDelay(DataFlow::OpcodeMux, 1, 1);
+	for (int dataflow : dataflows)
+		delays[dataflow] = Pipeliner::getDelay(netlist, dataflow) +
+				(getSharedResource(dataflow) != ResourceNone ? mux_delay : 0);
+
+	// Priority of every dataflow, the delay of the longest path from its
+	// start to the output
+	std::vector<double> heights(netlist.getNumDataFlows());
+	std::vector<double> net_heights(netlist.getNumNets());
+	for (auto it = dataflows.rbegin(); it != dataflows.rend(); ++it)
+	{
+		int dataflow = *it;
+		heights[dataflow] = delays[dataflow] +
+				net_heights[netlist.getDest(dataflow)];
+		for (int index = 0; index < netlist.getNumOperands(dataflow); index++)
+		{
+			int src = netlist.getOperand(dataflow, index);
+			net_heights[src] = std::max(net_heights[src], heights[dataflow]);
+		}
+	}
+
+	// Nets not computed yet, time every net is ready in its cycle, and
+	// whether it depends on a shared unit in its cycle
+	std::vector<bool> pending(netlist.getNumNets());
+	std::vector<double> arrival(netlist.getNumNets());
+	std::vector<bool> after_unit(netlist.getNumNets());
+	dataflow_cycles.assign(netlist.getNumDataFlows(), -1);
+	net_cycles.assign(netlist.getNumNets(), -1);
+	for (int dataflow : dataflows)
+		pending[netlist.getDest(dataflow)] = true;
+
+	// Fill one cycle at a time with the ready dataflow of highest
+	// priority that fits, the first one in code block order between
+	// equal priorities
+	int remaining = dataflows.size();
+	for (int cycle = 0; remaining; cycle++)
+	{
+		int used[ResourceMax] = { };
+		while (true)
+		{
+			int best = -1;
+			double best_start = 0;
+			bool best_after_unit = false;
+			for (int dataflow : dataflows)
+			{
+				Resource resource = getSharedResource(dataflow);
+				if (dataflow_cycles[dataflow] >= 0 || (resource != ResourceNone &&
+						used[resource] == limits[resource]))
+					continue;
+				double start = 0;
+				bool ready = true;
+				bool chained = false;
+				for (int index = 0; index < netlist.getNumOperands(dataflow) &&
+						ready; index++)
+				{
+					int src = netlist.getOperand(dataflow, index);
+					ready = !pending[src];
+					if (net_cycles[src] == cycle)
+					{
+						start = std::max(start, arrival[src]);
+						chained = chained || after_unit[src];
+					}
+				}
+				if (!ready || (resource != ResourceNone && chained))
+					continue;
+				if (clock_period > 0 && delays[dataflow] > 0 && start > 0 &&
+						start + delays[dataflow] > clock_period)
+					continue;
+				if (best < 0 || heights[dataflow] > heights[best])
+				{
+					best = dataflow;
+					best_start = start;
+					best_after_unit = chained || resource != ResourceNone;
+				}
+			}
+			if (best < 0)
+				break;
+
+			Resource resource = getSharedResource(best);
+			if (resource != ResourceNone)
+				used[resource]++;
+			int dest = netlist.getDest(best);
+			dataflow_cycles[best] = cycle;
+			net_cycles[dest] = cycle;
+			pending[dest] = false;
+			arrival[dest] = best_start + delays[best];
+			after_unit[dest] = best_after_unit;
+			remaining--;
+		}
+		num_cycles = cycle + 1;
+	}
+}
+
+
+void ResourceScheduler::bind()
+{
+	// Dataflows of every cycle go to units not used in the cycle yet,
+	// preferring the unit reading the most of their operands already,
+	// which saves multiplexer inputs. A new unit is only added when all
+	// others are used.
+	for (int resource = 0; resource < ResourceMax; resource++)
+	{
+		if (!shared[resource])
+			continue;
+		std::vector<std::vector<int>> &list = units[resource];
+		for (int cycle = 0; cycle < num_cycles; cycle++)
+		{
+			std::vector<bool> used(list.size());
+			for (int dataflow : dataflows)
+			{
+				if (dataflow_cycles[dataflow] != cycle ||
+						getSharedResource(dataflow) != resource)
+					continue;
+				int best = -1;
+				int best_matches = -1;
+				for (unsigned unit = 0; unit < list.size(); unit++)
+				{
+					if (used[unit])
+						continue;
+					int matches = 0;
+					for (int other : list[unit])
+						for (int index = 0; index < 2; index++)
+							if (netlist.getOperand(other, index) ==
+									netlist.getOperand(dataflow, index))
+								matches++;
+					if (matches > best_matches)
+					{
+						best = unit;
+						best_matches = matches;
+					}
+				}
+				if (best < 0)
+				{
+					best = list.size();
+					list.emplace_back();
+					used.push_back(false);
+				}
+				list[best].push_back(dataflow);
+				used[best] = true;
+			}
+		}
+	}
+}
+
+
+int ResourceScheduler::addLogic(DataFlow::Opcode opcode, int width,
+		std::initializer_list<int> operands)
+{
+	int dest = netlist.addWire(width);
+	module.addDataFlow(control_code_block, opcode, dest, operands);
+	return dest;
+}
+
+
+void ResourceScheduler::addRegister(int dest, int next)
+{
+	// Emit 'always @(posedge clk) dest <= rst ? 0 : next;'
+	module.addDataFlow(control_code_block, DataFlow::OpcodeRegister, dest,
+			{ next, module.getClockPort(), module.getResetPort() });
+	num_register_bits += netlist.getNetWidth(dest);
+}
+
+
+int ResourceScheduler::getNetInCycle(int net, int cycle)
+{
+	// Constants hold their value in all cycles, and nets are read
+	// directly in the cycle computing them
+	long long value;
+	bool input = netlist.getNetKind(net) == Netlist::NetKindInput;
+	if (netlist.getConstant(net, value) || (!input &&
+			(net >= (int) net_cycles.size() || net_cycles[net] < 0 ||
+			net_cycles[net] == cycle)))
+		return net;
+	auto it = held_nets.find(net);
+	if (it != held_nets.end())
+		return it->second;
+
+	// Input ports are latched while idle, and other nets are loaded in
+	// the state of the cycle computing them
+	int width = netlist.getNetWidth(net);
+	int reg = netlist.addRegister(width);
+	held_nets[net] = reg;
+	addRegister(reg, addLogic(DataFlow::OpcodeMux, width,
+			{ state_nets[input ? 0 : net_cycles[net] + 1], net, reg }));
+	return reg;
+}
+
+
+void ResourceScheduler::addUnit(Resource resource, const std::vector<int> &list)
+{
+	// Width of the operands, and of the result of additions and
+	// multiplications
+	bool is_comparator = resource == ResourceComparator;
+	int width = 1;
+	for (int dataflow : list)
+	{
+		for (int index = 0; index < 2; index++)
+		{
+			int slice_width = netlist.getOperandWidth(dataflow, index);
+			width = std::max(width, slice_width ? slice_width :
+					netlist.getNetWidth(netlist.getOperand(dataflow, index)));
+		}
+		if (!is_comparator)
+			width = std::max(width, netlist.getNetWidth(
+					netlist.getDest(dataflow)));
+	}
+
+	// Every operand selects the one of the dataflow of the current cycle,
+	// and defaults to the one of the last dataflow. Dataflows reading the
+	// same operand as the last one need no multiplexer input.
+	int operands[2];
+	for (int index = 0; index < 2; index++)
+	{
+		int last = list.back();
+		int src = netlist.getOperand(last, index);
+		int low = netlist.getOperandLow(last, index);
+		int slice_width = netlist.getOperandWidth(last, index);
+		int net = src;
+		if (slice_width)
+		{
+			net = netlist.addWire(slice_width);
+			int assign = module.addDataFlow(control_code_block,
+					DataFlow::OpcodeAssign, net, { src });
+			netlist.setOperandSlice(assign, 0, low, slice_width);
+		}
+		for (int position = list.size() - 2; position >= 0; position--)
+		{
+			int dataflow = list[position];
+			if (netlist.getOperand(dataflow, index) == src &&
+					netlist.getOperandLow(dataflow, index) == low &&
+					netlist.getOperandWidth(dataflow, index) == slice_width)
+				continue;
+
+			// Emit 'assign mux = state == c ? src : mux;'
+			int mux = netlist.addWire(width);
+			int select = module.addDataFlow(control_code_block,
+					DataFlow::OpcodeMux, mux, { state_nets[
+					dataflow_cycles[dataflow] + 1],
+					netlist.getOperand(dataflow, index), net });
+			netlist.setOperandSlice(select, 1,
+					netlist.getOperandLow(dataflow, index),
+					netlist.getOperandWidth(dataflow, index));
+			net = mux;
+			num_mux_inputs++;
+		}
+		operands[index] = net;
+	}
+
+	// Outputs of the unit, by opcode
+	std::map<DataFlow::Opcode, int> outputs;
+	for (int dataflow : list)
+		outputs[netlist.getOpcode(dataflow)] = -1;
+	if (resource == ResourceAdder && outputs.size() > 1)
+	{
+		// Additions and subtractions share one adder, which adds the
+		// complement of the second operand plus one in the cycles of the
+		// subtractions: 'assign sum = a + (b ^ {n{sub}}) + sub;'
+		int sub = -1;
+		for (int dataflow : list)
+		{
+			if (netlist.getOpcode(dataflow) != DataFlow::OpcodeSub)
+				continue;
+			int state = state_nets[dataflow_cycles[dataflow] + 1];
+			sub = sub < 0 ? state : addLogic(DataFlow::OpcodeOr, 1,
+					{ sub, state });
+		}
+		int mask = width > 1 ? addLogic(DataFlow::OpcodeSext, width, { sub }) :
+				sub;
+		int sum = addLogic(DataFlow::OpcodeAdd, width, { operands[0],
+				addLogic(DataFlow::OpcodeXor, width, { operands[1], mask }),
+				sub });
+		outputs[DataFlow::OpcodeAdd] = sum;
+		outputs[DataFlow::OpcodeSub] = sum;
+	}
+	else
+	{
+		for (auto &output : outputs)
+			output.second = addLogic(output.first, is_comparator ? 1 : width,
+					{ operands[0], operands[1] });
+	}
+
+	// Dataflows read the output of the unit, truncated to their width
+	for (int dataflow : list)
+	{
+		int dest = netlist.getDest(dataflow);
+		int output = outputs[netlist.getOpcode(dataflow)];
+		netlist.removeDataFlow(dataflow);
+		int assign = netlist.addDataFlow(DataFlow::OpcodeAssign, dest,
+				{ output });
+		if (netlist.getNetWidth(dest) < netlist.getNetWidth(output))
+			netlist.setOperandSlice(assign, 0, 0, netlist.getNetWidth(dest));
+		replacements[dataflow] = assign;
+	}
+}
+
+
+void ResourceScheduler::addSorted(int dataflow, std::vector<bool> &visited,
+		std::vector<int> &list)
+{
+	if (visited[dataflow] || netlist.getOpcode(dataflow) ==
+			DataFlow::OpcodeInvalid)
+		return;
+	visited[dataflow] = true;
+
+	// Registers are read where they are, so they do not order dataflows
+	if (netlist.getOpcode(dataflow) != DataFlow::OpcodeRegister)
+	{
+		for (int index = 0; index < netlist.getNumOperands(dataflow); index++)
+		{
+			int definition = netlist.getNetDefinition(
+					netlist.getOperand(dataflow, index));
+			if (definition >= 0 && netlist.getOpcode(definition) !=
+					DataFlow::OpcodeRegister)
+				addSorted(definition, visited, list);
+		}
+	}
+	list.push_back(dataflow);
+}
+
+
+void ResourceScheduler::sortDataFlows()
+{
+	std::vector<bool> visited(netlist.getNumDataFlows());
+	for (CodeBlock *code_block : module.getCodeBlocks())
+	{
+		std::vector<int> list;
+		for (int dataflow : code_block->getDataFlows())
+		{
+			for (auto it = replacements.find(dataflow);
+					it != replacements.end(); it = replacements.find(dataflow))
+				dataflow = it->second;
+			addSorted(dataflow, visited, list);
+		}
+		code_block->setDataFlows(std::move(list));
+	}
+}
+
+
+void ResourceScheduler::report()
+{
+	// The idle state and every cycle take one clock cycle until 'done'
+	// is set
+	std::ostringstream os;
+	os << "shared datapath " << num_cycles + 1 << " states, latency "
+			<< num_cycles + 1 << " cycles";
+	module.addComment(os.str());
+	for (int resource = 0; resource < ResourceMax; resource++)
+	{
+		if (!shared[resource])
+			continue;
+		int num_operations = 0;
+		for (auto &unit : units[resource])
+			num_operations += unit.size();
+		os.str("");
+		os << "  " << resource_names[resource] << ": " << num_operations
+				<< " operations on " << units[resource].size()
+				<< (units[resource].size() == 1 ? " unit" : " units")
+				<< " (limit " << limits[resource] << ")";
+		module.addComment(os.str());
+	}
+	os.str("");
+	os << "  area: " << num_mux_inputs << " multiplexer inputs, "
+			<< num_register_bits << " register bits";
+	module.addComment(os.str());
+}
+
+
+bool ResourceScheduler::run()
+{
+	// Dataflows of the datapath, and operators of every kind
+	int num_operators[ResourceMax] = { };
+	for (CodeBlock *code_block : module.getCodeBlocks())
+	{
+		for (int dataflow : code_block->getDataFlows())
+		{
+			dataflows.push_back(dataflow);
+			Resource resource = getResource(netlist.getOpcode(dataflow));
+			if (resource != ResourceNone)
+				num_operators[resource]++;
+		}
+	}
+	bool changed = false;
+	for (int resource = 0; resource < ResourceMax; resource++)
+	{
+		shared[resource] = limits[resource] > 0 &&
+				num_operators[resource] > limits[resource];
+		changed = changed || shared[resource];
+	}
+	int output_port = module.getOutputPort();
+	int output_definition = netlist.getNetDefinition(output_port);
+	if (!changed || output_definition < 0)
+		return false;
+
+	// The value of the output port is computed into a wire, and loaded
+	// into the result register in the last state
+	int value = netlist.addWire(netlist.getNetWidth(output_port));
+	std::vector<int> operand_list;
+	for (int index = 0; index < netlist.getNumOperands(output_definition);
+			index++)
+		operand_list.push_back(netlist.getOperand(output_definition, index));
+	int copy = netlist.addDataFlow(netlist.getOpcode(output_definition),
+			value, operand_list);
+	for (int index = 0; index < netlist.getNumOperands(output_definition);
+			index++)
+		netlist.setOperandSlice(copy, index,
+				netlist.getOperandLow(output_definition, index),
+				netlist.getOperandWidth(output_definition, index));
+	netlist.removeDataFlow(output_definition);
+	replacements[output_definition] = copy;
+	std::replace(dataflows.begin(), dataflows.end(), output_definition, copy);
+
+	schedule();
+
+	// Ports, with 'clk', 'rst' and 'start' first, and the state logic
+	module.addClockPorts();
+	module.addHandshakePorts();
+	control_code_block = module.create<CodeBlock>("control");
+	module.insertCodeBlock(control_code_block);
+	int state_width = getNumBits(num_cycles);
+	state_register = netlist.addRegister(state_width);
+	for (int state = 0; state <= num_cycles; state++)
+		state_nets.push_back(addLogic(DataFlow::OpcodeEq, 1,
+				{ state_register, module.getConstant(state, state_width) }));
+
+	// Operands computed in earlier cycles are read from registers
+	for (int dataflow : dataflows)
+		for (int index = 0; index < netlist.getNumOperands(dataflow); index++)
+			netlist.setOperand(dataflow, index, getNetInCycle(
+					netlist.getOperand(dataflow, index),
+					dataflow_cycles[dataflow]));
+
+	// Shared units
+	bind();
+	for (int resource = 0; resource < ResourceMax; resource++)
+	{
+		for (auto &unit : units[resource])
+			addUnit((Resource) resource, unit);
+		if (shared[resource])
+			statistics.num_operators_shared += num_operators[resource] -
+					units[resource].size();
+	}
+
+	// Next state. The idle state moves to the first cycle on 'start', and
+	// the last cycle moves back to the idle state.
+	int zero = module.getConstant(0, state_width);
+	int next = addLogic(DataFlow::OpcodeMux, state_width,
+			{ state_nets[num_cycles], zero, addLogic(DataFlow::OpcodeAdd,
+			state_width, { state_register,
+			module.getConstant(1, state_width) }) });
+	next = addLogic(DataFlow::OpcodeMux, state_width,
+			{ state_nets[0], addLogic(DataFlow::OpcodeMux, state_width,
+			{ module.getStartPort(), module.getConstant(1, state_width),
+			zero }), next });
+	addRegister(state_register, next);
+
+	// The result is loaded in the last state, and 'done' is set in the
+	// next cycle
+	int result = netlist.addRegister(netlist.getNetWidth(output_port));
+	int done = netlist.addRegister(1);
+	addRegister(result, addLogic(DataFlow::OpcodeMux,
+			netlist.getNetWidth(result), { state_nets[num_cycles],
+			getNetInCycle(value, num_cycles - 1), result }));
+	addRegister(done, state_nets[num_cycles]);
+	module.addDataFlow(control_code_block, DataFlow::OpcodeAssign, output_port,
+			{ result });
+	module.addDataFlow(control_code_block, DataFlow::OpcodeAssign,
+			module.getDonePort(), { done });
+
+	sortDataFlows();
+	report();
+	return true;
+}
+
+}
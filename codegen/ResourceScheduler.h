@@ -0,0 +1,171 @@
+/**
+ * @file   ResourceScheduler.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  ResourceScheduler class spreads the combinational netlist of a
+ *         verilog module over several cycles, sharing a limited number of
+ *         operators.
+ */
+
+#ifndef VERILOG_RESOURCE_SCHEDULER_H
+#define VERILOG_RESOURCE_SCHEDULER_H
+
+#include <initializer_list>
+#include <map>
+#include <vector>
+
+#include "DataFlow.h"
+
+
+namespace verilog
+{
+
+// Forward declarations
+class CodeBlock;
+class Module;
+class Netlist;
+struct OptimizerStatistics;
+
+
+// Operators of a kind whose number exceeds the limit given for the kind
+// are shared: dataflows are given cycles by a list scheduler, which
+// fills every cycle with the ready dataflows on the longest paths to the
+// output first, as long as a unit of their kind is free in the cycle and
+// the clock period, if any, is met. The outputs of a shared unit are only
+// valid in the cycles of its dataflows, so a shared dataflow never reads
+// the output of another one in the same cycle. Dataflows of a cycle are
+// then bound to the units of their kind, preferring a unit already
+// reading the same operands, and every unit selects its operands with
+// multiplexers controlled by the cycle.
+//
+// The module becomes a state machine with 'start' and 'done' ports, like
+// the ones of functions with loops: the arguments are latched while
+// idle, state 'c + 1' runs cycle 'c', values used in later cycles are
+// held in registers, and the result is loaded in the last state.
+class ResourceScheduler
+{
+public:
+
+	// Kinds of shared operators
+	enum Resource
+	{
+		ResourceNone = -1,
+
+		ResourceAdder,
+		ResourceComparator,
+		ResourceMultiplier,
+
+		ResourceMax
+	};
+
+private:
+
+	// Module being scheduled
+	Module &module;
+	Netlist &netlist;
+
+	// Counters
+	OptimizerStatistics &statistics;
+
+	// Clock period in ns, or 0 to chain any number of dataflows in a
+	// cycle
+	double clock_period;
+
+	// Largest number of units of every kind, or 0 for no limit
+	int limits[ResourceMax];
+
+	// Whether operators of every kind are shared
+	bool shared[ResourceMax];
+
+	// Dataflows of the datapath, in code block order
+	std::vector<int> dataflows;
+
+	// Cycle of every dataflow and of the net it computes. Nets computed
+	// before the first cycle, such as ports and constants, have cycle -1.
+	std::vector<int> dataflow_cycles;
+	std::vector<int> net_cycles;
+	int num_cycles = 0;
+
+	// Dataflows bound to every unit, by kind
+	std::vector<std::vector<int>> units[ResourceMax];
+
+	// Dataflows replaced by the dataflows reading the units, or by a copy
+	// writing the value of the output port
+	std::map<int, int> replacements;
+
+	// Code block holding the state logic, the registers, and the shared
+	// units
+	CodeBlock *control_code_block = nullptr;
+
+	// State register and nets set in every state, the idle state being 0
+	int state_register = -1;
+	std::vector<int> state_nets;
+
+	// Registers latching the input ports, and holding nets read in later
+	// cycles
+	std::map<int, int> held_nets;
+
+	// Multiplexer inputs and register bits added
+	int num_mux_inputs = 0;
+	int num_register_bits = 0;
+
+	// Return the kind of a dataflow if its operator is shared, or
+	// ResourceNone
+	Resource getSharedResource(int dataflow);
+
+	// Give every dataflow a cycle
+	void schedule();
+
+	// Bind the dataflows of shared kinds to units
+	void bind();
+
+	// Add a dataflow computing a new wire of the given width to the
+	// control code block, and return the wire
+	int addLogic(DataFlow::Opcode opcode, int width,
+			std::initializer_list<int> operands);
+
+	// Add a register loaded with 'next' on every clock edge
+	void addRegister(int dest, int next);
+
+	// Return a net holding the value of a net in a cycle
+	int getNetInCycle(int net, int cycle);
+
+	// Add the logic of a unit, and make its dataflows read its outputs
+	void addUnit(Resource resource, const std::vector<int> &list);
+
+	// Add a dataflow to 'list' after the dataflows it reads, unless it
+	// was added already
+	void addSorted(int dataflow, std::vector<bool> &visited,
+			std::vector<int> &list);
+
+	// Order the dataflows of every code block so that nets are assigned
+	// before they are read, placing the logic of the units before their
+	// first user
+	void sortDataFlows();
+
+	// Add the chosen latency and area to the comments of the module
+	void report();
+
+public:
+
+	// Constructor
+	ResourceScheduler(Module &module, OptimizerStatistics &statistics,
+			double clock_period);
+
+	// Return the kind of the operator of an opcode
+	static Resource getResource(DataFlow::Opcode opcode);
+
+	// Return the name of a kind of operators, in the plural
+	static const char *getResourceName(Resource resource);
+
+	// Set the largest number of units of a kind, or 0 for no limit
+	void setLimit(Resource resource, int limit) { limits[resource] = limit; }
+
+	// Schedule and share the operators of the module if their number
+	// exceeds a limit. Return whether the module was changed.
+	bool run();
+};
+
+}
+
+#endif
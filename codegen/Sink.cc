@@ -0,0 +1,53 @@
+/**
+ * @file   Sink.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the sinks receiving the generated verilog code.
+ */
+
+#include "Error.h"
+#include "Sink.h"
+
+
+namespace verilog
+{
+
+FileSink::FileSink(const std::string &name)
+{
+	if (name == "-")
+	{
+		file = stdout;
+		owned = false;
+		return;
+	}
+
+	file = fopen(name.c_str(), "w");
+	owned = true;
+	this->name = name;
+	if (!file)
+		fatal("Cannot open output file: " + name);
+}
+
+
+FileSink::~FileSink()
+{
+	if (owned)
+		fclose(file);
+	else
+		fflush(file);
+}
+
+
+void FileSink::write(const char *data, size_t size)
+{
+	if (fwrite(data, 1, size, file) != size)
+		fatal("Error writing verilog code");
+}
+
+
+void FileSink::flush()
+{
+	fflush(file);
+}
+
+}
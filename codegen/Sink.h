@@ -0,0 +1,97 @@
+/**
+ * @file   Sink.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  Sink classes receive the verilog code produced by the emitter.
+ */
+
+#ifndef VERILOG_SINK_H
+#define VERILOG_SINK_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+
+namespace verilog
+{
+
+// Destination of the generated verilog code. The emitter writes every
+// module with one call to write().
+class Sink
+{
+public:
+
+	// Destructor
+	virtual ~Sink() { }
+
+	// Write a block of characters
+	virtual void write(const char *data, size_t size) = 0;
+
+	// Flush written data, if buffered
+	virtual void flush() { }
+
+	// Return the name of the file written, or an empty string for the
+	// standard output and memory
+	virtual std::string getFileName() const { return std::string(); }
+};
+
+
+// Sink writing to a C file, such as stdout
+class FileSink : public Sink
+{
+	// File
+	FILE *file;
+
+	// Whether the file is closed by the destructor
+	bool owned;
+
+	// Name of the file, or empty for stdout
+	std::string name;
+
+public:
+
+	// Constructor for an already open file, such as stdout, which is
+	// not closed by the sink.
+	FileSink(FILE *file) : file(file), owned(false) { }
+
+	// Constructor opening the given file for writing, or producing an
+	// error if it cannot be opened. Name '-' stands for stdout.
+	FileSink(const std::string &name);
+
+	// Destructor, closing the file if it was opened by the sink
+	~FileSink();
+
+	// Sinks own their file and cannot be copied
+	FileSink(const FileSink &) = delete;
+	FileSink &operator=(const FileSink &) = delete;
+
+	void write(const char *data, size_t size) override;
+	void flush() override;
+	std::string getFileName() const override { return name; }
+};
+
+
+// Sink keeping the verilog code in memory
+class MemorySink : public Sink
+{
+	// Written characters
+	std::string contents;
+
+public:
+
+	void write(const char *data, size_t size) override
+	{
+		contents.append(data, size);
+	}
+
+	// Return the written characters
+	const std::string &getContents() { return contents; }
+
+	// Discard the written characters
+	void clear() { contents.clear(); }
+};
+
+}
+
+#endif
@@ -0,0 +1,627 @@
+/**
+ * @file   StateMachine.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the translation of LLVM functions with loops
+ *         into state machines.
+ */
+
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+#include <set>
+#include <sstream>
+
+#include "Bits.h"
+#include "CodeBlock.h"
+#include "IfConverter.h"
+#include "Module.h"
+#include "ModuloScheduler.h"
+#include "Netlist.h"
+#include "Optimizer.h"
+#include "StateMachine.h"
+
+
+namespace verilog
+{
+
+static llvm::cl::opt<bool> PipelineLoops("verilog-pipeline-loops",
+		llvm::cl::desc("Pipeline the innermost loops of state machines by "
+				"modulo scheduling"),
+		llvm::cl::init(true));
+
+
+// Return whether a block loads or stores array elements
+static bool hasMemoryAccesses(llvm::BasicBlock *block)
+{
+	for (llvm::BasicBlock::iterator it = block->begin(), e = block->end();
+			it != e; ++it)
+		if (llvm::isa<llvm::LoadInst>(it) || llvm::isa<llvm::StoreInst>(it))
+			return true;
+	return false;
+}
+
+
+// Return 'n cycles' or 'n to m cycles'
+static std::string getCycles(int shortest, int longest)
+{
+	std::ostringstream os;
+	os << shortest;
+	if (longest != shortest)
+		os << " to " << longest;
+	os << (longest == 1 ? " cycle" : " cycles");
+	return os.str();
+}
+
+
+StateMachine::StateMachine(Module &module) :
+		module(module),
+		netlist(module.getNetlist())
+{
+}
+
+
+void StateMachine::analyze(llvm::Function &function)
+{
+	// Depth-first search from the entry block. An edge reaching a block
+	// on the stack closes a loop.
+	enum State { StateUnvisited = 0, StateVisiting, StateVisited };
+	llvm::DenseMap<llvm::BasicBlock *, State> states;
+	llvm::DenseMap<llvm::BasicBlock *, int> num_pending;
+	std::vector<std::pair<llvm::BasicBlock *, unsigned>> stack;
+	llvm::BasicBlock *entry = &function.getEntryBlock();
+	states[entry] = StateVisiting;
+	stack.push_back(std::make_pair(entry, 0u));
+	while (!stack.empty())
+	{
+		llvm::BasicBlock *block = stack.back().first;
+		unsigned index = stack.back().second;
+		llvm::BranchInst *branch = IfConverter::getBranch(block);
+		if (branch && index < branch->getNumSuccessors())
+		{
+			llvm::BasicBlock *successor = branch->getSuccessor(index);
+			stack.back().second++;
+			if (states[successor] == StateVisiting)
+			{
+				auto edge = std::make_pair(block, successor);
+				if (back_edges.count(edge))
+					continue;
+				back_edges.insert(edge);
+				if (loop_latches[successor].empty())
+					loop_headers.push_back(successor);
+				loop_latches[successor].push_back(block);
+				continue;
+			}
+			num_pending[successor]++;
+			if (states[successor] == StateUnvisited)
+			{
+				states[successor] = StateVisiting;
+				stack.push_back(std::make_pair(successor, 0u));
+			}
+			continue;
+		}
+
+		// All successors visited
+		states[block] = StateVisited;
+		stack.pop_back();
+	}
+
+	// Order reachable blocks as in the function, as long as every block
+	// follows its predecessors on the edges not closing loops
+	std::vector<llvm::BasicBlock *> order;
+	for (llvm::Function::iterator it = function.begin(), e = function.end();
+			it != e; ++it)
+		if (states[&*it])
+			order.push_back(&*it);
+	std::set<int> ready;
+	ready.insert(0);
+	while (!ready.empty())
+	{
+		llvm::BasicBlock *block = order[*ready.begin()];
+		ready.erase(ready.begin());
+		blocks.push_back(block);
+		block_states[block] = blocks.size();
+		llvm::BranchInst *branch = IfConverter::getBranch(block);
+		for (unsigned index = 0; branch && index < branch->getNumSuccessors();
+				index++)
+		{
+			llvm::BasicBlock *successor = branch->getSuccessor(index);
+			if (back_edges.count(std::make_pair(block, successor)))
+				continue;
+			if (!--num_pending[successor])
+				ready.insert(std::find(order.begin(), order.end(), successor) -
+						order.begin());
+		}
+	}
+
+	// Loops are reported in state order
+	std::sort(loop_headers.begin(), loop_headers.end(),
+			[this](llvm::BasicBlock *first, llvm::BasicBlock *second)
+	{
+		return block_states[first] < block_states[second];
+	});
+	if (PipelineLoops)
+		for (llvm::BasicBlock *header : loop_headers)
+			analyzeLoop(header);
+
+	// Ports, with 'clk', 'rst' and 'start' first
+	state_width = getNumBits(blocks.size());
+	module.addClockPorts();
+	module.addHandshakePorts();
+
+	// Arguments are read from the registers latching them
+	for (llvm::Function::arg_iterator it = function.arg_begin(),
+			e = function.arg_end(); it != e; ++it)
+	{
+		int port = module.lookupSymbol(&*it);
+		int reg = netlist.addRegister(netlist.getNetWidth(port));
+		module.addSymbol(&*it, reg);
+		arguments.push_back(std::make_pair(port, reg));
+	}
+
+	control_code_block = module.create<CodeBlock>("control");
+}
+
+
+bool StateMachine::analyzeLoop(llvm::BasicBlock *header)
+{
+	// The header branches to the body, or to itself, and to the exit
+	if (loop_latches[header].size() != 1)
+		return false;
+	llvm::BasicBlock *body = loop_latches[header][0];
+	llvm::BranchInst *branch = IfConverter::getBranch(header);
+	if (!branch->isConditional() ||
+			branch->getSuccessor(0) == branch->getSuccessor(1))
+		return false;
+	int index = branch->getSuccessor(0) == body ? 0 : 1;
+	if (branch->getSuccessor(index) != body)
+		return false;
+	llvm::BasicBlock *exit = branch->getSuccessor(1 - index);
+
+	// The body is only entered from the header, and only branches back
+	if (body != header)
+	{
+		llvm::BranchInst *body_branch = IfConverter::getBranch(body);
+		if (body->getSinglePredecessor() != header ||
+				llvm::isa<llvm::PHINode>(body->begin()) || !body_branch ||
+				body_branch->isConditional() || exit == header)
+			return false;
+	}
+
+	// Memory ports are shared by the states accessing them
+	if (hasMemoryAccesses(header) || hasMemoryAccesses(body))
+		return false;
+
+	loop_bodies[header] = body;
+	loop_exits[header] = exit;
+	return true;
+}
+
+
+int StateMachine::addLogic(DataFlow::Opcode opcode, int width,
+		std::initializer_list<int> operands)
+{
+	int dest = netlist.addWire(width);
+	module.addDataFlow(control_code_block, opcode, dest, operands);
+	return dest;
+}
+
+
+void StateMachine::addRegister(int dest, int next)
+{
+	// Emit 'always @(posedge clk) dest <= rst ? 0 : next;'
+	module.addDataFlow(control_code_block, DataFlow::OpcodeRegister, dest,
+			{ next, module.getClockPort(), module.getResetPort() });
+}
+
+
+int StateMachine::getStateNet(int net, int state)
+{
+	// Ports, registers and constants hold their value in all states
+	long long value;
+	if (net >= (int) net_states.size() || net_states[net] < 0 ||
+			netlist.getConstant(net, value))
+		return net;
+
+	// Values of the header of a pipelined loop are taken from the
+	// iteration that exits. Other states read them from registers loaded
+	// on exit.
+	auto loop = loop_nets.find(net);
+	if (loop != loop_nets.end() && net_states[net] == state)
+		return loop->second->getExitValue(net);
+	if (loop != loop_nets.end())
+	{
+		auto it = held_nets.find(net);
+		if (it != held_nets.end())
+			return it->second;
+		int width = netlist.getNetWidth(net);
+		int reg = netlist.addRegister(width);
+		held_nets[net] = reg;
+		addRegister(reg, addLogic(DataFlow::OpcodeMux, width,
+				{ loop->second->getExitNet(),
+				loop->second->getExitValue(net), reg }));
+		return reg;
+	}
+	if (net_states[net] == state)
+		return net;
+
+	auto it = held_nets.find(net);
+	if (it != held_nets.end())
+		return it->second;
+
+	// Load the register in the state computing the net
+	int width = netlist.getNetWidth(net);
+	int reg = netlist.addRegister(width);
+	held_nets[net] = reg;
+	addRegister(reg, addLogic(DataFlow::OpcodeMux, width,
+			{ state_nets[net_states[net]], net, reg }));
+	return reg;
+}
+
+
+int StateMachine::getCondition(llvm::BasicBlock *block)
+{
+	llvm::BranchInst *branch = IfConverter::getBranch(block);
+	return getStateNet(module.translateLLVMValue(control_code_block,
+			branch->getCondition()), block_states[block]);
+}
+
+
+int StateMachine::getEdgeNet(llvm::BasicBlock *block,
+		llvm::BasicBlock *successor)
+{
+	auto key = std::make_pair(block, successor);
+	auto it = edge_nets.find(key);
+	if (it != edge_nets.end())
+		return it->second;
+
+	// Unconditional edges are taken in the state of their block.
+	// Otherwise, emit 'assign dest = state & cond;', or '~cond' for the
+	// second successor.
+	int net = state_nets[block_states[block]];
+	llvm::BranchInst *branch = IfConverter::getBranch(block);
+	if (branch->isConditional() &&
+			branch->getSuccessor(0) != branch->getSuccessor(1))
+	{
+		int cond = getCondition(block);
+		if (branch->getSuccessor(1) == successor)
+			cond = addLogic(DataFlow::OpcodeNot, 1, { cond });
+		net = addLogic(DataFlow::OpcodeAnd, 1, { net, cond });
+	}
+	edge_nets[key] = net;
+	return net;
+}
+
+
+int StateMachine::translatePHI(llvm::PHINode *phi)
+{
+	// Values are loaded when the edges are known, in run()
+	int width = Module::translateLLVMType(phi->getType(), "phi nodes");
+	int reg = netlist.addRegister(width);
+	module.addSymbol(phi, reg);
+	phis.push_back(std::make_pair(phi, reg));
+	return reg;
+}
+
+
+void StateMachine::translateReturn(llvm::BasicBlock *block, int value)
+{
+	returns.push_back(std::make_pair(block_states[block], value));
+}
+
+
+void StateMachine::pipelineLoop(llvm::BasicBlock *header)
+{
+	// The body is computed in the state of the header. Values of other
+	// states are read from registers.
+	llvm::BasicBlock *body = loop_bodies[header];
+	int state = block_states[header];
+	CodeBlock *header_code_block = module.getCodeBlock(header);
+	CodeBlock *body_code_block = module.getCodeBlock(body);
+	for (int dataflow : body_code_block->getDataFlows())
+		net_states[netlist.getDest(dataflow)] = state;
+	std::set<CodeBlock *> code_blocks = { header_code_block, body_code_block };
+	for (CodeBlock *code_block : code_blocks)
+		for (int dataflow : code_block->getDataFlows())
+			for (int index = 0; index < netlist.getNumOperands(dataflow);
+					index++)
+				netlist.setOperand(dataflow, index, getStateNet(
+						netlist.getOperand(dataflow, index), state));
+
+	ModuloScheduler *scheduler = module.create<ModuloScheduler>(module,
+			header_code_block, control_code_block,
+			Optimizer::getClockPeriod());
+	for (int resource = 0; resource < ResourceScheduler::ResourceMax;
+			resource++)
+		scheduler->setLimit((ResourceScheduler::Resource) resource,
+				Optimizer::getResourceLimit(
+				(ResourceScheduler::Resource) resource));
+	scheduler->addCodeBlock(header_code_block);
+	if (body != header)
+		scheduler->addCodeBlock(body_code_block);
+	for (auto &phi : phis)
+		if (phi.first->getParent() == header)
+			scheduler->addRecurrence(phi.second, getStateNet(
+					module.translateLLVMValue(control_code_block,
+					phi.first->getIncomingValueForBlock(body)), state));
+	llvm::BranchInst *branch = IfConverter::getBranch(header);
+	scheduler->setExitCondition(getCondition(header),
+			branch->getSuccessor(0) == loop_exits[header]);
+	for (int dataflow : header_code_block->getDataFlows())
+		loop_nets[netlist.getDest(dataflow)] = scheduler;
+	scheduler->schedule();
+	scheduler->run(state_register, module.getConstant(state, state_width));
+
+	loop_schedulers[header] = scheduler;
+	loop_schedulers[body] = scheduler;
+	edge_nets[std::make_pair(header, loop_exits[header])] =
+			scheduler->getExitNet();
+}
+
+
+int StateMachine::getNumCycles(llvm::BasicBlock *block)
+{
+	// The state of a pipelined loop lasts until the first iteration
+	// exits
+	auto it = loop_bodies.find(block);
+	return it == loop_bodies.end() ? 1 :
+			loop_schedulers[block]->getExitLatency();
+}
+
+
+void StateMachine::getPathLengths(llvm::BasicBlock *source,
+		llvm::DenseMap<llvm::BasicBlock *, int> &shortest,
+		llvm::DenseMap<llvm::BasicBlock *, int> &longest)
+{
+	// Blocks follow their predecessors
+	shortest[source] = getNumCycles(source);
+	longest[source] = shortest[source];
+	for (llvm::BasicBlock *block : blocks)
+	{
+		if (!shortest[block])
+			continue;
+		llvm::BranchInst *branch = IfConverter::getBranch(block);
+		for (unsigned index = 0; branch && index < branch->getNumSuccessors();
+				index++)
+		{
+			llvm::BasicBlock *successor = branch->getSuccessor(index);
+			if (back_edges.count(std::make_pair(block, successor)))
+				continue;
+			int first = shortest[block] + getNumCycles(successor);
+			int last = longest[block] + getNumCycles(successor);
+			if (shortest[successor])
+				first = std::min(first, shortest[successor]);
+			shortest[successor] = first;
+			longest[successor] = std::max(last, longest[successor]);
+		}
+	}
+}
+
+
+void StateMachine::reportLatency()
+{
+	// Cycles from the one where 'start' is set to the one where 'done'
+	// is set, when no edge closing a loop is taken. The idle state and
+	// every state on the path take one cycle, except for pipelined loops.
+	llvm::DenseMap<llvm::BasicBlock *, int> shortest;
+	llvm::DenseMap<llvm::BasicBlock *, int> longest;
+	getPathLengths(blocks[0], shortest, longest);
+	int first = 0;
+	int last = 0;
+	for (auto &ret : returns)
+	{
+		llvm::BasicBlock *block = blocks[ret.first - 1];
+		first = first ? std::min(first, shortest[block] + 1) :
+				shortest[block] + 1;
+		last = std::max(last, longest[block] + 1);
+	}
+
+	std::ostringstream os;
+	os << "state machine " << blocks.size() + 1 << " states, latency "
+			<< getCycles(first, last);
+	if (!loop_headers.empty())
+		os << " plus the loop iterations";
+	module.addComment(os.str());
+
+	// Every iteration of a loop runs the states from its header to one
+	// of the blocks branching back to it
+	for (llvm::BasicBlock *header : loop_headers)
+	{
+		auto it = loop_bodies.find(header);
+		if (it != loop_bodies.end())
+		{
+			ModuloScheduler *scheduler = loop_schedulers[header];
+			os.str("");
+			os << "  loop " << header->getName().str() << ": "
+					<< getCycles(scheduler->getII(), scheduler->getII())
+					<< " per iteration, pipelined in "
+					<< scheduler->getNumStages()
+					<< (scheduler->getNumStages() == 1 ? " stage" : " stages")
+					<< " (II "
+					<< scheduler->getII() << ", recurrences "
+					<< scheduler->getRecurrenceMII() << ", resources "
+					<< scheduler->getResourceMII() << ")";
+			module.addComment(os.str());
+			for (int resource = 0; resource < ResourceScheduler::ResourceMax;
+					resource++)
+			{
+				int num_operations, num_units;
+				if (!scheduler->getUnits((ResourceScheduler::Resource) resource,
+						num_operations, num_units))
+					continue;
+				os.str("");
+				os << "    " << ResourceScheduler::getResourceName(
+						(ResourceScheduler::Resource) resource) << ": "
+						<< num_operations << " operations on " << num_units
+						<< (num_units == 1 ? " unit" : " units") << " (limit "
+						<< Optimizer::getResourceLimit(
+						(ResourceScheduler::Resource) resource) << ")";
+				module.addComment(os.str());
+			}
+			continue;
+		}
+		shortest.clear();
+		longest.clear();
+		getPathLengths(header, shortest, longest);
+		first = 0;
+		last = 0;
+		for (llvm::BasicBlock *latch : loop_latches[header])
+		{
+			first = first ? std::min(first, shortest[latch]) : shortest[latch];
+			last = std::max(last, longest[latch]);
+		}
+		os.str("");
+		os << "  loop " << header->getName().str() << ": "
+				<< getCycles(first, last) << " per iteration";
+		module.addComment(os.str());
+	}
+}
+
+
+void StateMachine::run()
+{
+	module.addCodeBlock(control_code_block);
+
+	// Emit 'assign state_net = state == n;' for every state, the idle
+	// state being 0
+	int num_states = blocks.size() + 1;
+	state_register = netlist.addRegister(state_width);
+	for (int state = 0; state < num_states; state++)
+		state_nets.push_back(addLogic(DataFlow::OpcodeEq, 1,
+				{ state_register, module.getConstant(state, state_width) }));
+
+	// State of every net computed by the datapath
+	net_states.assign(netlist.getNumNets(), -1);
+	for (llvm::BasicBlock *block : blocks)
+		for (int dataflow : module.getCodeBlock(block)->getDataFlows())
+			net_states[netlist.getDest(dataflow)] = block_states[block];
+
+	// Pipelined loops first, so that other states read the values of
+	// the iteration that exits
+	for (llvm::BasicBlock *header : loop_headers)
+		if (loop_bodies.count(header))
+			pipelineLoop(header);
+
+	// Operands computed in other states are read from registers
+	for (llvm::BasicBlock *block : blocks)
+	{
+		if (loop_schedulers.count(block))
+			continue;
+		int state = block_states[block];
+		for (int dataflow : module.getCodeBlock(block)->getDataFlows())
+			for (int index = 0; index < netlist.getNumOperands(dataflow);
+					index++)
+				netlist.setOperand(dataflow, index, getStateNet(
+						netlist.getOperand(dataflow, index), state));
+	}
+
+	// Arguments are latched while idle
+	for (auto &argument : arguments)
+		addRegister(argument.second, addLogic(DataFlow::OpcodeMux,
+				netlist.getNetWidth(argument.second),
+				{ state_nets[0], argument.first, argument.second }));
+
+	// Phi nodes are loaded with the value of the edge taken, computed
+	// in the state of the predecessor, and hold their value otherwise.
+	// Incoming blocks that cannot branch here are ignored. Phi nodes of
+	// pipelined loops are loaded with the value of the iteration that
+	// exits.
+	for (auto &phi : phis)
+	{
+		llvm::BasicBlock *block = phi.first->getParent();
+		int width = netlist.getNetWidth(phi.second);
+		int next = phi.second;
+		auto loop = loop_bodies.find(block);
+		llvm::BasicBlock *body = loop == loop_bodies.end() ? nullptr :
+				loop->second;
+		std::set<llvm::BasicBlock *> predecessors;
+		for (unsigned index = 0; index < phi.first->getNumIncomingValues();
+				index++)
+		{
+			llvm::BasicBlock *predecessor = phi.first->getIncomingBlock(index);
+			llvm::BranchInst *branch = block_states.count(predecessor) ?
+					IfConverter::getBranch(predecessor) : nullptr;
+			if (!branch || predecessor == body ||
+					!predecessors.insert(predecessor).second)
+				continue;
+			bool found = false;
+			for (unsigned succ = 0; succ < branch->getNumSuccessors(); succ++)
+				found = found || branch->getSuccessor(succ) == block;
+			if (!found)
+				continue;
+			int value = getStateNet(module.translateLLVMValue(
+					control_code_block, phi.first->getIncomingValue(index)),
+					block_states[predecessor]);
+			next = addLogic(DataFlow::OpcodeMux, width,
+					{ getEdgeNet(predecessor, block), value, next });
+		}
+		if (body)
+		{
+			ModuloScheduler *scheduler = loop_schedulers[block];
+			next = addLogic(DataFlow::OpcodeMux, width,
+					{ scheduler->getExitNet(),
+					scheduler->getExitValue(phi.second), next });
+		}
+		addRegister(phi.second, next);
+	}
+
+	// Next state. The idle state moves to the entry block on 'start',
+	// and return states move back to the idle state. Pipelined loops stay
+	// in the state of their header until they exit.
+	int next = addLogic(DataFlow::OpcodeMux, state_width,
+			{ module.getStartPort(), module.getConstant(1, state_width),
+			module.getConstant(0, state_width) });
+	for (int state = num_states - 1; state > 0; state--)
+	{
+		llvm::BasicBlock *block = blocks[state - 1];
+		llvm::BranchInst *branch = IfConverter::getBranch(block);
+		int target = module.getConstant(0, state_width);
+		auto loop = loop_exits.find(block);
+		if (loop != loop_exits.end())
+			target = addLogic(DataFlow::OpcodeMux, state_width,
+					{ loop_schedulers[block]->getExitNet(),
+					module.getConstant(block_states[loop->second], state_width),
+					module.getConstant(state, state_width) });
+		else if (loop_schedulers.count(block))
+			continue;
+		else if (branch)
+			target = module.getConstant(block_states[branch->getSuccessor(0)],
+					state_width);
+		if (branch && branch->isConditional() &&
+				branch->getSuccessor(0) != branch->getSuccessor(1) &&
+				loop == loop_exits.end())
+			target = addLogic(DataFlow::OpcodeMux, state_width,
+					{ getCondition(block), target, module.getConstant(
+					block_states[branch->getSuccessor(1)], state_width) });
+		next = addLogic(DataFlow::OpcodeMux, state_width,
+				{ state_nets[state], target, next });
+	}
+	addRegister(state_register, next);
+
+	// The result is loaded in the return states, and 'done' is set in
+	// the next cycle
+	int output_port = module.getOutputPort();
+	int result = netlist.addRegister(netlist.getNetWidth(output_port));
+	int done = netlist.addRegister(1);
+	int result_next = result;
+	int done_next = -1;
+	for (auto &ret : returns)
+	{
+		result_next = addLogic(DataFlow::OpcodeMux, netlist.getNetWidth(result),
+				{ state_nets[ret.first], getStateNet(ret.second, ret.first),
+				result_next });
+		done_next = done_next < 0 ? state_nets[ret.first] :
+				addLogic(DataFlow::OpcodeOr, 1,
+				{ done_next, state_nets[ret.first] });
+	}
+	addRegister(result, result_next);
+	addRegister(done, done_next < 0 ? module.getConstant(0, 1) : done_next);
+	module.addDataFlow(control_code_block, DataFlow::OpcodeAssign, output_port,
+			{ result });
+	module.addDataFlow(control_code_block, DataFlow::OpcodeAssign,
+			module.getDonePort(), { done });
+
+	reportLatency();
+}
+
+}
@@ -0,0 +1,182 @@
+/**
+ * @file   StateMachine.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  StateMachine class turns an LLVM function with loops into a
+ *         finite-state machine controlling the datapath of its blocks.
+ */
+
+#ifndef VERILOG_STATE_MACHINE_H
+#define VERILOG_STATE_MACHINE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+
+#include <initializer_list>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "DataFlow.h"
+
+
+namespace verilog
+{
+
+// Forward declarations
+class CodeBlock;
+class Module;
+class ModuloScheduler;
+class Netlist;
+
+
+// Every reachable basic block becomes a state of a state machine, taking
+// one clock cycle, in addition to the idle state 0. The module waits in
+// the idle state until 'start' is set, latching its arguments, runs the
+// states of the blocks taken, and sets 'done' for one cycle once the
+// result is available. The result is held until the next return.
+//
+// The datapath of a state is the combinational translation of its block.
+// Values used by other states are held in registers loaded in the state
+// computing them, and phi nodes are registers loaded on the edges
+// entering their block. The state logic and all registers are added to
+// a last code block, 'control'.
+//
+// Innermost loops made of a header and at most one body block, branching
+// back to the header, are pipelined: they run in the state of their
+// header, starting a new iteration every II cycles as scheduled by
+// ModuloScheduler, and the state of their body is never entered. Loops
+// accessing arrays are not pipelined, since the ports of their memories
+// are scheduled by state.
+class StateMachine
+{
+	// Module being translated
+	Module &module;
+	Netlist &netlist;
+
+	// Reachable blocks, in an order where every block follows its
+	// predecessors, ignoring the edges closing loops. Block 'i' is
+	// state 'i + 1'.
+	std::vector<llvm::BasicBlock *> blocks;
+	llvm::DenseMap<llvm::BasicBlock *, int> block_states;
+
+	// Edges closing loops, and loop headers with the blocks branching
+	// back to them. Headers are sorted by state.
+	std::set<std::pair<llvm::BasicBlock *, llvm::BasicBlock *>> back_edges;
+	std::vector<llvm::BasicBlock *> loop_headers;
+	llvm::DenseMap<llvm::BasicBlock *, std::vector<llvm::BasicBlock *>>
+			loop_latches;
+
+	// Pipelined loops, by header, with their body block, or the header
+	// for loops of one block, and the block they exit to
+	llvm::DenseMap<llvm::BasicBlock *, llvm::BasicBlock *> loop_bodies;
+	llvm::DenseMap<llvm::BasicBlock *, llvm::BasicBlock *> loop_exits;
+
+	// Schedulers of the pipelined loops, by header and body block, and
+	// by net of their header
+	llvm::DenseMap<llvm::BasicBlock *, ModuloScheduler *> loop_schedulers;
+	std::map<int, ModuloScheduler *> loop_nets;
+
+	// State register, and nets set in every state
+	int state_register = -1;
+	int state_width = 1;
+	std::vector<int> state_nets;
+
+	// Input ports and the registers latching them
+	std::vector<std::pair<int, int>> arguments;
+
+	// Phi nodes and their registers
+	std::vector<std::pair<llvm::PHINode *, int>> phis;
+
+	// States of the return instructions and the values returned
+	std::vector<std::pair<int, int>> returns;
+
+	// State computing every net of the datapath, or -1
+	std::vector<int> net_states;
+
+	// Registers holding the nets used in other states, indexed by net
+	std::map<int, int> held_nets;
+
+	// Nets set when edges are taken
+	std::map<std::pair<llvm::BasicBlock *, llvm::BasicBlock *>, int>
+			edge_nets;
+
+	// Code block of the state logic and registers
+	CodeBlock *control_code_block = nullptr;
+
+	// Return a net holding the value of a net in the given state
+	int getStateNet(int net, int state);
+
+	// Return a net holding the branch condition of a block, in its state
+	int getCondition(llvm::BasicBlock *block);
+
+	// Return a net set when the edge from a block to its successor is
+	// taken
+	int getEdgeNet(llvm::BasicBlock *block, llvm::BasicBlock *successor);
+
+	// Add a dataflow computing a new wire of the given width to the
+	// control code block, and return the wire
+	int addLogic(DataFlow::Opcode opcode, int width,
+			std::initializer_list<int> operands);
+
+	// Add a register loaded with 'next' on every clock edge
+	void addRegister(int dest, int next);
+
+	// Return whether a loop can be pipelined, and record its body and
+	// exit block
+	bool analyzeLoop(llvm::BasicBlock *header);
+
+	// Schedule a pipelined loop and add its pipeline logic
+	void pipelineLoop(llvm::BasicBlock *header);
+
+	// Return the number of cycles spent in the state of a block when no
+	// edge closing a loop is taken
+	int getNumCycles(llvm::BasicBlock *block);
+
+	// Compute the number of cycles on the shortest and longest paths
+	// from a block to every block, ignoring the edges closing loops, or
+	// 0 for blocks not reached
+	void getPathLengths(llvm::BasicBlock *source,
+			llvm::DenseMap<llvm::BasicBlock *, int> &shortest,
+			llvm::DenseMap<llvm::BasicBlock *, int> &longest);
+
+	// Add the latency of the state machine to the comments of the module
+	void reportLatency();
+
+public:
+
+	// Constructor
+	StateMachine(Module &module);
+
+	// Number the states of the reachable blocks of a function, add the
+	// clock, reset and handshake ports, and associate the arguments of
+	// the function with the registers latching them.
+	void analyze(llvm::Function &function);
+
+	// Return the reachable blocks, in translation order
+	const std::vector<llvm::BasicBlock *> &getBlocks() { return blocks; }
+
+	// Return the net set in the state of a block, once run() was called
+	int getBlockNet(llvm::BasicBlock *block)
+	{
+		return state_nets[block_states[block]];
+	}
+
+	// Translate a phi node into a register and return it. Its value is
+	// loaded on the edges, so it needs no logic in a code block.
+	int translatePHI(llvm::PHINode *phi);
+
+	// Record the value returned by a block
+	void translateReturn(llvm::BasicBlock *block, int value);
+
+	// Once all blocks are translated, make values cross states through
+	// registers, and add the state logic
+	void run();
+};
+
+}
+
+#endif
@@ -0,0 +1,304 @@
+/**
+ * @file   StrengthReducer.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the strength reduction of multiplications and
+ *         divisions by constants.
+ */
+
+#include "llvm/Support/CommandLine.h"
+
+#include <vector>
+
+#include "Bits.h"
+#include "CodeBlock.h"
+#include "Error.h"
+#include "Module.h"
+#include "Netlist.h"
+#include "StrengthReducer.h"
+
+
+namespace verilog
+{
+
+static llvm::cl::opt<unsigned> MaxShiftAddDigits("verilog-max-shift-add",
+		llvm::cl::desc("Multiply by constants with at most <n> nonzero "
+				"signed digits with shifts and additions, and with a "
+				"multiplier otherwise"),
+		llvm::cl::value_desc("n"),
+		llvm::cl::init(8));
+
+
+// Compute the magic number and shift of a signed division by a constant,
+// whose absolute value is not 0, 1, or a power of two. The magic number
+// is returned in its low 'width' bits.
+static void getSignedMagic(long long divisor, int width,
+		unsigned long long &magic, int &shift)
+{
+	unsigned long long two = 1ULL << (width - 1);
+	unsigned long long abs_divisor = divisor < 0 ? -(unsigned long long) divisor :
+			divisor;
+	unsigned long long t = two + (divisor < 0);
+	unsigned long long abs_nc = t - 1 - t % abs_divisor;
+	unsigned long long q1 = two / abs_nc;
+	unsigned long long r1 = two - q1 * abs_nc;
+	unsigned long long q2 = two / abs_divisor;
+	unsigned long long r2 = two - q2 * abs_divisor;
+	unsigned long long delta;
+	int p = width - 1;
+	do
+	{
+		p++;
+		q1 *= 2;
+		r1 *= 2;
+		if (r1 >= abs_nc)
+		{
+			q1++;
+			r1 -= abs_nc;
+		}
+		q2 *= 2;
+		r2 *= 2;
+		if (r2 >= abs_divisor)
+		{
+			q2++;
+			r2 -= abs_divisor;
+		}
+		delta = abs_divisor - r2;
+	} while (q1 < delta || (q1 == delta && r1 == 0));
+	magic = truncate(divisor < 0 ? -(q2 + 1) : q2 + 1, width);
+	shift = p - width;
+}
+
+
+StrengthReducer::StrengthReducer(Module &module) :
+		module(module),
+		netlist(module.getNetlist())
+{
+}
+
+
+int StrengthReducer::addLogic(DataFlow::Opcode opcode, int width,
+		std::initializer_list<int> operands)
+{
+	int dest = netlist.addWire(width);
+	module.addDataFlow(code_block, opcode, dest, operands);
+	return dest;
+}
+
+
+int StrengthReducer::addSlice(int net, int low, int width)
+{
+	// Emit 'assign dest = net[low + width - 1:low];'
+	int dest = netlist.addWire(width);
+	int dataflow = module.addDataFlow(code_block, DataFlow::OpcodeAssign, dest,
+			{ net });
+	netlist.setOperandSlice(dataflow, 0, low, width);
+	return dest;
+}
+
+
+int StrengthReducer::addArithmeticShift(int net, int low, int width)
+{
+	if (!low)
+		return net;
+	return addLogic(DataFlow::OpcodeSext, width,
+			{ addSlice(net, low, width - low) });
+}
+
+
+int StrengthReducer::addTerms(int net, int width, const int *digits, int sign)
+{
+	// Shifted copies of the operand, written as wiring by the optimizer
+	std::vector<int> terms;
+	for (int bit = 0; bit < width; bit++)
+	{
+		if (digits[bit] != sign)
+			continue;
+		terms.push_back(bit ? addLogic(DataFlow::OpcodeShl, width,
+				{ net, module.getConstant(bit, width) }) : net);
+	}
+	if (terms.empty())
+		return -1;
+
+	// Add pairs of terms, one level of the tree at a time
+	while (terms.size() > 1)
+	{
+		std::vector<int> sums;
+		for (int index = 0; index + 1 < (int) terms.size(); index += 2)
+			sums.push_back(addLogic(DataFlow::OpcodeAdd, width,
+					{ terms[index], terms[index + 1] }));
+		if (terms.size() % 2)
+			sums.push_back(terms.back());
+		terms.swap(sums);
+	}
+	return terms[0];
+}
+
+
+int StrengthReducer::multiply(int net, unsigned long long constant, int width)
+{
+	// Canonical signed digits, from the least significant one. A run of
+	// ones ending at a bit becomes a digit -1 there and a carry into the
+	// next bits. Digits at or above the width vanish modulo 2 ^ width.
+	constant = truncate(constant, width);
+	int digits[64] = { };
+	unsigned num_digits = 0;
+	unsigned long long value = constant;
+	for (int bit = 0; bit < width && value; bit++)
+	{
+		if (value & 1)
+		{
+			digits[bit] = (value & 3) == 1 ? 1 : -1;
+			if (digits[bit] > 0)
+				value--;
+			else
+				value++;
+			num_digits++;
+		}
+		value >>= 1;
+	}
+	if (!num_digits)
+		return module.getConstant(0, width);
+	if (constant == 1)
+		return net;
+
+	// Emit 'assign dest = net * constant;' for dense constants
+	if (num_digits > MaxShiftAddDigits)
+		return addLogic(DataFlow::OpcodeMul, width, { net,
+				module.getConstant(signExtend(constant, width), width) });
+
+	// Emit 'assign dest = positive - negative;'
+	int positive = addTerms(net, width, digits, 1);
+	int negative = addTerms(net, width, digits, -1);
+	if (negative < 0)
+		return positive;
+	return addLogic(DataFlow::OpcodeSub, width, { positive < 0 ?
+			module.getConstant(0, width) : positive, negative });
+}
+
+
+int StrengthReducer::multiplyHigh(int net, unsigned long long constant,
+		int width, bool is_signed)
+{
+	// Product of the operands extended to twice their width
+	int wide_width = 2 * width;
+	int wide = addLogic(is_signed ? DataFlow::OpcodeSext :
+			DataFlow::OpcodeAssign, wide_width, { net });
+	if (is_signed)
+		constant = signExtend(constant, width);
+	int product = multiply(wide, constant, wide_width);
+	return addSlice(product, width, width);
+}
+
+
+int StrengthReducer::divideSigned(int net, long long divisor, int width)
+{
+	// Division by 1 or -1
+	int zero = module.getConstant(0, width);
+	if (divisor == 1)
+		return net;
+	if (divisor == -1)
+		return addLogic(DataFlow::OpcodeSub, width, { zero, net });
+
+	// Division by a power of two, or its opposite. Negative dividends are
+	// added 2 ^ k - 1 before the shift, so that it rounds toward zero. The
+	// bias is the sign bit copied to the low k bits, zero-extended.
+	unsigned long long abs_divisor = divisor < 0 ? -(unsigned long long) divisor :
+			divisor;
+	int log2 = getLog2(abs_divisor);
+	if (log2 > 0)
+	{
+		int sign = addSlice(net, width - 1, 1);
+		int bias = log2 > 1 ? addLogic(DataFlow::OpcodeSext, log2, { sign }) :
+				sign;
+		bias = addLogic(DataFlow::OpcodeAssign, width, { bias });
+		int sum = addLogic(DataFlow::OpcodeAdd, width, { net, bias });
+		int quotient = addArithmeticShift(sum, log2, width);
+		if (divisor < 0)
+			quotient = addLogic(DataFlow::OpcodeSub, width, { zero, quotient });
+		return quotient;
+	}
+
+	// High half of the product by the magic number, corrected when the
+	// sign of the magic number differs from the one of the divisor
+	unsigned long long magic;
+	int shift;
+	getSignedMagic(divisor, width, magic, shift);
+	long long signed_magic = signExtend(magic, width);
+	int quotient = multiplyHigh(net, magic, width, true);
+	if (divisor > 0 && signed_magic < 0)
+		quotient = addLogic(DataFlow::OpcodeAdd, width, { quotient, net });
+	else if (divisor < 0 && signed_magic > 0)
+		quotient = addLogic(DataFlow::OpcodeSub, width, { quotient, net });
+	quotient = addArithmeticShift(quotient, shift, width);
+
+	// Negative quotients are rounded toward zero by adding one
+	int sign = addSlice(divisor > 0 ? net : quotient, width - 1, 1);
+	return addLogic(DataFlow::OpcodeAdd, width, { quotient, sign });
+}
+
+
+int StrengthReducer::divideUnsigned(int net, unsigned long long divisor,
+		int width)
+{
+	// Division by a power of two
+	int log2 = getLog2(divisor);
+	if (log2 == 0)
+		return net;
+	if (log2 > 0)
+		return addLogic(DataFlow::OpcodeLshr, width, { net,
+				module.getConstant(log2, width) });
+
+	// With 'l = ceil(log2(divisor))', the magic number
+	// '2 ^ width * (2 ^ l - divisor) / divisor + 1' fits in 'width' bits,
+	// and 'q = (t + ((net - t) >> 1)) >> (l - 1)', where 't' is the high
+	// half of its product by the dividend.
+	int l = 0;
+	while ((1ULL << l) < divisor)
+		l++;
+	unsigned long long magic = ((1ULL << width) * ((1ULL << l) - divisor)) /
+			divisor + 1;
+	int high = multiplyHigh(net, magic, width, false);
+	int difference = addLogic(DataFlow::OpcodeSub, width, { net, high });
+	int half = addLogic(DataFlow::OpcodeLshr, width, { difference,
+			module.getConstant(1, width) });
+	int sum = addLogic(DataFlow::OpcodeAdd, width, { high, half });
+	if (l == 1)
+		return sum;
+	return addLogic(DataFlow::OpcodeLshr, width, { sum,
+			module.getConstant(l - 1, width) });
+}
+
+
+void StrengthReducer::translateMultiply(CodeBlock *code_block, int dest,
+		int src, long long constant)
+{
+	// Emit 'assign dest = product;'
+	this->code_block = code_block;
+	int width = netlist.getNetWidth(dest);
+	int product = multiply(src, constant, width);
+	module.addDataFlow(code_block, DataFlow::OpcodeAssign, dest, { product });
+}
+
+
+void StrengthReducer::translateDivide(CodeBlock *code_block, int dest,
+		int src, long long divisor, bool is_signed, bool remainder)
+{
+	int width = netlist.getNetWidth(dest);
+	unsigned long long bits = truncate(divisor, width);
+	if (!bits)
+		fatal("Error: Division by zero");
+
+	// Quotient, and 'net - quotient * divisor' for remainders
+	this->code_block = code_block;
+	int result = is_signed ? divideSigned(src, signExtend(bits, width), width) :
+			divideUnsigned(src, bits, width);
+	if (remainder)
+		result = addLogic(DataFlow::OpcodeSub, width, { src,
+				multiply(result, bits, width) });
+
+	// Emit 'assign dest = result;'
+	module.addDataFlow(code_block, DataFlow::OpcodeAssign, dest, { result });
+}
+
+}
@@ -0,0 +1,95 @@
+/**
+ * @file   StrengthReducer.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  StrengthReducer class translates multiplications and divisions
+ *         by constants into shifts, additions, and subtractions.
+ */
+
+#ifndef VERILOG_STRENGTH_REDUCER_H
+#define VERILOG_STRENGTH_REDUCER_H
+
+#include <initializer_list>
+
+#include "DataFlow.h"
+
+
+namespace verilog
+{
+
+// Forward declarations
+class CodeBlock;
+class Module;
+class Netlist;
+
+
+// A multiplication by a constant is written in canonical signed digits,
+// where no two adjacent digits are nonzero, so that a run of ones such as
+// 'x * 7' costs one subtraction, '(x << 3) - x'. Shifted copies of the
+// operand for the positive and the negative digits are added by balanced
+// trees, and the second sum is subtracted from the first one. Constants
+// with more nonzero digits than allowed use a multiplier instead.
+//
+// A division by a constant is a multiplication by its inverse: the high
+// half of the product of the dividend and a magic number, given by
+// Hacker's Delight (chapter 10), is corrected and shifted right. Powers
+// of two only need a shift, rounded toward zero for signed dividends, and
+// remainders are the dividend minus the quotient times the divisor.
+class StrengthReducer
+{
+	// Module being translated
+	Module &module;
+	Netlist &netlist;
+
+	// Code block the dataflows are added to
+	CodeBlock *code_block = nullptr;
+
+	// Add a dataflow computing a new wire of the given width, and return
+	// the wire
+	int addLogic(DataFlow::Opcode opcode, int width,
+			std::initializer_list<int> operands);
+
+	// Return a new wire holding 'width' bits of a net from bit 'low'
+	int addSlice(int net, int low, int width);
+
+	// Return a net holding the bits of a net from bit 'low' up, shifted
+	// right and sign-extended to 'width' bits
+	int addArithmeticShift(int net, int low, int width);
+
+	// Return a net holding the sum of the shifted copies of 'net' of the
+	// given digit sign, added by a balanced tree, or -1 if there are none
+	int addTerms(int net, int width, const int *digits, int sign);
+
+	// Return a net holding 'net * constant', modulo 2 ^ width. The net
+	// must have the given width.
+	int multiply(int net, unsigned long long constant, int width);
+
+	// Return a net holding the high half of the product of a net and a
+	// constant of the same width, both signed or unsigned
+	int multiplyHigh(int net, unsigned long long constant, int width,
+			bool is_signed);
+
+	// Return a net holding the quotient of a net by a constant, rounded
+	// toward zero
+	int divideSigned(int net, long long divisor, int width);
+	int divideUnsigned(int net, unsigned long long divisor, int width);
+
+public:
+
+	// Constructor
+	StrengthReducer(Module &module);
+
+	// Emit 'assign dest = src * constant;' as shifts and additions
+	void translateMultiply(CodeBlock *code_block, int dest, int src,
+			long long constant);
+
+	// Emit 'assign dest = src / divisor;', or the remainder if
+	// 'remainder' is true, with signed or unsigned operands. Divisors are
+	// truncated to the width of 'dest', and must not be zero.
+	void translateDivide(CodeBlock *code_block, int dest, int src,
+			long long divisor, bool is_signed, bool remainder);
+};
+
+}
+
+#endif
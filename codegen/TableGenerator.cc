@@ -0,0 +1,502 @@
+/**
+ * @file   TableGenerator.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the replacement of verilog modules with truth
+ *         tables.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <iomanip>
+#include <sstream>
+
+#include "CodeBlock.h"
+#include "Module.h"
+#include "Netlist.h"
+#include "Optimizer.h"
+#include "Pipeliner.h"
+#include "TableGenerator.h"
+
+
+namespace verilog
+{
+
+// Return the mask of the low 'width' bits
+static unsigned long long getMask(int width)
+{
+	return width >= 64 ? ~0ULL : (1ULL << width) - 1;
+}
+
+
+// Return the number of low bits of an operand that the result of its
+// dataflow depends on. The low bits of the result of additions, bitwise
+// operators and left shifts only depend on the low bits of their operands,
+// so bits above a narrowed destination are not read.
+static int getBitsRead(const Netlist &netlist, int dataflow, int index)
+{
+	int width = netlist.getNetWidth(netlist.getDest(dataflow));
+	switch (netlist.getOpcode(dataflow))
+	{
+	case DataFlow::OpcodeAssign:
+	case DataFlow::OpcodeAdd:
+	case DataFlow::OpcodeSub:
+	case DataFlow::OpcodeMul:
+	case DataFlow::OpcodeXor:
+	case DataFlow::OpcodeAnd:
+	case DataFlow::OpcodeOr:
+	case DataFlow::OpcodeNot:
+	case DataFlow::OpcodeMaj:
+		return width;
+
+	case DataFlow::OpcodeShl:
+		return index ? INT_MAX : width;
+
+	case DataFlow::OpcodeMux:
+		return index ? width : INT_MAX;
+
+	case DataFlow::OpcodeConcat:
+
+		// Bits of the operands after this one are below it
+		for (int next = index + 1; next < netlist.getNumOperands(dataflow);
+				next++)
+		{
+			int slice_width = netlist.getOperandWidth(dataflow, next);
+			width -= slice_width ? slice_width : netlist.getNetWidth(
+					netlist.getOperand(dataflow, next));
+		}
+		return std::max(width, 0);
+
+	default:
+		return INT_MAX;
+	}
+}
+
+
+TableGenerator::TableGenerator(Module &module,
+		OptimizerStatistics &statistics) :
+		module(module),
+		netlist(module.getNetlist()),
+		statistics(statistics)
+{
+}
+
+
+bool TableGenerator::findAddressBits()
+{
+	// Bits read of every input port
+	const std::vector<int> &ports = module.getInputPorts();
+	std::vector<std::vector<bool>> used(ports.size());
+	for (unsigned port = 0; port < ports.size(); port++)
+		used[port].resize(netlist.getNetWidth(ports[port]));
+
+	for (CodeBlock *code_block : module.getCodeBlocks())
+	{
+		for (int dataflow : code_block->getDataFlows())
+		{
+			DataFlow::Opcode opcode = netlist.getOpcode(dataflow);
+			if (opcode == DataFlow::OpcodeRegister ||
+					opcode == DataFlow::OpcodeRam ||
+					netlist.getNetWidth(netlist.getDest(dataflow)) > 64)
+				return false;
+			dataflows.push_back(dataflow);
+
+			// Sign extensions read the whole net
+			for (int index = 0; index < netlist.getNumOperands(dataflow);
+					index++)
+			{
+				int net = netlist.getOperand(dataflow, index);
+				auto it = std::find(ports.begin(), ports.end(), net);
+				if (it == ports.end())
+					continue;
+				std::vector<bool> &bits = used[it - ports.begin()];
+				int low = netlist.getOperandLow(dataflow, index);
+				int width = netlist.getOperandWidth(dataflow, index);
+				if (!width || opcode == DataFlow::OpcodeSext)
+				{
+					low = 0;
+					width = bits.size();
+				}
+				width = std::min(width, getBitsRead(netlist, dataflow, index));
+				for (int bit = low; bit < low + width &&
+						bit < (int) bits.size(); bit++)
+					bits[bit] = true;
+			}
+		}
+	}
+
+	// Address bits from the most significant bit of the first port
+	for (unsigned port = 0; port < ports.size(); port++)
+		for (int bit = used[port].size() - 1; bit >= 0; bit--)
+			if (used[port][bit])
+				address_bits.emplace_back(ports[port], bit);
+	return true;
+}
+
+
+unsigned long long TableGenerator::getOperandValue(int dataflow, int index)
+{
+	// Constants are printed as sized literals, except whole ones assigned
+	// to a net, which are plain numbers
+	int net = netlist.getOperand(dataflow, index);
+	int low = netlist.getOperandLow(dataflow, index);
+	int width = netlist.getOperandWidth(dataflow, index);
+	if (netlist.getNetKind(net) == Netlist::NetKindConstant)
+	{
+		long long value = netlist.getNetValue(net);
+		if (width)
+			return (low < 64 ? value >> low : value >> 63) & getMask(width);
+		if (netlist.getOpcode(dataflow) == DataFlow::OpcodeAssign)
+			return value;
+		return value & getMask(netlist.getNetWidth(net));
+	}
+
+	// Bits above the width of a net are zero
+	if (!width)
+		return values[net];
+	return low < 64 ? (values[net] >> low) & getMask(width) : 0;
+}
+
+
+void TableGenerator::evaluate(int dataflow)
+{
+	// Operands are unsigned and extended to the width of the expression,
+	// so the low bits of the result do not depend on that width
+	DataFlow::Opcode opcode = netlist.getOpcode(dataflow);
+	int dest = netlist.getDest(dataflow);
+	int num_operands = netlist.getNumOperands(dataflow);
+	unsigned long long result = num_operands ? getOperandValue(dataflow, 0) : 0;
+	switch (opcode)
+	{
+	case DataFlow::OpcodeAdd:
+		for (int index = 1; index < num_operands; index++)
+			result += getOperandValue(dataflow, index);
+		break;
+
+	case DataFlow::OpcodeSub:
+		for (int index = 1; index < num_operands; index++)
+			result -= getOperandValue(dataflow, index);
+		break;
+
+	case DataFlow::OpcodeMul:
+		for (int index = 1; index < num_operands; index++)
+			result *= getOperandValue(dataflow, index);
+		break;
+
+	case DataFlow::OpcodeXor:
+		for (int index = 1; index < num_operands; index++)
+			result ^= getOperandValue(dataflow, index);
+		break;
+
+	case DataFlow::OpcodeAnd:
+		for (int index = 1; index < num_operands; index++)
+			result &= getOperandValue(dataflow, index);
+		break;
+
+	case DataFlow::OpcodeOr:
+		for (int index = 1; index < num_operands; index++)
+			result |= getOperandValue(dataflow, index);
+		break;
+
+	case DataFlow::OpcodeLshr:
+	case DataFlow::OpcodeShl:
+	{
+		unsigned long long amount = getOperandValue(dataflow, 1);
+		if (amount >= 64)
+			result = 0;
+		else if (opcode == DataFlow::OpcodeLshr)
+			result >>= amount;
+		else
+			result <<= amount;
+		break;
+	}
+
+	case DataFlow::OpcodeEq:
+		result = result == getOperandValue(dataflow, 1);
+		break;
+
+	case DataFlow::OpcodeUgt:
+		result = result > getOperandValue(dataflow, 1);
+		break;
+
+	case DataFlow::OpcodeSext:
+	{
+		// The whole source is extended
+		int src = netlist.getOperand(dataflow, 0);
+		int width = netlist.getNetWidth(src);
+		if (netlist.getNetKind(src) != Netlist::NetKindConstant)
+			result = values[src];
+		if ((result >> (width - 1)) & 1)
+			result |= ~getMask(width);
+		break;
+	}
+
+	case DataFlow::OpcodeNot:
+		result = ~result;
+		break;
+
+	case DataFlow::OpcodeMux:
+		result = result ? getOperandValue(dataflow, 1) :
+				getOperandValue(dataflow, 2);
+		break;
+
+	case DataFlow::OpcodeMaj:
+	{
+		unsigned long long second = getOperandValue(dataflow, 1);
+		unsigned long long third = getOperandValue(dataflow, 2);
+		result = (result & second) | (result & third) | (second & third);
+		break;
+	}
+
+	case DataFlow::OpcodeConcat:
+	{
+		// Operands from the most significant one
+		result = 0;
+		int offset = 0;
+		for (int index = num_operands - 1; index >= 0 && offset < 64; index--)
+		{
+			int width = netlist.getOperandWidth(dataflow, index);
+			result |= getOperandValue(dataflow, index) << offset;
+			offset += width ? width : netlist.getNetWidth(
+					netlist.getOperand(dataflow, index));
+		}
+		break;
+	}
+
+	case DataFlow::OpcodeRom:
+	{
+		// Addresses past the words read the default zero
+		const std::vector<long long> &words = *netlist.getMemoryContents(
+				netlist.getOperand(dataflow, 0));
+		unsigned long long address = getOperandValue(dataflow, 1);
+		result = address < words.size() ? words[address] : 0;
+		break;
+	}
+
+	default:
+		break;
+	}
+	values[dest] = result & getMask(netlist.getNetWidth(dest));
+}
+
+
+long long TableGenerator::getArea(int dataflow)
+{
+	// Width of the widest operand, other than tables
+	DataFlow::Opcode opcode = netlist.getOpcode(dataflow);
+	int width = netlist.getNetWidth(netlist.getDest(dataflow));
+	int num_operands = netlist.getNumOperands(dataflow);
+	int operand_width = 1;
+	for (int index = 0; index < num_operands; index++)
+	{
+		int net = netlist.getOperand(dataflow, index);
+		if (netlist.getNetKind(net) == Netlist::NetKindMemory)
+			continue;
+		int slice_width = netlist.getOperandWidth(dataflow, index);
+		operand_width = std::max(operand_width, slice_width ? slice_width :
+				netlist.getNetWidth(net));
+	}
+
+	long long area = 0;
+	switch (opcode)
+	{
+	case DataFlow::OpcodeAdd:
+	case DataFlow::OpcodeSub:
+		return (long long) width * (num_operands - 1);
+
+	case DataFlow::OpcodeUgt:
+		return operand_width;
+
+	case DataFlow::OpcodeMul:
+		return ((long long) width * operand_width + 1) / 2;
+
+	case DataFlow::OpcodeEq:
+
+		// Three pairs of bits per LUT in the first level, and six LUTs per
+		// LUT in the next ones
+		area = (operand_width + 2) / 3;
+		for (int n = area; n > 1; area += n)
+			n = (n + 5) / 6;
+		return area;
+
+	case DataFlow::OpcodeLshr:
+	case DataFlow::OpcodeShl:
+
+		// A level of 4:1 multiplexers per two bits of the amount
+		area = width;
+		for (int n = 4; n < operand_width; n *= 4)
+			area += width;
+		return area;
+
+	case DataFlow::OpcodeXor:
+	case DataFlow::OpcodeAnd:
+	case DataFlow::OpcodeOr:
+	case DataFlow::OpcodeNot:
+	case DataFlow::OpcodeMux:
+	case DataFlow::OpcodeMaj:
+		return width;
+
+	case DataFlow::OpcodeRom:
+		return getTableArea(operand_width, width);
+
+	default:
+		return 0;
+	}
+}
+
+
+long long TableGenerator::getTableArea(int address_width, int width)
+{
+	// A LUT per 64 words, four of them combined by the multiplexers of a
+	// slice, and the groups of four by multiplexer LUTs
+	long long luts = address_width <= 6 ? 1 : 1LL << (address_width - 6);
+	long long area = luts;
+	for (long long n = luts / 4; n > 1; n = (n + 3) / 4)
+		area += n;
+	return area * width;
+}
+
+
+void TableGenerator::replace(const std::vector<long long> &words,
+		int width)
+{
+	for (int dataflow : dataflows)
+		netlist.removeDataFlow(dataflow);
+	for (CodeBlock *code_block : module.getCodeBlocks())
+		code_block->setDataFlows(std::vector<int>());
+	CodeBlock *code_block = module.getEntryCodeBlock();
+
+	// Constant output if all the words are the same
+	if (std::count(words.begin(), words.end(), words[0]) ==
+			(long long) words.size())
+	{
+		module.addDataFlow(code_block, DataFlow::OpcodeAssign,
+				module.getOutputPort(),
+				{ module.getConstant(words[0], width) });
+		return;
+	}
+
+	// Address made of the runs of consecutive bits of every port, or the
+	// port itself if it is read whole
+	std::vector<int> ports;
+	std::vector<std::pair<int, int>> slices;
+	for (unsigned index = 0; index < address_bits.size(); index++)
+	{
+		int port = address_bits[index].first;
+		int bit = address_bits[index].second;
+		if (!ports.empty() && ports.back() == port &&
+				slices.back().first == bit + 1)
+		{
+			slices.back().first = bit;
+			slices.back().second++;
+			continue;
+		}
+		ports.push_back(port);
+		slices.emplace_back(bit, 1);
+	}
+	int address = ports[0];
+	if (ports.size() > 1 || slices[0].first ||
+			slices[0].second != netlist.getNetWidth(ports[0]))
+	{
+		address = netlist.addWire(address_bits.size());
+		int concat = netlist.addDataFlow(DataFlow::OpcodeConcat, address,
+				ports);
+		for (unsigned index = 0; index < slices.size(); index++)
+			netlist.setOperandSlice(concat, index, slices[index].first,
+					slices[index].second);
+		code_block->addDataFlow(concat);
+	}
+
+	// Table read into a wire, zero-extended to the output
+	int memory = netlist.addMemory(width, words.size());
+	netlist.setMemoryContents(memory, words);
+	int data = netlist.addWire(width);
+	module.addDataFlow(code_block, DataFlow::OpcodeRom, data,
+			{ memory, address });
+	module.addDataFlow(code_block, DataFlow::OpcodeAssign,
+			module.getOutputPort(), { data });
+}
+
+
+bool TableGenerator::run(int num_inputs, bool force)
+{
+	int output = module.getOutputPort();
+	num_inputs = std::min(num_inputs, max_inputs);
+	if (num_inputs <= 0 || module.getStartPort() >= 0 ||
+			module.getClockPort() >= 0 || output < 0 ||
+			netlist.getNetWidth(output) > 64 || !findAddressBits() ||
+			address_bits.empty() || (int) address_bits.size() > num_inputs)
+		return false;
+
+	// Output for every address, with the bits not read cleared
+	int address_width = address_bits.size();
+	std::vector<long long> words(1LL << address_width);
+	values.assign(netlist.getNumNets(), 0);
+	for (long long address = 0; address < (long long) words.size(); address++)
+	{
+		for (int index = 0; index < address_width; index++)
+		{
+			int port = address_bits[index].first;
+			int bit = address_bits[index].second;
+			unsigned long long mask = 1ULL << bit;
+			if ((address >> (address_width - 1 - index)) & 1)
+				values[port] |= mask;
+			else
+				values[port] &= ~mask;
+		}
+		for (int dataflow : dataflows)
+			evaluate(dataflow);
+		words[address] = values[output];
+	}
+
+	// Bits needed by the largest word, and bits varying between words,
+	// the only ones needing logic
+	unsigned long long ones = 0;
+	unsigned long long zeros = 0;
+	for (long long word : words)
+	{
+		ones |= word;
+		zeros |= ~word;
+	}
+	int width = 1;
+	while (width < 64 && (ones >> width))
+		width++;
+	int num_varying = 0;
+	for (unsigned long long varying = ones & zeros & getMask(width); varying;
+			varying &= varying - 1)
+		num_varying++;
+
+	// Area and longest path of the operators
+	long long area = 0;
+	std::vector<double> arrival(netlist.getNumNets());
+	double delay = 0;
+	for (int dataflow : dataflows)
+	{
+		area += getArea(dataflow);
+		double start = 0;
+		for (int index = 0; index < netlist.getNumOperands(dataflow); index++)
+			start = std::max(start, arrival[netlist.getOperand(dataflow, index)]);
+		int dest = netlist.getDest(dataflow);
+		arrival[dest] = start + Pipeliner::getDelay(netlist, dataflow);
+		delay = std::max(delay, arrival[dest]);
+	}
+	long long table_area = getTableArea(address_width, num_varying);
+	double table_delay = num_varying ? Pipeliner::getDelay(
+			DataFlow::OpcodeRom, width, address_width) : 0;
+	if (!force && table_area * table_delay >= area * delay)
+		return false;
+
+	replace(words, width);
+	statistics.num_tables++;
+
+	std::ostringstream os;
+	os << std::fixed << std::setprecision(2);
+	os << "truth table of " << address_width << " input bits, "
+			<< words.size() << " words of " << width << " bits: "
+			<< table_area << " LUTs, " << table_delay << " ns, instead of "
+			<< area << " LUTs, " << delay << " ns";
+	module.addComment(os.str());
+	return true;
+}
+
+}
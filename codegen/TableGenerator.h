@@ -0,0 +1,99 @@
+/**
+ * @file   TableGenerator.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  TableGenerator class replaces the combinational netlist of a
+ *         verilog module reading few input bits with a truth table.
+ */
+
+#ifndef VERILOG_TABLE_GENERATOR_H
+#define VERILOG_TABLE_GENERATOR_H
+
+#include <utility>
+#include <vector>
+
+
+namespace verilog
+{
+
+// Forward declarations
+class Module;
+class Netlist;
+struct OptimizerStatistics;
+
+
+// A combinational module whose output only depends on a few bits of its
+// input ports, such as a decoder or a saturating lookup, is evaluated at
+// compile time for every value of these bits. The input bits read by the
+// netlist, concatenated in port order, become the address of a lookup
+// table holding the output for every address, which replaces all the
+// operators of the module, or a constant if all its words are the same.
+//
+// The table is used when the product of its area and delay is smaller
+// than the one of the operators it replaces, or always if option
+// '-verilog-table-force' is given. Areas are counted in 6-input LUTs: a
+// LUT per bit of bitwise operators, additions, comparisons and
+// multiplexers, a tree of LUTs for equalities and shifts, half a LUT per
+// partial product bit of multiplications, and a LUT per 64 words and bit
+// of lookup tables, with a multiplexer LUT per four LUTs beyond the
+// multiplexers of the slices. Delays are the ones of the pipeliner.
+class TableGenerator
+{
+	// Module being replaced
+	Module &module;
+	Netlist &netlist;
+
+	// Counters
+	OptimizerStatistics &statistics;
+
+	// Dataflows in code block order
+	std::vector<int> dataflows;
+
+	// Input bits read by the netlist, as pairs of port and bit, from the
+	// most significant bit of the address
+	std::vector<std::pair<int, int>> address_bits;
+
+	// Value of every net for the address being evaluated, with the bits
+	// above its width cleared
+	std::vector<unsigned long long> values;
+
+	// Find the input bits read by the dataflows. Return false if the
+	// module is not combinational, or has nets wider than 64 bits.
+	bool findAddressBits();
+
+	// Return the value of an operand of a dataflow, as printed
+	unsigned long long getOperandValue(int dataflow, int index);
+
+	// Compute the value of the destination of a dataflow
+	void evaluate(int dataflow);
+
+	// Return the area of a dataflow in LUTs
+	long long getArea(int dataflow);
+
+	// Add the table and the dataflows reading it, replacing all the
+	// dataflows of the module
+	void replace(const std::vector<long long> &words, int width);
+
+public:
+
+	// Largest number of input bits of a table, which has a word for
+	// every value of these bits
+	static const int max_inputs = 16;
+
+	// Constructor
+	TableGenerator(Module &module, OptimizerStatistics &statistics);
+
+	// Return the area in LUTs of a lookup table with the given address
+	// and word widths
+	static long long getTableArea(int address_width, int width);
+
+	// Replace the module with a truth table if it reads at most
+	// 'num_inputs' input bits, and the table wins or 'force' is set. Tables
+	// never read more than 'max_inputs' bits. Return whether it was
+	// replaced.
+	bool run(int num_inputs, bool force);
+};
+
+}
+
+#endif
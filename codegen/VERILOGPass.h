@@ -0,0 +1,145 @@
+/**
+ * @file   VERILOGPass.h
+ * @Author Rafael Ubal (ubal@ece.neu.edu), Northeastern University
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This class declares the verilog code generation pass.
+ */
+
+#ifndef VERILOG_PASS_H
+#define VERILOG_PASS_H
+
+#include "llvm/Pass.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+
+#include <iostream>
+#include <memory>
+
+#include "DataFlow.h"
+#include "Emitter.h"
+#include "Module.h"
+#include "Optimizer.h"
+#include "Sink.h"
+
+
+namespace verilog
+{
+
+// Forward declarations
+class CodeBlock;
+class DividerGenerator;
+class IfConverter;
+class MemoryMapper;
+class StateMachine;
+
+
+class VERILOGPass : public llvm::FunctionPass
+{
+	// Sink opened by the pass itself, when not given by the caller
+	std::unique_ptr<verilog::Sink> own_sink;
+
+	// Emitter printing the generated verilog code
+	verilog::Emitter emitter;
+
+	// Size of the verilog IR, added over all translated functions
+	verilog::ModuleStatistics statistics;
+
+	// Number of translated functions
+	unsigned num_functions = 0;
+
+	// Netlist optimization counters, added over all translated functions
+	verilog::OptimizerStatistics optimizer_statistics;
+
+public:
+	
+	// Identifier
+	static char ID;
+
+	// verilog module
+	verilog::Module *verilog_module = nullptr;
+
+	// If-conversion of the function being translated
+	verilog::IfConverter *if_converter = nullptr;
+
+	// State machine of the function being translated, if it has loops
+	verilog::StateMachine *state_machine = nullptr;
+
+	// Dividers of the function being translated
+	verilog::DividerGenerator *divider_generator = nullptr;
+
+	// Arrays of the function being translated
+	verilog::MemoryMapper *memory_mapper = nullptr;
+
+	// Constructor. The first argument of the parent constructor is
+	// a unique pass identifier. Verilog code is printed to the file
+	// given with option '-verilog-output', or to the standard output.
+	VERILOGPass();
+
+	// Constructor used by the compile driver, printing verilog code
+	// to the given sink.
+	VERILOGPass(verilog::Sink &sink) : llvm::FunctionPass(ID), emitter(sink) { }
+
+	// Destructor, releasing the objects of a function whose translation
+	// was interrupted by an error
+	~VERILOGPass();
+
+	// Virtual function overridden to restart net numbering
+	// for every LLVM module.
+	bool doInitialization(llvm::Module &llvm_module) override;
+
+	// Virtual function overridden to flush the output, and report the
+	// netlist optimizations if requested
+	bool doFinalization(llvm::Module &llvm_module) override;
+
+	// Virtual function overridden to implement the pass functionality.
+	bool runOnFunction(llvm::Function &llvm_function) override;
+
+	void TranslateBasicBlock(llvm::BasicBlock *llvm_basic_block,
+			verilog::CodeBlock *verilog_code_block);
+
+	void TranslateInstruction(llvm::Instruction *llvm_instruction,
+			verilog::CodeBlock *verilog_code_block);
+
+	// Translate an LLVM instruction with two operands into a dataflow
+	// with the given opcode.
+	void TranslateBinary(llvm::Instruction *llvm_instruction,
+			verilog::CodeBlock *verilog_code_block,
+			verilog::DataFlow::Opcode opcode);
+
+	// Translate an LLVM integer comparison into an equality or unsigned
+	// greater than dataflow.
+	void TranslateCompare(llvm::ICmpInst *icmp_instruction,
+			verilog::CodeBlock *verilog_code_block);
+
+	// Translate an LLVM multiplication. Multiplications by a constant
+	// are reduced to shifts and additions.
+	void TranslateMultiply(llvm::Instruction *llvm_instruction,
+			verilog::CodeBlock *verilog_code_block);
+
+	// Translate an LLVM division, or remainder if 'remainder' is true.
+	// Divisions by a constant are reduced to multiplications, and other
+	// ones get a divider.
+	void TranslateDivide(llvm::Instruction *llvm_instruction,
+			verilog::CodeBlock *verilog_code_block,
+			bool is_signed, bool remainder);
+
+	// Return the size of the verilog IR of all translated functions
+	const verilog::ModuleStatistics &getStatistics() { return statistics; }
+
+	// Return the number of translated functions
+	unsigned getNumFunctions() { return num_functions; }
+
+	// Return the netlist optimization counters of all translated functions
+	const verilog::OptimizerStatistics &getOptimizerStatistics()
+	{
+		return optimizer_statistics;
+	}
+
+	// Return the emitter, counting the characters written
+	const verilog::Emitter &getEmitter() { return emitter; }
+};
+
+}
+
+#endif
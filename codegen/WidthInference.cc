@@ -0,0 +1,486 @@
+/**
+ * @file   WidthInference.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  This file defines the bit-width inference of verilog modules.
+ */
+
+#include <algorithm>
+
+#include "Bits.h"
+#include "CodeBlock.h"
+#include "Module.h"
+#include "Netlist.h"
+#include "Optimizer.h"
+#include "WidthInference.h"
+
+
+namespace verilog
+{
+
+WidthInference::WidthInference(Module &module, OptimizerStatistics &statistics) :
+		module(module),
+		netlist(module.getNetlist()),
+		statistics(statistics)
+{
+}
+
+
+void WidthInference::initializeNet(int net)
+{
+	int width = original_width[net];
+	zero_width[net] = width;
+	sign_width[net] = width;
+	if (netlist.getNetKind(net) != Netlist::NetKindConstant)
+		return;
+
+	// Constants, whose value is taken from its low 'width' bits
+	unsigned long long bits = truncate(netlist.getNetValue(net), width);
+	long long value = signExtend(bits, width);
+	zero_width[net] = std::min(width, getNumBits(bits));
+	sign_width[net] = std::min(width, getNumBits(value < 0 ? ~value : value) + 1);
+}
+
+
+void WidthInference::getOperandWidths(int dataflow, int index, int &zero,
+		int &sign)
+{
+	int src = netlist.getOperand(dataflow, index);
+	int low = netlist.getOperandLow(dataflow, index);
+	int width = netlist.getOperandWidth(dataflow, index);
+	zero = zero_width[src];
+	sign = sign_width[src];
+
+	// Bits of a slice above the zero width of its net are zero
+	if (width)
+	{
+		zero = std::min(width, std::max(1, zero - low));
+		sign = std::min(width, zero + 1);
+	}
+
+	// Operands narrower than the dataflow are zero-extended by verilog,
+	// so their sign bit is not copied above them.
+	if ((width ? width : original_width[src]) <
+			original_width[netlist.getDest(dataflow)])
+		sign = zero + 1;
+}
+
+
+int WidthInference::getConcatOperandWidth(int dataflow, int index, int &offset)
+{
+	// Operands have fixed widths, and the last one is the least
+	// significant.
+	offset = 0;
+	int num_operands = netlist.getNumOperands(dataflow);
+	for (int other = index + 1; other < num_operands; other++)
+	{
+		int width = netlist.getOperandWidth(dataflow, other);
+		offset += width ? width : original_width[netlist.getOperand(
+				dataflow, other)];
+	}
+	int width = netlist.getOperandWidth(dataflow, index);
+	return width ? width : original_width[netlist.getOperand(dataflow, index)];
+}
+
+
+void WidthInference::computeForward(int dataflow)
+{
+	int dest = netlist.getDest(dataflow);
+	int width = original_width[dest];
+	int zero = width;
+	int sign = width;
+
+	// Widths of the first two operands
+	int num_operands = netlist.getNumOperands(dataflow);
+	int src2 = num_operands > 1 ? netlist.getOperand(dataflow, 1) : -1;
+	int zero1 = 0, sign1 = 0, zero2 = 0, sign2 = 0;
+	if (num_operands > 0)
+		getOperandWidths(dataflow, 0, zero1, sign1);
+	if (num_operands > 1)
+		getOperandWidths(dataflow, 1, zero2, sign2);
+
+	switch (netlist.getOpcode(dataflow))
+	{
+	case DataFlow::OpcodeAssign:
+		zero = zero1;
+		sign = sign1;
+		break;
+
+	case DataFlow::OpcodeAdd:
+		zero = std::max(zero1, zero2) + 1;
+		sign = std::max(sign1, sign2) + 1;
+		break;
+
+	case DataFlow::OpcodeSub:
+		sign = std::max(sign1, sign2) + 1;
+		break;
+
+	case DataFlow::OpcodeMul:
+		zero = zero1 + zero2;
+		sign = sign1 + sign2;
+		break;
+
+	case DataFlow::OpcodeAnd:
+		zero = std::min(zero1, zero2);
+		sign = std::max(sign1, sign2);
+		break;
+
+	case DataFlow::OpcodeOr:
+	case DataFlow::OpcodeXor:
+	case DataFlow::OpcodeMaj:
+
+		// Bitwise logic of any number of operands
+		zero = std::max(zero1, zero2);
+		sign = std::max(sign1, sign2);
+		for (int index = 2; index < num_operands; index++)
+		{
+			int zero3, sign3;
+			getOperandWidths(dataflow, index, zero3, sign3);
+			zero = std::max(zero, zero3);
+			sign = std::max(sign, sign3);
+		}
+		break;
+
+	case DataFlow::OpcodeNot:
+		sign = sign1;
+		break;
+
+	case DataFlow::OpcodeSext:
+
+	{
+		// High bits copy the sign bit of the operand, which is not
+		// zero-extended, and may be set unless its value is.
+		int src = netlist.getOperand(dataflow, 0);
+		sign = sign_width[src];
+		if (zero1 < original_width[src])
+			zero = zero1;
+		break;
+	}
+
+	case DataFlow::OpcodeMux:
+	{
+		// Either value
+		int zero3, sign3;
+		getOperandWidths(dataflow, 2, zero3, sign3);
+		zero = std::max(zero2, zero3);
+		sign = std::max(sign2, sign3);
+		break;
+	}
+
+	case DataFlow::OpcodeLshr:
+	{
+		// Shift by a constant drops its low bits. Any shift other than
+		// zero fills the high bits with zeros.
+		long long amount;
+		bool constant = netlist.getConstant(src2, amount);
+		zero = zero1;
+		sign = sign1;
+		if (constant && (amount < 0 || amount >= width))
+			zero = 1;
+		else if (constant && amount > 0)
+			zero = std::max(1, zero - (int) amount);
+		if (!constant || amount != 0)
+			sign = zero + 1;
+		break;
+	}
+
+	case DataFlow::OpcodeShl:
+	{
+		// Shift by a constant adds as many low zero bits
+		long long amount;
+		if (netlist.getConstant(src2, amount) && amount >= 0 && amount < width)
+		{
+			zero = zero1 + amount;
+			sign = sign1 + amount;
+		}
+		break;
+	}
+
+	case DataFlow::OpcodeConcat:
+	{
+		// Highest bit that can be set by an operand other than a zero
+		// constant
+		zero = 1;
+		for (int index = 0; index < num_operands; index++)
+		{
+			int offset;
+			int src = netlist.getOperand(dataflow, index);
+			getConcatOperandWidth(dataflow, index, offset);
+			if (netlist.getNetKind(src) == Netlist::NetKindConstant &&
+					!netlist.getNetValue(src))
+				continue;
+			int src_zero, src_sign;
+			getOperandWidths(dataflow, index, src_zero, src_sign);
+			zero = std::max(zero, offset + src_zero);
+		}
+		sign = zero + 1;
+		break;
+	}
+
+	case DataFlow::OpcodeRom:
+	{
+		// Widest word of the table, stored sign-extended
+		zero = 1;
+		sign = 1;
+		for (long long word : *netlist.getMemoryContents(
+				netlist.getOperand(dataflow, 0)))
+		{
+			unsigned long long bits = word;
+			if (width < 64)
+				bits &= (1ULL << width) - 1;
+			zero = std::max(zero, getNumBits(bits));
+			sign = std::max(sign, getNumBits(word < 0 ? ~word : word) + 1);
+		}
+		break;
+	}
+
+	default:
+		break;
+	}
+
+	// A value zero-extended from 'zero' bits is also sign-extended from
+	// one more bit.
+	zero = std::min(zero, width);
+	sign = std::min(std::min(sign, zero + 1), width);
+	zero_width[dest] = zero;
+	sign_width[dest] = sign;
+}
+
+
+void WidthInference::computeBackward(int dataflow)
+{
+	// Bits demanded from the destination. Ports keep their width.
+	int dest = netlist.getDest(dataflow);
+	int demanded = netlist.getNetKind(dest) == Netlist::NetKindWire ?
+			std::max(1, demanded_width[dest]) : original_width[dest];
+
+	int num_operands = netlist.getNumOperands(dataflow);
+	for (int index = 0; index < num_operands; index++)
+	{
+		int src = netlist.getOperand(dataflow, index);
+		int src_demanded = original_width[src];
+		long long value;
+
+		switch (netlist.getOpcode(dataflow))
+		{
+		case DataFlow::OpcodeAssign:
+		case DataFlow::OpcodeAdd:
+		case DataFlow::OpcodeSub:
+		case DataFlow::OpcodeMul:
+		case DataFlow::OpcodeOr:
+		case DataFlow::OpcodeXor:
+		case DataFlow::OpcodeMaj:
+		case DataFlow::OpcodeNot:
+		case DataFlow::OpcodeSext:
+
+			// Low bits of the result only depend on low bits of the
+			// operands
+			src_demanded = demanded;
+			break;
+
+		case DataFlow::OpcodeMux:
+
+			// The select is needed in full
+			if (index > 0)
+				src_demanded = demanded;
+			break;
+
+		case DataFlow::OpcodeAnd:
+		{
+			// Bits cleared by a constant mask are not demanded
+			int other = netlist.getOperand(dataflow, 1 - index);
+			src_demanded = demanded;
+			if (netlist.getConstant(other, value))
+				src_demanded = std::min(demanded, zero_width[other]);
+			break;
+		}
+
+		case DataFlow::OpcodeLshr:
+
+			// A shift by a constant needs as many more bits
+			if (index == 0 && netlist.getConstant(netlist.getOperand(dataflow, 1),
+					value) && value >= 0 && value < original_width[src])
+				src_demanded = demanded + value;
+			break;
+
+		case DataFlow::OpcodeShl:
+
+			// Low bits of the result only depend on low bits of the
+			// shifted operand
+			if (index == 0)
+				src_demanded = demanded;
+			break;
+
+		case DataFlow::OpcodeConcat:
+		{
+			// Bits of the operand below the demanded bits of the result
+			int offset;
+			int width = getConcatOperandWidth(dataflow, index, offset);
+			src_demanded = std::min(width, std::max(0, demanded - offset));
+			break;
+		}
+
+		default:
+			break;
+		}
+
+		// A slice demands the bits above its lowest bit
+		int low = netlist.getOperandLow(dataflow, index);
+		int width = netlist.getOperandWidth(dataflow, index);
+		if (width)
+			src_demanded = src_demanded > 0 ?
+					low + std::min(src_demanded, width) : 0;
+
+		src_demanded = std::min(src_demanded, original_width[src]);
+		demanded_width[src] = std::max(demanded_width[src], src_demanded);
+	}
+}
+
+
+int WidthInference::getRequiredWidth(int dataflow, int index)
+{
+	int dest = netlist.getDest(dataflow);
+	int src = netlist.getOperand(dataflow, index);
+	long long value;
+
+	// All bits of a slice are needed
+	int width = netlist.getOperandWidth(dataflow, index);
+	if (width)
+		return std::min(original_width[src],
+				netlist.getOperandLow(dataflow, index) + width);
+
+	switch (netlist.getOpcode(dataflow))
+	{
+	case DataFlow::OpcodeShl:
+		if (index == 0)
+			return netlist.getNetWidth(dest);
+		return original_width[src];
+
+	case DataFlow::OpcodeAssign:
+	case DataFlow::OpcodeAdd:
+	case DataFlow::OpcodeSub:
+	case DataFlow::OpcodeMul:
+	case DataFlow::OpcodeAnd:
+	case DataFlow::OpcodeOr:
+	case DataFlow::OpcodeXor:
+	case DataFlow::OpcodeMaj:
+	case DataFlow::OpcodeNot:
+		return netlist.getNetWidth(dest);
+
+	case DataFlow::OpcodeMux:
+		if (index > 0)
+			return netlist.getNetWidth(dest);
+		return original_width[src];
+
+	case DataFlow::OpcodeLshr:
+		if (index == 0 && netlist.getConstant(netlist.getOperand(dataflow, 1),
+				value) && value >= 0 && value < original_width[src])
+			return std::min(original_width[src],
+					netlist.getNetWidth(dest) + (int) value);
+		return original_width[src];
+
+	default:
+		return original_width[src];
+	}
+}
+
+
+int WidthInference::getSignExtension(int net, int width, std::vector<int> &list)
+{
+	auto key = std::make_pair(net, width);
+	auto it = sign_extensions.find(key);
+	if (it != sign_extensions.end())
+		return it->second;
+
+	// Emit 'assign dest = {{n{net[msb]}}, net};'
+	int dest = netlist.addWire(width);
+	list.push_back(netlist.addDataFlow(DataFlow::OpcodeSext, dest, { net }));
+	sign_extensions[key] = dest;
+	statistics.num_sign_extensions++;
+	statistics.num_wire_bits_saved -= width;
+	return dest;
+}
+
+
+void WidthInference::run()
+{
+	// Dataflows in code block order
+	for (CodeBlock *code_block : module.getCodeBlocks())
+		for (int dataflow : code_block->getDataFlows())
+			dataflows.push_back(dataflow);
+
+	// Nets not computed by dataflows
+	int num_nets = netlist.getNumNets();
+	original_width.resize(num_nets);
+	zero_width.resize(num_nets);
+	sign_width.resize(num_nets);
+	demanded_width.resize(num_nets);
+	sign_extended.resize(num_nets);
+	for (int net = 0; net < num_nets; net++)
+	{
+		original_width[net] = netlist.getNetWidth(net);
+		initializeNet(net);
+	}
+
+	// Forward and backward analyses. Nets are defined before they are
+	// used in the code block order.
+	for (int dataflow : dataflows)
+		computeForward(dataflow);
+	for (auto it = dataflows.rbegin(); it != dataflows.rend(); ++it)
+		computeBackward(*it);
+
+	// Narrow internal wires
+	size_t num_wire_bits = 0;
+	long long num_wire_bits_saved = 0;
+	for (int dataflow : dataflows)
+	{
+		int net = netlist.getDest(dataflow);
+		if (netlist.getNetKind(net) != Netlist::NetKindWire)
+			continue;
+
+		// Wires assigned a constant have no logic to narrow, so they
+		// are never sign-extended.
+		long long value;
+		int demanded = std::max(1, demanded_width[net]);
+		int width = std::min(zero_width[net], sign_width[net]);
+		if (netlist.getConstant(net, value))
+			width = zero_width[net];
+		if (width <= demanded)
+			sign_extended[net] = width < zero_width[net];
+		else
+			width = demanded;
+		num_wire_bits += original_width[net];
+		num_wire_bits_saved += original_width[net] - width;
+		netlist.setNetWidth(net, width);
+	}
+	statistics.num_modules++;
+	statistics.num_wire_bits += num_wire_bits;
+	statistics.num_wire_bits_saved += num_wire_bits_saved;
+
+	// Sign-extend narrowed operands where more bits are needed, up to
+	// their original width. Bits above it were zero-extended. The
+	// extension is added before the first dataflow using it.
+	for (CodeBlock *code_block : module.getCodeBlocks())
+	{
+		std::vector<int> list;
+		for (int dataflow : code_block->getDataFlows())
+		{
+			int num_operands = netlist.getNumOperands(dataflow);
+			for (int index = 0; index < num_operands; index++)
+			{
+				int src = netlist.getOperand(dataflow, index);
+				if (src >= num_nets || !sign_extended[src])
+					continue;
+				int width = std::min(getRequiredWidth(dataflow, index),
+						original_width[src]);
+				if (width > netlist.getNetWidth(src))
+					netlist.setOperand(dataflow, index,
+							getSignExtension(src, width, list));
+			}
+			list.push_back(dataflow);
+		}
+		code_block->setDataFlows(std::move(list));
+	}
+}
+
+}
@@ -0,0 +1,100 @@
+/**
+ * @file   WidthInference.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  WidthInference class gives every internal wire of a verilog module
+ *         the minimal width that preserves the value of the output port.
+ */
+
+#ifndef VERILOG_WIDTH_INFERENCE_H
+#define VERILOG_WIDTH_INFERENCE_H
+
+#include <map>
+#include <utility>
+#include <vector>
+
+
+namespace verilog
+{
+
+// Forward declarations
+class Module;
+class Netlist;
+struct OptimizerStatistics;
+
+
+// Widths are computed by two analyses over the netlist. The forward
+// analysis finds, for every net, the number of low bits whose zero
+// extension gives the value of the net ('zero_width'), and the number of
+// low bits whose sign extension gives it ('sign_width'). The backward
+// analysis finds the number of low bits demanded by the users of the net
+// ('demanded_width'). A wire keeps the smallest of the first two widths
+// if it does not exceed the demanded width, and is truncated to the
+// demanded width otherwise.
+//
+// All wires are unsigned, so verilog zero-extends narrow operands inside
+// expressions. Wires narrowed to their sign width are extended with an
+// explicit sign extension dataflow where more bits are needed.
+class WidthInference
+{
+	// Module being optimized
+	Module &module;
+	Netlist &netlist;
+
+	// Counters
+	OptimizerStatistics &statistics;
+
+	// Width of every net before inference
+	std::vector<int> original_width;
+
+	// Results of the analyses, per net
+	std::vector<int> zero_width;
+	std::vector<int> sign_width;
+	std::vector<int> demanded_width;
+
+	// Nets holding a sign-extended value, per net
+	std::vector<bool> sign_extended;
+
+	// Dataflows in code block order
+	std::vector<int> dataflows;
+
+	// Sign extensions already created, indexed by net and width
+	std::map<std::pair<int, int>, int> sign_extensions;
+
+	// Initialize the widths of a net that is not computed by a dataflow
+	void initializeNet(int net);
+
+	// Return the widths of an operand of a dataflow, which may be a
+	// slice of its net.
+	void getOperandWidths(int dataflow, int index, int &zero, int &sign);
+
+	// Return the width of an operand of a concatenation, and the
+	// position of its lowest bit in the result in 'offset'.
+	int getConcatOperandWidth(int dataflow, int index, int &offset);
+
+	// Compute the widths of the destination of a dataflow
+	void computeForward(int dataflow);
+
+	// Add the bits demanded by a dataflow to its operands
+	void computeBackward(int dataflow);
+
+	// Return the number of low bits of an operand that a dataflow needs
+	// once widths have been narrowed.
+	int getRequiredWidth(int dataflow, int index);
+
+	// Return a wire holding the sign extension of a net to the given
+	// width, adding its dataflow to 'list' the first time.
+	int getSignExtension(int net, int width, std::vector<int> &list);
+
+public:
+
+	// Constructor
+	WidthInference(Module &module, OptimizerStatistics &statistics);
+
+	// Narrow all internal wires of the module
+	void run();
+};
+
+}
+
+#endif
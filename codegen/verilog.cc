@@ -7,187 +7,412 @@
  */
 
 #include "llvm/Pass.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/CFG.h"
+#include "llvm/Support/CommandLine.h"
 
 #include "CodeBlock.h"
 #include "Module.h"
 #include "DataFlow.h"
+#include "DividerGenerator.h"
+#include "Error.h"
+#include "IfConverter.h"
+#include "LoopUnroller.h"
+#include "MemoryMapper.h"
+#include "Optimizer.h"
+#include "StateMachine.h"
+#include "StrengthReducer.h"
+#include "VERILOGPass.h"
 
 #include <iostream>
+#include <utility>
+#include <vector>
 
 
-namespace
+namespace verilog
 {
 
-class VERILOGPass : public llvm::FunctionPass
+static llvm::cl::opt<std::string> VerilogOutput("verilog-output",
+		llvm::cl::desc("Write verilog code to <file> instead of the standard output"),
+		llvm::cl::value_desc("file"));
+
+static llvm::cl::opt<bool> VerilogOptStats("verilog-opt-stats",
+		llvm::cl::desc("Report the netlist optimizations on the standard error"));
+
+
+VERILOGPass::VERILOGPass() :
+		llvm::FunctionPass(ID),
+		own_sink(new verilog::FileSink(VerilogOutput.empty() ?
+				std::string("-") : std::string(VerilogOutput))),
+		emitter(*own_sink)
 {
-public:
-	
-	// Identifier
-	static char ID;
+}
 
-	// verilog module
-	verilog::Module *verilog_module;
-        
-	verilog::Wire *verilog_result = new verilog::Wire("result", verilog::Wire::DirectionOutput);
 
-	std::string widthStr = "";
-	// Constructor. The first argument of the parent constructor is
-	// a unique pass identifier.
-	VERILOGPass() : llvm::FunctionPass(ID) { }
+VERILOGPass::~VERILOGPass()
+{
+	delete divider_generator;
+	delete memory_mapper;
+	delete if_converter;
+	delete state_machine;
+	delete verilog_module;
+}
 
-	// Virtual function overridden to implement the pass functionality.
-	bool runOnFunction(llvm::Function &llvm_function) override;
 
-	void TranslateBasicBlock(llvm::BasicBlock *llvm_basic_block,
-			verilog::CodeBlock *verilog_code_block);
+bool VERILOGPass::doInitialization(llvm::Module &llvm_module)
+{
+	verilog::Netlist::resetNumbering();
 
-	void TranslateInstruction(llvm::Instruction *llvm_instruction,
-			verilog::CodeBlock *verilog_code_block);
-};
+	// Module was not modified
+	return false;
+}
+
+
+bool VERILOGPass::doFinalization(llvm::Module &llvm_module)
+{
+	if (VerilogOptStats)
+		optimizer_statistics.dump(std::cerr);
+	if (own_sink)
+		own_sink->flush();
+
+	// Module was not modified
+	return false;
+}
 
 
 bool VERILOGPass::runOnFunction(llvm::Function &llvm_function)
 {
 	// Create VERILOG module
-	verilog_module = new verilog::Module();
+	verilog_module = new verilog::Module(llvm_function.getName());
 
 	// Add 'entry' code block
 	verilog::CodeBlock *verilog_entry_code_block = verilog_module->getEntryCodeBlock();
 	
-	// Emit "module <llvmfuncname> (ports);"
-	verilog::DataFlow *verilog_portliststart = new verilog::DataFlow(verilog::DataFlow::OpcodePortListStart);
-        verilog::Wire *verilog_wire = new verilog::Wire(llvm_function.getName(), verilog::Wire::DirectionInvalid);
-	verilog_portliststart->addArgument(verilog_wire);
-	verilog_entry_code_block->addDataFlow(verilog_portliststart);
-
+	// Module ports "module <llvmfuncname> (ports);"
 	for (auto& functionArgument : llvm_function.getArgumentList())
 	{
 		// Wire support, add register support later
-	        verilog::DataFlow *verilog_dataflow = new verilog::DataFlow(verilog::DataFlow::OpcodeInputPortDefine);
-                verilog::Wire *verilog_wire = new verilog::Wire(functionArgument.getName(), verilog::Wire::DirectionInput);
-		llvm::Type *type = functionArgument.getType();	
-		if (type->isIntegerTy(32))
-		{
-			verilog_wire->setWidth(32);	
-		}
-		else if (type->isIntegerTy(16))
-		{
-			verilog_wire->setWidth(16);	
-		}
-		else if (type->isIntegerTy(8))
-		{
-			verilog_wire->setWidth(8);	
-		}
-		else if (type->isIntegerTy(1))
-		{
-			verilog_wire->setWidth(1);	
-		}
-		else
-		{
-			std::cerr << "Unsupported type in function arguments\n";
-			exit(1);
-		}
-		verilog_module->WireAddSymbol(functionArgument.getName(), verilog_wire);
-		verilog_dataflow->addArgument(verilog_wire);
-	        verilog_entry_code_block->addDataFlow(verilog_dataflow);
+		int width = verilog::Module::translateLLVMType(
+				functionArgument.getType(), "function arguments");
+		int verilog_net = verilog_module->addInputPort(
+				functionArgument.getName(), width);
+		verilog_module->addSymbol(&functionArgument, verilog_net);
 	}
-	
-        verilog::DataFlow *verilog_dataflow_out = new verilog::DataFlow(verilog::DataFlow::OpcodeOutputPortDefine);
-		llvm::Type *type = llvm_function.getReturnType();	
-		if (type->isIntegerTy(32))
-		{
-			verilog_result->setWidth(32);	
-		}
-		else if (type->isIntegerTy(16))
-		{
-			verilog_result->setWidth(16);	
-		}
-		else if (type->isIntegerTy(8))
-		{
-			verilog_result->setWidth(8);	
-		}
-		else if (type->isIntegerTy(1))
-		{
-			verilog_result->setWidth(1);	
-		}
-		else
-		{
-			std::cerr << "Unsupported type in function arguments\n";
-			exit(1);
-		}
-	verilog_dataflow_out->addArgument(verilog_result);
-        verilog_entry_code_block->addDataFlow(verilog_dataflow_out);
-
-	//wrap up the module port list ");"
-	verilog::DataFlow *verilog_portlistend = new verilog::DataFlow(verilog::DataFlow::OpcodePortListEnd);
-	verilog_entry_code_block->addDataFlow(verilog_portlistend);
+	verilog_module->setOutputPort("result",
+			verilog::Module::translateLLVMType(
+			llvm_function.getReturnType(), "function arguments"));
 	
 	verilog_module->addCodeBlock(verilog_entry_code_block);
 
-	// Create all basic blocks
-	for (llvm::Function::iterator llvm_basic_block = llvm_function.begin(),
-			e = llvm_function.end();
-			llvm_basic_block != e;
-			++llvm_basic_block)
+	// Unroll the loops with a constant trip count
+	verilog::LoopUnroller loop_unroller(*verilog_module);
+	bool changed = loop_unroller.run(llvm_function);
+
+	// Map the arrays, and split the blocks accessing more words than
+	// the memory ports allow in a cycle
+	memory_mapper = new verilog::MemoryMapper(*verilog_module);
+	changed = memory_mapper->schedule(llvm_function) || changed;
+
+	// Order the basic blocks so that every block follows its
+	// predecessors, and create their code blocks. Functions with loops
+	// or arrays cannot be if-converted, and become state machines
+	// instead.
+	if_converter = new verilog::IfConverter(*verilog_module);
+	if (memory_mapper->hasArrays() || !if_converter->analyze(llvm_function))
+	{
+		delete if_converter;
+		if_converter = nullptr;
+		state_machine = new verilog::StateMachine(*verilog_module);
+		state_machine->analyze(llvm_function);
+	}
+	const std::vector<llvm::BasicBlock *> &llvm_basic_blocks = if_converter ?
+			if_converter->getBlocks() : state_machine->getBlocks();
+	for (llvm::BasicBlock *llvm_basic_block : llvm_basic_blocks)
 	{
 		verilog::CodeBlock *verilog_code_block =
-				new verilog::CodeBlock(llvm_basic_block->getName());
-		verilog_module->addCodeBlock(verilog_code_block);
+				verilog_module->create<verilog::CodeBlock>(llvm_basic_block->getName());
+		verilog_module->addCodeBlock(verilog_code_block, llvm_basic_block);
 	}
 
 	// Set first code block as successor of module's entry basic block
 	llvm::BasicBlock *llvm_first_basic_block = &llvm_function.getEntryBlock();
 	verilog::CodeBlock *verilog_first_code_block = verilog_module->getCodeBlock(
-			llvm_first_basic_block->getName());
+			llvm_first_basic_block);
 	verilog_entry_code_block->addSuccessor(verilog_first_code_block);
 
 	// Code generation for code blocks
-	for (llvm::Function::iterator llvm_basic_block = llvm_function.begin(),
-			e = llvm_function.end();
-			llvm_basic_block != e;
-			++llvm_basic_block)
+	divider_generator = new verilog::DividerGenerator(*verilog_module);
+	for (llvm::BasicBlock *llvm_basic_block : llvm_basic_blocks)
 	{
 		verilog::CodeBlock *verilog_code_block =
-				verilog_module->getCodeBlock(
-				llvm_basic_block->getName());
+				verilog_module->getCodeBlock(llvm_basic_block);
 		TranslateBasicBlock(llvm_basic_block, verilog_code_block);
 	}
-
-	// Add 'exit' code block
+	if (state_machine)
+	{
+		state_machine->run();
+		memory_mapper->run(state_machine);
+	}
+	else
+	{
+		divider_generator->run();
+	}
+	delete divider_generator;
+	divider_generator = nullptr;
+	delete memory_mapper;
+	memory_mapper = nullptr;
+	delete if_converter;
+	if_converter = nullptr;
+	delete state_machine;
+	state_machine = nullptr;
+
+	// Add 'exit' code block, where 'endmodule' is printed
 	verilog::CodeBlock *verilog_exit_code_block = verilog_module->getExitCodeBlock();
 	verilog_module->addCodeBlock(verilog_exit_code_block);
 
-	// Emit 'endmodule' in 'exit' code block
-	verilog::DataFlow *verilog_dataflow = new verilog::DataFlow(
-			verilog::DataFlow::OpcodeEndModule);
-	verilog_exit_code_block->addDataFlow(verilog_dataflow);
+	// Optimize the netlist
+	verilog::Optimizer optimizer(*verilog_module);
+	optimizer.run();
+	optimizer_statistics.add(optimizer.getStatistics());
 
 	// Print verilog module
-	verilog_module->dump();
+	emitter.emit(*verilog_module);
 
-	// Function was not modified
-	return false;
+	// Release the module together with all its IR objects
+	statistics.add(verilog_module->getStatistics());
+	num_functions++;
+	delete verilog_module;
+	verilog_module = nullptr;
+
+	// Function was modified if loops were unrolled
+	return changed;
 }
 
 
 void VERILOGPass::TranslateBasicBlock(llvm::BasicBlock *llvm_basic_block,
 		verilog::CodeBlock *verilog_code_block)
 {
-	// Traverse instructions
+	// Predicate of the block, unless it is a state of its own
+	if (if_converter)
+		if_converter->translateBlock(llvm_basic_block, verilog_code_block);
+
+	// Traverse instructions, up to the first terminator. Instructions
+	// after it are unreachable.
 	for (llvm::BasicBlock::iterator llvm_instruction = llvm_basic_block->begin(),
 			e = llvm_basic_block->end();
 			llvm_instruction != e;
 			++llvm_instruction)
 	{
 		TranslateInstruction(llvm_instruction, verilog_code_block);
+		if (llvm_instruction->isTerminator())
+			break;
 	}
 }
 
 
+void VERILOGPass::TranslateBinary(llvm::Instruction *llvm_instruction,
+		verilog::CodeBlock *verilog_code_block,
+		verilog::DataFlow::Opcode opcode)
+{
+	verilog::Netlist &netlist = verilog_module->getNetlist();
+
+	// Destination wire
+	int width = verilog::Module::translateLLVMType(
+			llvm_instruction->getType(), "temporay registers");
+	int verilog_dest = netlist.addWire(width);
+	verilog_module->addSymbol(llvm_instruction, verilog_dest);
+
+	// First operand
+	int verilog_src1 = verilog_module->translateLLVMValue(
+			verilog_code_block,
+			llvm_instruction->getOperand(0));
+
+	// Second operand
+	int verilog_src2 = verilog_module->translateLLVMValue(
+			verilog_code_block,
+			llvm_instruction->getOperand(1));
+
+	// Emit 'assign dest = src1 op src2;'
+	verilog_module->addDataFlow(verilog_code_block, opcode, verilog_dest,
+			{ verilog_src1, verilog_src2 });
+}
+
+
+void VERILOGPass::TranslateCompare(llvm::ICmpInst *icmp_instruction,
+		verilog::CodeBlock *verilog_code_block)
+{
+	verilog::Netlist &netlist = verilog_module->getNetlist();
+
+	// Destination wire
+	int verilog_dest = netlist.addWire(1);
+	verilog_module->addSymbol(icmp_instruction, verilog_dest);
+
+	// Operands
+	int width = verilog::Module::translateLLVMType(
+			icmp_instruction->getOperand(0)->getType(), "comparisons");
+	int verilog_src1 = verilog_module->translateLLVMValue(
+			verilog_code_block, icmp_instruction->getOperand(0));
+	int verilog_src2 = verilog_module->translateLLVMValue(
+			verilog_code_block, icmp_instruction->getOperand(1));
+
+	// Signed comparisons flip the sign bits of the operands, which maps
+	// the signed order onto the unsigned one
+	llvm::CmpInst::Predicate predicate = icmp_instruction->getPredicate();
+	if (icmp_instruction->isSigned())
+	{
+		long long sign = (long long) (~0ULL << (width - 1));
+		long long value;
+		int sign_net = verilog_module->getConstant(sign, width);
+		for (int *src : { &verilog_src1, &verilog_src2 })
+		{
+			if (netlist.getConstant(*src, value))
+			{
+				*src = verilog_module->getConstant(value ^ sign, width);
+				continue;
+			}
+			int flipped = netlist.addWire(width);
+			verilog_module->addDataFlow(verilog_code_block,
+					verilog::DataFlow::OpcodeXor, flipped,
+					{ *src, sign_net });
+			*src = flipped;
+		}
+		predicate = icmp_instruction->getUnsignedPredicate();
+	}
+
+	// Less than swaps the operands of greater than, and the other
+	// predicates are the complement of one of them
+	verilog::DataFlow::Opcode opcode = verilog::DataFlow::OpcodeUgt;
+	bool swapped = false;
+	bool inverted = false;
+	switch (predicate)
+	{
+	case llvm::CmpInst::ICMP_EQ:
+		opcode = verilog::DataFlow::OpcodeEq;
+		break;
+
+	case llvm::CmpInst::ICMP_NE:
+		opcode = verilog::DataFlow::OpcodeEq;
+		inverted = true;
+		break;
+
+	case llvm::CmpInst::ICMP_UGT:
+		break;
+
+	case llvm::CmpInst::ICMP_ULT:
+		swapped = true;
+		break;
+
+	case llvm::CmpInst::ICMP_UGE:
+		swapped = true;
+		inverted = true;
+		break;
+
+	case llvm::CmpInst::ICMP_ULE:
+		inverted = true;
+		break;
+
+	default:
+
+		fatal("icmp predicate not supported");
+	}
+	if (swapped)
+		std::swap(verilog_src1, verilog_src2);
+
+	// Emit 'assign dest = src1 op src2;', or 'assign dest = ~wire;'
+	// after it for complemented predicates
+	int verilog_result = inverted ? netlist.addWire(1) : verilog_dest;
+	verilog_module->addDataFlow(verilog_code_block, opcode, verilog_result,
+			{ verilog_src1, verilog_src2 });
+	if (inverted)
+		verilog_module->addDataFlow(verilog_code_block,
+				verilog::DataFlow::OpcodeNot, verilog_dest,
+				{ verilog_result });
+}
+
+
+void VERILOGPass::TranslateMultiply(llvm::Instruction *llvm_instruction,
+		verilog::CodeBlock *verilog_code_block)
+{
+	// Constant operand, if any, second
+	llvm::Value *llvm_src = llvm_instruction->getOperand(0);
+	llvm::Value *llvm_constant = llvm_instruction->getOperand(1);
+	if (llvm::isa<llvm::ConstantInt>(llvm_src))
+		std::swap(llvm_src, llvm_constant);
+	if (!llvm::isa<llvm::ConstantInt>(llvm_constant))
+	{
+		TranslateBinary(llvm_instruction, verilog_code_block,
+				verilog::DataFlow::OpcodeMul);
+		return;
+	}
+
+	// Destination wire
+	verilog::Netlist &netlist = verilog_module->getNetlist();
+	int width = verilog::Module::translateLLVMType(
+			llvm_instruction->getType(), "temporay registers");
+	int verilog_dest = netlist.addWire(width);
+	verilog_module->addSymbol(llvm_instruction, verilog_dest);
+
+	// Shifts and additions
+	int verilog_src = verilog_module->translateLLVMValue(
+			verilog_code_block, llvm_src);
+	verilog::StrengthReducer strength_reducer(*verilog_module);
+	strength_reducer.translateMultiply(verilog_code_block, verilog_dest,
+			verilog_src, llvm::cast<llvm::ConstantInt>(llvm_constant)->
+			getSExtValue());
+}
+
+
+void VERILOGPass::TranslateDivide(llvm::Instruction *llvm_instruction,
+		verilog::CodeBlock *verilog_code_block,
+		bool is_signed, bool remainder)
+{
+	// Destination wire
+	verilog::Netlist &netlist = verilog_module->getNetlist();
+	int width = verilog::Module::translateLLVMType(
+			llvm_instruction->getType(), "temporay registers");
+	int verilog_dest = netlist.addWire(width);
+	verilog_module->addSymbol(llvm_instruction, verilog_dest);
+
+	// Multiplication by the inverse of a constant divisor
+	int verilog_src = verilog_module->translateLLVMValue(
+			verilog_code_block, llvm_instruction->getOperand(0));
+	llvm::ConstantInt *llvm_divisor = llvm::dyn_cast<llvm::ConstantInt>(
+			llvm_instruction->getOperand(1));
+	if (llvm_divisor)
+	{
+		verilog::StrengthReducer strength_reducer(*verilog_module);
+		strength_reducer.translateDivide(verilog_code_block, verilog_dest,
+				verilog_src, llvm_divisor->getSExtValue(), is_signed,
+				remainder);
+		return;
+	}
+
+	// Divider of the architecture given for the division. States of a
+	// state machine take one cycle, so they only hold arrays.
+	int verilog_divisor = verilog_module->translateLLVMValue(
+			verilog_code_block, llvm_instruction->getOperand(1));
+	std::string function_name =
+			llvm_instruction->getParent()->getParent()->getName().str();
+	std::string name = llvm_instruction->getName().str();
+	verilog::DividerGenerator::Architecture architecture =
+			verilog::DividerGenerator::getArchitecture(function_name, name);
+	if (state_machine &&
+			architecture == verilog::DividerGenerator::ArchitectureIterative)
+	{
+		verilog::warning("Warning: iterative divider " +
+				(name.empty() ? std::string() : "'" + name + "' ") +
+				"of function '" + function_name + "' built as radix2, since "
+				"the states of its state machine take one cycle");
+		architecture = verilog::DividerGenerator::ArchitectureRadix2;
+	}
+	divider_generator->translateDivide(verilog_code_block, verilog_dest,
+			verilog_src, verilog_divisor, is_signed, remainder, architecture);
+}
+
+
 void VERILOGPass::TranslateInstruction(llvm::Instruction *llvm_instruction,
 		verilog::CodeBlock *verilog_code_block)
 {
@@ -199,551 +424,138 @@ void VERILOGPass::TranslateInstruction(llvm::Instruction *llvm_instruction,
 		llvm::AllocaInst *alloca_inst = llvm::cast<llvm::AllocaInst>
 				(llvm_instruction);
 
-		// Check type
+		// Arrays are read and written by loads and stores, mapped by
+		// the memory mapper
 		llvm::Type *type = alloca_inst->getAllocatedType();
+		if (type->isArrayTy())
+			break;
+
+		// Check type
 		if (!type->isIntegerTy(32))
-		{
-			std::cerr << "Unsupported type in alloca\n";
-			exit(1);
-		}
+			fatal("Unsupported type in alloca");
 		
-		// Get 'entry' and 'exit' code blocks
-		verilog::DataFlow *verilog_dataflow;
-		verilog::CodeBlock *verilog_entry_code_block = verilog_module->
-				getEntryCodeBlock();
-		verilog::CodeBlock *verilog_exit_code_block = verilog_module->
-				getExitCodeBlock();
-
-		// Emit 'addi $sp, $sp, -4' in '__entry' basic block
-//		mips_instruction = new mips::Instruction(
-//				mips::Instruction::OpcodeAddi);
-//		mips_instruction->addArgument(new mips::Register(29,
-//				mips::Register::DirectionOutput));
-//		mips_instruction->addArgument(new mips::Register(29,
-//				mips::Register::DirectionInput));
-//		mips_instruction->addArgument(new mips::Constant(-4));
-//		mips_entry_basic_block->addInstruction(mips_instruction);
-
-		// Emit 'move $temp, $sp' in 'entry' basic block.
-		// Store '$temp' in symbol table
-		verilog_dataflow = new verilog::DataFlow(verilog::DataFlow::OpcodeSignalDefine);
-		// Currently only supports wire signals, can be extended to support registers
-		// and sequential logic
-		verilog::Wire *dest = verilog::Wire::newWire(
-		verilog::Wire::DirectionLhs);
-		verilog_dataflow->addArgument(dest);
-		verilog_dataflow->addArgument(new verilog::Wire("wire0",
-		verilog::Wire::DirectionLhs));
-		verilog_entry_code_block->addDataFlow(verilog_dataflow);
-		verilog_module->WireAddSymbol(llvm_instruction->getName(), dest);
-		
-
+		// Associate a wire with the alloca in the symbol table. It is
+		// declared by the dataflow assigning it, if any. Currently only
+		// supports wire signals, can be extended to support registers
+		// and sequential logic.
+		int dest = verilog_module->getNetlist().addWire(32);
+		verilog_module->addSymbol(llvm_instruction, dest);
 		break;
 	}
 
-	case llvm::Instruction::Add:
-	{
-		// Destination wire
-		verilog::Wire *verilog_dest = verilog::Wire::newWire(
-				verilog::Wire::DirectionLhs);
-		verilog_module->WireAddSymbol(llvm_instruction->getName(), verilog_dest);
-			
-		// First operand
-		llvm::Value *llvm_src1 = llvm_instruction->getOperand(0);
-		verilog::Wire *verilog_src1 = verilog_module->translateLLVMValueWire(
-				verilog_code_block,
-				llvm_src1,
-				verilog::Wire::DirectionRhs);
+	case llvm::Instruction::GetElementPtr:
 
-		// Second operand
-		llvm::Value *llvm_src2 = llvm_instruction->getOperand(1);
-		verilog::Wire *verilog_src2 = verilog_module->translateLLVMValueWire(
-				verilog_code_block,
-				llvm_src2,
-				verilog::Wire::DirectionRhs);
+		// Element numbers are computed by the loads and stores
+		break;
 
-	        
-			verilog::DataFlow *verilog_signaldef = new verilog::DataFlow(verilog::DataFlow::OpcodeSignalDefine);
-			llvm::Type *type = llvm_instruction->getType();	
-			if (type->isIntegerTy(32))
-			{
-				verilog_dest->setWidth(32);	
-			}
-			else if (type->isIntegerTy(16))
-			{
-				verilog_dest->setWidth(16);	
-			}
-			else if (type->isIntegerTy(8))
-			{
-				verilog_dest->setWidth(8);	
-			}
-			else if (type->isIntegerTy(1))
-			{
-				verilog_dest->setWidth(1);	
-			}
-			else
-			{
-				std::cerr << "Unsupported type in temporay registers\n";
-				exit(1);
-			}
-		        verilog_code_block->addDataFlow(verilog_signaldef);
-			verilog_signaldef->addArgument(verilog_dest);
-
-			// Emit '>' operator
-			verilog::DataFlow *verilog_dataflow =
-					new verilog::DataFlow(
-					verilog::DataFlow::OpcodeAdd);
-			verilog_code_block->addDataFlow(verilog_dataflow);
-			verilog_dataflow->addArgument(verilog_dest);
-
-			// src1 and src2
-			verilog_dataflow->addArgument(verilog_src1);
-			verilog_dataflow->addArgument(verilog_src2);
+	case llvm::Instruction::Load:
+		memory_mapper->translateLoad(llvm::cast<llvm::LoadInst>(
+				llvm_instruction), verilog_code_block);
+		break;
+
+	case llvm::Instruction::Store:
+		memory_mapper->translateStore(llvm::cast<llvm::StoreInst>(
+				llvm_instruction), verilog_code_block);
+		break;
+
+	case llvm::Instruction::Add:
+		TranslateBinary(llvm_instruction, verilog_code_block,
+				verilog::DataFlow::OpcodeAdd);
 		break;
-	}
 
 	case llvm::Instruction::Sub:
-	{
-		// Destination wire
-		verilog::Wire *verilog_dest = verilog::Wire::newWire(
-				verilog::Wire::DirectionLhs);
-		verilog_module->WireAddSymbol(llvm_instruction->getName(), verilog_dest);
-			
-		// First operand
-		llvm::Value *llvm_src1 = llvm_instruction->getOperand(0);
-		verilog::Wire *verilog_src1 = verilog_module->translateLLVMValueWire(
-				verilog_code_block,
-				llvm_src1,
-				verilog::Wire::DirectionRhs);
+		TranslateBinary(llvm_instruction, verilog_code_block,
+				verilog::DataFlow::OpcodeSub);
+		break;
 
-		// Second operand
-		llvm::Value *llvm_src2 = llvm_instruction->getOperand(1);
-		verilog::Wire *verilog_src2 = verilog_module->translateLLVMValueWire(
-				verilog_code_block,
-				llvm_src2,
-				verilog::Wire::DirectionRhs);
+	case llvm::Instruction::Mul:
+		TranslateMultiply(llvm_instruction, verilog_code_block);
+		break;
 
-	        
-			verilog::DataFlow *verilog_signaldef = new verilog::DataFlow(verilog::DataFlow::OpcodeSignalDefine);
-			llvm::Type *type = llvm_instruction->getType();	
-			if (type->isIntegerTy(32))
-			{
-				verilog_dest->setWidth(32);	
-			}
-			else if (type->isIntegerTy(16))
-			{
-				verilog_dest->setWidth(16);	
-			}
-			else if (type->isIntegerTy(8))
-			{
-				verilog_dest->setWidth(8);	
-			}
-			else if (type->isIntegerTy(1))
-			{
-				verilog_dest->setWidth(1);	
-			}
-			else
-			{
-				std::cerr << "Unsupported type in temporay registers\n";
-				exit(1);
-			}
-		        verilog_code_block->addDataFlow(verilog_signaldef);
-			verilog_signaldef->addArgument(verilog_dest);
-
-			// Emit '>' operator
-			verilog::DataFlow *verilog_dataflow =
-					new verilog::DataFlow(
-					verilog::DataFlow::OpcodeSub);
-			verilog_code_block->addDataFlow(verilog_dataflow);
-			verilog_dataflow->addArgument(verilog_dest);
-
-			// src1 and src2
-			verilog_dataflow->addArgument(verilog_src1);
-			verilog_dataflow->addArgument(verilog_src2);
+	case llvm::Instruction::SDiv:
+		TranslateDivide(llvm_instruction, verilog_code_block, true, false);
 		break;
-	}
-	case llvm::Instruction::LShr:
-	{
-		// Destination wire
-		verilog::Wire *verilog_dest = verilog::Wire::newWire(
-				verilog::Wire::DirectionLhs);
-		verilog_module->WireAddSymbol(llvm_instruction->getName(), verilog_dest);
-			
-		// First operand
-		llvm::Value *llvm_src1 = llvm_instruction->getOperand(0);
-		verilog::Wire *verilog_src1 = verilog_module->translateLLVMValueWire(
-				verilog_code_block,
-				llvm_src1,
-				verilog::Wire::DirectionRhs);
 
-		// Second operand
-		llvm::Value *llvm_src2 = llvm_instruction->getOperand(1);
-		verilog::Wire *verilog_src2 = verilog_module->translateLLVMValueWire(
-				verilog_code_block,
-				llvm_src2,
-				verilog::Wire::DirectionRhs);
+	case llvm::Instruction::UDiv:
+		TranslateDivide(llvm_instruction, verilog_code_block, false, false);
+		break;
 
-	        
-			verilog::DataFlow *verilog_signaldef = new verilog::DataFlow(verilog::DataFlow::OpcodeSignalDefine);
-			llvm::Type *type = llvm_instruction->getType();	
-			if (type->isIntegerTy(32))
-			{
-				verilog_dest->setWidth(32);	
-			}
-			else if (type->isIntegerTy(16))
-			{
-				verilog_dest->setWidth(16);	
-			}
-			else if (type->isIntegerTy(8))
-			{
-				verilog_dest->setWidth(8);	
-			}
-			else if (type->isIntegerTy(1))
-			{
-				verilog_dest->setWidth(1);	
-			}
-			else
-			{
-				std::cerr << "Unsupported type in temporay registers\n";
-				exit(1);
-			}
-		        verilog_code_block->addDataFlow(verilog_signaldef);
-			verilog_signaldef->addArgument(verilog_dest);
-
-			// Emit '>' operator
-			verilog::DataFlow *verilog_dataflow =
-					new verilog::DataFlow(
-					verilog::DataFlow::OpcodeLshr);
-			verilog_code_block->addDataFlow(verilog_dataflow);
-			verilog_dataflow->addArgument(verilog_dest);
-
-			// src1 and src2
-			verilog_dataflow->addArgument(verilog_src1);
-			verilog_dataflow->addArgument(verilog_src2);
+	case llvm::Instruction::SRem:
+		TranslateDivide(llvm_instruction, verilog_code_block, true, true);
 		break;
-	}
-	case llvm::Instruction::Xor:
-	{
-		// Destination wire
-		verilog::Wire *verilog_dest = verilog::Wire::newWire(
-				verilog::Wire::DirectionLhs);
-		verilog_module->WireAddSymbol(llvm_instruction->getName(), verilog_dest);
-			
-		// First operand
-		llvm::Value *llvm_src1 = llvm_instruction->getOperand(0);
-		verilog::Wire *verilog_src1 = verilog_module->translateLLVMValueWire(
-				verilog_code_block,
-				llvm_src1,
-				verilog::Wire::DirectionRhs);
 
-		// Second operand
-		llvm::Value *llvm_src2 = llvm_instruction->getOperand(1);
-		verilog::Wire *verilog_src2 = verilog_module->translateLLVMValueWire(
-				verilog_code_block,
-				llvm_src2,
-				verilog::Wire::DirectionRhs);
+	case llvm::Instruction::URem:
+		TranslateDivide(llvm_instruction, verilog_code_block, false, true);
+		break;
 
-	        
-			verilog::DataFlow *verilog_signaldef = new verilog::DataFlow(verilog::DataFlow::OpcodeSignalDefine);
-			llvm::Type *type = llvm_instruction->getType();	
-			if (type->isIntegerTy(32))
-			{
-				verilog_dest->setWidth(32);	
-			}
-			else if (type->isIntegerTy(16))
-			{
-				verilog_dest->setWidth(16);	
-			}
-			else if (type->isIntegerTy(8))
-			{
-				verilog_dest->setWidth(8);	
-			}
-			else if (type->isIntegerTy(1))
-			{
-				verilog_dest->setWidth(1);	
-			}
-			else
-			{
-				std::cerr << "Unsupported type in temporay registers\n";
-				exit(1);
-			}
-		        verilog_code_block->addDataFlow(verilog_signaldef);
-			verilog_signaldef->addArgument(verilog_dest);
-
-			// Emit '>' operator
-			verilog::DataFlow *verilog_dataflow =
-					new verilog::DataFlow(
-					verilog::DataFlow::OpcodeXor);
-			verilog_code_block->addDataFlow(verilog_dataflow);
-			verilog_dataflow->addArgument(verilog_dest);
-
-			// src1 and src2
-			verilog_dataflow->addArgument(verilog_src1);
-			verilog_dataflow->addArgument(verilog_src2);
+	case llvm::Instruction::LShr:
+		TranslateBinary(llvm_instruction, verilog_code_block,
+				verilog::DataFlow::OpcodeLshr);
 		break;
-	}
-	case llvm::Instruction::And:
-	{
-		// Destination wire
-		verilog::Wire *verilog_dest = verilog::Wire::newWire(
-				verilog::Wire::DirectionLhs);
-		verilog_module->WireAddSymbol(llvm_instruction->getName(), verilog_dest);
-			
-		// First operand
-		llvm::Value *llvm_src1 = llvm_instruction->getOperand(0);
-		verilog::Wire *verilog_src1 = verilog_module->translateLLVMValueWire(
-				verilog_code_block,
-				llvm_src1,
-				verilog::Wire::DirectionRhs);
 
-		// Second operand
-		llvm::Value *llvm_src2 = llvm_instruction->getOperand(1);
-		verilog::Wire *verilog_src2 = verilog_module->translateLLVMValueWire(
-				verilog_code_block,
-				llvm_src2,
-				verilog::Wire::DirectionRhs);
+	case llvm::Instruction::Shl:
+		TranslateBinary(llvm_instruction, verilog_code_block,
+				verilog::DataFlow::OpcodeShl);
+		break;
 
-	        
-			verilog::DataFlow *verilog_signaldef = new verilog::DataFlow(verilog::DataFlow::OpcodeSignalDefine);
-			llvm::Type *type = llvm_instruction->getType();	
-			if (type->isIntegerTy(32))
-			{
-				verilog_dest->setWidth(32);	
-			}
-			else if (type->isIntegerTy(16))
-			{
-				verilog_dest->setWidth(16);	
-			}
-			else if (type->isIntegerTy(8))
-			{
-				verilog_dest->setWidth(8);	
-			}
-			else if (type->isIntegerTy(1))
-			{
-				verilog_dest->setWidth(1);	
-			}
-			else
-			{
-				std::cerr << "Unsupported type in temporay registers\n";
-				exit(1);
-			}
-		        verilog_code_block->addDataFlow(verilog_signaldef);
-			verilog_signaldef->addArgument(verilog_dest);
-
-			// Emit '>' operator
-			verilog::DataFlow *verilog_dataflow =
-					new verilog::DataFlow(
-					verilog::DataFlow::OpcodeAnd);
-			verilog_code_block->addDataFlow(verilog_dataflow);
-			verilog_dataflow->addArgument(verilog_dest);
-
-			// src1 and src2
-			verilog_dataflow->addArgument(verilog_src1);
-			verilog_dataflow->addArgument(verilog_src2);
+	case llvm::Instruction::Xor:
+		TranslateBinary(llvm_instruction, verilog_code_block,
+				verilog::DataFlow::OpcodeXor);
 		break;
-	}
-	case llvm::Instruction::Or:
-	{
-		// Destination wire
-		verilog::Wire *verilog_dest = verilog::Wire::newWire(
-				verilog::Wire::DirectionLhs);
-		verilog_module->WireAddSymbol(llvm_instruction->getName(), verilog_dest);
-			
-		// First operand
-		llvm::Value *llvm_src1 = llvm_instruction->getOperand(0);
-		verilog::Wire *verilog_src1 = verilog_module->translateLLVMValueWire(
-				verilog_code_block,
-				llvm_src1,
-				verilog::Wire::DirectionRhs);
 
-		// Second operand
-		llvm::Value *llvm_src2 = llvm_instruction->getOperand(1);
-		verilog::Wire *verilog_src2 = verilog_module->translateLLVMValueWire(
-				verilog_code_block,
-				llvm_src2,
-				verilog::Wire::DirectionRhs);
+	case llvm::Instruction::And:
+		TranslateBinary(llvm_instruction, verilog_code_block,
+				verilog::DataFlow::OpcodeAnd);
+		break;
 
-	        
-			verilog::DataFlow *verilog_signaldef = new verilog::DataFlow(verilog::DataFlow::OpcodeSignalDefine);
-			llvm::Type *type = llvm_instruction->getType();	
-			if (type->isIntegerTy(32))
-			{
-				verilog_dest->setWidth(32);	
-			}
-			else if (type->isIntegerTy(16))
-			{
-				verilog_dest->setWidth(16);	
-			}
-			else if (type->isIntegerTy(8))
-			{
-				verilog_dest->setWidth(8);	
-			}
-			else if (type->isIntegerTy(1))
-			{
-				verilog_dest->setWidth(1);	
-			}
-			else
-			{
-				std::cerr << "Unsupported type in temporay registers\n";
-				exit(1);
-			}
-		        verilog_code_block->addDataFlow(verilog_signaldef);
-			verilog_signaldef->addArgument(verilog_dest);
-
-			// Emit '>' operator
-			verilog::DataFlow *verilog_dataflow =
-					new verilog::DataFlow(
-					verilog::DataFlow::OpcodeOr);
-			verilog_code_block->addDataFlow(verilog_dataflow);
-			verilog_dataflow->addArgument(verilog_dest);
-
-			// src1 and src2
-			verilog_dataflow->addArgument(verilog_src1);
-			verilog_dataflow->addArgument(verilog_src2);
+	case llvm::Instruction::Or:
+		TranslateBinary(llvm_instruction, verilog_code_block,
+				verilog::DataFlow::OpcodeOr);
 		break;
-	}
+
 	case llvm::Instruction::ICmp:
-	{
-		// Destination wire
-		verilog::Wire *verilog_dest = verilog::Wire::newWire(
-				verilog::Wire::DirectionLhs);
-		verilog_module->WireAddSymbol(llvm_instruction->getName(), verilog_dest);
-			
-		// First operand
-		llvm::Value *llvm_src1 = llvm_instruction->getOperand(0);
-		verilog::Wire *verilog_src1 = verilog_module->translateLLVMValueWire(
-				verilog_code_block,
-				llvm_src1,
-				verilog::Wire::DirectionRhs);
+		TranslateCompare(llvm::cast<llvm::ICmpInst>(llvm_instruction),
+				verilog_code_block);
+		break;
 
-		// Second operand
-		llvm::Value *llvm_src2 = llvm_instruction->getOperand(1);
-		verilog::Wire *verilog_src2 = verilog_module->translateLLVMValueWire(
-				verilog_code_block,
-				llvm_src2,
-				verilog::Wire::DirectionRhs);
+	case llvm::Instruction::PHI:
+		if (state_machine)
+			state_machine->translatePHI(llvm::cast<llvm::PHINode>(
+					llvm_instruction));
+		else
+			if_converter->translatePHI(llvm::cast<llvm::PHINode>(
+					llvm_instruction), verilog_code_block);
+		break;
 
-		// Operation depending on condition
-		llvm::ICmpInst *icmp_instruction = llvm::cast<llvm::ICmpInst>
+	case llvm::Instruction::Br:
+	{
+		// Set branch targets as successors
+		llvm::BranchInst *branch_instruction = llvm::cast<llvm::BranchInst>
 				(llvm_instruction);
-		llvm::CmpInst::Predicate pred = icmp_instruction->getPredicate();          
-		switch (pred)                                                       
-		{                                                                        
-
-		case llvm::CmpInst::ICMP_EQ:
-		{
-	        
-			verilog::DataFlow *verilog_signaldef = new verilog::DataFlow(verilog::DataFlow::OpcodeSignalDefine);
-			llvm::Type *type = llvm_instruction->getType();	
-			if (type->isIntegerTy(32))
-			{
-				verilog_dest->setWidth(32);	
-			}
-			else if (type->isIntegerTy(16))
-			{
-				verilog_dest->setWidth(16);	
-			}
-			else if (type->isIntegerTy(8))
-			{
-				verilog_dest->setWidth(8);	
-			}
-			else if (type->isIntegerTy(1))
-			{
-				verilog_dest->setWidth(1);	
-			}
-			else
-			{
-				std::cerr << "Unsupported type in temporay registers\n";
-				exit(1);
-			}
-		        verilog_code_block->addDataFlow(verilog_signaldef);
-			verilog_signaldef->addArgument(verilog_dest);
-
-			// Emit '>' operator
-			verilog::DataFlow *verilog_dataflow =
-					new verilog::DataFlow(
-					verilog::DataFlow::OpcodeEq);
-			verilog_code_block->addDataFlow(verilog_dataflow);
-			verilog_dataflow->addArgument(verilog_dest);
-
-			// src1 and src2
-			verilog_dataflow->addArgument(verilog_src1);
-			verilog_dataflow->addArgument(verilog_src2);
-			break;
-		}
-		case llvm::CmpInst::ICMP_SGT:
+		for (unsigned index = 0; index < branch_instruction->getNumSuccessors();
+				index++)
 		{
-	        
-			verilog::DataFlow *verilog_signaldef = new verilog::DataFlow(verilog::DataFlow::OpcodeSignalDefine);
-			llvm::Type *type = llvm_instruction->getType();	
-			if (type->isIntegerTy(32))
-			{
-				verilog_dest->setWidth(32);	
-			}
-			else if (type->isIntegerTy(16))
-			{
-				verilog_dest->setWidth(16);	
-			}
-			else if (type->isIntegerTy(8))
-			{
-				verilog_dest->setWidth(8);	
-			}
-			else if (type->isIntegerTy(1))
-			{
-				verilog_dest->setWidth(1);	
-			}
-			else
-			{
-				std::cerr << "Unsupported type in temporay registers\n";
-				exit(1);
-			}
-		        verilog_code_block->addDataFlow(verilog_signaldef);
-			verilog_signaldef->addArgument(verilog_dest);
-
-			// Emit '>' operator
-			verilog::DataFlow *verilog_dataflow =
-					new verilog::DataFlow(
-					verilog::DataFlow::OpcodeSgt);
-			verilog_code_block->addDataFlow(verilog_dataflow);
-			verilog_dataflow->addArgument(verilog_dest);
-
-			// src1 and src2
-			verilog_dataflow->addArgument(verilog_src1);
-			verilog_dataflow->addArgument(verilog_src2);
-			break;
-		}
-
-		default:
-
-			std::cerr << "icmp predicate not supported\n";
-			exit(1);
+			verilog::CodeBlock *successor = verilog_module->getCodeBlock(
+					branch_instruction->getSuccessor(index));
+			if (successor != verilog_code_block)
+				verilog_code_block->addSuccessor(successor);
 		}
 		break;
 	}
 
-
 	case llvm::Instruction::Ret:
 	{
-		// Emit 'assign output = finalresult'
-		verilog::DataFlow *dataflow = new verilog::DataFlow(
-				verilog::DataFlow::OpcodeAssign);
-		// return value
-//		verilog::Wire *verilog_dest = verilog::Wire::newWire(
-//				verilog::Wire::DirectionOutput);
-		verilog_module->WireAddSymbol(llvm_instruction->getName(), verilog_result);
-
-		dataflow->addArgument(verilog_result);
-
-		// src operand
-		llvm::Value *llvm_src1 = llvm_instruction->getOperand(0);
-		verilog::Wire *verilog_src1 = verilog_module->translateLLVMValueWire(
+		// Emit 'assign output = finalresult', selecting the value of the
+		// return taken if there are several
+		int verilog_src1 = verilog_module->translateLLVMValue(
 				verilog_code_block,
-				llvm_src1,
-				verilog::Wire::DirectionInput);
-
-		dataflow->addArgument(verilog_src1);
-	
-		verilog_code_block->addDataFlow(dataflow);
+				llvm_instruction->getOperand(0));
+		if (state_machine)
+			state_machine->translateReturn(llvm_instruction->getParent(),
+					verilog_src1);
+		else
+			if_converter->translateReturn(llvm_instruction->getParent(),
+					verilog_src1, verilog_code_block);
 
 		// Set exit basic block as successor
 		verilog_code_block->addSuccessor(verilog_module->getExitCodeBlock());
@@ -751,11 +563,12 @@ void VERILOGPass::TranslateInstruction(llvm::Instruction *llvm_instruction,
 	}
 
 	default:
-
-		std::cerr << "Unsupported LLVM instruction: ";
-		llvm_instruction->dump();
-		std::cerr << '\n';
-		exit(1);
+	{
+		std::string text;
+		llvm::raw_string_ostream stream(text);
+		llvm_instruction->print(stream);
+		fatal("Unsupported LLVM instruction: " + stream.str());
+	}
 	}
 }
 
@@ -0,0 +1,67 @@
+/**
+ * @file   Synthetic.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  Generator of synthetic LLVM functions.
+ */
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+
+#include <sstream>
+#include <vector>
+
+#include "Synthetic.h"
+
+
+llvm::Module *createSyntheticModule(llvm::LLVMContext &llvm_context,
+		unsigned num_instructions)
+{
+	llvm::Module *module = new llvm::Module("Synthetic", llvm_context);
+	llvm::Type *lltype = llvm::Type::getInt32Ty(llvm_context);
+
+	// Function with four arguments, named as the parser does
+	std::vector<llvm::Type *> types(4, lltype);
+	llvm::FunctionType *function_type = llvm::FunctionType::get(lltype,
+			types, false);
+	llvm::Function *function = llvm::Function::Create(function_type,
+			llvm::GlobalValue::ExternalLinkage, "synthetic", module);
+	std::vector<llvm::Value *> values;
+	const char *names[] = { "a", "b", "c", "d" };
+	int index = 0;
+	for (llvm::Function::arg_iterator it = function->arg_begin(),
+			end = function->arg_end();
+			it != end;
+			++it)
+	{
+		it->setName(names[index++]);
+		values.push_back(it);
+	}
+
+	// Chain of operations supported by the code generator
+	const llvm::Instruction::BinaryOps opcodes[] = {
+		llvm::Instruction::Add,
+		llvm::Instruction::Xor,
+		llvm::Instruction::Sub,
+		llvm::Instruction::And,
+		llvm::Instruction::Or,
+		llvm::Instruction::LShr
+	};
+	llvm::IRBuilder<> builder(llvm::BasicBlock::Create(llvm_context,
+			"L0", function));
+	for (unsigned i = 0; i < num_instructions; i++)
+	{
+		llvm::Instruction::BinaryOps opcode = opcodes[i % 6];
+		llvm::Value *lhs = values.back();
+		llvm::Value *rhs = opcode == llvm::Instruction::LShr || i % 7 == 0 ?
+				llvm::ConstantInt::get(lltype, i % 31 + 1) :
+				values[values.size() - 1 - (i * 13) % values.size()];
+		std::ostringstream name;
+		name << "t" << i;
+		values.push_back(builder.CreateBinOp(opcode, lhs, rhs, name.str()));
+	}
+	builder.CreateRet(values.back());
+	return module;
+}
@@ -0,0 +1,23 @@
+/**
+ * @file   Synthetic.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  Generator of synthetic LLVM functions, used to measure the code
+ *         generator on very large datapaths.
+ */
+
+#ifndef DRIVER_SYNTHETIC_H
+#define DRIVER_SYNTHETIC_H
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+/// Return a new module with a single function 'synthetic', taking four i32
+/// arguments and computing its result through 'num_instructions' binary
+/// operations. Every operation uses the previous result and an earlier value
+/// or a constant, so that values have several uses. The caller owns the
+/// module.
+llvm::Module *createSyntheticModule(llvm::LLVMContext &llvm_context,
+		unsigned num_instructions);
+
+#endif
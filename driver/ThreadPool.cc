@@ -0,0 +1,79 @@
+/**
+ * @file   ThreadPool.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  Work-stealing thread pool definition.
+ */
+
+#include <thread>
+
+#include "ThreadPool.h"
+
+
+ThreadPool::ThreadPool(unsigned num_threads) : num_threads(num_threads)
+{
+	if (!this->num_threads)
+		this->num_threads = std::thread::hardware_concurrency();
+	if (!this->num_threads)
+		this->num_threads = 1;
+	for (unsigned i = 0; i < this->num_threads; i++)
+		queues.push_back(std::unique_ptr<Queue>(new Queue()));
+}
+
+bool ThreadPool::pop(unsigned worker, size_t &task)
+{
+	Queue &queue = *queues[worker];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tasks.empty())
+		return false;
+	task = queue.tasks.front();
+	queue.tasks.pop_front();
+	return true;
+}
+
+bool ThreadPool::steal(unsigned worker, size_t &task)
+{
+	// Visit victims starting at the next worker, so that thieves spread
+	// over different queues.
+	for (unsigned i = 1; i < num_threads; i++)
+	{
+		Queue &queue = *queues[(worker + i) % num_threads];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+			continue;
+		task = queue.tasks.back();
+		queue.tasks.pop_back();
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::run(size_t num_tasks,
+		const std::function<void(size_t task, unsigned worker)> &function)
+{
+	// Distribute contiguous ranges of tasks. No task is added once the
+	// workers start, so a worker finding all queues empty is done.
+	for (unsigned worker = 0; worker < num_threads; worker++)
+	{
+		size_t begin = num_tasks * worker / num_threads;
+		size_t end = num_tasks * (worker + 1) / num_threads;
+		for (size_t task = begin; task < end; task++)
+			queues[worker]->tasks.push_back(task);
+	}
+
+	// Worker loop
+	auto work = [&](unsigned worker)
+	{
+		size_t task;
+		while (pop(worker, task) || steal(worker, task))
+			function(task, worker);
+	};
+
+	// Run workers, the calling thread being worker 0
+	std::vector<std::thread> threads;
+	for (unsigned worker = 1; worker < num_threads; worker++)
+		threads.push_back(std::thread(work, worker));
+	work(0);
+	for (std::thread &thread : threads)
+		thread.join();
+}
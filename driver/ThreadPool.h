@@ -0,0 +1,59 @@
+/**
+ * @file   ThreadPool.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  Work-stealing thread pool used by the batch compilation mode.
+ */
+
+#ifndef DRIVER_THREAD_POOL_H
+#define DRIVER_THREAD_POOL_H
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+class ThreadPool
+{
+	// Task queue of a worker. Its owner takes tasks from the front, and
+	// idle workers steal tasks from the back.
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<size_t> tasks;
+	};
+
+	// Number of worker threads
+	unsigned num_threads;
+
+	// One task queue per worker
+	std::vector<std::unique_ptr<Queue>> queues;
+
+	// Take the next task of the given worker from its own queue. Return
+	// false if the queue is empty.
+	bool pop(unsigned worker, size_t &task);
+
+	// Take a task from the queue of another worker. Return false if all
+	// queues are empty.
+	bool steal(unsigned worker, size_t &task);
+
+public:
+
+	/// Constructor. A value of 0 uses one thread per hardware core.
+	ThreadPool(unsigned num_threads = 0);
+
+	/// Return the number of worker threads
+	unsigned getNumThreads() { return num_threads; }
+
+	/// Run 'function(task, worker)' for every task in [0, num_tasks), and
+	/// return when all tasks are done. Tasks are initially split into
+	/// contiguous ranges, one per worker, and balanced by work stealing.
+	/// Argument 'worker' identifies the thread running the task, so that
+	/// callers can keep per-worker state.
+	void run(size_t num_tasks,
+			const std::function<void(size_t task, unsigned worker)> &function);
+};
+
+#endif
@@ -0,0 +1,573 @@
+/**
+ * @file   c-ll-verilog.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  Single-process compile driver: parses a mini-C file, promotes
+ *         memory to registers, and runs the verilog code generator on the
+ *         in-memory LLVM module, without printing and re-parsing the IR.
+ *         Several files, or whole directories, can be compiled in parallel.
+ */
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/PassManager.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Scalar.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include "Error.h"
+#include "Frontend.h"
+#include "Synthetic.h"
+#include "ThreadPool.h"
+#include "VERILOGPass.h"
+
+
+// Command line options
+static llvm::cl::list<std::string> InputFilenames(llvm::cl::Positional,
+		llvm::cl::desc("<input .c files or directories>"),
+		llvm::cl::ZeroOrMore);
+
+static llvm::cl::opt<std::string> FileList("file-list",
+		llvm::cl::desc("Compile the files listed in <file>, one per line"),
+		llvm::cl::value_desc("file"));
+
+static llvm::cl::opt<std::string> OutputFilename("o",
+		llvm::cl::desc("Output verilog file (default: <input>.v, '-' for stdout)"),
+		llvm::cl::value_desc("filename"));
+
+static llvm::cl::opt<unsigned> NumThreads("j",
+		llvm::cl::desc("Number of threads in batch mode (default: one per core)"),
+		llvm::cl::value_desc("threads"),
+		llvm::cl::init(0));
+
+static llvm::cl::opt<bool> EmitLL("emit-ll",
+		llvm::cl::desc("Also write the optimized LLVM code to <input>.ll"));
+
+static llvm::cl::opt<bool> TimeStages("time-stages",
+		llvm::cl::desc("Report wall-clock time spent in each compilation stage"));
+
+static llvm::cl::opt<bool> CodegenStats("codegen-stats",
+		llvm::cl::desc("Report memory statistics of the code generator"));
+
+static llvm::cl::opt<bool> EmitToMemory("emit-to-memory",
+		llvm::cl::desc("Print verilog code into a memory buffer and discard it, "
+				"to measure the emitter without file output"));
+
+static llvm::cl::opt<unsigned> Synthetic("synthetic",
+		llvm::cl::desc("Translate a synthetic function with <n> instructions "
+				"instead of input files (default output: synthetic.v)"),
+		llvm::cl::value_desc("n"),
+		llvm::cl::init(0));
+
+static llvm::cl::opt<bool> CheckParse("check-parse",
+		llvm::cl::desc("Parse the input files serially, then again on the "
+				"thread pool, and report the files whose LLVM code differs"));
+
+static llvm::cl::opt<unsigned> CheckParseRounds("check-parse-rounds",
+		llvm::cl::desc("Number of times each file is parsed on the thread "
+				"pool with -check-parse (default: 4)"),
+		llvm::cl::value_desc("n"),
+		llvm::cl::init(4));
+
+
+// Wall-clock timer for the compilation stages
+class StageTimer
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// Stage names and accumulated time, in seconds
+	std::vector<std::pair<std::string, double>> stages;
+
+	// Start time of the current stage
+	Clock::time_point start;
+
+public:
+
+	// Start timing a new stage
+	void begin()
+	{
+		start = Clock::now();
+	}
+
+	// Stop timing the current stage, and add its time to the stage with
+	// the given name.
+	void end(const std::string &name)
+	{
+		std::chrono::duration<double> elapsed = Clock::now() - start;
+		add(name, elapsed.count());
+	}
+
+	// Add time to a stage
+	void add(const std::string &name, double seconds)
+	{
+		for (auto &stage : stages)
+		{
+			if (stage.first == name)
+			{
+				stage.second += seconds;
+				return;
+			}
+		}
+		stages.push_back(std::make_pair(name, seconds));
+	}
+
+	// Add the times of all stages of another timer
+	void merge(const StageTimer &other)
+	{
+		for (auto &stage : other.stages)
+			add(stage.first, stage.second);
+	}
+
+	// Print a report of all stages
+	void dump(std::ostream &os)
+	{
+		double total = 0;
+		os << "===-- c-ll-verilog stage timings --===\n";
+		for (auto &stage : stages)
+		{
+			os << "  " << std::left << std::setw(10) << stage.first
+					<< std::right << std::fixed << std::setprecision(3)
+					<< std::setw(10) << stage.second * 1e3 << " ms\n";
+			total += stage.second;
+		}
+		os << "  " << std::left << std::setw(10) << "total"
+				<< std::right << std::fixed << std::setprecision(3)
+				<< std::setw(10) << total * 1e3 << " ms\n";
+	}
+};
+
+
+// Code generator counters, added over all compiled files
+struct CodegenStatistics
+{
+	// Number of translated functions
+	unsigned num_functions = 0;
+
+	// Size of the verilog IR
+	verilog::ModuleStatistics ir;
+
+	// Netlist optimization counters
+	verilog::OptimizerStatistics optimizer;
+
+	// Characters of verilog code emitted, and time spent emitting them
+	size_t emitted_bytes = 0;
+	double emit_seconds = 0;
+
+	// Add the counters of another file or worker
+	void add(const CodegenStatistics &other)
+	{
+		num_functions += other.num_functions;
+		ir.add(other.ir);
+		optimizer.add(other.optimizer);
+		emitted_bytes += other.emitted_bytes;
+		emit_seconds += other.emit_seconds;
+	}
+
+	// Print a report, including the peak resident set size of the process
+	void dump(std::ostream &os)
+	{
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		double functions = num_functions ? num_functions : 1;
+		os << "===-- c-ll-verilog codegen statistics --===\n";
+		os << std::fixed << std::setprecision(1);
+		os << "  functions                      " << num_functions << '\n';
+		os << "  code blocks per function       " << ir.num_code_blocks / functions << '\n';
+		os << "  nets per function              " << ir.num_nets / functions << '\n';
+		os << "  dataflows per function         " << ir.num_dataflows / functions << '\n';
+		os << "  IR bytes per function          " << ir.num_bytes / functions << '\n';
+		os << "  heap blocks per function       " << ir.num_heap_blocks / functions << '\n';
+		os << "  verilog bytes emitted          " << emitted_bytes << '\n';
+		os << "  emitter throughput             " << (emit_seconds > 0 ?
+				emitted_bytes / emit_seconds / 1e6 : 0) << " MB/s\n";
+		os << "  peak RSS                       " << usage.ru_maxrss << " KB\n";
+		optimizer.dump(os);
+	}
+};
+
+
+// Return the file name without its extension
+static std::string stripExtension(const std::string &file_name)
+{
+	size_t dot = file_name.find_last_of('.');
+	size_t slash = file_name.find_last_of('/');
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		return file_name;
+	return file_name.substr(0, dot);
+}
+
+
+// Add all '.c' files under a directory to the input list, in alphabetical
+// order so that the batch order does not depend on the file system.
+static void addDirectory(const std::string &dir_name,
+		std::vector<std::string> &inputs)
+{
+	DIR *dir = opendir(dir_name.c_str());
+	if (!dir)
+	{
+		std::cerr << "Cannot open directory: " << dir_name << '\n';
+		exit(1);
+	}
+	std::vector<std::string> entries;
+	while (struct dirent *entry = readdir(dir))
+	{
+		std::string name = entry->d_name;
+		if (name != "." && name != "..")
+			entries.push_back(dir_name + "/" + name);
+	}
+	closedir(dir);
+	std::sort(entries.begin(), entries.end());
+
+	for (const std::string &entry : entries)
+	{
+		struct stat info;
+		if (stat(entry.c_str(), &info))
+			continue;
+		if (S_ISDIR(info.st_mode))
+			addDirectory(entry, inputs);
+		else if (entry.size() > 2 && entry.compare(entry.size() - 2, 2, ".c") == 0)
+			inputs.push_back(entry);
+	}
+}
+
+
+// Add a file or the contents of a directory to the input list
+static void addInput(const std::string &name, std::vector<std::string> &inputs)
+{
+	struct stat info;
+	if (!stat(name.c_str(), &info) && S_ISDIR(info.st_mode))
+		addDirectory(name, inputs);
+	else
+		inputs.push_back(name);
+}
+
+
+// Run the verilog code generator on all functions of an LLVM module
+static void translateModule(llvm::Module *module,
+		verilog::Sink &sink,
+		StageTimer &timer,
+		CodegenStatistics &statistics)
+{
+	timer.begin();
+	verilog::VERILOGPass verilog_pass(sink);
+	verilog_pass.doInitialization(*module);
+	try
+	{
+		for (llvm::Function &function : *module)
+			if (!function.isDeclaration())
+				verilog_pass.runOnFunction(function);
+		sink.flush();
+	}
+	catch (const verilog::Error &)
+	{
+		// Hex files of the modules already printed are not used
+		for (const std::string &path : verilog_pass.getEmitter().getHexFiles())
+			remove(path.c_str());
+		throw;
+	}
+	timer.end("codegen");
+	statistics.num_functions += verilog_pass.getNumFunctions();
+	statistics.ir.add(verilog_pass.getStatistics());
+	statistics.optimizer.add(verilog_pass.getOptimizerStatistics());
+	statistics.emitted_bytes += verilog_pass.getEmitter().getNumBytes();
+	statistics.emit_seconds += verilog_pass.getEmitter().getSeconds();
+}
+
+
+// Compile one file into the given sink, using the given LLVM
+// context. The time of each stage is added to 'timer', and the code
+// generator counters to 'statistics'.
+static void compileFile(const std::string &input_name,
+		verilog::Sink &sink,
+		llvm::LLVMContext &llvm_context,
+		StageTimer &timer,
+		CodegenStatistics &statistics)
+{
+	// Parse. The module must be released before its LLVM context, even
+	// if the compilation fails.
+	timer.begin();
+	std::unique_ptr<llvm::Module> module(parseFile(input_name, llvm_context));
+	timer.end("parse");
+
+	// Promote memory to registers, same as 'opt -mem2reg'
+	timer.begin();
+	llvm::FunctionPassManager function_pass_manager(module.get());
+	function_pass_manager.add(llvm::createPromoteMemoryToRegisterPass());
+	function_pass_manager.doInitialization();
+	for (llvm::Function &function : *module)
+		function_pass_manager.run(function);
+	function_pass_manager.doFinalization();
+	timer.end("mem2reg");
+
+	// Optionally keep the LLVM code, as 'simpleHLS.bash' does
+	if (EmitLL)
+	{
+		std::string ll_code;
+		llvm::raw_string_ostream ll_stream(ll_code);
+		module->print(ll_stream, nullptr);
+		std::ofstream ll_file(stripExtension(input_name) + ".ll");
+		ll_file << ll_stream.str();
+	}
+
+	// Verilog code generation on the in-memory module
+	translateModule(module.get(), sink, timer, statistics);
+}
+
+
+// Parse a file and return its LLVM code as text, or its error message
+static std::string printParsedFile(const std::string &input_name,
+		llvm::LLVMContext &llvm_context)
+{
+	llvm::Module *module;
+	try
+	{
+		module = parseFile(input_name, llvm_context);
+	}
+	catch (const ParseError &error)
+	{
+		return std::string("error: ") + error.what();
+	}
+	std::string ll_code;
+	llvm::raw_string_ostream ll_stream(ll_code);
+	module->print(ll_stream, nullptr);
+	ll_stream.flush();
+	delete module;
+	return ll_code;
+}
+
+
+// Stress test of the reentrant parser. Every input is parsed serially
+// first, then 'CheckParseRounds' times on the thread pool, with the
+// tasks of all rounds interleaved so that threads parse the same files
+// at once. Files whose LLVM code differs from the serial one are
+// reported. Return the number of files reported.
+static unsigned checkParse(const std::vector<std::string> &inputs)
+{
+	// Reference code, in the global context
+	std::vector<std::string> serial;
+	for (const std::string &input_name : inputs)
+		serial.push_back(printParsedFile(input_name,
+				llvm::getGlobalContext()));
+
+	// Same files on the thread pool, one LLVM context per worker
+	ThreadPool thread_pool(NumThreads);
+	unsigned num_threads = thread_pool.getNumThreads();
+	if (num_threads > 1)
+		llvm::llvm_start_multithreaded();
+	std::vector<std::unique_ptr<llvm::LLVMContext>> contexts;
+	for (unsigned i = 0; i < num_threads; i++)
+		contexts.push_back(std::unique_ptr<llvm::LLVMContext>(
+				new llvm::LLVMContext()));
+	unsigned num_rounds = std::max(1u, (unsigned) CheckParseRounds);
+	std::vector<std::string> parallel(inputs.size() * num_rounds);
+	thread_pool.run(parallel.size(), [&](size_t task, unsigned worker)
+	{
+		parallel[task] = printParsedFile(inputs[task % inputs.size()],
+				*contexts[worker]);
+	});
+
+	// Compare
+	unsigned num_errors = 0;
+	for (size_t index = 0; index < inputs.size(); index++)
+	{
+		for (unsigned round = 0; round < num_rounds; round++)
+		{
+			if (parallel[round * inputs.size() + index] == serial[index])
+				continue;
+			std::cerr << inputs[index] << ": LLVM code of round "
+					<< round << " differs from the serial parse\n";
+			num_errors++;
+			break;
+		}
+	}
+	std::cerr << "Parse check: " << inputs.size() << " files, "
+			<< num_rounds << " rounds, " << num_threads << " threads, "
+			<< num_errors << " mismatches\n";
+	return num_errors;
+}
+
+
+// Open the sink receiving the verilog code of an input file. Name '-'
+// stands for the standard output.
+static std::unique_ptr<verilog::Sink> openOutput(const std::string &output_name)
+{
+	if (EmitToMemory)
+		return std::unique_ptr<verilog::Sink>(new verilog::MemorySink());
+	return std::unique_ptr<verilog::Sink>(new verilog::FileSink(output_name));
+}
+
+
+// Compile one file into the given output. Errors of the parser and the
+// code generator only fail this file: they are reported with its name,
+// and its output and hex files are removed. Return whether it succeeded.
+static bool compileOutput(const std::string &input_name,
+		const std::string &output_name,
+		llvm::LLVMContext &llvm_context,
+		StageTimer &timer,
+		CodegenStatistics &statistics)
+{
+	verilog::ErrorTrap error_trap;
+	bool opened = false;
+	try
+	{
+		std::unique_ptr<verilog::Sink> sink = openOutput(output_name);
+		opened = true;
+		compileFile(input_name, *sink, llvm_context, timer, statistics);
+		return true;
+	}
+	catch (const ParseError &error)
+	{
+		std::cerr << input_name << ": " << error.what() << '\n';
+	}
+	catch (const verilog::Error &error)
+	{
+		std::cerr << input_name << ": " << error.what() << '\n';
+	}
+	if (opened && !EmitToMemory && output_name != "-")
+		remove(output_name.c_str());
+	return false;
+}
+
+
+int main(int argc, char **argv)
+{
+	llvm::cl::ParseCommandLineOptions(argc, argv,
+			"c-ll-verilog mini-C to verilog compiler\n");
+
+	// Synthetic function, used to measure the code generator
+	StageTimer timer;
+	CodegenStatistics statistics;
+	if (Synthetic)
+	{
+		std::string output_name = OutputFilename.empty() ?
+				"synthetic.v" : std::string(OutputFilename);
+		std::unique_ptr<verilog::Sink> sink = openOutput(output_name);
+		timer.begin();
+		llvm::Module *module = createSyntheticModule(
+				llvm::getGlobalContext(), Synthetic);
+		timer.end("generate");
+		translateModule(module, *sink, timer, statistics);
+		delete module;
+		if (TimeStages)
+			timer.dump(std::cerr);
+		if (CodegenStats)
+			statistics.dump(std::cerr);
+		return 0;
+	}
+
+	// Collect inputs
+	std::vector<std::string> inputs;
+	for (const std::string &name : InputFilenames)
+		addInput(name, inputs);
+	if (!FileList.empty())
+	{
+		std::ifstream list(FileList);
+		if (!list)
+		{
+			std::cerr << "Cannot open file list: " << FileList << '\n';
+			exit(1);
+		}
+		std::string line;
+		while (std::getline(list, line))
+			if (!line.empty())
+				addInput(line, inputs);
+	}
+	if (inputs.empty())
+	{
+		std::cerr << "No input files\n";
+		exit(1);
+	}
+
+	// Parser stress test, without code generation
+	if (CheckParse)
+		return checkParse(inputs) ? 1 : 0;
+
+	// Single file
+	if (inputs.size() == 1 && FileList.empty())
+	{
+		std::string output_name = OutputFilename.empty() ?
+				stripExtension(inputs[0]) + ".v" :
+				std::string(OutputFilename);
+		bool succeeded = compileOutput(inputs[0], output_name,
+				llvm::getGlobalContext(), timer, statistics);
+		if (TimeStages)
+			timer.dump(std::cerr);
+		if (CodegenStats)
+			statistics.dump(std::cerr);
+		return succeeded ? 0 : 1;
+	}
+
+	// Batch mode. Every input produces its own '.v' file, and a file
+	// failing does not stop the other ones.
+	if (!OutputFilename.empty())
+	{
+		std::cerr << "Option -o is not allowed with several input files\n";
+		exit(1);
+	}
+	ThreadPool thread_pool(NumThreads);
+	unsigned num_threads = thread_pool.getNumThreads();
+	if (num_threads > 1)
+		llvm::llvm_start_multithreaded();
+
+	// Each worker owns an LLVM context, a timer, and counters. Output
+	// names only depend on the input, and wires are numbered per module,
+	// so the generated code does not depend on the number of threads.
+	std::vector<std::unique_ptr<llvm::LLVMContext>> contexts;
+	std::vector<StageTimer> timers(num_threads);
+	std::vector<CodegenStatistics> worker_statistics(num_threads);
+	for (unsigned i = 0; i < num_threads; i++)
+		contexts.push_back(std::unique_ptr<llvm::LLVMContext>(
+				new llvm::LLVMContext()));
+
+	std::vector<char> failed(inputs.size());
+	auto start = std::chrono::steady_clock::now();
+	thread_pool.run(inputs.size(), [&](size_t task, unsigned worker)
+	{
+		failed[task] = !compileOutput(inputs[task],
+				stripExtension(inputs[task]) + ".v", *contexts[worker],
+				timers[worker], worker_statistics[worker]);
+	});
+	std::chrono::duration<double> elapsed =
+			std::chrono::steady_clock::now() - start;
+
+	// Report, with stage times added over all threads
+	if (TimeStages)
+	{
+		for (StageTimer &worker_timer : timers)
+			timer.merge(worker_timer);
+		timer.dump(std::cerr);
+		std::cerr << "  " << inputs.size() << " files, " << num_threads
+				<< " threads, " << std::fixed << std::setprecision(3)
+				<< elapsed.count() * 1e3 << " ms wall-clock\n";
+	}
+	if (CodegenStats)
+	{
+		for (CodegenStatistics &worker : worker_statistics)
+			statistics.add(worker);
+		statistics.dump(std::cerr);
+	}
+	size_t num_failed = std::count(failed.begin(), failed.end(), 1);
+	if (num_failed)
+	{
+		std::cerr << num_failed << " of " << inputs.size()
+				<< " files failed\n";
+		return 1;
+	}
+	return 0;
+}
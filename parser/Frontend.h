@@ -0,0 +1,34 @@
+/**
+ * @file   Frontend.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  Entry point of the mini-C parser, used by the parser tool and the
+ *         c-ll-verilog compile driver.
+ */
+
+#ifndef FRONTEND_H
+#define FRONTEND_H
+
+#include <stdexcept>
+#include <string>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+/// Error found in a mini-C file, with its message
+class ParseError : public std::runtime_error
+{
+public:
+	explicit ParseError(const std::string &message) :
+			std::runtime_error(message) { }
+};
+
+/// Parse the given mini-C file and return the LLVM module generated for it
+/// in the given LLVM context. The caller takes ownership of the module.
+/// Errors throw a ParseError, so that a file failing in a batch does not
+/// stop the other ones. The parser keeps no global state, so this function
+/// can be called from several threads at once, each with its own LLVM
+/// context.
+llvm::Module *parseFile(const std::string &file_name,
+		llvm::LLVMContext &llvm_context);
+
+#endif
@@ -0,0 +1,38 @@
+/**
+ * @file   ParserContext.cc
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  The ParserContext class definition.
+ */
+
+#include <sstream>
+
+#include "ParserContext.h"
+#include "SymbolTable.h"
+
+ParserContext::ParserContext(llvm::LLVMContext &llvm_context) :
+		llvm_context(llvm_context)
+{
+	builder = new llvm::IRBuilder<>(llvm_context);
+	module = new llvm::Module("TestModule", llvm_context);
+}
+
+ParserContext::~ParserContext()
+{
+	// The module is handed over to the caller of the parser
+	delete builder;
+}
+
+std::string ParserContext::getTemp()
+{
+	std::ostringstream stream;
+	stream << "t" << temp_index++;
+	return stream.str();
+}
+
+std::string ParserContext::getBasicBlock()
+{
+	std::ostringstream stream;
+	stream << "L" << basic_block_index++;
+	return stream.str();
+}
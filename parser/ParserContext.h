@@ -0,0 +1,58 @@
+/**
+ * @file   ParserContext.h
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  The ParserContext class holds the state of the compilation of one
+ *         file, so that several files can be parsed at the same time.
+ */
+
+#ifndef PARSER_CONTEXT_H
+#define PARSER_CONTEXT_H
+
+#include <list>
+#include <string>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+// Forward declarations
+class SymbolTable;
+
+
+class ParserContext
+{
+	// Index of next temporary variable
+	int temp_index = 0;
+
+	// Index of next basic block
+	int basic_block_index = 0;
+
+public:
+
+	/// Constructor. It creates an empty LLVM module in the given context.
+	ParserContext(llvm::LLVMContext &llvm_context);
+
+	/// Destructor
+	~ParserContext();
+
+	/// LLVM context of the file being parsed
+	llvm::LLVMContext &llvm_context;
+
+	/// Module, function, basic block, and builder
+	llvm::Module *module;
+	llvm::Function *function = nullptr;
+	llvm::BasicBlock *basic_block = nullptr;
+	llvm::IRBuilder<> *builder;
+
+	/// Environment: stack of symbol tables. It is actually implemented as
+	/// a list to facilitate the traversal of symbol tables.
+	std::list<SymbolTable *> environment;
+
+	/// Return the name of a new temporary variable
+	std::string getTemp();
+
+	/// Return the name of a new basic block
+	std::string getBasicBlock();
+};
+
+#endif
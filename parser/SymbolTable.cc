@@ -24,23 +24,6 @@ void Symbol::dump(int indent)
 	type->dump(indent + 2);
 }
 
-int Symbol::temp_index = 0;
-int Symbol::basic_block_index = 0;
-
-std::string Symbol::getTemp()
-{
-	std::ostringstream stream;
-	stream << "t" << temp_index++;
-	return stream.str();
-}
-
-std::string Symbol::getBasicBlock()
-{
-	std::ostringstream stream;
-	stream << "L" << basic_block_index++;
-	return stream.str();
-}
-
 
 Symbol *SymbolTable::getSymbol(const std::string &name)
 {
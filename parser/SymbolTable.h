@@ -21,12 +21,6 @@ class Symbol
 	// Symbol name
 	std::string name;
 
-	// Index of next temporary variable
-	static int temp_index;
-
-	// Index of next basic block
-	static int basic_block_index;
-
 public:
 	
 	/// Constructor
@@ -48,12 +42,6 @@ public:
 
 	/// Dump information about the symbol
 	void dump(int indent = 0);
-
-	/// Return the name of a new temporary variable
-	static std::string getTemp();
-
-	/// Return the name of a new basic block
-	static std::string getBasicBlock();
 };
 
 class SymbolTable
@@ -60,6 +60,10 @@ public:
 	/// Associated LLVM type
 	llvm::Type *lltype = nullptr;
 
+	/// Whether the type is qualified by 'const'. Global variables of
+	/// constant types are LLVM constants, and cannot be assigned.
+	bool is_constant = false;
+
 	/// For types of kind 'KindArray' and 'KindPointer', type of array
 	/// elements or elements pointed to.
 	Type *subtype = nullptr;
@@ -0,0 +1,36 @@
+/**
+ * @file   main.cc
+ * @Author Rafael Ubal (ubal@ece.neu.edu), Northeastern University
+ * @Author Majid Sabbagh (sabbagh.m@husky.neu.edu), Northeastern University
+ * @date   Dec, 2016
+ * @brief  The stand-alone parser tool, dumping the LLVM code of a mini-C file.
+ */
+
+#include <iostream>
+#include <cstdlib>
+
+#include "Frontend.h"
+
+int main(int argc, char **argv)
+{
+	// Syntax
+	if (argc != 2)
+	{
+		std::cerr << "Syntax: ./main <file>\n";
+		exit(1);
+	}
+	// Parse file
+	llvm::Module *module;
+	try
+	{
+		module = parseFile(argv[1], llvm::getGlobalContext());
+	}
+	catch (const ParseError &error)
+	{
+		std::cerr << error.what() << '\n';
+		exit(1);
+	}
+	// Dump module
+	module->dump();
+	return 0;
+}
@@ -1,21 +1,22 @@
-/* A Bison parser, made by GNU Bison 2.7.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
 /* Bison interface for Yacc-like parsers in C
-   
-      Copyright (C) 1984, 1989-1990, 2000-2012 Free Software Foundation, Inc.
-   
+
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
+
    This program is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
    the Free Software Foundation, either version 3 of the License, or
    (at your option) any later version.
-   
+
    This program is distributed in the hope that it will be useful,
    but WITHOUT ANY WARRANTY; without even the implied warranty of
    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
    GNU General Public License for more details.
-   
+
    You should have received a copy of the GNU General Public License
-   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -26,76 +27,102 @@
    special exception, which will cause the skeleton and the resulting
    Bison output files to be licensed under the GNU General Public
    License without this special exception.
-   
+
    This special exception was added by the Free Software Foundation in
    version 2.2 of Bison.  */
 
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
 #ifndef YY_YY_PARSER_H_INCLUDED
 # define YY_YY_PARSER_H_INCLUDED
-/* Enabling traces.  */
+/* Debug traces.  */
 #ifndef YYDEBUG
 # define YYDEBUG 0
 #endif
 #if YYDEBUG
 extern int yydebug;
 #endif
+/* "%code requires" blocks.  */
+#line 25 "parser.y"
+
+#include <vector>
+
+// All parser state lives in a 'ParserContext' object, and the reentrant
+// scanner state is passed as an opaque pointer.
+class ParserContext;
+
+// Initializer of a declaration: a number, or a list of initializers
+// between braces if 'elements' is set
+struct Initializer
+{
+	int value = 0;
+	std::vector<Initializer *> *elements = nullptr;
+};
+
+#line 65 "parser.h"
 
-/* Tokens.  */
+/* Token kinds.  */
 #ifndef YYTOKENTYPE
 # define YYTOKENTYPE
-   /* Put the tokens into the symbol table, so that GDB and other debuggers
-      know about them.  */
-   enum yytokentype {
-     TokenBool = 258,
-     TokenShort = 259,
-     TokenInt = 260,
-     TokenFloat = 261,
-     TokenVoid = 262,
-     TokenStruct = 263,
-     TokenId = 264,
-     TokenNumber = 265,
-     TokenOpenCurly = 266,
-     TokenCloseCurly = 267,
-     TokenOpenSquare = 268,
-     TokenCloseSquare = 269,
-     TokenOpenPar = 270,
-     TokenClosePar = 271,
-     TokenSemicolon = 272,
-     TokenComma = 273,
-     TokenPoint = 274,
-     TokenEqual = 275,
-     TokenLogicalOr = 276,
-     TokenLogicalAnd = 277,
-     TokenLogicalNot = 278,
-     Toke = 279,
-     TokenGreaterThan = 280,
-     TokenLessThan = 281,
-     TokenGreaterEqual = 282,
-     TokenLessEqual = 283,
-     TokenNotEqual = 284,
-     TokenDoubleEqual = 285,
-     TokenBitwiseOr = 286,
-     TokenBitwiseXor = 287,
-     TokenBitwiseAnd = 288,
-     TokenLogicalShiftRight = 289,
-     TokenMinus = 290,
-     TokenPlus = 291,
-     TokenDiv = 292,
-     TokenMult = 293,
-     TokenIf = 294,
-     TokenThen = 295,
-     TokenElse = 296,
-     TokenWhile = 297,
-     TokenReturn = 298
-   };
+  enum yytokentype
+  {
+    YYEMPTY = -2,
+    YYEOF = 0,                     /* "end of file"  */
+    YYerror = 256,                 /* error  */
+    YYUNDEF = 257,                 /* "invalid token"  */
+    TokenBool = 258,               /* TokenBool  */
+    TokenShort = 259,              /* TokenShort  */
+    TokenInt = 260,                /* TokenInt  */
+    TokenFloat = 261,              /* TokenFloat  */
+    TokenVoid = 262,               /* TokenVoid  */
+    TokenStruct = 263,             /* TokenStruct  */
+    TokenConst = 264,              /* TokenConst  */
+    TokenId = 265,                 /* TokenId  */
+    TokenNumber = 266,             /* TokenNumber  */
+    TokenOpenCurly = 267,          /* TokenOpenCurly  */
+    TokenCloseCurly = 268,         /* TokenCloseCurly  */
+    TokenOpenSquare = 269,         /* TokenOpenSquare  */
+    TokenCloseSquare = 270,        /* TokenCloseSquare  */
+    TokenOpenPar = 271,            /* TokenOpenPar  */
+    TokenClosePar = 272,           /* TokenClosePar  */
+    TokenSemicolon = 273,          /* TokenSemicolon  */
+    TokenComma = 274,              /* TokenComma  */
+    TokenPoint = 275,              /* TokenPoint  */
+    TokenEqual = 276,              /* TokenEqual  */
+    TokenLogicalOr = 277,          /* TokenLogicalOr  */
+    TokenLogicalAnd = 278,         /* TokenLogicalAnd  */
+    TokenLogicalNot = 279,         /* TokenLogicalNot  */
+    Toke = 280,                    /* Toke  */
+    TokenGreaterThan = 281,        /* TokenGreaterThan  */
+    TokenLessThan = 282,           /* TokenLessThan  */
+    TokenGreaterEqual = 283,       /* TokenGreaterEqual  */
+    TokenLessEqual = 284,          /* TokenLessEqual  */
+    TokenNotEqual = 285,           /* TokenNotEqual  */
+    TokenDoubleEqual = 286,        /* TokenDoubleEqual  */
+    TokenPlus = 287,               /* TokenPlus  */
+    TokenMinus = 288,              /* TokenMinus  */
+    TokenLogicalShiftRight = 289,  /* TokenLogicalShiftRight  */
+    TokenBitwiseAnd = 290,         /* TokenBitwiseAnd  */
+    TokenBitwiseXor = 291,         /* TokenBitwiseXor  */
+    TokenBitwiseOr = 292,          /* TokenBitwiseOr  */
+    TokenMult = 293,               /* TokenMult  */
+    TokenDiv = 294,                /* TokenDiv  */
+    TokenIf = 295,                 /* TokenIf  */
+    TokenThen = 296,               /* TokenThen  */
+    TokenElse = 297,               /* TokenElse  */
+    TokenWhile = 298,              /* TokenWhile  */
+    TokenReturn = 299              /* TokenReturn  */
+  };
+  typedef enum yytokentype yytoken_kind_t;
 #endif
 
-
+/* Value type.  */
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-typedef union YYSTYPE
+union YYSTYPE
 {
-/* Line 2058 of yacc.c  */
-#line 78 "parser.y"
+#line 206 "parser.y"
 
 	char *name;
 	llvm::Value *llvalue;
@@ -103,6 +130,10 @@ typedef union YYSTYPE
 	Type *type;
 	std::list<int> *indices;
 
+	// For 'Initializer', 'InitializerValue' and 'InitializerList'
+	Initializer *initializer;
+	std::vector<Initializer *> *initializers;
+
 	// For LValue
 	struct {
 		Type *type;
@@ -140,29 +171,18 @@ typedef union YYSTYPE
 	// For 'ActualArguments' and 'ActualArgummentsComma'
 	std::vector<llvm::Value *> *actual_arguments;
 
+#line 175 "parser.h"
 
-/* Line 2058 of yacc.c  */
-#line 146 "parser.h"
-} YYSTYPE;
+};
+typedef union YYSTYPE YYSTYPE;
 # define YYSTYPE_IS_TRIVIAL 1
-# define yystype YYSTYPE /* obsolescent; will be withdrawn */
 # define YYSTYPE_IS_DECLARED 1
 #endif
 
-extern YYSTYPE yylval;
 
-#ifdef YYPARSE_PARAM
-#if defined __STDC__ || defined __cplusplus
-int yyparse (void *YYPARSE_PARAM);
-#else
-int yyparse ();
-#endif
-#else /* ! YYPARSE_PARAM */
-#if defined __STDC__ || defined __cplusplus
-int yyparse (void);
-#else
-int yyparse ();
-#endif
-#endif /* ! YYPARSE_PARAM */
+
+
+int yyparse (ParserContext *context, void *scanner);
+
 
 #endif /* !YY_YY_PARSER_H_INCLUDED  */
@@ -18,22 +18,138 @@
 
 #include "SymbolTable.h"
 #include "Type.h"
+#include "ParserContext.h"
+#include "Frontend.h"
+%}
 
-extern "C" int yylex();
-extern "C" int yyparse();
-extern "C" FILE *yyin;
-void yyerror(const char *s);
+%code requires {
+#include <vector>
 
-// Module, function, basic block, and builder
-llvm::Module *module;
-llvm::Function *function;
-llvm::BasicBlock *basic_block;
-llvm::IRBuilder<> *builder;
+// All parser state lives in a 'ParserContext' object, and the reentrant
+// scanner state is passed as an opaque pointer.
+class ParserContext;
 
-// Environment: stack of symbol tables. It is actually implemented as a list
-// to facilitate the traversal of symbol tables.
-std::list<SymbolTable *> environment;
-%}
+// Initializer of a declaration: a number, or a list of initializers
+// between braces if 'elements' is set
+struct Initializer
+{
+	int value = 0;
+	std::vector<Initializer *> *elements = nullptr;
+};
+}
+
+%code {
+int yylex(YYSTYPE *yylval_param, void *scanner);
+int yylex_init(void **scanner);
+int yylex_destroy(void *scanner);
+void yyset_in(FILE *in, void *scanner);
+void yyerror(ParserContext *context, void *scanner, const char *s);
+
+// Return the number of scalar words of a type
+static size_t getNumWords(Type *type)
+{
+	return type->getKind() == Type::KindArray ?
+			type->num_elem * getNumWords(type->subtype) : 1;
+}
+
+static void fillObject(Type *type, const std::vector<Initializer *> &list,
+		size_t &position, std::vector<long long> &words, size_t offset,
+		const std::string &name);
+
+// Fill the elements of an array from the initializers of 'list' from
+// 'position', while they last. Missing elements stay zero.
+static void fillArray(Type *type, const std::vector<Initializer *> &list,
+		size_t &position, std::vector<long long> &words, size_t offset,
+		const std::string &name)
+{
+	size_t size = getNumWords(type->subtype);
+	for (int index = 0; index < type->num_elem && position < list.size();
+			index++)
+		fillObject(type->subtype, list, position, words,
+				offset + index * size, name);
+}
+
+// Fill the words of an object at 'offset' in 'words' from the initializer
+// at 'position' in 'list', as in C: a list between braces initializes a
+// whole array, and the elements of an array whose braces are left out are
+// taken from the enclosing list.
+static void fillObject(Type *type, const std::vector<Initializer *> &list,
+		size_t &position, std::vector<long long> &words, size_t offset,
+		const std::string &name)
+{
+	Initializer *initializer = list[position++];
+	if (type->getKind() == Type::KindArray && !initializer->elements)
+	{
+		position--;
+		fillArray(type, list, position, words, offset, name);
+		return;
+	}
+	if (type->getKind() == Type::KindArray)
+	{
+		size_t inner = 0;
+		fillArray(type, *initializer->elements, inner, words, offset, name);
+		if (inner < initializer->elements->size())
+		{
+			throw ParseError("error: too many initializers for '" +
+					name + "'");
+		}
+		return;
+	}
+
+	// Scalars may be between braces
+	while (initializer->elements)
+	{
+		if (initializer->elements->size() != 1)
+		{
+			throw ParseError("error: too many initializers for '" +
+					name + "'");
+		}
+		initializer = initializer->elements->front();
+	}
+	words[offset] = initializer->value;
+}
+
+// Return the LLVM constant of a type holding the words from 'offset'
+static llvm::Constant *getConstant(Type *type,
+		const std::vector<long long> &words, size_t &offset)
+{
+	if (type->getKind() != Type::KindArray)
+		return llvm::ConstantInt::get(type->lltype, words[offset++], true);
+	std::vector<llvm::Constant *> elements;
+	for (int index = 0; index < type->num_elem; index++)
+		elements.push_back(getConstant(type->subtype, words, offset));
+	return llvm::ConstantArray::get(llvm::cast<llvm::ArrayType>(type->lltype),
+			elements);
+}
+
+// Return the LLVM constant initializing a variable of the given type.
+// Integers and arrays of integers can be initialized.
+static llvm::Constant *getInitializer(Type *type, Initializer *initializer,
+		const std::string &name)
+{
+	Type *element_type = type;
+	while (element_type->getKind() == Type::KindArray)
+		element_type = element_type->subtype;
+	if ((element_type->getKind() != Type::KindBool &&
+			element_type->getKind() != Type::KindShort &&
+			element_type->getKind() != Type::KindInt) ||
+			(type->getKind() == Type::KindArray && !initializer->elements))
+	{
+		throw ParseError("error: invalid initializer for '" + name + "'");
+	}
+	std::vector<long long> words(getNumWords(type));
+	std::vector<Initializer *> list(1, initializer);
+	size_t position = 0;
+	fillObject(type, list, position, words, 0, name);
+	size_t offset = 0;
+	return getConstant(type, words, offset);
+}
+}
+
+%define api.pure
+%parse-param { ParserContext *context }
+%parse-param { void *scanner }
+%lex-param { void *scanner }
 
 %token TokenBool
 %token TokenShort
@@ -41,6 +157,7 @@ std::list<SymbolTable *> environment;
 %token TokenFloat
 %token TokenVoid
 %token TokenStruct
+%token TokenConst
 %token<name> TokenId
 %token<value> TokenNumber
 %token TokenOpenCurly
@@ -74,6 +191,9 @@ std::list<SymbolTable *> environment;
 %type<type> Type
 %type<type> Pointer
 %type<indices> Indices
+%type<initializer> Initializer
+%type<initializer> InitializerValue
+%type<initializers> InitializerList
 %type<llvalue> Expression
 %type<lvalue> LValue
 %type<if_statement> IfStatement
@@ -90,6 +210,10 @@ std::list<SymbolTable *> environment;
 	Type *type;
 	std::list<int> *indices;
 
+	// For 'Initializer', 'InitializerValue' and 'InitializerList'
+	Initializer *initializer;
+	std::vector<Initializer *> *initializers;
+
 	// For LValue
 	struct {
 		Type *type;
@@ -135,10 +259,10 @@ Start:
 Declarations:
 	| Declarations Declaration
 Declaration:
-	Pointer TokenId Indices TokenSemicolon
+	Pointer TokenId Indices Initializer TokenSemicolon
 {
 	// Get top symbol table
-	SymbolTable *symbol_table = environment.back();
+	SymbolTable *symbol_table = context->environment.back();
 	
 	// Create new symbol
 	Symbol *symbol = new Symbol($2);
@@ -154,20 +278,36 @@ Declaration:
 		type->lltype = llvm::ArrayType::get(symbol->type->lltype, index);
 		symbol->type = type;
 	}	
+
+	// Only global variables are initialized, and constants must be
+	if ($4 && symbol_table->getScope() != SymbolTable::ScopeGlobal)
+	{
+		throw ParseError("error: initializer of non-global variable '" +
+				symbol->getName() + "' not supported");
+	}
+	if (!$4 && $1->is_constant &&
+			symbol_table->getScope() != SymbolTable::ScopeStruct)
+	{
+		throw ParseError("error: uninitialized constant '" +
+				symbol->getName() + "'");
+	}
 	
-	// Symbol in global scope
+	// Symbol in global scope. Constant arrays with an initializer become
+	// ROMs.
 	if (symbol_table->getScope() == SymbolTable::ScopeGlobal)
 		symbol->lladdress = new llvm::GlobalVariable(
-		*module,
+		*context->module,
 		symbol->type->lltype,
-		false,
+		$1->is_constant,
 		llvm::GlobalValue::ExternalLinkage,
-		nullptr,
+		$4 ? getInitializer(symbol->type, $4, symbol->getName()) : nullptr,
 		symbol->getName());
-		// Symbol in local scope
+		// Symbol in local scope. Arrays are named after their symbol, so
+		// that the code generator can refer to them.
 		else if (symbol_table->getScope() == SymbolTable::ScopeLocal)
-		symbol->lladdress = builder->CreateAlloca(symbol->type->lltype,
-		nullptr, Symbol::getTemp());
+		symbol->lladdress = context->builder->CreateAlloca(symbol->type->lltype,
+		nullptr, symbol->type->getKind() == Type::KindArray ?
+		symbol->getName() : context->getTemp());
 		// Insert in symbol table
 		symbol_table->addSymbol(symbol);
 }
@@ -175,20 +315,20 @@ Declaration:
 {
 	// Push new local symbol table
 	SymbolTable *symbol_table = new SymbolTable(SymbolTable::ScopeLocal);
-	environment.push_back(symbol_table);
+	context->environment.push_back(symbol_table);
 	// Current LLVM function
-	function = llvm::cast<llvm::Function>($1->lladdress);
+	context->function = llvm::cast<llvm::Function>($1->lladdress);
 	// Create entry basic block
-	basic_block = llvm::BasicBlock::Create(
-	llvm::getGlobalContext(),
-	Symbol::getBasicBlock(),
-	function);
-	builder->SetInsertPoint(basic_block);
+	context->basic_block = llvm::BasicBlock::Create(
+	context->llvm_context,
+	context->getBasicBlock(),
+	context->function);
+	context->builder->SetInsertPoint(context->basic_block);
 	
 	// Add arguments to the stack
 	int index = 0;
-	for (llvm::Function::arg_iterator it = function->arg_begin(),
-		end = function->arg_end();
+	for (llvm::Function::arg_iterator it = context->function->arg_begin(),
+		end = context->function->arg_end();
 		it != end;
 	++it)
 	{
@@ -200,20 +340,20 @@ Declaration:
 	symbol->type = argument->type;
 	symbol_table->addSymbol(symbol);
 	// Emit 'alloca' instruction
-	symbol->lladdress = builder->CreateAlloca(symbol->type->lltype,
-	nullptr, Symbol::getTemp());
+	symbol->lladdress = context->builder->CreateAlloca(symbol->type->lltype,
+	nullptr, context->getTemp());
 	// Emit 'store' instruction
-	builder->CreateStore(it, symbol->lladdress);
+	context->builder->CreateStore(it, symbol->lladdress);
 	}
 }
 	Declarations Statements TokenCloseCurly
 {
 	// Return statement, if not present
-	if (!basic_block->getTerminator())
-		builder->CreateRetVoid();
+	if (!context->basic_block->getTerminator())
+		context->builder->CreateRetVoid();
 	// Pop local symbol table
-	SymbolTable *symbol_table = environment.back();
-	environment.pop_back();
+	SymbolTable *symbol_table = context->environment.back();
+	context->environment.pop_back();
 }
 	| FunctionDeclaration TokenSemicolon
 FunctionDeclaration:
@@ -228,7 +368,7 @@ FunctionDeclaration:
 	symbol->type = type;
 	$$ = symbol;
 	// Add to global symbol table
-	SymbolTable *symbol_table = environment.front();
+	SymbolTable *symbol_table = context->environment.front();
 	symbol_table->addSymbol(symbol);
 	// Create function type
 	std::vector<llvm::Type *> types;
@@ -239,7 +379,7 @@ FunctionDeclaration:
 		types,
 		false);
 	// Insert function
-	symbol->lladdress = module->getOrInsertFunction($2,
+	symbol->lladdress = context->module->getOrInsertFunction($2,
 	function_type);
 }
 FormalArguments:
@@ -264,6 +404,46 @@ FormalArgumentsComma:
 	symbol->index = $1->size();
 	$$->push_back(symbol);
 }
+Initializer:
+{
+	$$ = nullptr;
+}
+	| TokenEqual InitializerValue
+{
+	$$ = $2;
+}
+InitializerValue:
+	TokenNumber
+{
+	$$ = new Initializer();
+	$$->value = $1;
+}
+	| TokenMinus TokenNumber
+{
+	$$ = new Initializer();
+	$$->value = -$2;
+}
+	| TokenOpenCurly InitializerList TokenCloseCurly
+{
+	$$ = new Initializer();
+	$$->elements = $2;
+}
+	| TokenOpenCurly InitializerList TokenComma TokenCloseCurly
+{
+	$$ = new Initializer();
+	$$->elements = $2;
+}
+InitializerList:
+	InitializerValue
+{
+	$$ = new std::vector<Initializer *>();
+	$$->push_back($1);
+}
+	| InitializerList TokenComma InitializerValue
+{
+	$$ = $1;
+	$$->push_back($3);
+}
 Indices:
 {
 	$$ = new std::list<int>();
@@ -277,6 +457,11 @@ Pointer:
 	Type
 {
 	$$ = $1;
+}
+	| TokenConst Type
+{
+	$$ = $2;
+	$$->is_constant = true;
 }
 	| Pointer TokenMult
 {
@@ -288,33 +473,33 @@ Type:
 	TokenBool
 	{
 	$$ = new Type(Type::KindBool);
-	$$->lltype = llvm::Type::getInt1Ty(llvm::getGlobalContext());
+	$$->lltype = llvm::Type::getInt1Ty(context->llvm_context);
 	}
 	| TokenShort
 	{
 	$$ = new Type(Type::KindShort);
-	$$->lltype = llvm::Type::getInt16Ty(llvm::getGlobalContext());
+	$$->lltype = llvm::Type::getInt16Ty(context->llvm_context);
 	}
 	| TokenInt
 	{
 	$$ = new Type(Type::KindInt);
-	$$->lltype = llvm::Type::getInt32Ty(llvm::getGlobalContext());
+	$$->lltype = llvm::Type::getInt32Ty(context->llvm_context);
 	}
 	| TokenFloat
 	{
 	$$ = new Type(Type::KindFloat);
-	$$->lltype = llvm::Type::getFloatTy(llvm::getGlobalContext());
+	$$->lltype = llvm::Type::getFloatTy(context->llvm_context);
 }
 	| TokenVoid
 	{
 	$$ = new Type(Type::KindVoid);
-	$$->lltype = llvm::Type::getVoidTy(llvm::getGlobalContext());
+	$$->lltype = llvm::Type::getVoidTy(context->llvm_context);
 	}
 	| TokenStruct TokenOpenCurly
 	{
 	// Push new symbol table to environment
 	SymbolTable *symbol_table = new SymbolTable(SymbolTable::ScopeStruct);
-	environment.push_back(symbol_table);
+	context->environment.push_back(symbol_table);
 	// Create type
 	$<type>$ = new Type(Type::KindStruct);
 	$<type>$->symbol_table = symbol_table;
@@ -324,12 +509,12 @@ Declarations TokenCloseCurly
 	// Forward type
 	$$ = $<type>3;
 	// LLVM structure
-	SymbolTable *symbol_table = environment.back();
+	SymbolTable *symbol_table = context->environment.back();
 	std::vector<llvm::Type *> lltypes;
 	symbol_table->getLLVMTypes(lltypes);
-	$$->lltype = llvm::StructType::create(llvm::getGlobalContext(), lltypes);
+	$$->lltype = llvm::StructType::create(context->llvm_context, lltypes);
 	// Pop symbol table from environment
-	environment.pop_back();
+	context->environment.pop_back();
 }
 Statements:
 	| Statements Statement
@@ -339,16 +524,15 @@ Statement:
 	{
 
 	// Return statement, if not present
-	if (!basic_block->getTerminator()){
+	if (!context->basic_block->getTerminator()){
 		
 		// Check if the declared function return value type match the "return" value type
-		if($2->getType() != module->begin()->getReturnType())
+		if($2->getType() != context->module->begin()->getReturnType())
 		{
-			std::cerr << "error: the declared function type does not match the return value type\n";
-			exit(1);
+			throw ParseError("error: the declared function type does not match the return value type");
 		}
 
-		builder->CreateRet($2);
+		context->builder->CreateRet($2);
 	}
 
 	
@@ -358,38 +542,45 @@ Statement:
 		// Check valid pointer
 		if (!$2->getType()->isPointerTy())
 		{
-			std::cerr << "error: expression is not a pointer\n";
-			exit(1);
+			throw ParseError("error: expression is not a pointer");
 		}
 		// Emit store
-		builder->CreateStore($4, $2);
+		context->builder->CreateStore($4, $2);
 	}
 	| LValue TokenEqual Expression TokenSemicolon
 	{
+		// Constants are read-only
+		llvm::GlobalVariable *global = llvm::dyn_cast<llvm::GlobalVariable>(
+		$1.lladdress);
+		if (global && global->isConstant())
+		{
+			throw ParseError("error: assignment of constant '" +
+					global->getName().str() + "'");
+		}
 		llvm::Value *lladdress = $1.llindices->size() > 1 ?
-		builder->CreateGEP($1.lladdress, *$1.llindices,
-		Symbol::getTemp()) :
+		context->builder->CreateGEP($1.lladdress, *$1.llindices,
+		context->getTemp()) :
 		$1.lladdress;
-		builder->CreateStore($3, lladdress);
+		context->builder->CreateStore($3, lladdress);
 	}
 	| TokenOpenCurly
 	{
 		// Push new local symbol table
 		SymbolTable *symbol_table = new SymbolTable(SymbolTable::ScopeLocal);
-		environment.push_back(symbol_table);
+		context->environment.push_back(symbol_table);
 	}
 	Declarations Statements TokenCloseCurly
 	{
 		// Pop symbol table
-		environment.pop_back();
+		context->environment.pop_back();
 	}
 	| IfStatement %prec TokenThen
 	{
 		// Emit unconditional to 'end' basic block
-		builder->CreateBr($1.end_basic_block);
+		context->builder->CreateBr($1.end_basic_block);
 		// Move to 'end' basic block
-		basic_block = $1.end_basic_block;
-		builder->SetInsertPoint(basic_block);
+		context->basic_block = $1.end_basic_block;
+		context->builder->SetInsertPoint(context->basic_block);
 	}
 	| IfStatement TokenElse
 	{
@@ -397,82 +588,82 @@ Statement:
 		$<if_statement>$.then_basic_block = $1.then_basic_block;
 		$<if_statement>$.else_basic_block = $1.else_basic_block;
 		$<if_statement>$.end_basic_block = llvm::BasicBlock::Create(
-		llvm::getGlobalContext(),
-		Symbol::getBasicBlock(),
-		function);
+		context->llvm_context,
+		context->getBasicBlock(),
+		context->function);
 		// Emit unconditional branch to 'end' basic block
-		builder->CreateBr($<if_statement>$.end_basic_block);
+		context->builder->CreateBr($<if_statement>$.end_basic_block);
 		// Move to 'else' basic block
-		basic_block = $<if_statement>$.else_basic_block;
-		builder->SetInsertPoint(basic_block);
+		context->basic_block = $<if_statement>$.else_basic_block;
+		context->builder->SetInsertPoint(context->basic_block);
 	}
 	Statement
 	{
 		// Emit unconditional branch to 'end' basic block
-		builder->CreateBr($<if_statement>3.end_basic_block);
+		context->builder->CreateBr($<if_statement>3.end_basic_block);
 		// Move to 'end' basic block
-		basic_block = $<if_statement>3.end_basic_block;
-		builder->SetInsertPoint(basic_block);
+		context->basic_block = $<if_statement>3.end_basic_block;
+		context->builder->SetInsertPoint(context->basic_block);
 	}
 	| TokenWhile
 	{
 		// Create 'cond', 'body', and 'end' basic blocks
 		$<while_statement>$.cond_basic_block = llvm::BasicBlock::Create(
-		llvm::getGlobalContext(),
-		Symbol::getBasicBlock(),
-		function);
+		context->llvm_context,
+		context->getBasicBlock(),
+		context->function);
 		$<while_statement>$.body_basic_block = llvm::BasicBlock::Create(
-		llvm::getGlobalContext(),
-		Symbol::getBasicBlock(),
-		function);
+		context->llvm_context,
+		context->getBasicBlock(),
+		context->function);
 		$<while_statement>$.end_basic_block = llvm::BasicBlock::Create(
-		llvm::getGlobalContext(),
-		Symbol::getBasicBlock(),
-		function);
+		context->llvm_context,
+		context->getBasicBlock(),
+		context->function);
 		// Emit unconditional branch
-		builder->CreateBr($<while_statement>$.cond_basic_block);
+		context->builder->CreateBr($<while_statement>$.cond_basic_block);
 		// Continue in 'cond' basic block
-		basic_block = $<while_statement>$.cond_basic_block;
-		builder->SetInsertPoint(basic_block);
+		context->basic_block = $<while_statement>$.cond_basic_block;
+		context->builder->SetInsertPoint(context->basic_block);
 	}
 	TokenOpenPar Expression TokenClosePar
 	{
 		// Emit conditional branch
-		builder->CreateCondBr($4,
+		context->builder->CreateCondBr($4,
 		$<while_statement>2.body_basic_block,
 		$<while_statement>2.end_basic_block);
 		// Continue in 'body' basic block
-		basic_block = $<while_statement>2.body_basic_block;
-		builder->SetInsertPoint(basic_block);
+		context->basic_block = $<while_statement>2.body_basic_block;
+		context->builder->SetInsertPoint(context->basic_block);
 	}
 	Statement
 	{
 		// Emit unconditional branch
-		builder->CreateBr($<while_statement>2.cond_basic_block);
+		context->builder->CreateBr($<while_statement>2.cond_basic_block);
 		// Continue in 'end' basic block
-		basic_block = $<while_statement>2.end_basic_block;
-		builder->SetInsertPoint(basic_block);
+		context->basic_block = $<while_statement>2.end_basic_block;
+		context->builder->SetInsertPoint(context->basic_block);
 	}
 IfStatement:
 	TokenIf TokenOpenPar Expression TokenClosePar
 		{
 		// Create 'if' and 'else' basic blocks, assume 'end' is same as 'else'.
 		$<if_statement>$.then_basic_block = llvm::BasicBlock::Create(
-		llvm::getGlobalContext(),
-		Symbol::getBasicBlock(),
-		function);
+		context->llvm_context,
+		context->getBasicBlock(),
+		context->function);
 		$<if_statement>$.else_basic_block = llvm::BasicBlock::Create(
-		llvm::getGlobalContext(),
-		Symbol::getBasicBlock(),
-		function);
+		context->llvm_context,
+		context->getBasicBlock(),
+		context->function);
 		$<if_statement>$.end_basic_block = $<if_statement>$.else_basic_block;
 		// Emit conditional branch
-		builder->CreateCondBr($3,
+		context->builder->CreateCondBr($3,
 		$<if_statement>$.then_basic_block,
 		$<if_statement>$.else_basic_block);
 		// Continue in 'then' basic block
-		basic_block = $<if_statement>$.then_basic_block;
-		builder->SetInsertPoint(basic_block);
+		context->basic_block = $<if_statement>$.then_basic_block;
+		context->builder->SetInsertPoint(context->basic_block);
 		}
 	Statement
 	{
@@ -484,14 +675,14 @@ Expression:
 	LValue
 	{
 		llvm::Value *lladdress = $1.llindices->size() > 1 ?
-		builder->CreateGEP($1.lladdress, *$1.llindices,
-		Symbol::getTemp()) :
+		context->builder->CreateGEP($1.lladdress, *$1.llindices,
+		context->getTemp()) :
 		$1.lladdress;
-		$$ = builder->CreateLoad(lladdress, Symbol::getTemp());
+		$$ = context->builder->CreateLoad(lladdress, context->getTemp());
 	}
 	| TokenNumber
 	{
-		llvm::Type *lltype = llvm::Type::getInt32Ty(llvm::getGlobalContext());
+		llvm::Type *lltype = llvm::Type::getInt32Ty(context->llvm_context);
 		$$ = llvm::ConstantInt::get(lltype, $1);
 	}
 	| TokenMult Expression
@@ -499,57 +690,56 @@ Expression:
 		// Check valid pointer
 		if (!$2->getType()->isPointerTy())
 		{
-			std::cerr << "error: expression is not a pointer\n";
-			exit(1);
+			throw ParseError("error: expression is not a pointer");
 		}
 		// Emit load
-		$$ = builder->CreateLoad($2, Symbol::getTemp());
+		$$ = context->builder->CreateLoad($2, context->getTemp());
 	}
 	| TokenMinus Expression
 	{
-		llvm::Type *lltype = llvm::Type::getInt32Ty(llvm::getGlobalContext());
+		llvm::Type *lltype = llvm::Type::getInt32Ty(context->llvm_context);
 		llvm::Value *llvalue = llvm::ConstantInt::get(lltype, 0);
-		$$ = builder->CreateBinOp(llvm::Instruction::Sub, llvalue, $2, Symbol::getTemp());
+		$$ = context->builder->CreateBinOp(llvm::Instruction::Sub, llvalue, $2, context->getTemp());
 	}
 	| Expression TokenPlus Expression
 	{
-		$$ = builder->CreateBinOp(llvm::Instruction::Add, $1, $3,
-		Symbol::getTemp());
+		$$ = context->builder->CreateBinOp(llvm::Instruction::Add, $1, $3,
+		context->getTemp());
 	}
 	| Expression TokenMinus Expression
 	{
-		$$ = builder->CreateBinOp(llvm::Instruction::Sub, $1, $3,
-		Symbol::getTemp());
+		$$ = context->builder->CreateBinOp(llvm::Instruction::Sub, $1, $3,
+		context->getTemp());
 	}
 	| Expression TokenLogicalShiftRight Expression
 	{
-		$$ = builder->CreateBinOp(llvm::Instruction::LShr, $1, $3,
-		Symbol::getTemp());
+		$$ = context->builder->CreateBinOp(llvm::Instruction::LShr, $1, $3,
+		context->getTemp());
 	}
 	| Expression TokenBitwiseAnd Expression
 	{
-		$$ = builder->CreateBinOp(llvm::Instruction::And, $1, $3,
-		Symbol::getTemp());
+		$$ = context->builder->CreateBinOp(llvm::Instruction::And, $1, $3,
+		context->getTemp());
 	}
 	| Expression TokenBitwiseXor Expression
 	{
-		$$ = builder->CreateBinOp(llvm::Instruction::Xor, $1, $3,
-		Symbol::getTemp());
+		$$ = context->builder->CreateBinOp(llvm::Instruction::Xor, $1, $3,
+		context->getTemp());
 	}
 	| Expression TokenBitwiseOr Expression
 	{
-		$$ = builder->CreateBinOp(llvm::Instruction::Or, $1, $3,
-		Symbol::getTemp());
+		$$ = context->builder->CreateBinOp(llvm::Instruction::Or, $1, $3,
+		context->getTemp());
 	}
 	| Expression TokenMult Expression
 	{
-		$$ = builder->CreateBinOp(llvm::Instruction::Mul, $1, $3,
-		Symbol::getTemp());
+		$$ = context->builder->CreateBinOp(llvm::Instruction::Mul, $1, $3,
+		context->getTemp());
 	}
 	| Expression TokenDiv Expression
 	{
-		$$ = builder->CreateBinOp(llvm::Instruction::SDiv, $1, $3,
-		Symbol::getTemp());
+		$$ = context->builder->CreateBinOp(llvm::Instruction::SDiv, $1, $3,
+		context->getTemp());
 	}
 	| TokenOpenPar Expression TokenClosePar
 	{
@@ -557,60 +747,60 @@ Expression:
 	}
 	| Expression TokenGreaterThan Expression
 	{
-		$$ = builder->CreateICmpSGT($1, $3, Symbol::getTemp());
+		$$ = context->builder->CreateICmpSGT($1, $3, context->getTemp());
 	}
 	| Expression TokenLessThan Expression
 	{
-		$$ = builder->CreateICmpSLT($1, $3, Symbol::getTemp());
+		$$ = context->builder->CreateICmpSLT($1, $3, context->getTemp());
 	}
 	| Expression TokenGreaterEqual Expression
 	{
-		$$ = builder->CreateICmpSGE($1, $3, Symbol::getTemp());
+		$$ = context->builder->CreateICmpSGE($1, $3, context->getTemp());
 	}
 	| Expression TokenLessEqual Expression
 	{
-		$$ = builder->CreateICmpSLE($1, $3, Symbol::getTemp());
+		$$ = context->builder->CreateICmpSLE($1, $3, context->getTemp());
 	}
 	| Expression TokenDoubleEqual Expression
 	{
-		$$ = builder->CreateICmpEQ($1, $3, Symbol::getTemp());
+		$$ = context->builder->CreateICmpEQ($1, $3, context->getTemp());
 	}
 	| Expression TokenNotEqual Expression
 	{
-		$$ = builder->CreateICmpNE($1, $3, Symbol::getTemp());
+		$$ = context->builder->CreateICmpNE($1, $3, context->getTemp());
 	}
 	| Expression TokenLogicalOr
 	{
 		// Save current basic block
-		$<logical>$.lhs_basic_block = basic_block;
+		$<logical>$.lhs_basic_block = context->basic_block;
 		// Create RHS and end basic blocks
 		$<logical>$.rhs_basic_block = llvm::BasicBlock::Create(
-		llvm::getGlobalContext(),
-		Symbol::getBasicBlock(),
-		function);
+		context->llvm_context,
+		context->getBasicBlock(),
+		context->function);
 		$<logical>$.end_basic_block = llvm::BasicBlock::Create(
-		llvm::getGlobalContext(),
-		Symbol::getBasicBlock(),
-		function);
+		context->llvm_context,
+		context->getBasicBlock(),
+		context->function);
 		// Emit conditional branch
-		builder->CreateCondBr($1,
+		context->builder->CreateCondBr($1,
 		$<logical>$.end_basic_block,
 		$<logical>$.rhs_basic_block);
 		// Set current basic block to RHS
-		basic_block = $<logical>$.rhs_basic_block;
-		builder->SetInsertPoint(basic_block);
+		context->basic_block = $<logical>$.rhs_basic_block;
+		context->builder->SetInsertPoint(context->basic_block);
 	}
 	Expression
 	{
 		// Emit unconditional branch
-		builder->CreateBr($<logical>3.end_basic_block);
+		context->builder->CreateBr($<logical>3.end_basic_block);
 		// Move to end basic block
-		basic_block = $<logical>3.end_basic_block;
-		builder->SetInsertPoint(basic_block);
+		context->basic_block = $<logical>3.end_basic_block;
+		context->builder->SetInsertPoint(context->basic_block);
 		// Emit phi instruction
-		llvm::PHINode *phi = builder->CreatePHI(
-		llvm::IntegerType::getInt1Ty(llvm::getGlobalContext()),
-		2, Symbol::getTemp());
+		llvm::PHINode *phi = context->builder->CreatePHI(
+		llvm::IntegerType::getInt1Ty(context->llvm_context),
+		2, context->getTemp());
 		phi->addIncoming($1, $<logical>3.lhs_basic_block);
 		phi->addIncoming($4, $<logical>3.rhs_basic_block);
 		$$ = phi;
@@ -618,35 +808,35 @@ Expression:
 	| Expression TokenLogicalAnd
 	{
 		// Save current basic block
-		$<logical>$.lhs_basic_block = basic_block;
+		$<logical>$.lhs_basic_block = context->basic_block;
 		// Create RHS and end basic blocks
 		$<logical>$.rhs_basic_block = llvm::BasicBlock::Create(
-		llvm::getGlobalContext(),
-		Symbol::getBasicBlock(),
-		function);
+		context->llvm_context,
+		context->getBasicBlock(),
+		context->function);
 		$<logical>$.end_basic_block = llvm::BasicBlock::Create(
-		llvm::getGlobalContext(),
-		Symbol::getBasicBlock(),
-		function);
+		context->llvm_context,
+		context->getBasicBlock(),
+		context->function);
 		// Emit conditional branch
-		builder->CreateCondBr($1,
+		context->builder->CreateCondBr($1,
 		$<logical>$.rhs_basic_block,
 		$<logical>$.end_basic_block);
 		// Set current basic block to RHS
-		basic_block = $<logical>$.rhs_basic_block;
-		builder->SetInsertPoint(basic_block);
+		context->basic_block = $<logical>$.rhs_basic_block;
+		context->builder->SetInsertPoint(context->basic_block);
 	}
 	Expression
 	{
 		// Emit unconditional branch
-		builder->CreateBr($<logical>3.end_basic_block);
+		context->builder->CreateBr($<logical>3.end_basic_block);
 		// Move to end basic block
-		basic_block = $<logical>3.end_basic_block;
-		builder->SetInsertPoint(basic_block);
+		context->basic_block = $<logical>3.end_basic_block;
+		context->builder->SetInsertPoint(context->basic_block);
 		// Emit phi instruction
-		llvm::PHINode *phi = builder->CreatePHI(
-		llvm::IntegerType::getInt1Ty(llvm::getGlobalContext()),
-		2, Symbol::getTemp());
+		llvm::PHINode *phi = context->builder->CreatePHI(
+		llvm::IntegerType::getInt1Ty(context->llvm_context),
+		2, context->getTemp());
 		phi->addIncoming($1, $<logical>3.lhs_basic_block);
 		phi->addIncoming($4, $<logical>3.rhs_basic_block);
 		$$ = phi;
@@ -654,19 +844,18 @@ Expression:
 	| TokenId TokenOpenPar ActualArguments TokenClosePar
 	{
 		// Search function in global scope
-		SymbolTable *symbol_table = environment.front();
+		SymbolTable *symbol_table = context->environment.front();
 		Symbol *symbol = symbol_table->getSymbol($1);
 		// Undeclared, or not a function
 		if (!symbol || symbol->type->getKind() != Type::KindFunction)
 		{
-			std::cerr << "Identifier is not a function: " << $1 << '\n';
-			exit(1);
+			throw ParseError(std::string("Identifier is not a function: ") + $1);
 		}
 		// Invoke
-		$$ = builder->CreateCall(symbol->lladdress,
+		$$ = context->builder->CreateCall(symbol->lladdress,
 		*$3,
 		symbol->type->rettype->getKind() == Type::KindVoid ?
-		"" : Symbol::getTemp());
+		"" : context->getTemp());
 	}
 	ActualArguments:
 	{
@@ -691,8 +880,8 @@ LValue:
 	{
 	// Search symbol in environment, from the top to the bottom
 	Symbol *symbol = nullptr;
-	for (auto it = environment.rbegin();
-		it != environment.rend();
+	for (auto it = context->environment.rbegin();
+		it != context->environment.rend();
 		++it)
 	{
 		SymbolTable *symbol_table = *it;
@@ -703,15 +892,14 @@ LValue:
 	// Undeclared
 	if (!symbol)
 	{
-		std::cerr << "Undeclared identifier: " << $1 << '\n';
-		exit(1);
+		throw ParseError(std::string("Undeclared identifier: ") + $1);
 	}
 	// Save info
 	$$.type = symbol->type;
 	$$.lladdress = symbol->lladdress;
 	$$.llindices = new std::vector<llvm::Value *>();
 	// Add initial index set to 0
-	llvm::Type *lltype = llvm::Type::getInt32Ty(llvm::getGlobalContext());
+	llvm::Type *lltype = llvm::Type::getInt32Ty(context->llvm_context);
 	llvm::Value *llindex = llvm::ConstantInt::get(lltype, 0);
 	$$.llindices->push_back(llindex);
 	}
@@ -720,8 +908,7 @@ LValue:
 	// Check that L-value is array
 	if ($1.type->getKind() != Type::KindArray)
 	{
-		std::cerr << "L-value is not an array\n";
-		exit(1);
+		throw ParseError("L-value is not an array");
 	}
 	// Add index
 	$$.llindices = $1.llindices;
@@ -735,18 +922,16 @@ LValue:
 	// Check that L-value is a structure
 	if ($1.type->getKind() != Type::KindStruct)
 	{
-		std::cerr << "L-value is not a struct\n";
-		exit(1);
+		throw ParseError("L-value is not a struct");
 	}
 	// Find symbol in structure
 	Symbol *symbol = $1.type->symbol_table->getSymbol($3);
 	if (!symbol)
 	{
-		std::cerr << "Invalid field: " << $3 << '\n';
-		exit(1);
+		throw ParseError(std::string("Invalid field: ") + $3);
 	}
 	// Add index
-	llvm::Type *lltype = llvm::Type::getInt32Ty(llvm::getGlobalContext());
+	llvm::Type *lltype = llvm::Type::getInt32Ty(context->llvm_context);
 	llvm::Value *llindex = llvm::ConstantInt::get(lltype, symbol->index);
 	$$.llindices = $1.llindices;
 	$$.llindices->push_back(llindex);
@@ -756,40 +941,47 @@ LValue:
 	}
 %%
 
-int main(int argc, char **argv)
+llvm::Module *parseFile(const std::string &file_name,
+		llvm::LLVMContext &llvm_context)
 {
-	// Syntax
-	if (argc != 2)
-	{
-		std::cerr << "Syntax: ./main <file>\n";
-		exit(1);
-	}
-	// Open file in 'yyin'
-	yyin = fopen(argv[1], "r");
-	if (!yyin)
+	// Open file
+	FILE *file = fopen(file_name.c_str(), "r");
+	if (!file)
 	{
-		std::cerr << "Cannot open file\n";
-		exit(1);
+		throw ParseError("Cannot open file: " + file_name);
 	}
-	// LLVM context, builder, and module
-	llvm::LLVMContext &context = llvm::getGlobalContext();
-	builder = new llvm::IRBuilder<>(context);
-	module = new llvm::Module("TestModule", context);
+	// Parser state, with a new LLVM module
+	ParserContext context(llvm_context);
 	// Push global symbol table to environment
 	SymbolTable *global_symbol_table = new SymbolTable(SymbolTable::ScopeGlobal);
-	environment.push_back(global_symbol_table);
-	// Parse input until there is no more
-	do
+	context.environment.push_back(global_symbol_table);
+	// Scanner reading from the file
+	void *scanner;
+	yylex_init(&scanner);
+	yyset_in(file, scanner);
+	// Parse input until there is no more. On errors, the scanner, the
+	// file and the module are released before the error is passed on.
+	try
+	{
+		do
+		{
+			yyparse(&context, scanner);
+		} while (!feof(file));
+	}
+	catch (const ParseError &)
 	{
-		yyparse();
-	} while (!feof(yyin));
-	// Dump module
-	module->dump();
-return 0;
+		yylex_destroy(scanner);
+		fclose(file);
+		delete context.module;
+		throw;
+	}
+	// Release scanner, the caller owns the module
+	yylex_destroy(scanner);
+	fclose(file);
+	return context.module;
 }
 
-void yyerror(const char *s)
+void yyerror(ParserContext *context, void *scanner, const char *s)
 {
-	std::cerr << s << std::endl;
-	exit(1);
+	throw ParseError(s);
 }
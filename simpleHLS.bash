@@ -6,4 +6,4 @@
 cfile=$1
 file="${cfile%.*}"
 ./parser/parser "$file".c 2>&1 | opt -mem2reg | llvm-dis &> "$file".ll
-cat "$file".ll | opt -load ./codegen/verilog.so -verilog -o "$file".v &> "$file".v
\ No newline at end of file
+opt -load ./codegen/verilog.so -verilog -verilog-output "$file".v -o /dev/null "$file".ll
\ No newline at end of file